@@ -55,6 +55,8 @@ fi
 BUILD_MODE="release"
 BUILD_VERBOSE=0
 BUILD_JOB_COUNT=0
+BUILD_A2M_CONVERTER=0
+BUILD_TOOLS=0
 
 # read/evaluate floor_conf.hpp to know which build configuration should be used (must match the floor one!)
 eval $(printf "" | ${CXX} -E -dM ${INCLUDES} -isystem /usr/include -isystem /usr/local/include -include floor/floor/floor_conf.hpp - 2>&1 | grep -E "define FLOOR_" | sed -E "s/.*define (.*) [\"]*([^ \"]*)[\"]*/export \1=\2/g")
@@ -96,6 +98,10 @@ for arg in "$@"; do
 			echo "	debug              builds this project in debug mode"
 			echo "	clean              cleans all build binaries and intermediate build files"
 			echo ""
+			echo "additional targets:"
+			echo "	a2m_converter      also builds the offline .a2m model converter (bin/a2m_converter)"
+			echo "	tools              also builds all check and benchmark programs in tools/ (bin/<tool name>)"
+			echo ""
 			echo "build configuration:"
 			#echo "	libstdc++          use the libstdc++ library instead of libc++ (unsupported)"
 			echo "	x32                build a 32-bit binary "$(if [ "${BUILD_ARCH_SIZE}" == "x32" ]; then printf "(default on this platform)"; fi)
@@ -121,6 +127,12 @@ for arg in "$@"; do
 		"clean")
 			BUILD_MODE="clean"
 			;;
+		"a2m_converter")
+			BUILD_A2M_CONVERTER=1
+			;;
+		"tools")
+			BUILD_TOOLS=1
+			;;
 		"-v")
 			BUILD_VERBOSE=1
 			;;
@@ -252,6 +264,13 @@ SRC_DIR="src"
 # all source code sub-directories, relative to SRC_DIR
 SRC_SUB_DIRS=". gui gui/compound gui/objects gui/style particle rendering rendering/renderer rendering/renderer/gl3 rendering/renderer/gles2 rendering/renderer/gles3 scene scene/model"
 
+# check and benchmark programs in tools/<name>/<name>.cpp (built with the "tools" option)
+TOOLS_LIST="render_queue_bench range_allocator_check occlusion_buffer_bench task_scheduler_bench frame_allocator_bench light_clusters_bench generate_normals_bench bvh_bench alpha_sort_bench gl_state_check vertex_packing_check mesh_optimizer_check a2m_load_bench shader_var_bench"
+# frame_sync_check creates a headless gl context via egl (linux/mesa only)
+if [ $BUILD_OS == "linux" ]; then
+	TOOLS_LIST="${TOOLS_LIST} frame_sync_check"
+fi
+
 # build directory where all temporary files are stored (*.o, etc.)
 BUILD_DIR=build
 
@@ -682,6 +701,10 @@ case ${BUILD_MODE} in
 		# delete the target binary and the complete build folder (all object files)
 		info "cleaning ..."
 		rm -f ${TARGET_BIN}
+		rm -f ${BIN_DIR}/a2m_converter
+		for tool in ${TOOLS_LIST}; do
+			rm -f ${BIN_DIR}/${tool}
+		done
 		rm -Rf ${BUILD_DIR}
 		exit 0
 		;;
@@ -786,3 +809,29 @@ else
 fi
 
 info "built ${TARGET_NAME} v${TARGET_FULL_VERSION}"
+
+# additional targets (these link against the library that was just built)
+if [ ${BUILD_A2M_CONVERTER} -gt 0 ]; then
+	info "building a2m_converter ..."
+	CONVERTER_LIB_NAME=$(echo ${TARGET_BIN_NAME} | sed -E "s/^lib(.*)\.(so|dylib|dll)$/\1/")
+	CONVERTER_LDFLAGS=$(echo "${LDFLAGS}" | sed -E "s/-install_name [^ ]+//g" | sed -E "s/ -(shared|dynamiclib)//g")
+	verbose "${CXX} ${CXXFLAGS} tools/a2m_converter/a2m_converter.cpp -o ${BIN_DIR}/a2m_converter -L${BIN_DIR} -l${CONVERTER_LIB_NAME} ${CONVERTER_LDFLAGS}"
+	${CXX} ${CXXFLAGS} tools/a2m_converter/a2m_converter.cpp -o ${BIN_DIR}/a2m_converter -L${BIN_DIR} -l${CONVERTER_LIB_NAME} ${CONVERTER_LDFLAGS}
+	info "built a2m_converter"
+fi
+if [ ${BUILD_TOOLS} -gt 0 ]; then
+	TOOLS_LIB_NAME=$(echo ${TARGET_BIN_NAME} | sed -E "s/^lib(.*)\.(so|dylib|dll)$/\1/")
+	TOOLS_LDFLAGS=$(echo "${LDFLAGS}" | sed -E "s/-install_name [^ ]+//g" | sed -E "s/ -(shared|dynamiclib)//g")
+	for tool in ${TOOLS_LIST}; do
+		TOOL_LIBS=""
+		case ${tool} in
+			"frame_sync_check")
+				TOOL_LIBS="-lEGL"
+				;;
+		esac
+		info "building ${tool} ..."
+		verbose "${CXX} ${CXXFLAGS} tools/${tool}/${tool}.cpp -o ${BIN_DIR}/${tool} -L${BIN_DIR} -l${TOOLS_LIB_NAME} ${TOOLS_LDFLAGS} ${TOOL_LIBS}"
+		${CXX} ${CXXFLAGS} tools/${tool}/${tool}.cpp -o ${BIN_DIR}/${tool} -L${BIN_DIR} -l${TOOLS_LIB_NAME} ${TOOLS_LDFLAGS} ${TOOL_LIBS}
+	done
+	info "built tools"
+fi
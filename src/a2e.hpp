@@ -57,6 +57,7 @@
 #include "rendering/renderer/shader_object.hpp"
 #include "rendering/renderer/a2e_shader.hpp"
 #include "rendering/gl_timer.hpp"
+#include "rendering/gl_state.hpp"
 #if !defined(FLOOR_IOS)
 #include "rendering/renderer/gl3/shader_gl3.hpp"
 #else
@@ -72,4 +73,5 @@
 #include "scene/light.hpp"
 #include "scene/model/a2ematerial.hpp"
 #include "scene/model/a2estatic.hpp"
+#include "scene/model/a2einstanced.hpp"
 #include "scene/model/a2emodel.hpp"
@@ -22,6 +22,9 @@
 #include "rendering/gfx2d.hpp"
 #include "scene/scene.hpp"
 #include "rendering/gl_timer.hpp"
+#include "rendering/geometry_arena.hpp"
+#include "task_scheduler.hpp"
+#include "frame_allocator.hpp"
 #include <floor/audio/audio_controller.hpp>
 
 #if defined(__APPLE__)
@@ -37,6 +40,9 @@ gui* engine::ui { nullptr };
 scene* engine::sce { nullptr };
 event* engine::evt { nullptr };
 xml* engine::x { nullptr };
+geometry_arena* engine::arena { nullptr };
+task_scheduler* engine::scheduler { nullptr };
+frame_sync* engine::fsync { nullptr };
 
 struct engine::engine_config engine::config;
 
@@ -113,6 +119,7 @@ void engine::init(const char* callpath_, const char* datapath_,
 	x = new xml();
 	
 	// load config (that aren't already part of floor)
+	config.worker_threads = task_scheduler::get_default_worker_count();
 	const auto& config_doc = floor::get_config_doc();
 	if(config_doc.valid) {
 		// ui anti-aliasing should at least be 2x msaa
@@ -128,6 +135,7 @@ void engine::init(const char* callpath_, const char* datapath_,
 		else config.filtering = TEXTURE_FILTERING::POINT;
 		
 		config.anisotropic = config_doc.get<uint64_t>("graphic.anisotropic", 0);
+		config.frames_in_flight = config_doc.get<uint64_t>("graphic.frames_in_flight", 2);
 		
 		string anti_aliasing_str = config_doc.get<string>("graphic.anti_aliasing", "");
 		if(anti_aliasing_str == "NONE") config.anti_aliasing = rtt::TEXTURE_ANTI_ALIASING::NONE;
@@ -145,8 +153,14 @@ void engine::init(const char* callpath_, const char* datapath_,
 		config.upscaling = config_doc.get<float>("inferred.upscaling", 1.0f);
 		config.geometry_light_scaling = config_doc.get<float>("inferred.geometry_light_scaling", 1.0f);
 		config.geometry_light_scaling = const_math::clamp(config.geometry_light_scaling, 0.5f, 1.0f);
+		
+		config.worker_threads = config_doc.get<uint64_t>("threading.worker_threads", config.worker_threads);
 	}
 	
+	// create the task scheduler (0 worker threads: everything is executed on the render thread)
+	scheduler = new task_scheduler(config.worker_threads);
+	log_debug("using %u task worker threads", config.worker_threads);
+	
 	if(console_only_) {
 		init_mode = engine::INIT_MODE::CONSOLE;
 		// create extension class object
@@ -234,6 +248,10 @@ void engine::init(const char* callpath_, const char* datapath_,
 		// create texture manager and render to texture object
 		t = new texman(exts, config.anisotropic);
 		r = new rtt(exts);
+		fsync = new frame_sync(config.frames_in_flight);
+#if !defined(FLOOR_IOS)
+		arena = new geometry_arena(exts);
+#endif
 		
 		// set standard texture filtering + anisotropic filtering
 		t->set_filtering(config.filtering);
@@ -299,6 +317,10 @@ void engine::init(const char* callpath_, const char* datapath_,
 void engine::destroy() {
 	log_debug("deleting engine object");
 	
+	const auto frame_mem = frame_allocator::get_total_stats();
+	log_debug("frame memory: high-water mark %u bytes (%u bytes in %u blocks)",
+			  frame_mem.high_water, frame_mem.capacity, frame_mem.block_count);
+	
 	floor::acquire_context();
 	
 	for(const auto& cursor : cursors) {
@@ -317,9 +339,12 @@ void engine::destroy() {
 	if(shd != nullptr) delete shd;
 	if(ui != nullptr) delete ui;
 	if(sce != nullptr) delete sce;
+	if(arena != nullptr) delete arena;
 	if(r != nullptr) delete r;
+	if(fsync != nullptr) delete fsync;
 	if(exts != nullptr) delete exts;
 	if(x != nullptr) delete x;
+	if(scheduler != nullptr) delete scheduler;
 	
 #if defined(A2E_DEBUG)
 	gl_timer::destroy();
@@ -334,9 +359,15 @@ void engine::destroy() {
  */
 void engine::start_draw() {
 	floor::start_draw(); // acquires context
+	
+	// wait until the gpu is done with the frame that last used the slot of this frame
+	if(fsync != nullptr) fsync->begin_frame();
+	// all transient memory of the previous frame is released (no tasks are running at this point)
+	frame_allocator::reset_all();
 	gl_timer::stop_frame();
 	gl_timer::state_check();
 	gl_timer::start_frame();
+	gl_state::start_frame();
 	
 	// if no ui exists, use the "default" frame/renderbuffer
 	if(ui == nullptr) {
@@ -362,7 +393,7 @@ void engine::start_draw() {
 	mvp_matrix = projection_matrix;
 	
 #if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
-	glBindVertexArray(global_vao);
+	gl_state::bind_vertex_array(global_vao);
 #endif
 }
 
@@ -382,6 +413,9 @@ void engine::stop_draw() {
 	}
 #endif
 	
+	// all commands of this frame have been submitted
+	if(fsync != nullptr) fsync->end_frame();
+	
 	// swap, gl error handling, fps counter handling, kernel reloading
 	// note: also releases the context
 	floor::stop_draw();
@@ -416,8 +450,8 @@ void engine::push_ogl_state() {
 void engine::pop_ogl_state() {
 	// make a full soft-context-switch, restore all values
 	
-	glBlendFunc(pushed_blend_src, pushed_blend_dst);
-	glBlendFuncSeparate(pushed_blend_src_rgb, pushed_blend_dst_rgb,
+	gl_state::blend_func(pushed_blend_src, pushed_blend_dst);
+	gl_state::blend_func_separate(pushed_blend_src_rgb, pushed_blend_dst_rgb,
 						pushed_blend_src_alpha, pushed_blend_dst_alpha);
 }
 
@@ -426,9 +460,11 @@ void engine::pop_ogl_state() {
 void engine::init_gl() {
 	// this already handles most opengl initialization ...
 	floor::init_gl();
+	// nothing about the gl state is known at this point
+	gl_state::invalidate();
 	// ... except for these two
-	glFrontFace(GL_CCW);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::front_face(GL_CCW);
+	gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	
 	// and ios specific code
 #if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
@@ -437,7 +473,7 @@ void engine::init_gl() {
 		vao_init = true;
 		glGenVertexArrays(1, &global_vao);
 	}
-	glBindVertexArray(global_vao);
+	gl_state::bind_vertex_array(global_vao);
 #endif
 }
 
@@ -497,6 +533,11 @@ float3* engine::get_rotation() {
 	return &rotation;
 }
 
+render_view engine::get_camera_view() {
+	return render_view(position, float2(rotation.x, rotation.y), projection_matrix, floor::get_near_far_plane(),
+					   uint4(0, 0, (unsigned int)floor::get_physical_width(), (unsigned int)floor::get_physical_height()));
+}
+
 /*! starts drawing the 2d elements and initializes the opengl functions for that
  */
 void engine::start_2d_draw() {
@@ -513,12 +554,12 @@ void engine::start_2d_draw(const unsigned int width, const unsigned int height)
 	push_modelview_matrix();
 	modelview_matrix.identity();
 	
-	glFrontFace(GL_CW);
+	gl_state::front_face(GL_CW);
 	mvp_matrix = projection_matrix;
-	glDisable(GL_CULL_FACE); // TODO: GL3, remove again
+	gl_state::disable(GL_CULL_FACE); // TODO: GL3, remove again
 	
 	// shaders are using pre-multiplied alpha
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 /*! stops drawing the 2d elements
@@ -526,8 +567,8 @@ void engine::start_2d_draw(const unsigned int width, const unsigned int height)
 void engine::stop_2d_draw() {
 	pop_projection_matrix();
 	pop_modelview_matrix();
-	glFrontFace(GL_CCW);
-	glEnable(GL_CULL_FACE); // TODO: GL3, remove again
+	gl_state::front_face(GL_CCW);
+	gl_state::enable(GL_CULL_FACE); // TODO: GL3, remove again
 }
 
 /*! returns the type of the initialization (0 = GRAPHICAL, 1 = CONSOLE)
@@ -536,6 +577,10 @@ const engine::INIT_MODE& engine::get_init_mode() {
 	return init_mode;
 }
 
+GLuint engine::get_global_vao() {
+	return global_vao;
+}
+
 /*! returns the texman class
  */
 texman* engine::get_texman() {
@@ -572,6 +617,18 @@ scene* engine::get_scene() {
 	return engine::sce;
 }
 
+geometry_arena* engine::get_geometry_arena() {
+	return engine::arena;
+}
+
+task_scheduler* engine::get_task_scheduler() {
+	return engine::scheduler;
+}
+
+frame_sync* engine::get_frame_sync() {
+	return engine::fsync;
+}
+
 xml* engine::get_xml() {
 	return x;
 }
@@ -642,6 +699,21 @@ void engine::set_anti_aliasing(const rtt::TEXTURE_ANTI_ALIASING& anti_aliasing)
 	}
 }
 
+size_t engine::get_frames_in_flight() {
+	return (fsync != nullptr ? fsync->get_frames_in_flight() : config.frames_in_flight);
+}
+
+void engine::set_frames_in_flight(const size_t& count) {
+	config.frames_in_flight = count;
+	if(fsync == nullptr) return;
+	
+	// waits for all frames in flight
+	floor::acquire_context();
+	fsync->set_frames_in_flight(count);
+	floor::release_context();
+	log_debug("using %u frames in flight", fsync->get_frames_in_flight());
+}
+
 matrix4f* engine::get_projection_matrix() {
 	return &(engine::projection_matrix);
 }
@@ -28,15 +28,20 @@
 #include "rendering/extensions.hpp"
 #include <floor/core/xml.hpp>
 #include "rendering/rtt.hpp"
+#include "rendering/gl_state.hpp"
+#include "rendering/frame_sync.hpp"
+#include "scene/render_view.hpp"
 #include <floor/math/vector_lib.hpp>
 #include <floor/math/matrix4.hpp>
 #include <floor/core/unicode.hpp>
 
-#define A2M_VERSION 2
+#define A2M_VERSION 3
 
 class shader;
 class gui;
 class scene;
+class geometry_arena;
+class task_scheduler;
 
 //! main engine
 class engine {
@@ -76,6 +81,12 @@ public:
 	static gui* get_gui();
 	static scene* get_scene();
 	static xml* get_xml();
+	//! shared vertex/index buffers of all static models that use it (nullptr in console mode and with opengl es)
+	static geometry_arena* get_geometry_arena();
+	//! worker threads for cpu frame work (culling, sorting, matrix updates, ...), also available in console mode
+	static task_scheduler* get_task_scheduler();
+	//! fences of all frames in flight (nullptr in console mode)
+	static frame_sync* get_frame_sync();
 
 	// miscellaneous control functions
 	static SDL_Cursor* add_cursor(const char* name, const char** raw_data, unsigned int xsize, unsigned int ysize, unsigned int hotx, unsigned int hoty);
@@ -101,8 +112,13 @@ public:
 	static float3* get_position(); //! shouldn't be used outside of the engine, use camera class function instead
 	static void set_rotation(float xrot, float yrot);
 	static float3* get_rotation(); //! shouldn't be used outside of the engine, use camera class function instead
+	//! returns the view of the current camera (position, rotation and perspective projection, full screen viewport),
+	//! the scene renders this view and passes it through all of its passes (the matrices above are still used for 2d)
+	static render_view get_camera_view();
 	
 	static const INIT_MODE& get_init_mode();
+	//! the vao that is bound by default (everything that binds another vao has to rebind this one afterwards)
+	static GLuint get_global_vao();
 	
 	// gui
 	static const rtt::TEXTURE_ANTI_ALIASING& get_ui_anti_aliasing();
@@ -119,6 +135,9 @@ public:
 	static void set_filtering(const TEXTURE_FILTERING& filtering);
 	static void set_anisotropic(const size_t& anisotropic);
 	static void set_anti_aliasing(const rtt::TEXTURE_ANTI_ALIASING& anti_aliasing);
+	//! amount of frames that can be queued on the gpu while the next one is prepared (1 .. A2E_CONCURRENT_FRAMES)
+	static size_t get_frames_in_flight();
+	static void set_frames_in_flight(const size_t& count);
 	
 	// graphic device
 	static const string& get_disabled_extensions();
@@ -141,6 +160,9 @@ protected:
 	static scene* sce;
 	static event* evt;
 	static xml* x;
+	static geometry_arena* arena;
+	static task_scheduler* scheduler;
+	static frame_sync* fsync;
 	
 	static void load_ico(const char* ico);
 	
@@ -156,6 +178,7 @@ protected:
 		TEXTURE_FILTERING filtering = TEXTURE_FILTERING::POINT;
 		rtt::TEXTURE_ANTI_ALIASING anti_aliasing = rtt::TEXTURE_ANTI_ALIASING::NONE;
 		size_t anisotropic = 0;
+		size_t frames_in_flight = 2;
 		
 		// graphic device
 		string disabled_extensions = "";
@@ -165,6 +188,9 @@ protected:
 		// inferred rendering
 		float upscaling = 1.0f;
 		float geometry_light_scaling = 1.0f;
+		
+		// threading
+		size_t worker_threads = 0; // hardware threads - 1 if not set in the config
 	} config;
 	
 	// path variables
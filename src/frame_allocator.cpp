@@ -0,0 +1,131 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "frame_allocator.hpp"
+
+mutex frame_allocator::allocators_lock;
+vector<frame_allocator*> frame_allocator::allocators;
+
+frame_allocator::frame_allocator(const size_t initial_size_) : initial_size(initial_size_), owner(this_thread::get_id()) {
+	lock_guard<mutex> lock(allocators_lock);
+	allocators.emplace_back(this);
+}
+
+frame_allocator::~frame_allocator() {
+	{
+		lock_guard<mutex> lock(allocators_lock);
+		const auto iter = find(begin(allocators), end(allocators), this);
+		if(iter != end(allocators)) allocators.erase(iter);
+	}
+	free_blocks();
+}
+
+frame_allocator& frame_allocator::get() {
+	// created on first use (no memory is allocated until the thread actually allocates something)
+	static thread_local frame_allocator thread_allocator;
+	return thread_allocator;
+}
+
+void* frame_allocator::allocate(const size_t& size, const size_t& alignment) {
+	uintptr_t addr = (uintptr_t(cur_ptr) + (alignment - 1)) & ~uintptr_t(alignment - 1);
+	if(cur_ptr == nullptr || addr + size > uintptr_t(cur_end)) {
+		add_block(size + alignment);
+		addr = (uintptr_t(cur_ptr) + (alignment - 1)) & ~uintptr_t(alignment - 1);
+	}
+	
+	last_allocation = (unsigned char*)addr;
+	last_allocation_begin = cur_ptr;
+	cur_ptr = last_allocation + size;
+	
+	cur_stats.used += size_t(cur_ptr - last_allocation_begin);
+	cur_stats.high_water = std::max(cur_stats.high_water, cur_stats.used);
+	cur_stats.allocation_count++;
+	return last_allocation;
+}
+
+void frame_allocator::deallocate(void* ptr, const size_t& size floor_unused) {
+	// only the owning thread may move the pointer, other threads just leave the memory until the next reset
+	if(ptr == nullptr || ptr != last_allocation || this_thread::get_id() != owner) return;
+	cur_stats.used -= size_t(cur_ptr - last_allocation_begin);
+	cur_ptr = last_allocation_begin;
+	last_allocation = nullptr;
+}
+
+void frame_allocator::reset() {
+	// more than one block was necessary -> replace them by a single block that can hold a whole frame
+	if(blocks.size() > 1) {
+		free_blocks();
+		add_block(cur_stats.high_water + cur_stats.high_water / 4);
+	}
+	else if(!blocks.empty()) {
+		cur_ptr = blocks.back().data;
+	}
+	last_allocation = nullptr;
+	last_allocation_begin = nullptr;
+	cur_stats.used = 0;
+	cur_stats.allocation_count = 0;
+}
+
+void frame_allocator::add_block(const size_t& min_size) {
+	// blocks at least double in size, so that a frame only needs a few of them until the next reset merges them
+	size_t size = std::max(min_size, initial_size);
+	if(!blocks.empty()) size = std::max(size, blocks.back().size * 2);
+	
+	blocks.emplace_back(block { new unsigned char[size], size });
+	cur_ptr = blocks.back().data;
+	cur_end = cur_ptr + size;
+	cur_stats.capacity += size;
+	cur_stats.block_count = blocks.size();
+	cur_stats.heap_allocation_count++;
+}
+
+void frame_allocator::free_blocks() {
+	for(auto& blk : blocks) {
+		delete [] blk.data;
+	}
+	blocks.clear();
+	cur_ptr = nullptr;
+	cur_end = nullptr;
+	cur_stats.capacity = 0;
+	cur_stats.block_count = 0;
+}
+
+frame_allocator::stats frame_allocator::get_stats() const {
+	return cur_stats;
+}
+
+void frame_allocator::reset_all() {
+	lock_guard<mutex> lock(allocators_lock);
+	for(auto& alloc : allocators) {
+		alloc->reset();
+	}
+}
+
+frame_allocator::stats frame_allocator::get_total_stats() {
+	stats total;
+	lock_guard<mutex> lock(allocators_lock);
+	for(const auto& alloc : allocators) {
+		total.used += alloc->cur_stats.used;
+		total.high_water += alloc->cur_stats.high_water;
+		total.capacity += alloc->cur_stats.capacity;
+		total.block_count += alloc->cur_stats.block_count;
+		total.allocation_count += alloc->cur_stats.allocation_count;
+		total.heap_allocation_count += alloc->cur_stats.heap_allocation_count;
+	}
+	return total;
+}
@@ -0,0 +1,129 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_FRAME_ALLOCATOR_HPP__
+#define __A2E_FRAME_ALLOCATOR_HPP__
+
+#include "global.hpp"
+#include <mutex>
+#include <thread>
+#include <memory>
+
+//! linear (bump) allocator for transient per-frame data (point lists, sort keys, temporary strings, ...):
+//! allocations only advance a pointer and are all released at once by reset(), which happens at the start of each
+//! frame (engine::start_draw -> reset_all()). every thread has its own allocator (get()), so no locking is necessary.
+//! the memory blocks are kept across frames and are merged into a single block of the high-water mark size on reset,
+//! so that a frame doesn't allocate any heap memory once the allocator has warmed up.
+//! NOTE: frame memory must not be used beyond the frame it was allocated in (don't store frame_vector/frame_string
+//!       in anything that persists across frames)
+//! NOTE: reset_all() must only be called while no other thread allocates frame memory (i.e. no tasks are running)
+class frame_allocator {
+public:
+	frame_allocator(const size_t initial_size = default_block_size);
+	~frame_allocator();
+	frame_allocator(const frame_allocator&) = delete;
+	frame_allocator& operator=(const frame_allocator&) = delete;
+	
+	static constexpr size_t default_block_size = 256 * 1024;
+	
+	//! returns "size" bytes aligned to "alignment" (must be a power of two)
+	void* allocate(const size_t& size, const size_t& alignment = alignof(max_align_t));
+	//! frame memory is only really freed by reset(), but if this is the most recent allocation (e.g. a temporary
+	//! that is destroyed right away), its memory is reused immediately
+	void deallocate(void* ptr, const size_t& size);
+	//! releases all allocations (keeps the memory)
+	void reset();
+	
+	struct stats {
+		size_t used = 0; // bytes allocated in the current frame (incl. alignment padding)
+		size_t high_water = 0; // max bytes used in a single frame
+		size_t capacity = 0; // total size of all memory blocks
+		size_t block_count = 0;
+		size_t allocation_count = 0; // in the current frame
+		size_t heap_allocation_count = 0; // amount of blocks that have been allocated from the heap (ever)
+	};
+	stats get_stats() const;
+	
+	//! the allocator of the calling thread
+	static frame_allocator& get();
+	//! resets the allocators of all threads
+	static void reset_all();
+	//! accumulated stats of all threads (high_water is the sum of the per-thread high-water marks)
+	static stats get_total_stats();
+
+protected:
+	struct block {
+		unsigned char* data;
+		size_t size;
+	};
+	// the current block is always the last one, earlier ones are full
+	vector<block> blocks;
+	const size_t initial_size;
+	const thread::id owner;
+	unsigned char* cur_ptr = nullptr;
+	unsigned char* cur_end = nullptr;
+	// most recent allocation and the pointer before it was aligned (-> deallocate)
+	unsigned char* last_allocation = nullptr;
+	unsigned char* last_allocation_begin = nullptr;
+	stats cur_stats;
+	
+	void add_block(const size_t& min_size);
+	void free_blocks();
+	
+	// all thread allocators (for reset_all and get_total_stats)
+	static mutex allocators_lock;
+	static vector<frame_allocator*> allocators;
+
+};
+
+//! stl allocator that allocates from the frame allocator of the thread that creates it
+//! (containers can be read and destroyed on any thread, but should only be grown on the creating thread)
+template <typename T> class frame_stl_allocator {
+public:
+	typedef T value_type;
+	// containers can be moved/swapped between threads, the memory always stays with the allocator it came from
+	typedef true_type propagate_on_container_move_assignment;
+	typedef true_type propagate_on_container_swap;
+	
+	frame_stl_allocator() noexcept : alloc(&frame_allocator::get()) {}
+	template <typename U> frame_stl_allocator(const frame_stl_allocator<U>& other) noexcept : alloc(other.alloc) {}
+	
+	T* allocate(const size_t n) {
+		return (T*)alloc->allocate(n * sizeof(T), alignof(T));
+	}
+	void deallocate(T* ptr, const size_t n) noexcept {
+		alloc->deallocate(ptr, n * sizeof(T));
+	}
+	
+	template <typename U> bool operator==(const frame_stl_allocator<U>& other) const noexcept {
+		return (alloc == other.alloc);
+	}
+	template <typename U> bool operator!=(const frame_stl_allocator<U>& other) const noexcept {
+		return (alloc != other.alloc);
+	}
+
+protected:
+	template <typename U> friend class frame_stl_allocator;
+	frame_allocator* alloc;
+
+};
+
+template <typename T> using frame_vector = vector<T, frame_stl_allocator<T>>;
+typedef basic_string<char, char_traits<char>, frame_stl_allocator<char>> frame_string;
+
+#endif
@@ -135,7 +135,7 @@ shader_reload_fnctr(bind(&a2e_font::shader_reload_handler, this, placeholders::_
 	
 	// create necessary glyph vbo and ubo
 	glGenBuffers(1, &glyph_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, glyph_vbo);
 	const float2 glyph_quad[] {
 		float2(0.0f, 1.0f),
 		float2(0.0f, 0.0f),
@@ -143,13 +143,13 @@ shader_reload_fnctr(bind(&a2e_font::shader_reload_handler, this, placeholders::_
 		float2(1.0f, 0.0f),
 	};
 	glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(float2), &glyph_quad[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	
 #if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
 	glGenBuffers(1, &text_ubo);
-	glBindBuffer(GL_UNIFORM_BUFFER, text_ubo);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, text_ubo);
 	glBufferData(GL_UNIFORM_BUFFER, A2E_FONT_UBO_SIZE, nullptr, GL_STATIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, 0);
 #else
 	// TODO: gles 2.0 implementation
 #endif
@@ -171,9 +171,9 @@ a2e_font::~a2e_font() {
 		}
 	}
 	
-	if(glIsBuffer(glyph_vbo)) glDeleteBuffers(1, &glyph_vbo);
-	if(glIsBuffer(text_ubo)) glDeleteBuffers(1, &text_ubo);
-	if(glIsTexture(tex_array)) glDeleteTextures(1, &tex_array);
+	if(glIsBuffer(glyph_vbo)) gl_state::delete_buffers(1, &glyph_vbo);
+	if(glIsBuffer(text_ubo)) gl_state::delete_buffers(1, &text_ubo);
+	if(glIsTexture(tex_array)) gl_state::delete_textures(1, &tex_array);
 	
 #if defined(FLOOR_IOS)
 	if(tex_data != nullptr) delete [] tex_data;
@@ -276,7 +276,7 @@ void a2e_font::cache(const unsigned int& start_code, const unsigned int& end_cod
 	}
 	
 	// render glyph bitmaps and copy them to the texture
-	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_array);
+	gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, tex_array);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // necessary, b/c we'll upload data that has no 4 or 2 byte alignment
 	
 	size_t glyph_counter = cur_glyph_count;
@@ -354,7 +354,7 @@ void a2e_font::cache(const unsigned int& start_code, const unsigned int& end_cod
 	}
 	
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, 0);
 }
 
 a2e_font::text_cache a2e_font::cache_text(const string& text, const GLuint existing_ubo) {
@@ -363,11 +363,11 @@ a2e_font::text_cache a2e_font::cache_text(const string& text, const GLuint exist
 #if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
 	if(ubo == 0 || !glIsBuffer(ubo)) {
 		glGenBuffers(1, &ubo);
-		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		gl_state::bind_buffer(GL_UNIFORM_BUFFER, ubo);
 		glBufferData(GL_UNIFORM_BUFFER, A2E_FONT_UBO_SIZE, nullptr, GL_STATIC_DRAW);
 	}
 	else {
-		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		gl_state::bind_buffer(GL_UNIFORM_BUFFER, ubo);
 	}
 #else
 	// TODO: gles 2.0 implementation
@@ -380,7 +380,7 @@ a2e_font::text_cache a2e_font::cache_text(const string& text, const GLuint exist
 	
 #if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
 	glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)(text_data.first.size() * sizeof(uint2)), &text_data.first[0]);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, 0);
 #else
 	// TODO: gles 2.0 implementation
 #endif
@@ -390,7 +390,7 @@ a2e_font::text_cache a2e_font::cache_text(const string& text, const GLuint exist
 
 void a2e_font::destroy_text_cache(text_cache& cached_text) {
 	if(glIsBuffer(cached_text.first.x)) {
-		glDeleteBuffers(1, &cached_text.first.x);
+		gl_state::delete_buffers(1, &cached_text.first.x);
 		cached_text.first.x = 0;
 	}
 }
@@ -409,7 +409,7 @@ void a2e_font::recreate_texture_array(const size_t& layers) {
 	// check if we need to copy data from the old tex layers
 	if(prev_layers != 0 && tex_array != 0) {
 #if !defined(FLOOR_IOS)
-		glBindTexture(GL_TEXTURE_2D_ARRAY, tex_array);
+		gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, tex_array);
 		glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, GL_UNSIGNED_BYTE, new_tex_data);
 #else
 		memcpy(new_tex_data, tex_data, layer_size * prev_layers);
@@ -426,7 +426,7 @@ void a2e_font::recreate_texture_array(const size_t& layers) {
 	if(tex_array == 0) {
 		glGenTextures(1, &tex_array);
 	}
-	glBindTexture(GL_TEXTURE_2D_ARRAY, tex_array);
+	gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, tex_array);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -446,7 +446,7 @@ void a2e_font::recreate_texture_array(const size_t& layers) {
 	if(tex_data != nullptr) delete [] tex_data;
 	tex_data = new_tex_data;
 #endif
-	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	gl_state::bind_texture(GL_TEXTURE_2D_ARRAY, 0);
 }
 
 void a2e_font::reload_shaders() {
@@ -470,9 +470,9 @@ void a2e_font::draw_cached(const string& text, const float2& position, const flo
 	const auto text_data(create_text_ubo_data(text));
 	
 #if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
-	glBindBuffer(GL_UNIFORM_BUFFER, text_ubo);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, text_ubo);
 	glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)(text_data.first.size() * sizeof(uint2)), &text_data.first[0]);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, 0);
 #else
 	// TODO: gles 2.0 implementation
 #endif
@@ -480,9 +480,9 @@ void a2e_font::draw_cached(const string& text, const float2& position, const flo
 	draw_cached(text_ubo, text_data.first.size(), position, color);
 }
 
-pair<vector<uint2>, float2> a2e_font::create_text_ubo_data(const string& text,
-														   std::function<void(unsigned int)> cache_fnc) const {
-	vector<uint2> ubo_data;
+pair<frame_vector<uint2>, float2> a2e_font::create_text_ubo_data(const string& text,
+																 std::function<void(unsigned int)> cache_fnc) const {
+	frame_vector<uint2> ubo_data;
 	const float2 extent = text_stepper(text,
 									   [&ubo_data](unsigned int code floor_unused,
 												   const glyph_data& glyph,
@@ -494,7 +494,7 @@ pair<vector<uint2>, float2> a2e_font::create_text_ubo_data(const string& text,
 									   },
 									   [](unsigned int, const float2&, const float&){},
 									   cache_fnc);
-	return { ubo_data, extent };
+	return { move(ubo_data), extent };
 }
 
 float a2e_font::compute_advance(const string& str, const unsigned int component) const {
@@ -578,7 +578,7 @@ float2 a2e_font::text_stepper(const vector<unsigned int>& unicode_str_,
 		{ unicode::utf8_to_unicode(u8"<b>"), 3 },
 		{ unicode::utf8_to_unicode(u8"</b>"), 4 },
 	};
-	auto unicode_str(unicode_str_); // copy!
+	frame_vector<unsigned int> unicode_str(cbegin(unicode_str_), cend(unicode_str_)); // copy!
 	for(const auto& cc : control_chars) {
 		auto iter = unicode_str.begin();
 		while((iter = search(begin(unicode_str), end(unicode_str),
@@ -590,52 +590,25 @@ float2 a2e_font::text_stepper(const vector<unsigned int>& unicode_str_,
 	
 	//
 	float2 origin(0.0f);
-	string cur_style = "Regular";
 	
 	const decltype(glyph_map)::value_type::second_type& regular_map(glyph_map.find("Regular")->second);
 	const decltype(glyph_map)::value_type::second_type& italic_map(glyph_map.find("Italic")->second);
 	const decltype(glyph_map)::value_type::second_type& bold_map(glyph_map.find("Bold")->second);
 	const decltype(glyph_map)::value_type::second_type& bold_italic_map(glyph_map.find("Bold Italic")->second);
+	const decltype(glyph_map)::value_type::second_type* style_maps[] {
+		&regular_map, &italic_map, &bold_map, &bold_italic_map
+	};
 	const decltype(glyph_map)::value_type::second_type* cur_style_map = &regular_map;
 	
-	static const int tab_multiplier = 4;
+	static const unsigned int tab_multiplier = 4;
 	static const float leading_multiplier = 1.125f;
-	const unordered_map<string, unordered_map<unsigned int, unsigned int>> whitespace_sizes {
-		{
-			"Regular", {
-				{ 0x0A, float(display_font_size) * leading_multiplier },
-				{ 0x0D, float(display_font_size) * leading_multiplier },
-				{ 0x09, (regular_map.find(0x20)->second.layout.z >> 6) * tab_multiplier },
-				{ 0x20, (regular_map.find(0x20)->second.layout.z >> 6) },
-			}
-		},
-		{
-			"Italic", {
-				{ 0x0A, float(display_font_size) * leading_multiplier },
-				{ 0x0D, float(display_font_size) * leading_multiplier },
-				{ 0x09, (italic_map.find(0x20)->second.layout.z >> 6) * tab_multiplier },
-				{ 0x20, (italic_map.find(0x20)->second.layout.z >> 6) },
-			}
-		},
-		{
-			"Bold", {
-				{ 0x0A, float(display_font_size) * leading_multiplier },
-				{ 0x0D, float(display_font_size) * leading_multiplier },
-				{ 0x09, (bold_map.find(0x20)->second.layout.z >> 6) * tab_multiplier },
-				{ 0x20, (bold_map.find(0x20)->second.layout.z >> 6) },
-			}
-		},
-		{
-			"Bold Italic", {
-				{ 0x0A, float(display_font_size) * leading_multiplier },
-				{ 0x0D, float(display_font_size) * leading_multiplier },
-				{ 0x09, (bold_italic_map.find(0x20)->second.layout.z >> 6) * tab_multiplier },
-				{ 0x20, (bold_italic_map.find(0x20)->second.layout.z >> 6) },
-			}
-		},
-	};
 	const auto whitespace_size = [&](const unsigned int code) -> unsigned int {
-		return whitespace_sizes.find(cur_style)->second.find(code)->second;
+		switch(code) {
+			case 0x0A:
+			case 0x0D: return (unsigned int)(float(display_font_size) * leading_multiplier);
+			case 0x09: return (unsigned int)(cur_style_map->find(0x20)->second.layout.z >> 6) * tab_multiplier;
+			default: return (unsigned int)(cur_style_map->find(0x20)->second.layout.z >> 6);
+		}
 	};
 	
 	float2 extent;
@@ -676,8 +649,7 @@ float2 a2e_font::text_stepper(const vector<unsigned int>& unicode_str_,
 			case 0x03:
 			case 0x04: {
 				const size_t style_idx = size_t(style_italic) + size_t(style_bold)*2;
-				cur_style = vector<string> { "Regular", "Italic", "Bold", "Bold Italic" }[style_idx];
-				cur_style_map = vector<decltype(cur_style_map)> { &regular_map, &italic_map, &bold_map, &bold_italic_map }[style_idx];
+				cur_style_map = style_maps[style_idx];
 				continue;
 			}
 			default: break;
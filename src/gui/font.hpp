@@ -23,6 +23,7 @@
 #include <floor/core/event.hpp>
 #include "gui/font_manager.hpp"
 #include "rendering/renderer/gl_shader_fwd.hpp"
+#include "frame_allocator.hpp"
 
 class shader;
 typedef struct FT_FaceRec_* FT_Face;
@@ -119,7 +120,8 @@ protected:
 	unsigned char* tex_data { nullptr };
 #endif
 	
-	pair<vector<uint2>, float2> create_text_ubo_data(const string& text, std::function<void(unsigned int)> cache_fnc = [](unsigned int){}) const;
+	//! NOTE: the returned ubo data is frame memory
+	pair<frame_vector<uint2>, float2> create_text_ubo_data(const string& text, std::function<void(unsigned int)> cache_fnc = [](unsigned int){}) const;
 	GLuint text_ubo = 0;
 		
 	gl_shader font_shd;
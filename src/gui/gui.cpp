@@ -135,10 +135,10 @@ void gui::draw() {
 	gl_timer::mark("GUI_START");
 	
 	//
-	glEnable(GL_BLEND);
-	glEnable(GL_SCISSOR_TEST);
+	gl_state::enable(GL_BLEND);
+	gl_state::enable(GL_SCISSOR_TEST);
 	glScissor(0, 0, (int)aa_fbo->draw_width, (int)aa_fbo->draw_height);
-	glDepthFunc(GL_LEQUAL);
+	gl_state::depth_func(GL_LEQUAL);
 	gfx2d::set_blend_mode(gfx2d::BLEND_MODE::PRE_MUL);
 	
 	//////////////////////////////////////////////////////////////////
@@ -193,7 +193,7 @@ void gui::draw() {
 	}
 	
 	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	texture_shd->disable();
 	
 	// stop
@@ -201,9 +201,9 @@ void gui::draw() {
 	r->stop_draw();
 	
 	//
-	glDepthFunc(GL_LESS);
-	glDisable(GL_SCISSOR_TEST);
-	glDisable(GL_BLEND);
+	gl_state::depth_func(GL_LESS);
+	gl_state::disable(GL_SCISSOR_TEST);
+	gl_state::disable(GL_BLEND);
 	
 	//////////////////////////////////////////////////////////////////
 	// blend with scene buffer (if the scene is enabled) and draw
@@ -223,9 +223,9 @@ void gui::draw() {
 		blend_shd->texture("src_buffer", main_fbo.tex[0]);
 		blend_shd->texture("dst_buffer", sce->get_scene_buffer()->tex[0]);
 		
-		glFrontFace(GL_CW);
+		gl_state::front_face(GL_CW);
 		gfx2d::draw_fullscreen_triangle();
-		glFrontFace(GL_CCW);
+		gl_state::front_face(GL_CCW);
 		
 		blend_shd->disable();
 	}
@@ -27,7 +27,7 @@ void a2e_image::draw(const uint2& scale_xy, const bool flip_y) {
 	if(!gui_img) engine::start_2d_draw();
 	
 	if(tex->alpha) {
-		glEnable(GL_BLEND);
+		gl_state::enable(GL_BLEND);
 	}
 	
 	float2 bottom_left, top_right;
@@ -55,7 +55,7 @@ void a2e_image::draw(const uint2& scale_xy, const bool flip_y) {
 	}
 	gfx2d::draw_rectangle_texture(rectangle, tex->tex(), color, float4(0.0f), bottom_left, top_right);
 
-	if(tex->alpha) { glDisable(GL_BLEND); }
+	if(tex->alpha) { gl_state::disable(GL_BLEND); }
 
 	// if we want to draw 3d stuff later on, we have to clear
 	// the depth buffer, otherwise nothing will be seen
@@ -30,7 +30,7 @@ r(engine::get_rtt()), flags(flags_), buffer_size(buffer_size_), offset(offset_)
 
 gui_surface::~gui_surface() {
 	delete_buffer();
-	if(glIsBuffer(vbo_rectangle)) glDeleteBuffers(1, &vbo_rectangle);
+	if(glIsBuffer(vbo_rectangle)) gl_state::delete_buffers(1, &vbo_rectangle);
 }
 
 void gui_surface::delete_buffer() {
@@ -125,7 +125,7 @@ void gui_surface::blit(gl_shader& shd) {
 	shd->uniform("extent", extent);
 	shd->texture("tex", buffer->tex[0]);
 	
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_rectangle);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_rectangle);
 	glVertexAttribPointer((GLuint)shd->get_attribute_position("in_vertex"),
 						  2, GL_FLOAT, GL_FALSE, 0, nullptr);
 	glEnableVertexAttribArray((GLuint)shd->get_attribute_position("in_vertex"));
@@ -149,9 +149,9 @@ void gui_surface::set_offset(const float2& offset_) {
 		}
 	};
 	
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_rectangle);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_rectangle);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(float2) * 4, &points[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 }
 
 const float2& gui_surface::get_offset() const {
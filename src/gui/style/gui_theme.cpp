@@ -523,15 +523,18 @@ void gui_theme::draw(const string& type, const string& state,
 	//
 	gui_ui_object::state* st = state_iter->second.get();
 	const float size_avg = (size.x + size.y) * 0.5f;
+	
+	// helpers:
+	static gfx2d::primitive_properties pprops;
+	struct compute_only_draw_style {
+		static void draw(gfx2d::primitive_properties& props) {
+			pprops = std::move(props);
+		}
+	};
+	// gradient colors of the current primitive (kept around to avoid reallocations)
+	static vector<float4> colors;
+	
 	for(const auto& prim : st->primitives) {
-		// helpers:
-		static gfx2d::primitive_properties pprops;
-		struct compute_only_draw_style {
-			static void draw(gfx2d::primitive_properties& props) {
-				pprops = std::move(props);
-			}
-		};
-		
 		// compute sizes and create primitive_properties for drawing
 		switch(prim.type) {
 			case PRIMITIVE_TYPE::POINT: {
@@ -706,7 +709,7 @@ void gui_theme::draw(const string& type, const string& state,
 				floor_fallthrough;
 			case DRAW_STYLE::GRADIENT: {
 				auto ds = (ds_gradient*)&*prim.ddata;
-				vector<float4> colors;
+				colors.clear();
 				for(auto& color : ds->colors) {
 					color.compute(scheme);
 					colors.emplace_back(color.value);
@@ -775,7 +778,7 @@ void gui_theme::draw(const string& type, const string& state,
 					}
 				}
 				else {
-					vector<float4> colors;
+					colors.clear();
 					for(auto& color : ds->gradient.colors) {
 						color.compute(scheme);
 						colors.emplace_back(color.value);
@@ -802,6 +805,8 @@ void gui_theme::draw(const string& type, const string& state,
 			case DRAW_STYLE::TEXT: break;
 		}
 	}
+	// the points are frame memory -> they must not be kept until the next frame
+	pprops = gfx2d::primitive_properties();
 	
 	// reset scissor rect
 	if(scissor) {
@@ -48,12 +48,12 @@ particle_manager::~particle_manager() {
 
 /*! draws all particle systems
  */
-void particle_manager::draw(const rtt::fbo* frame_buffer) {
-	pm->draw(frame_buffer);
+void particle_manager::draw(const render_view& view, const rtt::fbo* frame_buffer) {
+	pm->draw(view, frame_buffer);
 }
 
-void particle_manager::draw_particle_system(particle_system* ps, const rtt::fbo* frame_buffer) {
-	pm->draw_particle_system(ps, frame_buffer);
+void particle_manager::draw_particle_system(particle_system* ps, const render_view& view, const rtt::fbo* frame_buffer) {
+	pm->draw_particle_system(ps, view, frame_buffer);
 }
 
 /*! runs the particle system
@@ -37,8 +37,9 @@ public:
 	particle_manager();
 	~particle_manager();
 
-	void draw(const rtt::fbo* frame_buffer);
-	void draw_particle_system(particle_system* ps, const rtt::fbo* frame_buffer);
+	//! draws all visible particle systems from the specified view (frame_buffer: g-buffer with the depth of the view)
+	void draw(const render_view& view, const rtt::fbo* frame_buffer);
+	void draw_particle_system(particle_system* ps, const render_view& view, const rtt::fbo* frame_buffer);
 	void run();
 	
 	particle_system* add_particle_system(const particle_system::EMITTER_TYPE type,
@@ -37,9 +37,9 @@ particle_manager_base::~particle_manager_base() {
 
 /*! draws all particle systems
  */
-void particle_manager_base::draw(const rtt::fbo* frame_buffer) {
+void particle_manager_base::draw(const render_view& view, const rtt::fbo* frame_buffer) {
 	for(const auto& psystem : particle_systems) {
-		if(psystem->is_visible()) draw_particle_system(psystem, frame_buffer);
+		if(psystem->is_visible()) draw_particle_system(psystem, view, frame_buffer);
 	}
 }
 
@@ -36,7 +36,7 @@ public:
 	particle_manager_base();
 	virtual ~particle_manager_base();
 	
-	virtual void draw(const rtt::fbo* frame_buffer);
+	virtual void draw(const render_view& view, const rtt::fbo* frame_buffer);
 	virtual void run();
 	
 	virtual particle_system* add_particle_system(const particle_system::EMITTER_TYPE type,
@@ -57,7 +57,7 @@ public:
 	virtual void delete_particle_system(particle_system* ps);
 	virtual void reset_particle_system(particle_system* ps) = 0;
 	virtual void run_particle_system(particle_system* ps) = 0;
-	virtual void draw_particle_system(particle_system* ps, const rtt::fbo* frame_buffer) = 0;
+	virtual void draw_particle_system(particle_system* ps, const render_view& view, const rtt::fbo* frame_buffer) = 0;
 	
 protected:
 	shader* s;
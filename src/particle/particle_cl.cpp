@@ -105,19 +105,19 @@ void particle_manager_cl::reset_particle_count(particle_system* ps) {
 		pdata->ocl_indices[1] = nullptr;
 	}
 	if(glIsBuffer(pdata->ocl_gl_pos_time_vbo)) {
-		glDeleteBuffers(1, &pdata->ocl_gl_pos_time_vbo);
+		gl_state::delete_buffers(1, &pdata->ocl_gl_pos_time_vbo);
 		pdata->ocl_gl_pos_time_vbo = 0;
 	}
 	if(glIsBuffer(pdata->ocl_gl_dir_vbo)) {
-		glDeleteBuffers(1, &pdata->ocl_gl_dir_vbo);
+		gl_state::delete_buffers(1, &pdata->ocl_gl_dir_vbo);
 		pdata->ocl_gl_dir_vbo = 0;
 	}
 	if(glIsBuffer(pdata->particle_indices_vbo[0])) {
-		glDeleteBuffers(1, &pdata->particle_indices_vbo[0]);
+		gl_state::delete_buffers(1, &pdata->particle_indices_vbo[0]);
 		pdata->particle_indices_vbo[0] = 0;
 	}
 	if(glIsBuffer(pdata->particle_indices_vbo[1])) {
-		glDeleteBuffers(1, &pdata->particle_indices_vbo[1]);
+		gl_state::delete_buffers(1, &pdata->particle_indices_vbo[1]);
 		pdata->particle_indices_vbo[1] = 0;
 	}
 
@@ -129,12 +129,12 @@ void particle_manager_cl::reset_particle_count(particle_system* ps) {
 	float4* dir_data = new float4[pdata->particle_count];
 	
 	glGenBuffers(1, &pdata->ocl_gl_pos_time_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, pdata->ocl_gl_pos_time_vbo);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, pdata->ocl_gl_pos_time_vbo);
 	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(pdata->particle_count * sizeof(float4)), pos_time_data, GL_DYNAMIC_DRAW);
 	glGenBuffers(1, &pdata->ocl_gl_dir_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, pdata->ocl_gl_dir_vbo);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, pdata->ocl_gl_dir_vbo);
 	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(pdata->particle_count * sizeof(float4)), dir_data, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	
 	delete [] pos_time_data;
 	delete [] dir_data;
@@ -154,9 +154,9 @@ void particle_manager_cl::reset_particle_count(particle_system* ps) {
 	
 	for(unsigned int i = 0; i < 2; i++) {
 		glGenBuffers(1, &pdata->particle_indices_vbo[i]);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pdata->particle_indices_vbo[i]);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, pdata->particle_indices_vbo[i]);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(pdata->particle_count * sizeof(unsigned int)), particle_indices, GL_DYNAMIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 		
 		pdata->ocl_indices[i] = ocl->create_ogl_buffer(opencl::BUFFER_FLAG::READ_WRITE, pdata->particle_indices_vbo[i]);
 		ocl->set_manual_gl_sharing(pdata->ocl_indices[i], true);
@@ -427,18 +427,17 @@ void particle_manager_cl::sort_particle_system(particle_system* ps) {
 	ocl->release_gl_object(pdata->ocl_indices[pdata->particle_indices_swap]);
 }
 
-void particle_manager_cl::draw_particle_system(particle_system* ps, const rtt::fbo* frame_buffer) {
+void particle_manager_cl::draw_particle_system(particle_system* ps, const render_view& view, const rtt::fbo* frame_buffer) {
 	// prep matrices
-	matrix4f mvm(*engine::get_modelview_matrix());
-	matrix4f pm(*engine::get_projection_matrix());
-	matrix4f mvpm(mvm * pm);
+	const matrix4f& mvm(view.modelview_matrix);
+	const matrix4f& mvpm(view.mvp_matrix);
 	
 	// draw
 	particle_system::internal_particle_data* pdata = ps->get_internal_particle_data();
 	
-	glEnable(GL_BLEND);
+	gl_state::enable(GL_BLEND);
 	gfx2d::set_blend_mode(ps->get_blend_mode());
-	glDepthMask(GL_FALSE);
+	gl_state::depth_mask(GL_FALSE);
 	
 	// point -> gs: quad
 	gl_shader particle_draw = s->get_gl_shader("PARTICLE_DRAW_OPENCL");
@@ -461,10 +460,7 @@ void particle_manager_cl::draw_particle_system(particle_system* ps, const rtt::f
 	particle_draw->uniform("mvpm", mvpm);
 	particle_draw->uniform("position", ps->get_position());
 	
-	const float2 near_far_plane = floor::get_near_far_plane();
-	const float2 projection_ab = float2(near_far_plane.y / (near_far_plane.y - near_far_plane.x),
-										(-near_far_plane.y * near_far_plane.x) / (near_far_plane.y - near_far_plane.x));
-	particle_draw->uniform("projection_ab", projection_ab);
+	particle_draw->uniform("projection_ab", view.get_projection_ab());
 	particle_draw->texture("depth_buffer", frame_buffer->depth_buffer);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
 	
@@ -489,7 +485,7 @@ void particle_manager_cl::draw_particle_system(particle_system* ps, const rtt::f
 		}
 		// update and set ubo
 		const GLuint lights_ubo = ps->get_lights_ubo();
-		glBindBuffer(GL_UNIFORM_BUFFER, lights_ubo); // will be unbound automatically
+		gl_state::bind_buffer(GL_UNIFORM_BUFFER, lights_ubo); // will be unbound automatically
 		glBufferSubData(GL_UNIFORM_BUFFER, 0,
 						(sizeof(float4) * 2) * A2E_MAX_PARTICLE_LIGHTS,
 						&lights_data[0]);
@@ -507,24 +503,24 @@ void particle_manager_cl::draw_particle_system(particle_system* ps, const rtt::f
 	   (ps->is_sorting() && !ps->is_reentrant_sorting()) ||
 	   (ps->is_reentrant_sorting() && ps->is_render_intermediate_sorted_buffer())) {
 		// std: use active indices buffer
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pdata->particle_indices_vbo[pdata->particle_indices_swap]);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, pdata->particle_indices_vbo[pdata->particle_indices_swap]);
 	}
 	else if(ps->is_reentrant_sorting() && !ps->is_render_intermediate_sorted_buffer()) {
 		// use previously sorted indices buffer
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pdata->particle_indices_vbo[1 - pdata->particle_indices_swap]);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, pdata->particle_indices_vbo[1 - pdata->particle_indices_swap]);
 	}
 	else {
 		assert(false && "invalid particle system state");
 	}
 	
 	glDrawElements(GL_POINTS, (GLsizei)pdata->particle_count, GL_UNSIGNED_INT, nullptr);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	
 	particle_draw->disable();
 	
-	glDepthMask(GL_TRUE);
+	gl_state::depth_mask(GL_TRUE);
 	gfx2d::set_blend_mode(gfx2d::BLEND_MODE::DEFAULT);
-	glDisable(GL_BLEND);
+	gl_state::disable(GL_BLEND);
 }
 
 #endif
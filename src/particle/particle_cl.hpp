@@ -55,7 +55,7 @@ public:
 	virtual void reset_particle_system(particle_system* ps);
 	virtual void run_particle_system(particle_system* ps);
 	virtual void sort_particle_system(particle_system* ps);
-	virtual void draw_particle_system(particle_system* ps, const rtt::fbo* frame_buffer);
+	virtual void draw_particle_system(particle_system* ps, const render_view& view, const rtt::fbo* frame_buffer);
 	
 protected:	
 	virtual void reset_particle_count(particle_system* ps);
@@ -34,11 +34,11 @@ particle_system::particle_system() {
 #if !defined(FLOOR_IOS)
 	// only gen if ltype == POINT is set?
 	glGenBuffers(1, &lights_ubo);
-	glBindBuffer(GL_UNIFORM_BUFFER, lights_ubo);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, lights_ubo);
 	glBufferData(GL_UNIFORM_BUFFER,
 				 (sizeof(float4) * 2) * A2E_MAX_PARTICLE_LIGHTS,
 				 nullptr, GL_STATIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	gl_state::bind_buffer(GL_UNIFORM_BUFFER, 0);
 #else
 	lights_ubo = 0;
 #endif
@@ -56,7 +56,7 @@ particle_system::particle_system() {
 }
 
 particle_system::~particle_system() {
-	if(glIsBuffer(lights_ubo)) glDeleteBuffers(1, &lights_ubo);
+	if(glIsBuffer(lights_ubo)) gl_state::delete_buffers(1, &lights_ubo);
 	
 #if !defined(FLOOR_NO_OPENCL) && 0 // TODO: update compute stuff
 	if(data.ocl_pos_time_buffer != nullptr) ocl->delete_buffer(data.ocl_pos_time_buffer);
@@ -64,12 +64,12 @@ particle_system::~particle_system() {
 	if(data.ocl_distances != nullptr) ocl->delete_buffer(data.ocl_distances);
 	if(data.ocl_indices[0] != nullptr) ocl->delete_buffer(data.ocl_indices[0]);
 	if(data.ocl_indices[1] != nullptr) ocl->delete_buffer(data.ocl_indices[1]);
-	if(glIsBuffer(data.ocl_gl_pos_time_vbo)) glDeleteBuffers(1, &data.ocl_gl_pos_time_vbo);
-	if(glIsBuffer(data.ocl_gl_dir_vbo)) glDeleteBuffers(1, &data.ocl_gl_dir_vbo);
+	if(glIsBuffer(data.ocl_gl_pos_time_vbo)) gl_state::delete_buffers(1, &data.ocl_gl_pos_time_vbo);
+	if(glIsBuffer(data.ocl_gl_dir_vbo)) gl_state::delete_buffers(1, &data.ocl_gl_dir_vbo);
 #endif
 	
-	if(glIsBuffer(data.particle_indices_vbo[0])) glDeleteBuffers(1, &data.particle_indices_vbo[0]);
-	if(glIsBuffer(data.particle_indices_vbo[1])) glDeleteBuffers(1, &data.particle_indices_vbo[1]);
+	if(glIsBuffer(data.particle_indices_vbo[0])) gl_state::delete_buffers(1, &data.particle_indices_vbo[0]);
+	if(glIsBuffer(data.particle_indices_vbo[1])) gl_state::delete_buffers(1, &data.particle_indices_vbo[1]);
 }
 
 void particle_system::set_type(particle_system::EMITTER_TYPE type_) {
@@ -0,0 +1,151 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "frame_sync.hpp"
+#include <chrono>
+
+// a single wait is split into 100ms steps, give up after 5s (lost context, driver hang, ...)
+static constexpr GLuint64 wait_step_ns = 100000000ull;
+static constexpr size_t max_wait_steps = 50;
+
+frame_sync::frame_sync(const size_t frames_in_flight_) {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	// sync objects are core in opengl 3.2 (the minimum requirement) and opengl es 3.0
+	for(auto& fence : fences) fence = nullptr;
+	sync_support = true;
+#endif
+	set_frames_in_flight(frames_in_flight_);
+	log_debug("frame sync: %u frames in flight", frames_in_flight);
+}
+
+frame_sync::~frame_sync() {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	for(auto& fence : fences) {
+		if(fence != nullptr) glDeleteSync(fence);
+		fence = nullptr;
+	}
+#endif
+}
+
+void frame_sync::set_frames_in_flight(const size_t count) {
+	wait_idle();
+	frames_in_flight = (sync_support ? std::min(std::max(count, size_t(1)), size_t(A2E_CONCURRENT_FRAMES)) : 1);
+	cur_slot = 0;
+}
+
+size_t frame_sync::get_frames_in_flight() const {
+	return frames_in_flight;
+}
+
+size_t frame_sync::get_frame_slot() const {
+	return cur_slot;
+}
+
+uint64_t frame_sync::get_frame_number() const {
+	return frame_number;
+}
+
+const frame_sync::stats& frame_sync::get_stats() const {
+	return cur_stats;
+}
+
+void frame_sync::begin_frame() {
+	frame_number++;
+	cur_slot = (cur_slot + 1) % frames_in_flight;
+	cur_stats.last_wait_time = 0.0f;
+
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	if(fences[cur_slot] == nullptr) return;
+	
+	// don't count frames as waiting if the gpu has already finished them
+	if(is_slot_available(cur_slot)) {
+		glDeleteSync(fences[cur_slot]);
+		fences[cur_slot] = nullptr;
+		return;
+	}
+	
+	const auto start = chrono::steady_clock::now();
+	wait_fence(fences[cur_slot]);
+	cur_stats.last_wait_time = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+	cur_stats.total_wait_time += cur_stats.last_wait_time;
+	cur_stats.wait_count++;
+#endif
+}
+
+void frame_sync::end_frame() {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	if(!sync_support) return;
+	if(fences[cur_slot] != nullptr) glDeleteSync(fences[cur_slot]); // end_frame without begin_frame
+	fences[cur_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+void frame_sync::wait_idle() {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	for(auto& fence : fences) {
+		if(fence != nullptr) wait_fence(fence);
+	}
+#endif
+}
+
+bool frame_sync::is_slot_available(const size_t& slot floor_unused) const {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	if(fences[slot] == nullptr) return true;
+	GLint status = GL_UNSIGNALED;
+	glGetSynciv(fences[slot], GL_SYNC_STATUS, 1, nullptr, &status);
+	return (status == GL_SIGNALED);
+#else
+	return true;
+#endif
+}
+
+bool frame_sync::check_writable(const size_t& slot, const char* name) const {
+	if(slot != cur_slot) {
+		log_error("%s: writing slot %u during frame %u, which uses slot %u!", name, slot, frame_number, cur_slot);
+		cur_stats.assertion_failures++;
+		return false;
+	}
+	if(!is_slot_available(slot)) {
+		log_error("%s: slot %u is still in use by the gpu (frame %u)!", name, slot, frame_number);
+		cur_stats.assertion_failures++;
+		return false;
+	}
+	return true;
+}
+
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+void frame_sync::wait_fence(GLsync& fence) {
+	// the first wait must flush, otherwise the fence might never be submitted
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	for(size_t step = 0; ; step++) {
+		const GLenum result = glClientWaitSync(fence, flags, wait_step_ns);
+		if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+		if(result == GL_WAIT_FAILED) {
+			log_error("failed to wait on frame fence!");
+			break;
+		}
+		if(step + 1 >= max_wait_steps) {
+			log_error("frame fence wasn't signaled after %ums!", (max_wait_steps * wait_step_ns) / 1000000ull);
+			break;
+		}
+		flags = 0;
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+#endif
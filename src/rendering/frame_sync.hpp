@@ -0,0 +1,86 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_FRAME_SYNC_HPP__
+#define __A2E_FRAME_SYNC_HPP__
+
+//! max amount of frames that can be queued on the gpu at the same time
+//! (-> amount of slots of all per-frame gpu resources)
+#define A2E_CONCURRENT_FRAMES 3
+
+#include "global.hpp"
+
+//! cpu/gpu frame pipelining: while the gpu still executes up to (frames in flight - 1) previous frames, the cpu
+//! already prepares and submits the next one. every per-frame gpu resource that is written by the cpu (dynamic
+//! buffers, uniform rings, ...) has one slot per frame in flight, a frame only writes the slot of get_frame_slot().
+//! begin_frame waits on the fence of the frame that last used that slot, so a slot is never written while the gpu
+//! might still read it (-> writes can be unsynchronized, no buffer orphaning necessary).
+//! NOTE: without sync object support (opengl es 2.0), only one frame is used and no fences are created
+//! NOTE: only use this from the thread that owns the gl context
+class frame_sync {
+public:
+	frame_sync(const size_t frames_in_flight = 2);
+	~frame_sync();
+	
+	//! 1 .. A2E_CONCURRENT_FRAMES (waits until the gpu is idle)
+	void set_frames_in_flight(const size_t count);
+	size_t get_frames_in_flight() const;
+	
+	//! waits until the gpu has finished the frame that previously used the next slot and makes it the current one
+	void begin_frame();
+	//! inserts the fence of the current frame (must be called after all commands of the frame have been submitted)
+	void end_frame();
+	//! waits for all frames in flight
+	void wait_idle();
+	
+	//! slot of the current frame (0 .. get_frames_in_flight() - 1)
+	size_t get_frame_slot() const;
+	//! incremented by each begin_frame()
+	uint64_t get_frame_number() const;
+	
+	//! returns true if the gpu has finished all commands that used the slot (non-blocking)
+	bool is_slot_available(const size_t& slot) const;
+	//! fence-based assertion: logs an error (and returns false) if the slot is not the one of the current frame or if
+	//! the gpu might still use it (call this before writing a per-frame resource, name is only used for the message)
+	bool check_writable(const size_t& slot, const char* name) const;
+	
+	struct stats {
+		size_t wait_count = 0; // amount of begin_frame() calls that had to wait on the gpu
+		float last_wait_time = 0.0f; // ms
+		float total_wait_time = 0.0f; // ms
+		size_t assertion_failures = 0;
+	};
+	const stats& get_stats() const;
+
+protected:
+	bool sync_support = false;
+	size_t frames_in_flight = 1;
+	size_t cur_slot = 0;
+	uint64_t frame_number = 0;
+	mutable stats cur_stats;
+	
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	// fence of the last frame that used each slot (nullptr if there is none or it has already been waited on)
+	GLsync fences[A2E_CONCURRENT_FRAMES];
+	//! blocks until the fence is signaled (and deletes it)
+	void wait_fence(GLsync& fence);
+#endif
+
+};
+
+#endif
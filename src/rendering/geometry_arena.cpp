@@ -0,0 +1,214 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "geometry_arena.hpp"
+#include "rendering/extensions.hpp"
+#include "rendering/gl_state.hpp"
+
+constexpr size_t geometry_arena::vertex_stride;
+
+// initial buffer sizes: 2 MiB of vertices, 1.5 MiB of indices
+static constexpr size_t min_vertex_capacity = 65536;
+static constexpr size_t min_index_capacity = 393216;
+
+geometry_arena::geometry_arena(ext* exts floor_unused) {
+#if !defined(__APPLE__)
+	multi_draw_support = (exts->is_gl_version(4, 3) ||
+						  (exts->is_ext_supported("GL_ARB_multi_draw_indirect") &&
+						   exts->is_ext_supported("GL_ARB_base_instance")));
+#else
+	multi_draw_support = false; // max opengl 4.1
+#endif
+	log_debug("geometry arena: multi-draw indirect %s", (multi_draw_support ? "supported" : "not supported"));
+}
+
+geometry_arena::~geometry_arena() {
+	for(GLuint* vbo : { &vbo_vertices, &vbo_indices, &vbo_commands, &vbo_matrices }) {
+		if(*vbo != 0 && glIsBuffer(*vbo)) { gl_state::delete_buffers(1, vbo); }
+		*vbo = 0;
+	}
+}
+
+geometry_arena::allocation geometry_arena::allocate(const void* vertex_data, const size_t& vertex_count,
+													const uint32_t* index_data, const size_t& index_count) {
+	allocation alloc;
+	alloc.vertices = allocate_range(vertex_allocator, vbo_vertices, vertex_stride, vertex_count, min_vertex_capacity);
+	if(alloc.vertices == range_allocator::invalid_handle) return alloc;
+	alloc.indices = allocate_range(index_allocator, vbo_indices, sizeof(uint32_t), index_count, min_index_capacity);
+	if(alloc.indices == range_allocator::invalid_handle) {
+		vertex_allocator.free(alloc.vertices);
+		alloc.vertices = range_allocator::invalid_handle;
+		return alloc;
+	}
+	
+	// note: GL_COPY_WRITE_BUFFER is used for all uploads, so that no vao state is modified
+	update_vertices(alloc, vertex_data);
+	if(index_count > 0) {
+		gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, vbo_indices);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(index_allocator.get_offset(alloc.indices) * sizeof(uint32_t)),
+						(GLsizeiptr)(index_count * sizeof(uint32_t)), index_data);
+		gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	return alloc;
+}
+
+void geometry_arena::update_vertices(const allocation& alloc, const void* vertex_data) {
+	const size_t vertex_count = vertex_allocator.get_size(alloc.vertices);
+	if(vertex_count == 0) return;
+	gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, vbo_vertices);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(vertex_allocator.get_offset(alloc.vertices) * vertex_stride),
+					(GLsizeiptr)(vertex_count * vertex_stride), vertex_data);
+	gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void geometry_arena::free(allocation& alloc) {
+	if(alloc.vertices != range_allocator::invalid_handle) vertex_allocator.free(alloc.vertices);
+	if(alloc.indices != range_allocator::invalid_handle) index_allocator.free(alloc.indices);
+	alloc = allocation {};
+}
+
+GLint geometry_arena::get_base_vertex(const allocation& alloc) const {
+	return (GLint)vertex_allocator.get_offset(alloc.vertices);
+}
+
+size_t geometry_arena::get_first_index(const allocation& alloc) const {
+	return index_allocator.get_offset(alloc.indices);
+}
+
+range_allocator::handle geometry_arena::allocate_range(range_allocator& allocator, GLuint& buffer,
+													   const size_t& element_size, const size_t& size,
+													   const size_t& min_capacity) {
+	range_allocator::handle alloc = allocator.allocate(size);
+	if(alloc != range_allocator::invalid_handle) return alloc;
+	
+	if(allocator.get_free_size() >= size && allocator.get_free_size() >= allocator.get_capacity() / 4) {
+		// enough free space, but too fragmented -> only defragment
+		rebuild_buffer(allocator, buffer, element_size, allocator.get_capacity(), true);
+	}
+	else {
+		// grow (at least doubling the size), this also defragments the buffer, since all data is copied anyway
+		const size_t capacity = std::max(std::max(allocator.get_capacity() * 2, allocator.get_used_size() + size),
+										 min_capacity);
+		rebuild_buffer(allocator, buffer, element_size, capacity, true);
+	}
+	
+	alloc = allocator.allocate(size);
+	if(alloc == range_allocator::invalid_handle) {
+		log_error("failed to allocate %u elements in the geometry arena", size);
+	}
+	return alloc;
+}
+
+void geometry_arena::rebuild_buffer(range_allocator& allocator, GLuint& buffer, const size_t& element_size,
+									const size_t& capacity, const bool defragment) {
+	// the data can't be moved within the same buffer (the source and destination ranges might overlap)
+	// -> copy everything into a new buffer
+	GLuint new_buffer = 0;
+	glGenBuffers(1, &new_buffer);
+	gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, new_buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(capacity * element_size), nullptr, GL_STATIC_DRAW);
+	
+	if(buffer != 0) {
+		gl_state::bind_buffer(GL_COPY_READ_BUFFER, buffer);
+		if(defragment) {
+			const auto relocations = allocator.defragment();
+			
+			// merge relocations of adjacent ranges (that stay adjacent) into one copy
+			size_t i = 0;
+			while(i < relocations.size()) {
+				const size_t src_offset = relocations[i].src_offset;
+				const size_t dst_offset = relocations[i].dst_offset;
+				size_t size = relocations[i].size;
+				for(i++; i < relocations.size() && relocations[i].src_offset == src_offset + size; i++) {
+					size += relocations[i].size;
+				}
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+									(GLintptr)(src_offset * element_size), (GLintptr)(dst_offset * element_size),
+									(GLsizeiptr)(size * element_size));
+			}
+		}
+		else if(allocator.get_capacity() > 0) {
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+								(GLsizeiptr)(allocator.get_capacity() * element_size));
+		}
+		gl_state::bind_buffer(GL_COPY_READ_BUFFER, 0);
+		gl_state::delete_buffers(1, &buffer);
+	}
+	gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+	
+	allocator.grow(capacity);
+	buffer = new_buffer;
+	buffer_generation++;
+}
+
+void geometry_arena::defragment() {
+	if(vertex_allocator.get_free_range_count() > 1) {
+		rebuild_buffer(vertex_allocator, vbo_vertices, vertex_stride, vertex_allocator.get_capacity(), true);
+	}
+	if(index_allocator.get_free_range_count() > 1) {
+		rebuild_buffer(index_allocator, vbo_indices, sizeof(uint32_t), index_allocator.get_capacity(), true);
+	}
+}
+
+void geometry_arena::clear_commands() {
+	commands.clear();
+	command_matrices.clear();
+}
+
+size_t geometry_arena::add_command(const allocation& alloc, const size_t& first_index, const size_t& index_count,
+								   const matrix4f& world) {
+	const size_t idx = commands.size();
+	commands.push_back({
+		(GLuint)index_count,
+		1,
+		(GLuint)(get_first_index(alloc) + first_index),
+		get_base_vertex(alloc),
+		(GLuint)idx
+	});
+	command_matrices.emplace_back(world);
+	return idx;
+}
+
+void geometry_arena::upload_commands() {
+	if(commands.empty()) return;
+	
+	// orphan the previous contents (might still be in use by the gpu)
+	if(vbo_matrices == 0) glGenBuffers(1, &vbo_matrices);
+	gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, vbo_matrices);
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(command_matrices.size() * sizeof(matrix4f)),
+				 command_matrices.data(), GL_STREAM_DRAW);
+	
+	// the command buffer is only needed for actual multi-draw calls (the fallback reads the commands on the cpu)
+	if(multi_draw_support) {
+		if(vbo_commands == 0) glGenBuffers(1, &vbo_commands);
+		gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, vbo_commands);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)(commands.size() * sizeof(draw_command)),
+					 commands.data(), GL_STREAM_DRAW);
+	}
+	gl_state::bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void geometry_arena::draw_commands(const size_t& first floor_unused, const size_t& count floor_unused) const {
+#if !defined(__APPLE__)
+	if(!multi_draw_support || count == 0) return;
+	gl_state::bind_buffer(GL_DRAW_INDIRECT_BUFFER, vbo_commands);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(first * sizeof(draw_command)),
+								(GLsizei)count, 0);
+	gl_state::bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+#endif
+}
@@ -0,0 +1,118 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_GEOMETRY_ARENA_HPP__
+#define __A2E_GEOMETRY_ARENA_HPP__
+
+#include "global.hpp"
+#include "rendering/range_allocator.hpp"
+#include <floor/math/matrix4.hpp>
+
+class ext;
+
+//! stores the geometry of many static meshes in one large vertex buffer and one large index buffer, so that draws of
+//! different meshes can be batched into a single multi-draw indirect call (if supported, see add_command).
+//! the buffers grow as needed and are defragmented when they run out of contiguous space. since this moves the
+//! data, the offsets of an allocation must be queried each time it is drawn (get_base_vertex/get_first_index).
+//! NOTE: only use this from the thread that owns the gl context
+class geometry_arena {
+public:
+	geometry_arena(ext* exts);
+	~geometry_arena();
+	
+	//! interleaved vertex layout: position (float3), normal/binormal/tangent (10:10:10:2 snorm each), tex coord (float2)
+	//! (this is the compact vertex format of a2estatic, always with full precision tex coords)
+	static constexpr size_t vertex_stride = 32;
+	
+	struct allocation {
+		range_allocator::handle vertices = range_allocator::invalid_handle;
+		range_allocator::handle indices = range_allocator::invalid_handle;
+		bool is_valid() const { return (vertices != range_allocator::invalid_handle); }
+	};
+	//! uploads the vertices (vertex_stride bytes each) and the 32-bit indices (relative to the first vertex)
+	allocation allocate(const void* vertex_data, const size_t& vertex_count,
+						const uint32_t* index_data, const size_t& index_count);
+	//! replaces all vertices of the allocation
+	void update_vertices(const allocation& alloc, const void* vertex_data);
+	void free(allocation& alloc);
+	
+	GLint get_base_vertex(const allocation& alloc) const;
+	size_t get_first_index(const allocation& alloc) const;
+	GLuint get_vertex_buffer() const { return vbo_vertices; }
+	GLuint get_index_buffer() const { return vbo_indices; }
+	//! incremented each time the buffers are re-created (anything that references them, e.g. a vao, must be rebuilt)
+	size_t get_buffer_generation() const { return buffer_generation; }
+	
+	//! packs all allocations to the front of the buffers
+	void defragment();
+	
+	//! returns the amount of used/allocated vertices and indices
+	size_t get_used_vertex_count() const { return vertex_allocator.get_used_size(); }
+	size_t get_vertex_capacity() const { return vertex_allocator.get_capacity(); }
+	size_t get_used_index_count() const { return index_allocator.get_used_size(); }
+	size_t get_index_capacity() const { return index_allocator.get_capacity(); }
+	
+	// multi-draw indirect submission: the commands are built on the cpu (e.g. for all sorted draws of a pass),
+	// uploaded once and then drawn in ranges. each command draws a single instance, its world matrix is stored at
+	// its base instance in the matrix buffer (-> "instance_matrix" attribute with a divisor of 1).
+	//! GL_DrawElementsIndirectCommand
+	struct draw_command {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+	//! opengl 4.3 or GL_ARB_multi_draw_indirect + GL_ARB_base_instance
+	bool is_multi_draw_supported() const { return multi_draw_support; }
+	
+	void clear_commands();
+	//! adds a command for "index_count" indices of the allocation (first_index: relative to its first index)
+	size_t add_command(const allocation& alloc, const size_t& first_index, const size_t& index_count,
+					   const matrix4f& world);
+	size_t get_command_count() const { return commands.size(); }
+	const draw_command& get_command(const size_t& idx) const { return commands[idx]; }
+	//! uploads all commands and their world matrices (must be called before draw_commands)
+	void upload_commands();
+	GLuint get_matrix_buffer() const { return vbo_matrices; }
+	//! draws the specified commands with a single multi-draw indirect call (the vao must already be set up)
+	void draw_commands(const size_t& first, const size_t& count) const;
+
+protected:
+	range_allocator vertex_allocator;
+	range_allocator index_allocator;
+	GLuint vbo_vertices = 0;
+	GLuint vbo_indices = 0;
+	size_t buffer_generation = 0;
+	
+	//! tries to allocate "size" elements, the buffer is defragmented/grown if there is no contiguous free range
+	range_allocator::handle allocate_range(range_allocator& allocator, GLuint& buffer, const size_t& element_size,
+										   const size_t& size, const size_t& min_capacity);
+	//! re-creates the buffer with the specified capacity (>= the current one), optionally defragmenting it
+	void rebuild_buffer(range_allocator& allocator, GLuint& buffer, const size_t& element_size,
+						const size_t& capacity, const bool defragment);
+	
+	bool multi_draw_support = false;
+	vector<draw_command> commands;
+	vector<matrix4f> command_matrices;
+	GLuint vbo_commands = 0;
+	GLuint vbo_matrices = 0;
+	
+};
+
+#endif
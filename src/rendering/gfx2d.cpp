@@ -26,6 +26,11 @@
 gl_shader gfx2d::simple_shd = nullptr;
 gl_shader gfx2d::gradient_shd = nullptr;
 gl_shader gfx2d::texture_shd = nullptr;
+array<size_t, 6> gfx2d::gradient_option_ids;
+size_t gfx2d::tex_option_default = 0;
+size_t gfx2d::tex_option_passthrough = 0;
+size_t gfx2d::tex_option_madd_color = 0;
+uint32_t gfx2d::tex_array_combiner = 0;
 shader* gfx2d::eshd = nullptr;
 ext* gfx2d::exts = nullptr;
 
@@ -41,19 +46,28 @@ void gfx2d::init() {
 	exts = engine::get_ext();
 	eshd = engine::get_shader();
 	
+	// resolve shader permutation ids once
+	for(size_t i = 0; i < gradient_option_ids.size(); i++) {
+		gradient_option_ids[i] = eshd->get_option_id(gradient_type_to_string((GRADIENT_TYPE)i));
+	}
+	tex_option_default = eshd->get_option_id("#");
+	tex_option_passthrough = eshd->get_option_id("passthrough");
+	tex_option_madd_color = eshd->get_option_id("madd_color");
+	tex_array_combiner = eshd->get_combiner_bit("*tex_array");
+	
 	//
 	floor::get_event()->add_internal_event_handler(evt_handler, EVENT_TYPE::SHADER_RELOAD);
 	
 	// create fullscreen triangle/quad vbo
 	glGenBuffers(1, &vbo_fullscreen_triangle);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_fullscreen_triangle);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_fullscreen_triangle);
 	glBufferData(GL_ARRAY_BUFFER, 3 * sizeof(float2), fullscreen_triangle, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	
 	glGenBuffers(1, &vbo_fullscreen_quad);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_fullscreen_quad);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_fullscreen_quad);
 	glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(float2), fullscreen_quad, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	
 	//
 	glGenBuffers(1, &vbo_primitive);
@@ -63,9 +77,9 @@ void gfx2d::init() {
 }
 
 void gfx2d::destroy() {
-	if(glIsBuffer(vbo_fullscreen_triangle)) glDeleteBuffers(1, &vbo_fullscreen_triangle);
-	if(glIsBuffer(vbo_fullscreen_quad)) glDeleteBuffers(1, &vbo_fullscreen_quad);
-	if(glIsBuffer(vbo_primitive)) glDeleteBuffers(1, &vbo_primitive);
+	if(glIsBuffer(vbo_fullscreen_triangle)) gl_state::delete_buffers(1, &vbo_fullscreen_triangle);
+	if(glIsBuffer(vbo_fullscreen_quad)) gl_state::delete_buffers(1, &vbo_fullscreen_quad);
+	if(glIsBuffer(vbo_primitive)) gl_state::delete_buffers(1, &vbo_primitive);
 	
 	floor::get_event()->remove_event_handler(evt_handler);
 }
@@ -85,21 +99,21 @@ bool gfx2d::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj floor_un
 }
 
 void gfx2d::draw_fullscreen_triangle() {
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_fullscreen_triangle);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_fullscreen_triangle);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 	glEnableVertexAttribArray(0);
 	glDrawArrays(GL_TRIANGLES, 0, 3);
 	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 }
 
 void gfx2d::draw_fullscreen_quad() {
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_fullscreen_quad);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_fullscreen_quad);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
 	glEnableVertexAttribArray(0);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 }
 
 GLuint gfx2d::get_fullscreen_triangle_vbo() {
@@ -110,7 +124,7 @@ GLuint gfx2d::get_fullscreen_quad_vbo() {
 	return vbo_fullscreen_quad;
 }
 
-void gfx2d::compute_ellipsoid_points(vector<float2>& dst_points, const float& radius_lr, const float& radius_tb, const float& start_angle, const float& end_angle) {
+void gfx2d::compute_ellipsoid_points(frame_vector<float2>& dst_points, const float& radius_lr, const float& radius_tb, const float& start_angle, const float& end_angle) {
 	//
 	const float angle_size = (end_angle >= start_angle ? (end_angle - start_angle) : (360.0f + end_angle - start_angle)) / 360.0f;
 	const float steps_per_quadrant_lr = ceilf(radius_lr); // "per 90° or 0.25 angle size"
@@ -130,7 +144,7 @@ void gfx2d::compute_ellipsoid_points(vector<float2>& dst_points, const float& ra
 
 void gfx2d::upload_points_and_draw(const gl_shader& shd, const primitive_properties& props) {
 	// points
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_primitive);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_primitive);
 	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(sizeof(float2) * props.points.size()), &props.points[0], GL_STREAM_DRAW);
 	glVertexAttribPointer((GLuint)shd->get_attribute_position("in_vertex"),
 						  2, GL_FLOAT, GL_FALSE, 0, nullptr);
@@ -141,24 +155,24 @@ void gfx2d::upload_points_and_draw(const gl_shader& shd, const primitive_propert
 	
 	// disable everything
 	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	shd->disable();
 }
 
 void gfx2d::set_blend_mode(const BLEND_MODE mode) {
 	switch(mode) {
 		case BLEND_MODE::ADD:
-			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+			gl_state::blend_func(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
 			break;
 		case BLEND_MODE::PRE_MUL:
-			glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+			gl_state::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 			break;
 		case BLEND_MODE::COLOR:
-			glBlendFunc(GL_SRC_COLOR, GL_ONE_MINUS_SRC_COLOR);
+			gl_state::blend_func(GL_SRC_COLOR, GL_ONE_MINUS_SRC_COLOR);
 			break;
 		case BLEND_MODE::DEFAULT:
 		case BLEND_MODE::ALPHA:
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 			break;
 	}
 }
@@ -24,6 +24,7 @@
 
 #include "rendering/shader.hpp"
 #include "rendering/extensions.hpp"
+#include "frame_allocator.hpp"
 
 #define __GFX2D_POINT_COMPUTE_FUNCS(F, DS_FUNC, DS_NAME) \
 F(gfx2d::point_compute_point, point, DS_FUNC, DS_NAME) \
@@ -117,8 +118,9 @@ public:
 	// some macro voodoo for user convenience (e.g. draw_rectangle_gradient(...))
 	__GFX2D_DRAW_STYLE_FUNCS(__GFX2D_DEFINE_DRAW_FUNC, __GFX2D_POINT_COMPUTE_FUNCS)
 	
+	//! NOTE: the points are transient frame memory -> properties must not be kept beyond the frame they're drawn in
 	struct primitive_properties {
-		vector<float2> points;
+		frame_vector<float2> points;
 		float4 extent;
 		GLenum primitive_type;
 		union {
@@ -160,7 +162,7 @@ public:
 	static GLuint get_fullscreen_triangle_vbo();
 	static GLuint get_fullscreen_quad_vbo();
 
-	static void compute_ellipsoid_points(vector<float2>& dst_points, const float& radius_lr, const float& radius_tb, const float& start_angle, const float& end_angle);
+	static void compute_ellipsoid_points(frame_vector<float2>& dst_points, const float& radius_lr, const float& radius_tb, const float& start_angle, const float& end_angle);
 	
 protected:
 	static shader* eshd;
@@ -169,6 +171,13 @@ protected:
 	static gl_shader simple_shd;
 	static gl_shader gradient_shd;
 	static gl_shader texture_shd;
+	
+	// shader permutation ids (resolved once in init(), so that drawing doesn't need any strings)
+	static array<size_t, 6> gradient_option_ids; // indexed by GRADIENT_TYPE
+	static size_t tex_option_default;
+	static size_t tex_option_passthrough;
+	static size_t tex_option_madd_color;
+	static uint32_t tex_array_combiner;
 			
 	static GLuint vbo_primitive;
 	
@@ -414,9 +423,7 @@ struct gfx2d::draw_style_gradient {
 					 const float4& stops,
 					 const vector<float4>& colors) {
 		// draw
-		const string option = gradient_type_to_string(type);
-		
-		gradient_shd->use(option);
+		gradient_shd->use(gradient_option_ids[(size_t)type], 0);
 		gradient_shd->uniform("mvpm", *engine::get_mvp_matrix());
 		
 		const size_t color_count = std::min(colors.size(), size_t(4));
@@ -442,7 +449,7 @@ struct gfx2d::draw_style_texture {
 					 const float2 bottom_left = float2(0.0f),
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
-		draw(props, texture, false, 0.0f, bottom_left, top_right, draw_depth, "#");
+		draw(props, texture, false, 0.0f, bottom_left, top_right, draw_depth, tex_option_default);
 	}
 	static void draw(const primitive_properties& props,
 					 const GLuint texture,
@@ -451,7 +458,7 @@ struct gfx2d::draw_style_texture {
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
 		draw(props, texture, false, 0.0f, bottom_left, top_right, draw_depth,
-			 (passthrough ? "passthrough" : "#"));
+			 (passthrough ? tex_option_passthrough : tex_option_default));
 	}
 	static void draw(const primitive_properties& props,
 					 const GLuint texture,
@@ -460,7 +467,7 @@ struct gfx2d::draw_style_texture {
 					 const float2 bottom_left = float2(0.0f),
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
-		draw(props, texture, false, 0.0f, mul_color, add_color, bottom_left, top_right, draw_depth, "madd_color");
+		draw(props, texture, false, 0.0f, mul_color, add_color, bottom_left, top_right, draw_depth, tex_option_madd_color);
 	}
 	static void draw(const primitive_properties& props,
 					 const GLuint texture,
@@ -474,9 +481,8 @@ struct gfx2d::draw_style_texture {
 					 const float2 bottom_left = float2(0.0f),
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
-		const string option = gradient_type_to_string(type);
 		draw(props, texture, false, 0.0f, mul_color, add_color, gradient_stops, gradient_colors, gradient_mul_interpolator,
-			 gradient_add_interpolator, bottom_left, top_right, draw_depth, option);
+			 gradient_add_interpolator, bottom_left, top_right, draw_depth, gradient_option_ids[(size_t)type]);
 	}
 	
 	// texture 2d array
@@ -486,7 +492,7 @@ struct gfx2d::draw_style_texture {
 					 const float2 bottom_left = float2(0.0f),
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
-		draw(props, texture, true, layer, bottom_left, top_right, draw_depth, "#");
+		draw(props, texture, true, layer, bottom_left, top_right, draw_depth, tex_option_default);
 	}
 	static void draw(const primitive_properties& props,
 					 const GLuint texture,
@@ -496,7 +502,7 @@ struct gfx2d::draw_style_texture {
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
 		draw(props, texture, true, layer, bottom_left, top_right, draw_depth,
-			 (passthrough ? "passthrough" : "#"));
+			 (passthrough ? tex_option_passthrough : tex_option_default));
 	}
 	static void draw(const primitive_properties& props,
 					 const GLuint texture,
@@ -506,7 +512,7 @@ struct gfx2d::draw_style_texture {
 					 const float2 bottom_left = float2(0.0f),
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
-		draw(props, texture, true, layer, mul_color, add_color, bottom_left, top_right, draw_depth, "madd_color");
+		draw(props, texture, true, layer, mul_color, add_color, bottom_left, top_right, draw_depth, tex_option_madd_color);
 	}
 	static void draw(const primitive_properties& props,
 					 const GLuint texture,
@@ -521,9 +527,8 @@ struct gfx2d::draw_style_texture {
 					 const float2 bottom_left = float2(0.0f),
 					 const float2 top_right = float2(1.0f),
 					 const float draw_depth = 0.0f) {
-		const string option = gradient_type_to_string(type);
 		draw(props, texture, true, layer, mul_color, add_color, gradient_stops, gradient_colors, gradient_mul_interpolator,
-			 gradient_add_interpolator, bottom_left, top_right, draw_depth, option);
+			 gradient_add_interpolator, bottom_left, top_right, draw_depth, gradient_option_ids[(size_t)type]);
 	}
 	
 protected:
@@ -534,8 +539,8 @@ protected:
 					 const float2 bottom_left,
 					 const float2 top_right,
 					 const float draw_depth,
-					 const string& option) {
-		texture_shd->use(option, (is_tex_array ? set<string> { "*tex_array" } : set<string> {}));
+					 const size_t& option_id) {
+		texture_shd->use(option_id, (is_tex_array ? tex_array_combiner : 0));
 		const matrix4f mvpm(matrix4f().translate(0.0f, 0.0f, draw_depth) * *engine::get_mvp_matrix());
 		texture_shd->uniform("mvpm", mvpm);
 		texture_shd->uniform("extent", props.extent);
@@ -555,8 +560,8 @@ protected:
 					 const float2 bottom_left,
 					 const float2 top_right,
 					 const float draw_depth,
-					 const string& option) {
-		texture_shd->use(option, (is_tex_array ? set<string> { "*tex_array" } : set<string> {}));
+					 const size_t& option_id) {
+		texture_shd->use(option_id, (is_tex_array ? tex_array_combiner : 0));
 		const matrix4f mvpm(matrix4f().translate(0.0f, 0.0f, draw_depth) * *engine::get_mvp_matrix());
 		texture_shd->uniform("mvpm", mvpm);
 		texture_shd->uniform("extent", props.extent);
@@ -583,8 +588,8 @@ protected:
 					 const float2 bottom_left,
 					 const float2 top_right,
 					 const float draw_depth,
-					 const string& option) {
-		texture_shd->use(option, (is_tex_array ? set<string> { "*tex_array" } : set<string> {}));
+					 const size_t& option_id) {
+		texture_shd->use(option_id, (is_tex_array ? tex_array_combiner : 0));
 		const matrix4f mvpm(matrix4f().translate(0.0f, 0.0f, draw_depth) * *engine::get_mvp_matrix());
 		texture_shd->uniform("mvpm", mvpm);
 		texture_shd->uniform("extent", props.extent);
@@ -619,11 +624,11 @@ struct gfx2d::draw_style_border {
 		border_props.has_mid_point = 0;
 		const float2 center((props.extent.x + props.extent.z) * 0.5f,
 							(props.extent.y + props.extent.w) * 0.5f);
-		const vector<float2>* points = &props.points;
+		const frame_vector<float2>* points = &props.points;
 		const size_t orig_point_count = points->size();
 		border_props.points.reserve(orig_point_count * 2 + (props.border_connect_start_end_point ? 2 : 0)); // we'll need twice as much
 		
-		vector<float2> swapped_points;
+		frame_vector<float2> swapped_points;
 		if(props.border_swap_strip_points) {
 			swapped_points.assign(cbegin(*points), cend(*points));
 			std::swap(swapped_points[2], swapped_points[3]);
@@ -0,0 +1,384 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gl_state.hpp"
+
+constexpr GLuint gl_state::unknown;
+constexpr size_t gl_state::cap_count;
+constexpr size_t gl_state::buffer_target_count;
+constexpr size_t gl_state::max_texture_units;
+constexpr size_t gl_state::texture_target_count;
+
+static constexpr size_t invalid_index = ~size_t(0);
+
+gl_state::backend gl_state::gl {
+	[](GLenum cap) { glEnable(cap); },
+	[](GLenum cap) { glDisable(cap); },
+	[](GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+		glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+	},
+	[](GLenum func) { glDepthFunc(func); },
+	[](GLboolean flag) { glDepthMask(flag); },
+	[](GLenum mode) { glCullFace(mode); },
+	[](GLenum mode) { glFrontFace(mode); },
+	[](GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) { glColorMask(red, green, blue, alpha); },
+	[](GLenum target, GLuint buffer) { glBindBuffer(target, buffer); },
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	[](GLenum target, GLuint index, GLuint buffer) { glBindBufferBase(target, index, buffer); },
+#else
+	[](GLenum target floor_unused, GLuint index floor_unused, GLuint buffer floor_unused) {
+		log_error("glBindBufferBase is not supported in OpenGL ES 2.0!");
+	},
+#endif
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	[](GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		glBindBufferRange(target, index, buffer, offset, size);
+	},
+#else
+	[](GLenum target floor_unused, GLuint index floor_unused, GLuint buffer floor_unused,
+	   GLintptr offset floor_unused, GLsizeiptr size floor_unused) {
+		log_error("glBindBufferRange is not supported in OpenGL ES 2.0!");
+	},
+#endif
+	[](GLuint program) { glUseProgram(program); },
+	[](GLenum texture_unit) { glActiveTexture(texture_unit); },
+	[](GLenum target, GLuint texture) { glBindTexture(target, texture); },
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	[](GLuint vao) { glBindVertexArray(vao); },
+#else
+	[](GLuint vao floor_unused) {
+		log_error("glBindVertexArray is not supported in OpenGL ES 2.0!");
+	},
+#endif
+	[](GLsizei count, const GLuint* buffers) { glDeleteBuffers(count, buffers); },
+	[](GLsizei count, const GLuint* textures) { glDeleteTextures(count, textures); },
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	[](GLsizei count, const GLuint* vaos) { glDeleteVertexArrays(count, vaos); },
+#else
+	[](GLsizei count floor_unused, const GLuint* vaos floor_unused) {
+		log_error("glDeleteVertexArrays is not supported in OpenGL ES 2.0!");
+	},
+#endif
+};
+
+gl_state::frame_counters gl_state::counters;
+gl_state::frame_counters gl_state::last_counters;
+
+array<int8_t, gl_state::cap_count> gl_state::caps;
+array<GLenum, 4> gl_state::blend;
+GLenum gl_state::depth_func_state;
+int8_t gl_state::depth_mask_state;
+GLenum gl_state::cull_face_state;
+GLenum gl_state::front_face_state;
+int8_t gl_state::color_mask_state;
+array<GLuint, gl_state::buffer_target_count> gl_state::buffers;
+GLuint gl_state::program;
+GLenum gl_state::active_unit;
+array<array<GLuint, gl_state::texture_target_count>, gl_state::max_texture_units> gl_state::textures;
+GLuint gl_state::vertex_array;
+
+void gl_state::invalidate() {
+	caps.fill(-1);
+	blend.fill(unknown);
+	depth_func_state = unknown;
+	depth_mask_state = -1;
+	cull_face_state = unknown;
+	front_face_state = unknown;
+	color_mask_state = -1;
+	buffers.fill(unknown);
+	program = unknown;
+	active_unit = unknown;
+	for(auto& unit : textures) {
+		unit.fill(unknown);
+	}
+	vertex_array = unknown;
+}
+
+size_t gl_state::cap_index(const GLenum cap) {
+	switch(cap) {
+		case GL_BLEND: return 0;
+		case GL_CULL_FACE: return 1;
+		case GL_DEPTH_TEST: return 2;
+		case GL_STENCIL_TEST: return 3;
+		case GL_SCISSOR_TEST: return 4;
+		case GL_POLYGON_OFFSET_FILL: return 5;
+		default: break;
+	}
+	return invalid_index;
+}
+
+size_t gl_state::buffer_target_index(const GLenum target) {
+	switch(target) {
+		case GL_ARRAY_BUFFER: return 0;
+		case GL_ELEMENT_ARRAY_BUFFER: return 1;
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+		case GL_UNIFORM_BUFFER: return 2;
+#endif
+#if !defined(FLOOR_IOS)
+		case GL_TEXTURE_BUFFER: return 3;
+#endif
+		default: break;
+	}
+	return invalid_index;
+}
+
+size_t gl_state::texture_target_index(const GLenum target) {
+	switch(target) {
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_CUBE_MAP: return 1;
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+		case GL_TEXTURE_2D_ARRAY: return 2;
+		case GL_TEXTURE_3D: return 3;
+#endif
+#if !defined(FLOOR_IOS)
+		case GL_TEXTURE_2D_MULTISAMPLE: return 4;
+		case GL_TEXTURE_BUFFER: return 5;
+#endif
+		default: break;
+	}
+	return invalid_index;
+}
+
+void gl_state::set_cap(const GLenum cap, const bool state) {
+	const CALL call = (state ? CALL::ENABLE : CALL::DISABLE);
+	const size_t idx = cap_index(cap);
+	if(idx != invalid_index) {
+		if(caps[idx] == (state ? 1 : 0)) {
+			count(call, false);
+			return;
+		}
+		caps[idx] = (state ? 1 : 0);
+	}
+	if(state) gl.enable(cap);
+	else gl.disable(cap);
+	count(call, true);
+}
+
+void gl_state::enable(const GLenum cap) {
+	set_cap(cap, true);
+}
+
+void gl_state::disable(const GLenum cap) {
+	set_cap(cap, false);
+}
+
+void gl_state::blend_func(const GLenum src, const GLenum dst) {
+	blend_func_separate(src, dst, src, dst);
+}
+
+void gl_state::blend_func_separate(const GLenum src_rgb, const GLenum dst_rgb, const GLenum src_alpha, const GLenum dst_alpha) {
+	if(blend[0] == src_rgb && blend[1] == dst_rgb && blend[2] == src_alpha && blend[3] == dst_alpha) {
+		count(CALL::BLEND_FUNC, false);
+		return;
+	}
+	blend = {{ src_rgb, dst_rgb, src_alpha, dst_alpha }};
+	gl.blend_func_separate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+	count(CALL::BLEND_FUNC, true);
+}
+
+void gl_state::depth_func(const GLenum func) {
+	if(depth_func_state == func) {
+		count(CALL::DEPTH_FUNC, false);
+		return;
+	}
+	depth_func_state = func;
+	gl.depth_func(func);
+	count(CALL::DEPTH_FUNC, true);
+}
+
+void gl_state::depth_mask(const GLboolean flag) {
+	const int8_t state = (flag != GL_FALSE ? 1 : 0);
+	if(depth_mask_state == state) {
+		count(CALL::DEPTH_MASK, false);
+		return;
+	}
+	depth_mask_state = state;
+	gl.depth_mask(flag);
+	count(CALL::DEPTH_MASK, true);
+}
+
+void gl_state::cull_face(const GLenum mode) {
+	if(cull_face_state == mode) {
+		count(CALL::CULL_FACE, false);
+		return;
+	}
+	cull_face_state = mode;
+	gl.cull_face(mode);
+	count(CALL::CULL_FACE, true);
+}
+
+void gl_state::front_face(const GLenum mode) {
+	if(front_face_state == mode) {
+		count(CALL::FRONT_FACE, false);
+		return;
+	}
+	front_face_state = mode;
+	gl.front_face(mode);
+	count(CALL::FRONT_FACE, true);
+}
+
+void gl_state::color_mask(const GLboolean red, const GLboolean green, const GLboolean blue, const GLboolean alpha) {
+	const int8_t state = (int8_t)((red != GL_FALSE ? 1 : 0) | (green != GL_FALSE ? 2 : 0) |
+								  (blue != GL_FALSE ? 4 : 0) | (alpha != GL_FALSE ? 8 : 0));
+	if(color_mask_state == state) {
+		count(CALL::COLOR_MASK, false);
+		return;
+	}
+	color_mask_state = state;
+	gl.color_mask(red, green, blue, alpha);
+	count(CALL::COLOR_MASK, true);
+}
+
+void gl_state::bind_buffer(const GLenum target, const GLuint buffer) {
+	const size_t idx = buffer_target_index(target);
+	if(idx != invalid_index) {
+		if(buffers[idx] == buffer) {
+			count(CALL::BIND_BUFFER, false);
+			return;
+		}
+		buffers[idx] = buffer;
+	}
+	gl.bind_buffer(target, buffer);
+	count(CALL::BIND_BUFFER, true);
+}
+
+void gl_state::bind_buffer_base(const GLenum target, const GLuint index, const GLuint buffer) {
+	// indexed bindings aren't cached, but this also changes the generic binding point
+	gl.bind_buffer_base(target, index, buffer);
+	count(CALL::BIND_BUFFER, true);
+	const size_t idx = buffer_target_index(target);
+	if(idx != invalid_index) buffers[idx] = buffer;
+}
+
+void gl_state::bind_buffer_range(const GLenum target, const GLuint index, const GLuint buffer,
+								 const GLintptr offset, const GLsizeiptr size) {
+	// same as bind_buffer_base: not cached, but also changes the generic binding point
+	gl.bind_buffer_range(target, index, buffer, offset, size);
+	count(CALL::BIND_BUFFER, true);
+	const size_t idx = buffer_target_index(target);
+	if(idx != invalid_index) buffers[idx] = buffer;
+}
+
+void gl_state::use_program(const GLuint program_) {
+	if(program == program_) {
+		count(CALL::USE_PROGRAM, false);
+		return;
+	}
+	program = program_;
+	gl.use_program(program_);
+	count(CALL::USE_PROGRAM, true);
+}
+
+void gl_state::active_texture(const GLenum texture_unit) {
+	if(active_unit == texture_unit) {
+		count(CALL::ACTIVE_TEXTURE, false);
+		return;
+	}
+	active_unit = texture_unit;
+	gl.active_texture(texture_unit);
+	count(CALL::ACTIVE_TEXTURE, true);
+}
+
+void gl_state::bind_texture(const GLenum target, const GLuint texture) {
+	const size_t unit = (size_t)(active_unit - GL_TEXTURE0);
+	const size_t idx = texture_target_index(target);
+	if(active_unit != unknown && unit < max_texture_units && idx != invalid_index) {
+		if(textures[unit][idx] == texture) {
+			count(CALL::BIND_TEXTURE, false);
+			return;
+		}
+		textures[unit][idx] = texture;
+	}
+	gl.bind_texture(target, texture);
+	count(CALL::BIND_TEXTURE, true);
+}
+
+void gl_state::bind_vertex_array(const GLuint vao) {
+	if(vertex_array == vao) {
+		count(CALL::BIND_VERTEX_ARRAY, false);
+		return;
+	}
+	vertex_array = vao;
+	gl.bind_vertex_array(vao);
+	count(CALL::BIND_VERTEX_ARRAY, true);
+	
+	// the element array buffer binding is part of the vao state
+	buffers[buffer_target_index(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+}
+
+void gl_state::delete_buffers(const GLsizei count_, const GLuint* buffers_) {
+	gl.delete_buffers(count_, buffers_);
+	for(GLsizei i = 0; i < count_; ++i) {
+		for(auto& bound_buffer : buffers) {
+			if(bound_buffer == buffers_[i]) bound_buffer = 0;
+		}
+	}
+}
+
+void gl_state::delete_textures(const GLsizei count_, const GLuint* textures_) {
+	gl.delete_textures(count_, textures_);
+	for(GLsizei i = 0; i < count_; ++i) {
+		for(auto& unit : textures) {
+			for(auto& bound_texture : unit) {
+				if(bound_texture == textures_[i]) bound_texture = 0;
+			}
+		}
+	}
+}
+
+void gl_state::delete_vertex_arrays(const GLsizei count_, const GLuint* vaos) {
+	gl.delete_vertex_arrays(count_, vaos);
+	for(GLsizei i = 0; i < count_; ++i) {
+		if(vertex_array == vaos[i]) {
+			vertex_array = 0;
+			buffers[buffer_target_index(GL_ELEMENT_ARRAY_BUFFER)] = unknown;
+		}
+	}
+}
+
+gl_state::call_counter gl_state::frame_counters::total() const {
+	call_counter ret;
+	for(const auto& call : calls) {
+		ret.issued += call.issued;
+		ret.elided += call.elided;
+	}
+	return ret;
+}
+
+const gl_state::frame_counters& gl_state::get_last_frame_counters() {
+	return last_counters;
+}
+
+const gl_state::frame_counters& gl_state::get_frame_counters() {
+	return counters;
+}
+
+void gl_state::start_frame() {
+	last_counters = counters;
+	counters = frame_counters();
+	invalidate();
+}
+
+const gl_state::backend& gl_state::get_gl_backend() {
+	return gl;
+}
+
+void gl_state::set_backend(const backend& gl_backend) {
+	gl = gl_backend;
+	invalidate();
+}
@@ -0,0 +1,160 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_GL_STATE_HPP__
+#define __A2E_GL_STATE_HPP__
+
+#include "global.hpp"
+
+//! tracks the gl state that is set by a2elight and skips all calls that wouldn't change anything.
+//! all state changes (enable/disable, blend/depth/cull state, buffer/program/texture bindings) must go
+//! through this, otherwise invalidate() has to be called after modifying the state directly.
+//! NOTE: the cached state is reset at the start of each frame (-> 3rd party code can't mess things up)
+//! NOTE: the element array buffer binding is vao state, so vaos must be bound via bind_vertex_array
+//!       (this forgets the cached element array buffer binding whenever the vao changes)
+class gl_state {
+public:
+	gl_state() = delete;
+	~gl_state() = delete;
+	
+	// state changes
+	static void enable(const GLenum cap);
+	static void disable(const GLenum cap);
+	static void blend_func(const GLenum src, const GLenum dst);
+	static void blend_func_separate(const GLenum src_rgb, const GLenum dst_rgb, const GLenum src_alpha, const GLenum dst_alpha);
+	static void depth_func(const GLenum func);
+	static void depth_mask(const GLboolean flag);
+	static void cull_face(const GLenum mode);
+	static void front_face(const GLenum mode);
+	static void color_mask(const GLboolean red, const GLboolean green, const GLboolean blue, const GLboolean alpha);
+	static void bind_buffer(const GLenum target, const GLuint buffer);
+	static void bind_buffer_base(const GLenum target, const GLuint index, const GLuint buffer);
+	static void bind_buffer_range(const GLenum target, const GLuint index, const GLuint buffer,
+								  const GLintptr offset, const GLsizeiptr size);
+	static void use_program(const GLuint program);
+	static void active_texture(const GLenum texture_unit);
+	static void bind_texture(const GLenum target, const GLuint texture);
+	static void bind_vertex_array(const GLuint vao);
+	
+	//! deletes the buffers and removes them from all cached bindings (gl resets them to 0)
+	static void delete_buffers(const GLsizei count, const GLuint* buffers);
+	//! deletes the textures and removes them from all cached bindings (gl resets them to 0)
+	static void delete_textures(const GLsizei count, const GLuint* textures);
+	//! deletes the vertex array objects (gl binds vao 0 if the bound one is deleted)
+	static void delete_vertex_arrays(const GLsizei count, const GLuint* vaos);
+	
+	//! forgets all cached state (the next call of each kind is always issued)
+	//! NOTE: this is first called by engine::init_gl, nothing may go through gl_state before that
+	static void invalidate();
+	
+	// per-frame statistics
+	enum class CALL : unsigned int {
+		ENABLE,
+		DISABLE,
+		BLEND_FUNC,
+		DEPTH_FUNC,
+		DEPTH_MASK,
+		CULL_FACE,
+		FRONT_FACE,
+		COLOR_MASK,
+		BIND_BUFFER,
+		USE_PROGRAM,
+		ACTIVE_TEXTURE,
+		BIND_TEXTURE,
+		BIND_VERTEX_ARRAY,
+		__MAX_CALL
+	};
+	struct call_counter {
+		size_t issued = 0;
+		size_t elided = 0;
+	};
+	struct frame_counters {
+		array<call_counter, (size_t)CALL::__MAX_CALL> calls;
+		//! sum of all calls
+		call_counter total() const;
+	};
+	//! counters of the last completed frame
+	static const frame_counters& get_last_frame_counters();
+	//! counters of the current frame (so far)
+	static const frame_counters& get_frame_counters();
+	
+	//! starts a new frame (resets the counters and invalidates the cached state), called by the engine
+	static void start_frame();
+	
+	//! the gl functions that are actually called (these can be replaced, e.g. by a recording backend for testing)
+	struct backend {
+		void (*enable)(GLenum cap);
+		void (*disable)(GLenum cap);
+		void (*blend_func_separate)(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+		void (*depth_func)(GLenum func);
+		void (*depth_mask)(GLboolean flag);
+		void (*cull_face)(GLenum mode);
+		void (*front_face)(GLenum mode);
+		void (*color_mask)(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+		void (*bind_buffer)(GLenum target, GLuint buffer);
+		void (*bind_buffer_base)(GLenum target, GLuint index, GLuint buffer);
+		void (*bind_buffer_range)(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+		void (*use_program)(GLuint program);
+		void (*active_texture)(GLenum texture_unit);
+		void (*bind_texture)(GLenum target, GLuint texture);
+		void (*bind_vertex_array)(GLuint vao);
+		void (*delete_buffers)(GLsizei count, const GLuint* buffers);
+		void (*delete_textures)(GLsizei count, const GLuint* textures);
+		void (*delete_vertex_arrays)(GLsizei count, const GLuint* vaos);
+	};
+	static const backend& get_gl_backend();
+	//! sets the backend and invalidates the cached state
+	static void set_backend(const backend& gl_backend);
+
+protected:
+	static backend gl;
+	static frame_counters counters;
+	static frame_counters last_counters;
+	
+	// cached state ("unknown" values force the next call)
+	static constexpr GLuint unknown = ~0u;
+	static constexpr size_t cap_count = 6;
+	static array<int8_t, cap_count> caps; // -1: unknown, 0: disabled, 1: enabled
+	static array<GLenum, 4> blend; // src rgb, dst rgb, src alpha, dst alpha
+	static GLenum depth_func_state;
+	static int8_t depth_mask_state;
+	static GLenum cull_face_state;
+	static GLenum front_face_state;
+	static int8_t color_mask_state; // rgba bits, -1: unknown
+	static constexpr size_t buffer_target_count = 4;
+	static array<GLuint, buffer_target_count> buffers;
+	static GLuint program;
+	static GLenum active_unit;
+	static constexpr size_t max_texture_units = 32;
+	static constexpr size_t texture_target_count = 6;
+	static array<array<GLuint, texture_target_count>, max_texture_units> textures;
+	static GLuint vertex_array;
+	
+	static size_t cap_index(const GLenum cap);
+	static size_t buffer_target_index(const GLenum target);
+	static size_t texture_target_index(const GLenum target);
+	static void set_cap(const GLenum cap, const bool state);
+	
+	static void count(const CALL call, const bool issued) {
+		if(issued) counters.calls[(size_t)call].issued++;
+		else counters.calls[(size_t)call].elided++;
+	}
+
+};
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "global.hpp"
 #include <floor/math/vector_lib.hpp>
+#include "rendering/frame_sync.hpp"
 
 //! arb_timer_query wrapper + additional functionality
 //! NOTE: this is not supported on iOS
@@ -30,6 +31,8 @@ public:
 	~gl_timer() = delete;
 	
 	static constexpr size_t stored_frames = 16;
+	// the queries of a frame are only available once the gpu has finished it (-> keep more frames than can be in flight)
+	static_assert(stored_frames > A2E_CONCURRENT_FRAMES, "not enough stored frames for all frames in flight");
 	struct frame_info {
 		struct query_object {
 			const string identifier;
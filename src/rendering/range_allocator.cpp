@@ -0,0 +1,162 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "range_allocator.hpp"
+
+constexpr range_allocator::handle range_allocator::invalid_handle;
+
+range_allocator::range_allocator(const size_t& capacity_) : capacity(capacity_) {
+	if(capacity > 0) free_ranges.emplace(0, capacity);
+}
+
+range_allocator::handle range_allocator::allocate(const size_t& size) {
+	size_t offset = 0;
+	if(size > 0) {
+		// first fit
+		auto range = free_ranges.begin();
+		for(; range != free_ranges.end(); range++) {
+			if(range->second >= size) break;
+		}
+		if(range == free_ranges.end()) return invalid_handle;
+		
+		offset = range->first;
+		const size_t remaining = range->second - size;
+		free_ranges.erase(range);
+		if(remaining > 0) free_ranges.emplace(offset + size, remaining);
+		used_size += size;
+	}
+	
+	handle alloc;
+	if(!free_handles.empty()) {
+		alloc = free_handles.back();
+		free_handles.pop_back();
+		allocations[alloc] = { offset, size, true };
+	}
+	else {
+		alloc = (handle)allocations.size();
+		allocations.push_back({ offset, size, true });
+	}
+	return alloc;
+}
+
+void range_allocator::free(const handle& alloc) {
+	if(alloc >= allocations.size() || !allocations[alloc].used) {
+		log_error("invalid allocation handle: %u", alloc);
+		return;
+	}
+	allocation& entry = allocations[alloc];
+	entry.used = false;
+	free_handles.push_back(alloc);
+	if(entry.size == 0) return;
+	
+	used_size -= entry.size;
+	add_free_range(entry.offset, entry.size);
+}
+
+void range_allocator::add_free_range(size_t offset, size_t size) {
+	// merge with the following free range
+	auto next = free_ranges.lower_bound(offset);
+	if(next != free_ranges.end() && next->first == offset + size) {
+		size += next->second;
+		next = free_ranges.erase(next);
+	}
+	// merge with the preceding free range
+	if(next != free_ranges.begin()) {
+		auto prev = next;
+		prev--;
+		if(prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+	free_ranges.emplace_hint(next, offset, size);
+}
+
+size_t range_allocator::get_offset(const handle& alloc) const {
+	return allocations[alloc].offset;
+}
+
+size_t range_allocator::get_size(const handle& alloc) const {
+	return allocations[alloc].size;
+}
+
+void range_allocator::grow(const size_t& new_capacity) {
+	if(new_capacity <= capacity) return;
+	const size_t old_capacity = capacity;
+	capacity = new_capacity;
+	add_free_range(old_capacity, new_capacity - old_capacity);
+}
+
+vector<range_allocator::relocation> range_allocator::defragment() {
+	vector<relocation> relocations;
+	relocations.reserve(get_allocation_count());
+	for(handle alloc = 0; alloc < (handle)allocations.size(); alloc++) {
+		const allocation& entry = allocations[alloc];
+		if(!entry.used || entry.size == 0) continue;
+		relocations.push_back({ alloc, entry.offset, 0, entry.size });
+	}
+	sort(relocations.begin(), relocations.end(), [](const relocation& a, const relocation& b) {
+		return a.src_offset < b.src_offset;
+	});
+	
+	size_t offset = 0;
+	for(auto& reloc : relocations) {
+		reloc.dst_offset = offset;
+		allocations[reloc.alloc].offset = offset;
+		offset += reloc.size;
+	}
+	
+	free_ranges.clear();
+	if(offset < capacity) free_ranges.emplace(offset, capacity - offset);
+	return relocations;
+}
+
+size_t range_allocator::get_largest_free_range() const {
+	size_t largest = 0;
+	for(const auto& range : free_ranges) {
+		largest = std::max(largest, range.second);
+	}
+	return largest;
+}
+
+bool range_allocator::validate() const {
+	// collect all used and free ranges, sorted by offset, they must exactly cover [0, capacity)
+	vector<pair<size_t, size_t>> ranges;
+	size_t allocated = 0;
+	for(const auto& entry : allocations) {
+		if(!entry.used || entry.size == 0) continue;
+		ranges.emplace_back(entry.offset, entry.size);
+		allocated += entry.size;
+	}
+	if(allocated != used_size) return false;
+	
+	size_t prev_free_end = ~size_t(0);
+	for(const auto& range : free_ranges) {
+		if(range.second == 0 || range.first == prev_free_end) return false; // empty or not merged
+		prev_free_end = range.first + range.second;
+		ranges.emplace_back(range.first, range.second);
+	}
+	sort(ranges.begin(), ranges.end());
+	
+	size_t offset = 0;
+	for(const auto& range : ranges) {
+		if(range.first != offset) return false;
+		offset += range.second;
+	}
+	return (offset == capacity);
+}
@@ -0,0 +1,84 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_RANGE_ALLOCATOR_HPP__
+#define __A2E_RANGE_ALLOCATOR_HPP__
+
+#include "global.hpp"
+
+//! sub-allocates ranges (in arbitrary units, e.g. vertices or indices) of a linear address space with a fixed capacity:
+//! first fit allocation, freed ranges are merged with their free neighbors. allocations are referenced via handles,
+//! so that defragment() can move them (their current offset must be queried via get_offset).
+//! NOTE: this only does the bookkeeping, the user has to move the actual data (see geometry_arena)
+class range_allocator {
+public:
+	typedef uint32_t handle;
+	static constexpr handle invalid_handle = ~0u;
+	
+	range_allocator(const size_t& capacity = 0);
+	~range_allocator() = default;
+	
+	//! returns invalid_handle if there is no free range that is large enough (zero-sized allocations are allowed)
+	handle allocate(const size_t& size);
+	void free(const handle& alloc);
+	
+	size_t get_offset(const handle& alloc) const;
+	size_t get_size(const handle& alloc) const;
+	
+	//! increases the capacity (the new space is appended to the free range at the end)
+	void grow(const size_t& new_capacity);
+	
+	//! packs all allocations to the front of the address space (keeping their order), afterwards there is only
+	//! a single free range at the end. returns the previous and new offset of each allocation (in offset order).
+	struct relocation {
+		handle alloc;
+		size_t src_offset;
+		size_t dst_offset;
+		size_t size;
+	};
+	vector<relocation> defragment();
+	
+	size_t get_capacity() const { return capacity; }
+	size_t get_used_size() const { return used_size; }
+	size_t get_free_size() const { return capacity - used_size; }
+	size_t get_largest_free_range() const;
+	size_t get_free_range_count() const { return free_ranges.size(); }
+	size_t get_allocation_count() const { return allocations.size() - free_handles.size(); }
+	
+	//! checks the internal consistency (no overlaps, no gaps, merged free ranges, correct sizes)
+	bool validate() const;
+
+protected:
+	size_t capacity;
+	size_t used_size = 0;
+	
+	struct allocation {
+		size_t offset;
+		size_t size;
+		bool used;
+	};
+	vector<allocation> allocations;
+	vector<handle> free_handles;
+	
+	// offset -> size, always merged (two free ranges are never adjacent)
+	map<size_t, size_t> free_ranges;
+	void add_free_range(size_t offset, size_t size);
+	
+};
+
+#endif
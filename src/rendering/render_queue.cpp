@@ -0,0 +1,103 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "render_queue.hpp"
+
+static_assert(render_queue::pass_bits + render_queue::shader_bits + render_queue::material_bits +
+			  render_queue::mesh_bits + render_queue::depth_bits == 64, "invalid render queue key layout");
+
+uint64_t render_queue::make_key(const uint32_t& pass, const uint32_t& shader_id, const uint32_t& material_id,
+								const uint32_t& mesh_id, const float& depth) {
+	const auto field = [](const uint64_t& value, const uint32_t& bits) {
+		return (value & ((uint64_t(1) << bits) - 1u));
+	};
+	const float max_depth = float((1u << depth_bits) - 1u);
+	const uint32_t quantized_depth = (uint32_t)std::min(std::max(depth, 0.0f) * max_depth, max_depth);
+	
+	uint64_t key = field(pass, pass_bits);
+	key = (key << shader_bits) | field(shader_id, shader_bits);
+	key = (key << material_bits) | field(material_id, material_bits);
+	key = (key << mesh_bits) | field(mesh_id, mesh_bits);
+	key = (key << depth_bits) | field(quantized_depth, depth_bits);
+	return key;
+}
+
+void render_queue::clear() {
+	keys.clear();
+	items.clear();
+}
+
+void render_queue::reserve(const size_t& count) {
+	keys.reserve(count);
+	items.reserve(count);
+}
+
+void render_queue::push(const uint64_t& key, a2emodel* model, const uint32_t& sub_object,
+						const uint32_t& shader_id, const uint32_t& material_id) {
+	keys.push_back({ key, (uint32_t)items.size() });
+	items.push_back({ model, sub_object, shader_id, material_id });
+}
+
+void render_queue::sort() {
+	const size_t count = keys.size();
+	if(count < 2) return;
+	
+	// small queues: not worth the histogram overhead
+	if(count <= 64) {
+		std::stable_sort(keys.begin(), keys.end(), [](const sort_entry& a, const sort_entry& b) {
+			return a.key < b.key;
+		});
+		return;
+	}
+	
+	// histograms of all 8 digits (8 bits each) in one pass over the keys
+	array<array<uint32_t, 256>, 8> histograms;
+	for(auto& histogram : histograms) histogram.fill(0);
+	for(const auto& entry : keys) {
+		for(size_t digit = 0; digit < 8; digit++) {
+			histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+	
+	sort_buffer.resize(count);
+	sort_entry* src = keys.data();
+	sort_entry* dst = sort_buffer.data();
+	for(size_t digit = 0; digit < 8; digit++) {
+		auto& histogram = histograms[digit];
+		
+		// all keys have the same digit -> order doesn't change
+		if(histogram[(src[0].key >> (digit * 8)) & 0xFF] == count) continue;
+		
+		// histogram -> offsets
+		uint32_t offset = 0;
+		for(auto& bucket : histogram) {
+			const uint32_t bucket_count = bucket;
+			bucket = offset;
+			offset += bucket_count;
+		}
+		
+		for(size_t i = 0; i < count; i++) {
+			const uint32_t bucket = (uint32_t)((src[i].key >> (digit * 8)) & 0xFF);
+			dst[histogram[bucket]++] = src[i];
+		}
+		swap(src, dst);
+	}
+	
+	// the sorted keys might currently be in the sort buffer
+	if(src != keys.data()) keys.swap(sort_buffer);
+}
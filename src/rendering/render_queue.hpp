@@ -0,0 +1,78 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_RENDER_QUEUE_HPP__
+#define __A2E_RENDER_QUEUE_HPP__
+
+#include "global.hpp"
+
+class a2emodel;
+
+//! list of sub-object draws that is sorted by a 64-bit key before it is submitted, so that draws with the same
+//! render state end up next to each other. key layout (msb -> lsb):
+//! pass (4 bits) | shader permutation (12 bits) | material (16 bits) | mesh (16 bits) | depth (16 bits, front to back)
+//! NOTE: this has no gl dependencies (the submission is done by the user of the queue)
+class render_queue {
+public:
+	render_queue() = default;
+	~render_queue() = default;
+	
+	//! the full (untruncated) shader and material ids are stored with each item, so that draws can be batched
+	//! without querying the render state again
+	struct item {
+		a2emodel* model;
+		uint32_t sub_object;
+		uint32_t shader_id;
+		uint32_t material_id;
+	};
+	
+	static constexpr uint32_t pass_bits = 4;
+	static constexpr uint32_t shader_bits = 12;
+	static constexpr uint32_t material_bits = 16;
+	static constexpr uint32_t mesh_bits = 16;
+	static constexpr uint32_t depth_bits = 16;
+	
+	//! combines the render state ids into a sort key (ids that don't fit are truncated), "depth" is in [0, 1]
+	static uint64_t make_key(const uint32_t& pass, const uint32_t& shader_id, const uint32_t& material_id,
+							 const uint32_t& mesh_id, const float& depth);
+	
+	void clear();
+	void reserve(const size_t& count);
+	void push(const uint64_t& key, a2emodel* model, const uint32_t& sub_object,
+			  const uint32_t& shader_id = 0, const uint32_t& material_id = 0);
+	//! sorts all items by their key (stable lsd radix sort, passes in which all keys have the same digit are skipped)
+	void sort();
+	
+	size_t size() const { return keys.size(); }
+	bool empty() const { return keys.empty(); }
+	//! returns the i-th item (in sorted order after sort() was called)
+	const item& operator[](const size_t& i) const { return items[keys[i].index]; }
+	uint64_t get_key(const size_t& i) const { return keys[i].key; }
+	
+protected:
+	struct sort_entry {
+		uint64_t key;
+		uint32_t index;
+	};
+	vector<sort_entry> keys;
+	vector<sort_entry> sort_buffer;
+	vector<item> items;
+	
+};
+
+#endif
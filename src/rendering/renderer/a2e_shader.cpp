@@ -857,6 +857,46 @@ bool a2e_shader::compile_a2e_shader(a2e_shader_object* shd) {
 		else obj->a2e_shader = true;
 	}
 	
+	// resolve all permutations (option + combiner set -> program), so that selecting one only requires a table lookup
+	if(ret) {
+		shader_object* obj = shader_obj->get_shader_object(shd->identifier);
+		if(obj != nullptr) {
+			shader_object::permutation_table& table = obj->permutation_programs;
+			const size_t invalid = shader_object::permutation_table::invalid;
+			table.option_slots.clear();
+			table.combiner_bits.clear();
+			table.permutations.clear();
+			
+			// combiners are always appended in (set) order
+			vector<const string*> combiners;
+			for(const auto& combiner : shd->combiners) {
+				combiners.emplace_back(&combiner);
+				table.combiner_bits.emplace_back(shader_obj->get_combiner_bit(combiner));
+			}
+			const size_t combiner_permutations = size_t(1) << combiners.size();
+			
+			size_t option_slot = 0;
+			for(const auto& option : shd->options) {
+				if(option.find("*") != string::npos) continue; // only base options
+				
+				const size_t option_id = shader_obj->get_option_id(option);
+				if(option_id >= table.option_slots.size()) {
+					table.option_slots.resize(option_id + 1, invalid);
+				}
+				table.option_slots[option_id] = option_slot++;
+				
+				for(size_t mask = 0; mask < combiner_permutations; ++mask) {
+					tmp = option;
+					for(size_t i = 0; i < combiners.size(); ++i) {
+						if((mask & (size_t(1) << i)) != 0) tmp += *combiners[i];
+					}
+					const auto prog_iter = obj->options.find(tmp);
+					table.permutations.emplace_back(prog_iter != obj->options.end() ? prog_iter->second : invalid);
+				}
+			}
+		}
+	}
+	
 	return ret;
 }
 
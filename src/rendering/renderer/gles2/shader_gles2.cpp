@@ -40,8 +40,8 @@ if(shd_obj.programs.size() <= cur_program) { \
 log_error("invalid program #%u for shader \"%s\"!", cur_program, shd_obj.name.c_str()); \
 return; \
 } \
-if(shd_obj.programs[cur_program]->uniforms.count(name) == 0) { \
-log_error("unknown uniform name \"%s\" for shader \"%s\"!", name, shd_obj.name.c_str()); \
+if(shd_obj.programs[cur_program]->uniform_table.find(name) == nullptr) { \
+log_error("unknown uniform name \"%s\" for shader \"%s\"!", name.str, shd_obj.name.c_str()); \
 return; \
 }
 
@@ -50,8 +50,8 @@ if(shd_obj.programs.size() <= cur_program) { \
 log_error("invalid program #%u for shader \"%s\"!", cur_program, shd_obj.name.c_str()); \
 return; \
 } \
-if(shd_obj.programs[cur_program]->attributes.count(name) == 0) { \
-log_error("unknown attribute name \"%s\" for shader \"%s\"!", name, shd_obj.name.c_str()); \
+if(shd_obj.programs[cur_program]->attribute_table.find(name) == nullptr) { \
+log_error("unknown attribute name \"%s\" for shader \"%s\"!", name.str, shd_obj.name.c_str()); \
 return; \
 }
 
@@ -60,21 +60,21 @@ if(shd_obj.programs.size() <= cur_program) { \
 log_error("invalid program #%u for shader \"%s\"!", cur_program, shd_obj.name.c_str()); \
 return; \
 } \
-if(shd_obj.programs[cur_program]->blocks.count(name) == 0) { \
-log_error("unknown uniform block name \"%s\" for shader \"%s\"!", name, shd_obj.name.c_str()); \
+if(shd_obj.programs[cur_program]->block_table.find(name) == nullptr) { \
+log_error("unknown uniform block name \"%s\" for shader \"%s\"!", name.str, shd_obj.name.c_str()); \
 return; \
 }
 
 #define A2E_CHECK_UNIFORM_TYPE(name, uniform_type) \
-size_t expected_type = shd_obj.programs[cur_program]->uniforms.find(name)->second.type; \
+size_t expected_type = shd_obj.programs[cur_program]->uniform_table.find(name)->type; \
 if(uniform_type != (size_t)expected_type) { \
-log_error("unexpected type %s for uniform \"%s\" - expected %s (in shader \"%s\")!", gles2_type_to_string(uniform_type), name, gles2_type_to_string(expected_type), shd_obj.name.c_str()); \
+log_error("unexpected type %s for uniform \"%s\" - expected %s (in shader \"%s\")!", gles2_type_to_string(uniform_type), name.str, gles2_type_to_string(expected_type), shd_obj.name.c_str()); \
 }
 
 #define A2E_CHECK_ATTRIBUTE_TYPE(name, attribute_type) \
-size_t expected_type = shd_obj.programs[cur_program]->attributes.find(name)->second.type; \
+size_t expected_type = shd_obj.programs[cur_program]->attribute_table.find(name)->type; \
 if(attribute_type != (size_t)expected_type) { \
-log_error("unexpected type %s for attribute \"%s\" - expected %s (in shader \"%s\")!", gles2_type_to_string(attribute_type), name, gles2_type_to_string(expected_type), shd_obj.name.c_str()); \
+log_error("unexpected type %s for attribute \"%s\" - expected %s (in shader \"%s\")!", gles2_type_to_string(attribute_type), name.str, gles2_type_to_string(expected_type), shd_obj.name.c_str()); \
 }
 
 #else // don't check the type in release mode
@@ -102,12 +102,12 @@ void shader_gles2::disable() {
 		glDisableVertexAttribArray((GLuint)vattr_iter);
 	}
 	if(!active_vertex_attribs.empty()) {
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
 	}
 	active_vertex_attribs.clear();
 	
 	// disable program
-	glUseProgram(0);
+	gl_state::use_program(0);
 }
 
 void shader_gles2::use() {
@@ -116,7 +116,7 @@ void shader_gles2::use() {
 
 void shader_gles2::use(const size_t& program) {
 	shader_base::use(program);
-	glUseProgram(shd_obj.programs[cur_program]->program);
+	gl_state::use_program(shd_obj.programs[cur_program]->program);
 #if defined(A2E_DEBUG)
 	if(shd_obj.programs.size() == 0) {
 		log_error("no program #%u exists in shader \"%s\"!", program, shd_obj.name.c_str());
@@ -129,17 +129,22 @@ void shader_gles2::use(const string& option, const set<string> combiners) {
 													 [](string& ret, const string& in) {
 														 return ret + in;
 													 }));
-#if defined(A2E_DEBUG)
-	if(shd_obj.options.count(combined_option) == 0) {
+	const auto option_iter = shd_obj.options.find(combined_option);
+	if(option_iter == shd_obj.options.end()) {
 		log_error("no option \"%s\" exists in shader \"%s\"!", combined_option, shd_obj.name);
 		return;
 	}
-#endif
-	cur_option = combined_option;
-	const shader_object::internal_shader_object* int_shd_obj = shd_obj.options.find(cur_option)->second;
-	const auto piter = find(shd_obj.programs.begin(), shd_obj.programs.end(), int_shd_obj);
-	cur_program = piter - shd_obj.programs.begin();
-	use(cur_program);
+	use(option_iter->second);
+}
+
+void shader_gles2::use(const size_t& option_id, const uint32_t& combiner_mask) {
+	const size_t program = shd_obj.permutation_programs.get_program(option_id, combiner_mask);
+	if(program == shader_object::permutation_table::invalid) {
+		log_error("no permutation (option #%u, combiners %X) exists in shader \"%s\"!",
+				  option_id, combiner_mask, shd_obj.name);
+		return;
+	}
+	use(program);
 }
 
 size_t shader_gles2::get_cur_program() const {
@@ -147,44 +152,44 @@ size_t shader_gles2::get_cur_program() const {
 }
 
 const string& shader_gles2::get_cur_option() const {
-	return cur_option;
+	return shd_obj.program_options[cur_program];
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // -> uniform
 
 // 1{i,f,b,fv,iv,bv}
-void shader_gles2::uniform(const char* name, const float& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const float& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT);
 	glUniform1f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1);
 }
 
-void shader_gles2::uniform(const char* name, const int& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const int& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT);
 	glUniform1i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1);
 }
 
-void shader_gles2::uniform(const char* name, const bool& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL);
 	glUniform1i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1);
 }
 
-void shader_gles2::uniform(const char* name, const float* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const float* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT);
 	glUniform1fv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, arg1);
 }
 
-void shader_gles2::uniform(const char* name, const int* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const int* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT);
 	glUniform1iv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, arg1);
 }
 
-void shader_gles2::uniform(const char* name, const bool* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL);
 	GLint* int_array = new int[count];
@@ -194,55 +199,55 @@ void shader_gles2::uniform(const char* name, const bool* arg1, const size_t& cou
 }
 
 // 2{i,f,b,fv,iv,bv}
-void shader_gles2::uniform(const char* name, const float& arg1, const float& arg2) const {
+void shader_gles2::uniform(const shader_var_name& name, const float& arg1, const float& arg2) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC2);
 	glUniform2f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2);
 }
 
-void shader_gles2::uniform(const char* name, const int& arg1, const int& arg2) const {
+void shader_gles2::uniform(const shader_var_name& name, const int& arg1, const int& arg2) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC2);
 	glUniform2i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2);
 }
 
-void shader_gles2::uniform(const char* name, const bool& arg1, const bool& arg2) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool& arg1, const bool& arg2) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC2);
 	glUniform2i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2);
 }
 
-void shader_gles2::uniform(const char* name, const float2& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const float2& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC2);
 	glUniform2f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y);
 }
 
-void shader_gles2::uniform(const char* name, const int2& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const int2& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC2);
 	glUniform2i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y);
 }
 
-void shader_gles2::uniform(const char* name, const bool2& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool2& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC2);
 	glUniform2i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y);
 }
 
-void shader_gles2::uniform(const char* name, const float2* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const float2* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC2);
 	glUniform2fv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, (GLfloat*)arg1);
 }
 
-void shader_gles2::uniform(const char* name, const int2* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const int2* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC2);
 	glUniform2iv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, (GLint*)arg1);
 }
 
-void shader_gles2::uniform(const char* name, const bool2* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool2* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC2);
 	GLint* int_array = new int[count*2];
@@ -257,55 +262,55 @@ void shader_gles2::uniform(const char* name, const bool2* arg1, const size_t& co
 
 
 // 3{i,f,b,fv,iv,bv}
-void shader_gles2::uniform(const char* name, const float& arg1, const float& arg2, const float& arg3) const {
+void shader_gles2::uniform(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC3);
 	glUniform3f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2, arg3);
 }
 
-void shader_gles2::uniform(const char* name, const int& arg1, const int& arg2, const int& arg3) const {
+void shader_gles2::uniform(const shader_var_name& name, const int& arg1, const int& arg2, const int& arg3) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC3);
 	glUniform3i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2, arg3);
 }
 
-void shader_gles2::uniform(const char* name, const bool& arg1, const bool& arg2, const bool& arg3) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool& arg1, const bool& arg2, const bool& arg3) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC3);
 	glUniform3i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2, arg3);
 }
 
-void shader_gles2::uniform(const char* name, const float3& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const float3& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC3);
 	glUniform3f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y, arg1.z);
 }
 
-void shader_gles2::uniform(const char* name, const int3& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const int3& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC3);
 	glUniform3i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y, arg1.z);
 }
 
-void shader_gles2::uniform(const char* name, const bool3& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool3& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC3);
 	glUniform3i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y, arg1.z);
 }
 
-void shader_gles2::uniform(const char* name, const float3* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const float3* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC3);
 	glUniform3fv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, (GLfloat*)arg1);
 }
 
-void shader_gles2::uniform(const char* name, const int3* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const int3* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC3);
 	glUniform3iv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, (GLint*)arg1);
 }
 
-void shader_gles2::uniform(const char* name, const bool3* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool3* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC3);
 	GLint* int_array = new int[count*3];
@@ -320,55 +325,55 @@ void shader_gles2::uniform(const char* name, const bool3* arg1, const size_t& co
 
 
 // 4{i,f,b,fv,iv,bv}
-void shader_gles2::uniform(const char* name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const {
+void shader_gles2::uniform(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC4);
 	glUniform4f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2, arg3, arg4);
 }
 
-void shader_gles2::uniform(const char* name, const int& arg1, const int& arg2, const int& arg3, const int& arg4) const {
+void shader_gles2::uniform(const shader_var_name& name, const int& arg1, const int& arg2, const int& arg3, const int& arg4) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC4);
 	glUniform4i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2, arg3, arg4);
 }
 
-void shader_gles2::uniform(const char* name, const bool& arg1, const bool& arg2, const bool& arg3, const bool& arg4) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool& arg1, const bool& arg2, const bool& arg3, const bool& arg4) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC4);
 	glUniform4i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1, arg2, arg3, arg4);
 }
 
-void shader_gles2::uniform(const char* name, const float4& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const float4& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC4);
 	glUniform4f(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y, arg1.z, arg1.w);
 }
 
-void shader_gles2::uniform(const char* name, const int4& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const int4& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC4);
 	glUniform4i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y, arg1.z, arg1.w);
 }
 
-void shader_gles2::uniform(const char* name, const bool4& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool4& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC4);
 	glUniform4i(A2E_SHADER_GET_UNIFORM_POSITION(name), arg1.x, arg1.y, arg1.z, arg1.w);
 }
 
-void shader_gles2::uniform(const char* name, const float4* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const float4* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_VEC4);
 	glUniform4fv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, (GLfloat*)arg1);
 }
 
-void shader_gles2::uniform(const char* name, const int4* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const int4* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_INT_VEC4);
 	glUniform4iv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, (GLint*)arg1);
 }
 
-void shader_gles2::uniform(const char* name, const bool4* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const bool4* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_BOOL_VEC4);
 	GLint* int_array = new int[count*4];
@@ -382,13 +387,13 @@ void shader_gles2::uniform(const char* name, const bool4* arg1, const size_t& co
 }
 
 // mat{--3,4}
-void shader_gles2::uniform(const char* name, const matrix4f& arg1) const {
+void shader_gles2::uniform(const shader_var_name& name, const matrix4f& arg1) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_MAT4);
 	glUniformMatrix4fv(A2E_SHADER_GET_UNIFORM_POSITION(name), 1, false, (GLfloat*)&arg1.data[0]);
 }
 
-void shader_gles2::uniform(const char* name, const matrix4f* arg1, const size_t& count) const {
+void shader_gles2::uniform(const shader_var_name& name, const matrix4f* arg1, const size_t& count) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 	A2E_CHECK_UNIFORM_TYPE(name, GL_FLOAT_MAT4);
 	glUniformMatrix4fv(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLsizei)count, false, (GLfloat*)arg1);
@@ -397,42 +402,44 @@ void shader_gles2::uniform(const char* name, const matrix4f* arg1, const size_t&
 ///////////////////////////////////////////////////////////////////////////////////////
 // -> texture
 
-void shader_gles2::set_texture(const char* name, const GLuint& tex, const GLenum& texture_type) const {
+void shader_gles2::set_texture(const shader_var_name& name, const GLuint& tex, const GLenum& texture_type) const {
 	A2E_CHECK_UNIFORM_EXISTENCE(name);
 #if defined(A2E_DEBUG)
 	// check texture number (0 == uninitialized)
 	if(tex == 0) {
-		log_error("invalid texture number %u for texture uniform \"%s\" (in shader \"%s\")!", tex, name, shd_obj.name.c_str());
+		log_error("invalid texture number %u for texture uniform \"%s\" (in shader \"%s\")!", tex, name.str, shd_obj.name.c_str());
 	}
 	// check type
-	const size_t uniform_type = shd_obj.programs[cur_program]->uniforms.find(name)->second.type;
+	const size_t uniform_type = shd_obj.programs[cur_program]->uniform_table.find(name)->type;
 	if(!is_gl_sampler_type((const GLenum)uniform_type)) {
-		log_error("unexpected type %s for texture uniform \"%s\" - expected a sampler type (in shader \"%s\")!", gles2_type_to_string(uniform_type), name, shd_obj.name.c_str());
+		log_error("unexpected type %s for texture uniform \"%s\" - expected a sampler type (in shader \"%s\")!", gles2_type_to_string(uniform_type), name.str, shd_obj.name.c_str());
 	}
 	// check sampler mapping existence
-	if(shd_obj.programs[cur_program]->samplers.count(name) == 0) {
-		log_error("no sampler mapping for texture uniform \"%s\" exists (in shader \"%s\")!", name, shd_obj.name.c_str());
+	if(shd_obj.programs[cur_program]->samplers.count(name.str) == 0) {
+		log_error("no sampler mapping for texture uniform \"%s\" exists (in shader \"%s\")!", name.str, shd_obj.name.c_str());
 	}
 #endif
 	
-	const size_t tex_num = shd_obj.programs[cur_program]->samplers.find(name)->second;
+	const auto var = shd_obj.programs[cur_program]->uniform_table.find(name);
+	if(var == nullptr) return;
+	const size_t tex_num = var->sampler;
 #if defined(A2E_DEBUG)
 	if(tex_num >= 32) {
-		log_error("invalid texture number #%u for texture uniform \"%s\" - only 32 textures are allowed (in shader \"%s\")!", tex_num, name, shd_obj.name.c_str());
+		log_error("invalid texture number #%u for texture uniform \"%s\" - only 32 textures are allowed (in shader \"%s\")!", tex_num, name.str, shd_obj.name.c_str());
 	}
 #endif
 	
 	// set uniform, activate and bind texture
-	glUniform1i(A2E_SHADER_GET_UNIFORM_POSITION(name), (GLint)tex_num);
-	glActiveTexture(GL_TEXTURE0+(GLint)tex_num);
-	glBindTexture(texture_type, tex);
+	glUniform1i((GLint)var->location, (GLint)tex_num);
+	gl_state::active_texture(GL_TEXTURE0+(GLint)tex_num);
+	gl_state::bind_texture(texture_type, tex);
 }
 
-void shader_gles2::texture(const char* name, const GLuint& tex, const GLenum texture_type) const {
+void shader_gles2::texture(const shader_var_name& name, const GLuint& tex, const GLenum texture_type) const {
 	set_texture(name, tex, texture_type);
 }
 
-void shader_gles2::texture(const char* name, const a2e_texture& tex) const {
+void shader_gles2::texture(const shader_var_name& name, const a2e_texture& tex) const {
 	set_texture(name, tex->tex_num, tex->texture_type);
 }
 
@@ -442,52 +449,52 @@ void shader_gles2::texture(const char* name, const a2e_texture& tex) const {
 // NOTE: in opengl 2.x attributes types must be of type float! => overwrite these functions in opengl 3.x+
 
 // 1{f,fv}
-void shader_gles2::attribute(const char* name, const float& arg1) const {
+void shader_gles2::attribute(const shader_var_name& name, const float& arg1) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT);
 	glVertexAttrib1f(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), arg1);
 }
 
-void shader_gles2::attribute(const char* name, const float* arg1) const {
+void shader_gles2::attribute(const shader_var_name& name, const float* arg1) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT);
 	glVertexAttrib1fv(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), arg1);
 }
 
 // 2{f,fv}
-void shader_gles2::attribute(const char* name, const float& arg1, const float& arg2) const {
+void shader_gles2::attribute(const shader_var_name& name, const float& arg1, const float& arg2) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT_VEC2);
 	glVertexAttrib2f(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), arg1, arg2);
 }
 
-void shader_gles2::attribute(const char* name, const float2* arg1) const {
+void shader_gles2::attribute(const shader_var_name& name, const float2* arg1) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT_VEC2);
 	glVertexAttrib2fv(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), (GLfloat*)arg1);
 }
 
 // 3{f,fv}
-void shader_gles2::attribute(const char* name, const float& arg1, const float& arg2, const float& arg3) const {
+void shader_gles2::attribute(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT_VEC3);
 	glVertexAttrib3f(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), arg1, arg2, arg3);
 }
 
-void shader_gles2::attribute(const char* name, const float3* arg1) const {
+void shader_gles2::attribute(const shader_var_name& name, const float3* arg1) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT_VEC3);
 	glVertexAttrib3fv(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), (GLfloat*)arg1);
 }
 
 // 4{f,fv}
-void shader_gles2::attribute(const char* name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const {
+void shader_gles2::attribute(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT_VEC4);
 	glVertexAttrib4f(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), arg1, arg2, arg3, arg4);
 }
 
-void shader_gles2::attribute(const char* name, const float4* arg1) const {
+void shader_gles2::attribute(const shader_var_name& name, const float4* arg1) const {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	A2E_CHECK_ATTRIBUTE_TYPE(name, GL_FLOAT_VEC4);
 	glVertexAttrib4fv(A2E_SHADER_GET_ATTRIBUTE_POSITION(name), (GLfloat*)arg1);
@@ -496,15 +503,16 @@ void shader_gles2::attribute(const char* name, const float4* arg1) const {
 ///////////////////////////////////////////////////////////////////////////////////////
 // -> attribute array
 
-void shader_gles2::attribute_array(const char* name, const GLuint& buffer, const GLint& size, const GLenum type, const GLboolean normalized_, const GLsizei stride) {
+void shader_gles2::attribute_array(const shader_var_name& name, const GLuint& buffer, const GLint& size, const GLenum type, const GLboolean normalized_, const GLsizei stride, const size_t offset) {
 	A2E_CHECK_ATTRIBUTE_EXISTENCE(name);
 	
 	// SHADER TODO: type/size via shader obj?
 	
-	const size_t location = A2E_SHADER_GET_ATTRIBUTE_POSITION(name);
-	active_vertex_attribs.insert(location);
+	const GLint location = get_attribute_position(name);
+	if(location < 0) return;
+	active_vertex_attribs.insert((size_t)location);
 	
-	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, buffer);
 	glEnableVertexAttribArray((GLuint)location);
 	
 	GLboolean normalized = normalized_;
@@ -520,7 +528,7 @@ void shader_gles2::attribute_array(const char* name, const GLuint& buffer, const
 			floor_fallthrough;
 		default:
 			if(size <= 4) {
-				glVertexAttribPointer((GLuint)location, size, type, normalized, stride, nullptr);
+				glVertexAttribPointer((GLuint)location, size, type, normalized, stride, (const void*)offset);
 			}
 			else if(size == 9) {
 				glVertexAttribPointer((GLuint)location, 3, type, normalized, 36, nullptr);
@@ -546,7 +554,7 @@ void shader_gles2::attribute_array(const char* name, const GLuint& buffer, const
 ///////////////////////////////////////////////////////////////////////////////////////
 // -> uniform buffer
 
-void shader_gles2::block(const char* name, const GLuint& ubo) const {
+void shader_gles2::block(const shader_var_name& name, const GLuint& ubo) const {
 	log_error("UBOs are not supported in OpenGL ES 2.0!");
 }
 
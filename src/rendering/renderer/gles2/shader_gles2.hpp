@@ -35,85 +35,86 @@ public:
 	virtual void use();
 	virtual void use(const size_t& program);
 	virtual void use(const string& option, const set<string> combiners = set<string> {});
+	virtual void use(const size_t& option_id, const uint32_t& combiner_mask);
 	virtual void disable();
 	virtual size_t get_cur_program() const;
 	virtual const string& get_cur_option() const;
 	
 	// -> uniform
 	// 1{i,f,b,fv,iv,bv}
-	void uniform(const char* name, const float& arg1) const;
-	void uniform(const char* name, const int& arg1) const;
-	void uniform(const char* name, const bool& arg1) const;
-	void uniform(const char* name, const float* arg1, const size_t& count) const;
-	void uniform(const char* name, const int* arg1, const size_t& count) const;
-	void uniform(const char* name, const bool* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const float& arg1) const;
+	void uniform(const shader_var_name& name, const int& arg1) const;
+	void uniform(const shader_var_name& name, const bool& arg1) const;
+	void uniform(const shader_var_name& name, const float* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const int* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const bool* arg1, const size_t& count) const;
 	
 	// 2{i,f,b,fv,iv,bv}
-	void uniform(const char* name, const float& arg1, const float& arg2) const;
-	void uniform(const char* name, const int& arg1, const int& arg2) const;
-	void uniform(const char* name, const bool& arg1, const bool& arg2) const;
-	void uniform(const char* name, const float2& arg1) const;
-	void uniform(const char* name, const int2& arg1) const;
-	void uniform(const char* name, const bool2& arg1) const;
-	void uniform(const char* name, const float2* arg1, const size_t& count) const;
-	void uniform(const char* name, const int2* arg1, const size_t& count) const;
-	void uniform(const char* name, const bool2* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const float& arg1, const float& arg2) const;
+	void uniform(const shader_var_name& name, const int& arg1, const int& arg2) const;
+	void uniform(const shader_var_name& name, const bool& arg1, const bool& arg2) const;
+	void uniform(const shader_var_name& name, const float2& arg1) const;
+	void uniform(const shader_var_name& name, const int2& arg1) const;
+	void uniform(const shader_var_name& name, const bool2& arg1) const;
+	void uniform(const shader_var_name& name, const float2* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const int2* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const bool2* arg1, const size_t& count) const;
 	
 	// 3{i,f,b,fv,iv,bv}
-	void uniform(const char* name, const float& arg1, const float& arg2, const float& arg3) const;
-	void uniform(const char* name, const int& arg1, const int& arg2, const int& arg3) const;
-	void uniform(const char* name, const bool& arg1, const bool& arg2, const bool& arg3) const;
-	void uniform(const char* name, const float3& arg1) const;
-	void uniform(const char* name, const int3& arg1) const;
-	void uniform(const char* name, const bool3& arg1) const;
-	void uniform(const char* name, const float3* arg1, const size_t& count) const;
-	void uniform(const char* name, const int3* arg1, const size_t& count) const;
-	void uniform(const char* name, const bool3* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3) const;
+	void uniform(const shader_var_name& name, const int& arg1, const int& arg2, const int& arg3) const;
+	void uniform(const shader_var_name& name, const bool& arg1, const bool& arg2, const bool& arg3) const;
+	void uniform(const shader_var_name& name, const float3& arg1) const;
+	void uniform(const shader_var_name& name, const int3& arg1) const;
+	void uniform(const shader_var_name& name, const bool3& arg1) const;
+	void uniform(const shader_var_name& name, const float3* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const int3* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const bool3* arg1, const size_t& count) const;
 	
 	// 4{i,f,b,fv,iv,bv}
-	void uniform(const char* name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const;
-	void uniform(const char* name, const int& arg1, const int& arg2, const int& arg3, const int& arg4) const;
-	void uniform(const char* name, const bool& arg1, const bool& arg2, const bool& arg3, const bool& arg4) const;
-	void uniform(const char* name, const float4& arg1) const;
-	void uniform(const char* name, const int4& arg1) const;
-	void uniform(const char* name, const bool4& arg1) const;
-	void uniform(const char* name, const float4* arg1, const size_t& count) const;
-	void uniform(const char* name, const int4* arg1, const size_t& count) const;
-	void uniform(const char* name, const bool4* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const;
+	void uniform(const shader_var_name& name, const int& arg1, const int& arg2, const int& arg3, const int& arg4) const;
+	void uniform(const shader_var_name& name, const bool& arg1, const bool& arg2, const bool& arg3, const bool& arg4) const;
+	void uniform(const shader_var_name& name, const float4& arg1) const;
+	void uniform(const shader_var_name& name, const int4& arg1) const;
+	void uniform(const shader_var_name& name, const bool4& arg1) const;
+	void uniform(const shader_var_name& name, const float4* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const int4* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const bool4* arg1, const size_t& count) const;
 	
 	// mat*
-	void uniform(const char* name, const matrix4f& arg1) const;
-	void uniform(const char* name, const matrix4f* arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const matrix4f& arg1) const;
+	void uniform(const shader_var_name& name, const matrix4f* arg1, const size_t& count) const;
 	
 	// -> texture
-	void texture(const char* name, const GLuint& tex, const GLenum texture_type = GL_TEXTURE_2D) const;
-	void texture(const char* name, const a2e_texture& tex) const;
+	void texture(const shader_var_name& name, const GLuint& tex, const GLenum texture_type = GL_TEXTURE_2D) const;
+	void texture(const shader_var_name& name, const a2e_texture& tex) const;
 	
 	// -> attribute
 	// 1{f,fv}
-	void attribute(const char* name, const float& arg1) const;
-	void attribute(const char* name, const float* arg1) const;
+	void attribute(const shader_var_name& name, const float& arg1) const;
+	void attribute(const shader_var_name& name, const float* arg1) const;
 	
 	// 2{f,fv}
-	void attribute(const char* name, const float& arg1, const float& arg2) const;
-	void attribute(const char* name, const float2* arg1) const;
+	void attribute(const shader_var_name& name, const float& arg1, const float& arg2) const;
+	void attribute(const shader_var_name& name, const float2* arg1) const;
 	
 	// 3{f,fv}
-	void attribute(const char* name, const float& arg1, const float& arg2, const float& arg3) const;
-	void attribute(const char* name, const float3* arg1) const;
+	void attribute(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3) const;
+	void attribute(const shader_var_name& name, const float3* arg1) const;
 	
 	// 4{f,fv}
-	void attribute(const char* name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const;
-	void attribute(const char* name, const float4* arg1) const;
+	void attribute(const shader_var_name& name, const float& arg1, const float& arg2, const float& arg3, const float& arg4) const;
+	void attribute(const shader_var_name& name, const float4* arg1) const;
 	
 	// -> attribute array
-	void attribute_array(const char* name, const GLuint& buffer, const GLint& size, const GLenum type = GL_FLOAT, const GLboolean normalized = GL_FALSE, const GLsizei stride = 0);
+	void attribute_array(const shader_var_name& name, const GLuint& buffer, const GLint& size, const GLenum type = GL_FLOAT, const GLboolean normalized = GL_FALSE, const GLsizei stride = 0, const size_t offset = 0);
 	
 	// -> uniform block
-	void block(const char* name, const GLuint& ubo) const;
+	void block(const shader_var_name& name, const GLuint& ubo) const;
 	
 protected:
-	void set_texture(const char* name, const GLuint& tex, const GLenum& texture_type) const;
+	void set_texture(const shader_var_name& name, const GLuint& tex, const GLenum& texture_type) const;
 	
 };
 
@@ -229,52 +229,56 @@ F(GL_SAMPLER_CUBE)
 
 template<class shader_impl> class shader_base {
 public:
-	shader_base(const shader_object& shd_obj_) : shd_obj(shd_obj_), cur_program(0), cur_option("#") {}
+	shader_base(const shader_object& shd_obj_) : shd_obj(shd_obj_), cur_program(0) {}
 	virtual ~shader_base() {}
 	
 	// basic functions
 	virtual void use() { cur_program = 0; }
 	virtual void use(const size_t& program) { cur_program = program; }
 	virtual void use(const string& option, const set<string> combiners = set<string> {}) = 0;
+	//! selects a permutation via its engine-wide option id and combiner mask (see shader::get_option_id and
+	//! shader::get_combiner_bit), this is only a table lookup and should be preferred in per-draw code
+	virtual void use(const size_t& option_id, const uint32_t& combiner_mask) = 0;
 	virtual void disable() = 0;
 	virtual size_t get_cur_program() const = 0;
 	virtual const string& get_cur_option() const = 0;
 	
 	// functions for setting uniform variables
 	template<typename arg1_type>
-	void uniform(const char* name, const arg1_type& arg1) const;
+	void uniform(const shader_var_name& name, const arg1_type& arg1) const;
 	template<typename arg1_type>
-	void uniform(const char* name, const arg1_type& arg1, const size_t& count) const;
+	void uniform(const shader_var_name& name, const arg1_type& arg1, const size_t& count) const;
 	
 	template<typename arg1_type, typename arg2_type>
-	void uniform(const char* name, const arg1_type& arg1, const arg2_type& arg2) const;
+	void uniform(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2) const;
 	
 	template<typename arg1_type, typename arg2_type, typename arg3_type>
-	void uniform(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const;
+	void uniform(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const;
 	
 	template<typename arg1_type, typename arg2_type, typename arg3_type, typename arg4_type>
-	void uniform(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const;
+	void uniform(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const;
 	
 	// function for setting a texture (accepts direct gl ids (GLuint) and a2e texture objects)
-	void texture(const char* name, const GLuint& tex, const GLenum texture_type = GL_TEXTURE_2D) const;
-	void texture(const char* name, const a2e_texture& tex) const;
+	void texture(const shader_var_name& name, const GLuint& tex, const GLenum texture_type = GL_TEXTURE_2D) const;
+	void texture(const shader_var_name& name, const a2e_texture& tex) const;
 	
 	// functions for setting attribute variables
 	template<typename arg1_type>
-	void attribute(const char* name, const arg1_type& arg1) const;
+	void attribute(const shader_var_name& name, const arg1_type& arg1) const;
 	
 	template<typename arg1_type, typename arg2_type>
-	void attribute(const char* name, const arg1_type& arg1, const arg2_type& arg2) const;
+	void attribute(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2) const;
 	
 	template<typename arg1_type, typename arg2_type, typename arg3_type>
-	void attribute(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const;
+	void attribute(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const;
 	
 	template<typename arg1_type, typename arg2_type, typename arg3_type, typename arg4_type>
-	void attribute(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const;
+	void attribute(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const;
 	
 	// functions for setting attribute array variables
-	void attribute_array(const char* name, const GLuint& buffer, const GLint& size, const GLenum type = GL_FLOAT, const GLboolean normalized = GL_FALSE, const GLsizei stride = 0) {
-		((shader_impl*)this)->attribute_array(name, buffer, size, type, normalized, stride);
+	//! offset: byte offset of the first element in the buffer (only used for non-matrix attributes)
+	void attribute_array(const shader_var_name& name, const GLuint& buffer, const GLint& size, const GLenum type = GL_FLOAT, const GLboolean normalized = GL_FALSE, const GLsizei stride = 0, const size_t offset = 0) {
+		((shader_impl*)this)->attribute_array(name, buffer, size, type, normalized, stride, offset);
 	}
 	
 	// misc functions
@@ -294,109 +298,124 @@ public:
 		return false;
 	}
 	
-	size_t get_attribute_position(const char* name) const {
+	//! the position lookups return -1 for unknown names, so that a typo never writes to location 0
+	//! (glUniform* ignores location -1, attribute_array() and block() skip it)
+	GLint get_attribute_position(const shader_var_name& name) const {
 #if defined(A2E_DEBUG)
 		if(shd_obj.programs.size() <= cur_program) {
 			log_error("invalid program #%u!", cur_program);
-			return 0;
-		}
-		if(shd_obj.programs[cur_program]->attributes.count(name) == 0) {
-			log_error("unknown attribute name \"%s\"!", name);
-			return 0;
+			return -1;
 		}
 #endif
-		return shd_obj.programs[cur_program]->attributes.find(name)->second.location;
+		const auto var = shd_obj.programs[cur_program]->attribute_table.find(name);
+		if(var == nullptr) {
+#if defined(A2E_DEBUG)
+			log_error("unknown attribute name \"%s\"!", name.str);
+#endif
+			return -1;
+		}
+		return (GLint)var->location;
 	}
 	
-	size_t get_uniform_position(const char* name) const {
+	GLint get_uniform_position(const shader_var_name& name) const {
 #if defined(A2E_DEBUG)
 		if(shd_obj.programs.size() <= cur_program) {
 			log_error("invalid program #%u!", cur_program);
-			return 0;
-		}
-		if(shd_obj.programs[cur_program]->uniforms.count(name) == 0) {
-			log_error("unknown uniform name \"%s\"!", name);
-			return 0;
+			return -1;
 		}
 #endif
-		return shd_obj.programs[cur_program]->uniforms.find(name)->second.location;
+		const auto var = shd_obj.programs[cur_program]->uniform_table.find(name);
+		if(var == nullptr) {
+#if defined(A2E_DEBUG)
+			log_error("unknown uniform name \"%s\"!", name.str);
+#endif
+			return -1;
+		}
+		return (GLint)var->location;
+	}
+	
+	//! returns true if the current program has an (active) vertex attribute with the specified name
+	bool has_attribute(const shader_var_name& name) const {
+		return (shd_obj.programs[cur_program]->attribute_table.find(name) != nullptr);
 	}
 	
-	size_t get_block_position(const char* name) const {
+	GLint get_block_position(const shader_var_name& name) const {
 #if defined(A2E_DEBUG)
 		if(shd_obj.programs.size() <= cur_program) {
 			log_error("invalid program #%u!", cur_program);
-			return 0;
-		}
-		if(shd_obj.programs[cur_program]->blocks.count(name) == 0) {
-			log_error("unknown uniform block name \"%s\"!", name);
-			return 0;
+			return -1;
 		}
 #endif
-		return shd_obj.programs[cur_program]->blocks.find(name)->second.location;
+		const auto var = shd_obj.programs[cur_program]->block_table.find(name);
+		if(var == nullptr) {
+#if defined(A2E_DEBUG)
+			log_error("unknown uniform block name \"%s\"!", name.str);
+#endif
+			return -1;
+		}
+		return (GLint)var->location;
 	}
 	
 protected:
 	const shader_object& shd_obj;
 	size_t cur_program;
-	string cur_option;
 	set<size_t> active_vertex_attribs;
 	
 };
 
 // functions for setting uniform variables
 template<class shader_impl> template<typename arg1_type>
-void shader_base<shader_impl>::uniform(const char* name, const arg1_type& arg1) const {
+void shader_base<shader_impl>::uniform(const shader_var_name& name, const arg1_type& arg1) const {
 	((shader_impl*)this)->uniform(name, arg1);
 }
 
 template<class shader_impl> template<typename arg1_type>
-void shader_base<shader_impl>::uniform(const char* name, const arg1_type& arg1, const size_t& count) const {
+void shader_base<shader_impl>::uniform(const shader_var_name& name, const arg1_type& arg1, const size_t& count) const {
 	((shader_impl*)this)->uniform(name, arg1, count);
 }
 
 template<class shader_impl> template<typename arg1_type, typename arg2_type>
-void shader_base<shader_impl>::uniform(const char* name, const arg1_type& arg1, const arg2_type& arg2) const {
+void shader_base<shader_impl>::uniform(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2) const {
 	((shader_impl*)this)->uniform(name, arg1, arg2);
 }
 
 template<class shader_impl> template<typename arg1_type, typename arg2_type, typename arg3_type>
-void shader_base<shader_impl>::uniform(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const {
+void shader_base<shader_impl>::uniform(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const {
 	((shader_impl*)this)->uniform(name, arg1, arg2, arg3);
 }
 
 template<class shader_impl> template<typename arg1_type, typename arg2_type, typename arg3_type, typename arg4_type>
-void shader_base<shader_impl>::uniform(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const {
+void shader_base<shader_impl>::uniform(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const {
 	((shader_impl*)this)->uniform(name, arg1, arg2, arg3, arg4);
 }
 
 // function for setting a texture
-template<class shader_impl> void shader_base<shader_impl>::texture(const char* name, const GLuint& tex, const GLenum texture_type) const {
+template<class shader_impl> void shader_base<shader_impl>::texture(const shader_var_name& name, const GLuint& tex, const GLenum texture_type) const {
 	((shader_impl*)this)->texture(name, tex, texture_type);
 }
 
-template<class shader_impl> void shader_base<shader_impl>::texture(const char* name, const a2e_texture& tex) const {
+template<class shader_impl> void shader_base<shader_impl>::texture(const shader_var_name& name, const a2e_texture& tex) const {
 	((shader_impl*)this)->texture(name, tex);
 }
 
 // functions for setting attribute variables
 template<class shader_impl> template<typename arg1_type>
-void shader_base<shader_impl>::attribute(const char* name, const arg1_type& arg1) const {
+void shader_base<shader_impl>::attribute(const shader_var_name& name, const arg1_type& arg1) const {
 	((shader_impl*)this)->attribute(name, arg1);
 }
 
 template<class shader_impl> template<typename arg1_type, typename arg2_type>
-void shader_base<shader_impl>::attribute(const char* name, const arg1_type& arg1, const arg2_type& arg2) const {
+void shader_base<shader_impl>::attribute(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2) const {
 	((shader_impl*)this)->attribute(name, arg1, arg2);
 }
 
 template<class shader_impl> template<typename arg1_type, typename arg2_type, typename arg3_type>
-void shader_base<shader_impl>::attribute(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const {
+void shader_base<shader_impl>::attribute(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3) const {
 	((shader_impl*)this)->attribute(name, arg1, arg2, arg3);
 }
 
 template<class shader_impl> template<typename arg1_type, typename arg2_type, typename arg3_type, typename arg4_type>
-void shader_base<shader_impl>::attribute(const char* name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const {
+void shader_base<shader_impl>::attribute(const shader_var_name& name, const arg1_type& arg1, const arg2_type& arg2, const arg3_type& arg3, const arg4_type& arg4) const {
 	((shader_impl*)this)->attribute(name, arg1, arg2, arg3, arg4);
 }
 
@@ -21,6 +21,26 @@
 
 #include "global.hpp"
 
+//! fnv-1a hash of a shader variable name (constexpr, so names that are known at compile time are hashed by the compiler)
+constexpr uint32_t shader_var_hash(const char* str) {
+	uint32_t hash = 2166136261u;
+	for(; *str != '\0'; ++str) {
+		hash = (hash ^ (uint32_t)(uint8_t)*str) * 16777619u;
+	}
+	return hash;
+}
+
+//! name of a uniform/attribute/uniform block and its hash. this is implicitly constructed from c strings
+//! (-> the hash is computed at runtime, but no memory is allocated), use A2E_SHADER_VAR("name") in hot code
+//! paths to hash the name at compile time.
+struct shader_var_name {
+	const char* str;
+	uint32_t hash;
+	constexpr shader_var_name(const char* str_) : str(str_), hash(shader_var_hash(str_)) {}
+	constexpr shader_var_name(const char* str_, const uint32_t hash_) : str(str_), hash(hash_) {}
+};
+#define A2E_SHADER_VAR(name) shader_var_name(name, std::integral_constant<uint32_t, shader_var_hash(name)>::value)
+
 struct shader_object {
 	struct internal_shader_object {
 		GLuint program;
@@ -41,6 +61,61 @@ struct shader_object {
 		map<string, size_t> samplers;
 		map<string, shader_variable> blocks;
 		
+		//! flat open addressing hash table (name hash -> variable) that is used for all lookups while rendering
+		//! (built once per program, see build_lookup_tables())
+		struct variable_table {
+			struct entry {
+				uint32_t hash;
+				GLenum type;
+				size_t location;
+				size_t sampler; // texture unit (only valid for sampler uniforms)
+				const char* name; // nullptr: empty slot
+			};
+			vector<entry> entries;
+			
+			void build(const map<string, shader_variable>& vars, const map<string, size_t>* sampler_map = nullptr) {
+				// power of two size and at most 50% load (-> there is always an empty slot that ends the probing)
+				size_t size = 4;
+				while(size < vars.size() * 2) size <<= 1;
+				entries.assign(size, entry { 0, 0, 0, 0, nullptr });
+				
+				const size_t mask = size - 1;
+				for(const auto& var : vars) {
+					const uint32_t hash = shader_var_hash(var.first.c_str());
+					size_t idx = hash & mask;
+					while(entries[idx].name != nullptr) idx = (idx + 1) & mask;
+					
+					size_t sampler = 0;
+					if(sampler_map != nullptr) {
+						const auto sampler_iter = sampler_map->find(var.first);
+						if(sampler_iter != sampler_map->end()) sampler = sampler_iter->second;
+					}
+					entries[idx] = entry { hash, (GLenum)var.second.type, var.second.location, sampler, var.first.c_str() };
+				}
+			}
+			
+			//! returns nullptr if no variable with this name exists
+			const entry* find(const shader_var_name& name) const {
+				if(entries.empty()) return nullptr;
+				const size_t mask = entries.size() - 1;
+				for(size_t idx = name.hash & mask; ; idx = (idx + 1) & mask) {
+					const entry& e = entries[idx];
+					if(e.name == nullptr) return nullptr;
+					if(e.hash == name.hash && strcmp(e.name, name.str) == 0) return &e;
+				}
+			}
+		};
+		variable_table uniform_table;
+		variable_table attribute_table;
+		variable_table block_table;
+		
+		//! must be called once all variables have been added
+		void build_lookup_tables() {
+			uniform_table.build(uniforms, &samplers);
+			attribute_table.build(attributes);
+			block_table.build(blocks);
+		}
+		
 		internal_shader_object() : program(0), vertex_shader(0), fragment_shader(0), geometry_shader(0), tess_control_shader(0), tess_evaluation_shader(0), uniforms(), attributes(), samplers(), blocks() {}
 		~internal_shader_object() {
 			// TODO: delete shaders?
@@ -52,11 +127,39 @@ struct shader_object {
 	};
 	string name;
 	vector<internal_shader_object*> programs;
-	map<string, internal_shader_object*> options;
+	//! <option*combiner..., program index>
+	map<string, size_t> options;
+	//! option name of each program ("#" if the program has no option)
+	vector<string> program_options;
 	ext::GLSL_VERSION glsl_version;
 	bool a2e_shader;
 	
-	shader_object(const string& shd_name) : name(shd_name), programs(), options(),
+	//! a2e shader permutations, resolved once when the shader is compiled (see shader::get_option_id and
+	//! shader::get_combiner_bit). program index of an option + combiner set:
+	//! permutations[option_slots[option id] * (1 << combiner_bits.size()) + local combiner mask]
+	struct permutation_table {
+		static constexpr size_t invalid = ~size_t(0);
+		//! engine-wide option id -> local option index (or invalid if the shader doesn't have this option)
+		vector<size_t> option_slots;
+		//! local combiner index -> engine-wide combiner bit
+		vector<uint32_t> combiner_bits;
+		//! local permutation -> program index (or invalid)
+		vector<size_t> permutations;
+		
+		//! returns the program index of the specified option id and engine-wide combiner mask (or invalid),
+		//! combiners that don't exist in this shader are ignored
+		size_t get_program(const size_t& option_id, const uint32_t& combiner_mask) const {
+			if(option_id >= option_slots.size() || option_slots[option_id] == invalid) return invalid;
+			size_t local_mask = 0;
+			for(size_t i = 0, count = combiner_bits.size(); i < count; ++i) {
+				if((combiner_mask & combiner_bits[i]) != 0) local_mask |= (size_t(1) << i);
+			}
+			return permutations[(option_slots[option_id] << combiner_bits.size()) + local_mask];
+		}
+	};
+	permutation_table permutation_programs;
+	
+	shader_object(const string& shd_name) : name(shd_name), programs(), options(), program_options(),
 #if !defined(FLOOR_IOS)
 	glsl_version(ext::GLSL_VERSION::GLSL_150),
 #else
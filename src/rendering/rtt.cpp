@@ -188,7 +188,7 @@ rtt::fbo* rtt::add_buffer(const unsigned int width_, const unsigned int height_,
 #endif
 		
 		buffer->target[i] = target[i];
-		glBindTexture(buffer->target[i], buffer->tex[i]);
+		gl_state::bind_texture(buffer->target[i], buffer->tex[i]);
 		
 		glTexParameteri(buffer->target[i], GL_TEXTURE_MAG_FILTER,
 						(filtering[i] == TEXTURE_FILTERING::POINT ? GL_NEAREST : GL_LINEAR));
@@ -280,7 +280,7 @@ rtt::fbo* rtt::add_buffer(const unsigned int width_, const unsigned int height_,
 				}
 				else if(depth_type == DEPTH_TYPE::TEXTURE_2D) {
 					glGenTextures(1, &buffer->depth_buffer);
-					glBindTexture(GL_TEXTURE_2D, buffer->depth_buffer);
+					gl_state::bind_texture(GL_TEXTURE_2D, buffer->depth_buffer);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -325,7 +325,7 @@ rtt::fbo* rtt::add_buffer(const unsigned int width_, const unsigned int height_,
 #if !defined(FLOOR_IOS)
 				else if(depth_type == DEPTH_TYPE::TEXTURE_2D) {
 					glGenTextures(1, &buffer->depth_buffer);
-					glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, buffer->depth_buffer);
+					gl_state::bind_texture(GL_TEXTURE_2D_MULTISAMPLE, buffer->depth_buffer);
 					glTexParameteri(GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 					glTexParameteri(GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 					glTexParameteri(GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -416,7 +416,7 @@ rtt::fbo* rtt::add_buffer(const unsigned int width_, const unsigned int height_,
 void rtt::delete_buffer(rtt::fbo* buffer) {
 	for(size_t i = 0; i < buffer->attachment_count; i++) {
 		if(buffer->tex[i] == 0) continue;
-		glDeleteTextures(1, &buffer->tex[i]);
+		gl_state::delete_textures(1, &buffer->tex[i]);
 	}
 	for(size_t i = 0; i < buffer->attachment_count; i++) {
 		if(buffer->resolve_buffer[i] <= A2E_DEFAULT_FRAMEBUFFER) break;
@@ -433,11 +433,11 @@ void rtt::delete_buffer(rtt::fbo* buffer) {
 		buffer->depth_buffer = 0;
 	}
 	if(buffer->color_buffer > 0 && glIsTexture(buffer->color_buffer)) {
-		glDeleteTextures(1, &buffer->color_buffer);
+		gl_state::delete_textures(1, &buffer->color_buffer);
 		buffer->color_buffer = 0;
 	}
 	if(buffer->depth_buffer > 0 && glIsTexture(buffer->depth_buffer)) {
-		glDeleteTextures(1, &buffer->depth_buffer);
+		gl_state::delete_textures(1, &buffer->depth_buffer);
 		buffer->depth_buffer = 0;
 	}
 	
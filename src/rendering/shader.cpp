@@ -86,10 +86,16 @@ void shader::reload_shaders() {
 	if(err_shd_cnt == 0) log_debug("external shaders compiled successfully!");
 	else log_debug("failed to compile %u external!", err_shd_cnt);
 	
+	reload_count++;
+	
 	// emit shader reload event
 	floor::get_event()->add_event(EVENT_TYPE::SHADER_RELOAD, make_shared<shader_reload_event>(SDL_GetTicks()));
 }
 
+size_t shader::get_reload_count() const {
+	return reload_count;
+}
+
 void shader::copy_buffer(rtt::fbo* src_buffer, rtt::fbo* dest_buffer, unsigned int src_attachment, unsigned int dest_attachment) {
 #if !defined(FLOOR_IOS)
 	if((src_buffer->target[src_attachment] != GL_TEXTURE_2D && src_buffer->target[src_attachment] != GL_TEXTURE_RECTANGLE) ||
@@ -149,8 +155,9 @@ shader_object* shader::add_shader_src(const string& identifier, const string& op
 	
 	// add a new program object to this shader
 	shaders[identifier]->programs.push_back(new shader_object::internal_shader_object());
+	shaders[identifier]->program_options.emplace_back(option != "" ? option : "#");
 	if(option != "") {
-		shaders[identifier]->options[option] = shaders[identifier]->programs.back();
+		shaders[identifier]->options[option] = shaders[identifier]->programs.size() - 1;
 	}
 	shader_object::internal_shader_object& shd_obj = *shaders[identifier]->programs.back();
 	shaders[identifier]->glsl_version = std::max(shaders[identifier]->glsl_version, glsl_version);
@@ -255,7 +262,7 @@ shader_object* shader::add_shader_src(const string& identifier, const string& op
 		log_error("Error in program \"%s/%s\" linkage!\nInfo log: %s", identifier, option, info_log);
 		return 0;
 	}
-	glUseProgram(shd_obj.program);
+	gl_state::use_program(shd_obj.program);
 	
 	// bind frag data locations (frag_color, frag_color_2, frag_color_3, ...)
 	bool fd_relink = false;
@@ -401,10 +408,14 @@ shader_object* shader::add_shader_src(const string& identifier, const string& op
 		shd_obj.blocks.insert(make_pair(uniform_block_name,
 										shader_object::internal_shader_object::shader_variable(block_index, (size_t)data_size, GL_UNIFORM_BUFFER)));
 		
+		// each block is bound to the binding point of its block index (see shader_*::block)
+		glUniformBlockBinding(shd_obj.program, block_index, block_index);
+		
 		// TODO: handle samplers?
 	}
 	delete [] uni_block_name;
 #endif
+	shd_obj.build_lookup_tables();
 	
 	// validate the program object
 	glValidateProgram(shd_obj.program);
@@ -424,7 +435,7 @@ shader_object* shader::add_shader_src(const string& identifier, const string& op
 	}
 	
 	//
-	glUseProgram(0);
+	gl_state::use_program(0);
 
 	return shaders[identifier];
 }
@@ -559,6 +570,28 @@ bool shader::add_a2e_shader(const string& identifier, const string& filename) {
 	return true;
 }
 
+size_t shader::get_option_id(const string& option) {
+	const auto iter = option_ids.find(option);
+	if(iter != option_ids.end()) return iter->second;
+	
+	const size_t id = option_ids.size();
+	option_ids.emplace(option, id);
+	return id;
+}
+
+uint32_t shader::get_combiner_bit(const string& combiner) {
+	const auto iter = combiner_bits.find(combiner);
+	if(iter != combiner_bits.end()) return iter->second;
+	
+	if(combiner_bits.size() >= 32) {
+		log_error("too many shader combiners - can't add combiner \"%s\"!", combiner);
+		return 0;
+	}
+	const uint32_t bit = 1u << (uint32_t)combiner_bits.size();
+	combiner_bits.emplace(combiner, bit);
+	return bit;
+}
+
 ////
 #define A2E_SHADER_IMPL_TO_STR(x) #x
 #define make_get_shader(ret_type, shader_impl, min_glsl, max_glsl) \
@@ -58,6 +58,13 @@ public:
 	// for convenience:
 	gl_shader get_gl_shader(const string& identifier) const;
 	
+	//! returns the engine-wide id of a shader option (e.g. "opaque"), use this together with
+	//! get_combiner_bit() to select a shader permutation via use(option_id, combiner_mask).
+	//! note: ids are stable for the lifetime of the shader class (also across reload_shaders())
+	size_t get_option_id(const string& option);
+	//! returns the engine-wide bit of a shader combiner (e.g. "*env_map"), bits can be or-ed together
+	uint32_t get_combiner_bit(const string& combiner);
+	
 	// actually a rtt function, but put here, b/c it uses shaders (which aren't allowed in rtt class, b/c of class dependency)
 	void copy_buffer(rtt::fbo* src_buffer, rtt::fbo* dest_buffer, unsigned int src_attachment = 0, unsigned int dest_attachment = 0);
 
@@ -69,6 +76,8 @@ public:
 	//! reloads all internal and external shaders that were added via add_a2e_shader
 	//! note: this invalidates _all_ shaders!
 	void reload_shaders();
+	//! number of reload_shaders() calls (anything that depends on attribute/uniform locations must be rebuilt if this changed)
+	size_t get_reload_count() const;
 
 protected:
 	ext* exts;
@@ -78,11 +87,16 @@ protected:
 
 	GLenum copy_draw_buffer[1];
 	bool gui_shader_rendering;
+	size_t reload_count = 0;
 	
 	bool load_internal_shaders();
 	
 	map<string, string> external_shaders;
 	
+	// shader permutation ids (see get_option_id/get_combiner_bit)
+	unordered_map<string, size_t> option_ids;
+	unordered_map<string, uint32_t> combiner_bits;
+	
 	void log_pretty_print(const char* log, const char* code) const;
 	
 };
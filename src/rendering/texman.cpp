@@ -233,7 +233,7 @@ a2e_texture texman::add_texture(void* pixel_data, GLsizei width, GLsizei height,
 	
 	// now create/generate an opengl texture and bind it
 	glGenTextures(1, &tex->tex_num);
-	glBindTexture(GL_TEXTURE_2D, tex->tex_num);
+	gl_state::bind_texture(GL_TEXTURE_2D, tex->tex_num);
 	
 	// texture parameters
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (filtering == TEXTURE_FILTERING::POINT ? GL_NEAREST : GL_LINEAR));
@@ -299,7 +299,7 @@ a2e_texture texman::add_cubemap_texture(void** pixel_data, GLsizei width, GLsize
 	
 	// now create/generate an opengl texture and bind it
 	glGenTextures(1, &tex->tex_num);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, tex->tex_num);
+	gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, tex->tex_num);
 	
 	// texture parameters
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER,
@@ -21,6 +21,7 @@
 
 #include "global.hpp"
 #include <floor/core/gl_support.hpp>
+#include "rendering/gl_state.hpp"
 
 enum class TEXTURE_FILTERING : unsigned int {
 	POINT,
@@ -51,7 +52,7 @@ struct texture_object {
 	
 	~texture_object() {
 		if(tex_num > 0) {
-			glDeleteTextures(1, &tex_num);
+			gl_state::delete_textures(1, &tex_num);
 		}
 	}
 	
@@ -0,0 +1,68 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "alpha_mask_grid.hpp"
+
+void alpha_mask_grid::assign(const vector<int4>& rects, const int2& screen_dim, const size_t& max_mask_id,
+							 vector<pair<uint32_t, size_t>>& mask_ids) {
+	const size_t obj_count = rects.size();
+	const int2 cell_size(std::max((screen_dim.x + grid_dim - 1) / grid_dim, 1),
+						 std::max((screen_dim.y + grid_dim - 1) / grid_dim, 1));
+	grid.resize(grid_dim * grid_dim);
+	for(auto& cell : grid) {
+		cell.clear();
+	}
+	visit_stamps.assign(obj_count, ~size_t(0));
+	
+	const size_t max_overlaps = max_mask_id - 1;
+	for(size_t i = 0; i < obj_count; i++) {
+		const int4& rect = rects[i];
+		if(rect.x > rect.z) {
+			mask_ids[i].second = numeric_limits<int>::max();
+			continue;
+		}
+		
+		const int cell_x_min = std::min(rect.x / cell_size.x, grid_dim - 1);
+		const int cell_y_min = std::min(rect.y / cell_size.y, grid_dim - 1);
+		const int cell_x_max = std::min(rect.z / cell_size.x, grid_dim - 1);
+		const int cell_y_max = std::min(rect.w / cell_size.y, grid_dim - 1);
+		
+		size_t overlaps = 0;
+		for(int cy = cell_y_min; cy <= cell_y_max && overlaps < max_overlaps; cy++) {
+			for(int cx = cell_x_min; cx <= cell_x_max && overlaps < max_overlaps; cx++) {
+				for(const auto& j : grid[size_t(cy * grid_dim + cx)]) {
+					if(visit_stamps[j] == i) continue; // already checked (spans multiple cells)
+					visit_stamps[j] = i;
+					
+					const int4& other = rects[j];
+					if(rect.x < other.z && rect.z > other.x &&
+					   rect.y < other.w && rect.w > other.y) {
+						if(++overlaps >= max_overlaps) break;
+					}
+				}
+			}
+		}
+		mask_ids[i].second = std::min(overlaps + 1, max_mask_id);
+		
+		for(int cy = cell_y_min; cy <= cell_y_max; cy++) {
+			for(int cx = cell_x_min; cx <= cell_x_max; cx++) {
+				grid[size_t(cy * grid_dim + cx)].push_back((uint32_t)i);
+			}
+		}
+	}
+}
@@ -0,0 +1,46 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_ALPHA_MASK_GRID_HPP__
+#define __A2E_ALPHA_MASK_GRID_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+
+//! assigns the mask ids of the (front to back sorted) alpha objects from their screen space rectangles:
+//! the mask id of an object is 1 + the amount of overlapping objects in front of it (clamped to the max mask id).
+//! objects are inserted into a uniform screen grid in front to back order, so only objects in the same grid cells
+//! have to be checked (and the check stops as soon as the max mask id has been reached).
+//! the grid memory is kept across frames. this is purely cpu side (no gl calls).
+class alpha_mask_grid {
+public:
+	static constexpr int grid_dim = 32;
+	
+	//! "rects" are (min x, min y, max x, max y) in pixels in front to back order (invisible objects: min x > max x,
+	//! these get a mask id of numeric_limits<int>::max()), the mask id of rects[i] is written to mask_ids[i].second
+	void assign(const vector<int4>& rects, const int2& screen_dim, const size_t& max_mask_id,
+				vector<pair<uint32_t, size_t>>& mask_ids);
+	
+protected:
+	vector<vector<uint32_t>> grid;
+	vector<size_t> visit_stamps;
+	
+};
+
+#endif
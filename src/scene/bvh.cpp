@@ -0,0 +1,34 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "bvh.hpp"
+
+void bvh_base::compute_aabb(const extbbox& box, float3& aabb_min, float3& aabb_max) {
+	// world = (local * mview) + pos -> transform the center and sum up the absolute rotated extents
+	const float3 local_center((box.min + box.max) * 0.5f);
+	const float3 half_extent((box.max - box.min) * 0.5f);
+	const float3 center((local_center * box.mview) + box.pos);
+	
+	const auto& m = box.mview.data;
+	const float3 ext(half_extent.x * fabsf(m[0]) + half_extent.y * fabsf(m[4]) + half_extent.z * fabsf(m[8]),
+					 half_extent.x * fabsf(m[1]) + half_extent.y * fabsf(m[5]) + half_extent.z * fabsf(m[9]),
+					 half_extent.x * fabsf(m[2]) + half_extent.y * fabsf(m[6]) + half_extent.z * fabsf(m[10]));
+	aabb_min = center - ext;
+	aabb_max = center + ext;
+}
+
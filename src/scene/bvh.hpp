@@ -0,0 +1,542 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_BVH_HPP__
+#define __A2E_BVH_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+#include <floor/math/bbox.hpp>
+#include "scene/frustum.hpp"
+
+//! aabb functions of the bvh that don't depend on the object type
+class bvh_base {
+public:
+	//! computes the world space aabb of an oriented extended bounding box
+	static void compute_aabb(const extbbox& box, float3& aabb_min, float3& aabb_max);
+	
+protected:
+	static float aabb_surface_area(const float3& aabb_min, const float3& aabb_max) {
+		const float3 ext(aabb_max - aabb_min);
+		return 2.0f * (ext.x * ext.y + ext.y * ext.z + ext.z * ext.x);
+	}
+	static bool aabb_contains(const float3& outer_min, const float3& outer_max,
+							  const float3& inner_min, const float3& inner_max) {
+		return (outer_min.x <= inner_min.x && outer_min.y <= inner_min.y && outer_min.z <= inner_min.z &&
+				outer_max.x >= inner_max.x && outer_max.y >= inner_max.y && outer_max.z >= inner_max.z);
+	}
+	static bool aabb_overlaps(const float3& a_min, const float3& a_max, const float3& b_min, const float3& b_max) {
+		return (a_min.x <= b_max.x && a_max.x >= b_min.x &&
+				a_min.y <= b_max.y && a_max.y >= b_min.y &&
+				a_min.z <= b_max.z && a_max.z >= b_min.z);
+	}
+	
+};
+
+//! dynamic bounding volume hierarchy (aabb tree) over the world space bounding boxes of objects:
+//! leaves store a slightly enlarged ("fat") aabb, so small movements only require a containment check,
+//! larger ones reinsert the leaf. inner nodes are kept balanced via tree rotations on insert/remove.
+//! "object_type" must provide "extbbox* get_bounding_box()" (the scene uses bvh = bvh_tree<a2emodel>).
+//! note: transformations only mark an object as dirty, the actual refit happens in refit() (once per frame)
+template <typename object_type> class bvh_tree : public bvh_base {
+public:
+	bvh_tree() { nodes.reserve(64); }
+	~bvh_tree() {}
+	
+	void insert(object_type* obj);
+	//! returns false if the object isn't contained in the bvh
+	bool remove(object_type* obj);
+	bool contains(const object_type* obj) const;
+	void clear();
+	
+	//! flags the object for a refit (call this whenever its bounding box changes)
+	void mark_dirty(object_type* obj);
+	//! updates all dirty leaves (reinserts them if they moved out of their fat aabb)
+	void refit();
+	
+	// queries: all objects whose (fat) aabb intersects the specified volume are appended to "result"
+	void query(const frustum& view_frustum, vector<object_type*>& result) const;
+	void query(const float3& sphere_center, const float& sphere_radius, vector<object_type*>& result) const;
+	void query(const float3& aabb_min, const float3& aabb_max, vector<object_type*>& result) const;
+	//! "direction" doesn't have to be normalized, "max_distance" is in units of "direction"
+	void query_ray(const float3& origin, const float3& direction, const float& max_distance,
+				   vector<object_type*>& result) const;
+	
+	size_t size() const;
+	//! height of the tree (0 if empty or a single leaf)
+	int32_t get_height() const;
+	
+	//! margin (in world units) that is added to each side of a leaf aabb
+	void set_fat_margin(const float& margin);
+	float get_fat_margin() const;
+
+protected:
+	static constexpr int32_t null_node = -1;
+	
+	struct node {
+		float3 aabb_min;
+		float3 aabb_max;
+		//! parent node, or the next free node if this node is unused
+		int32_t parent;
+		int32_t children[2];
+		//! leaf: 0, unused: -1
+		int32_t height;
+		object_type* object;
+		bool dirty;
+		
+		bool is_leaf() const { return (children[0] == null_node); }
+	};
+	vector<node> nodes;
+	int32_t root = null_node;
+	int32_t free_list = null_node;
+	size_t leaf_count = 0;
+	float fat_margin = 0.5f;
+	
+	unordered_map<const object_type*, int32_t> leaves;
+	vector<int32_t> dirty_leaves;
+	
+	int32_t allocate_node();
+	void free_node(const int32_t node_id);
+	void insert_leaf(const int32_t leaf);
+	void remove_leaf(const int32_t leaf);
+	int32_t balance(const int32_t node_id);
+	void fix_upwards(int32_t node_id);
+	void compute_fat_aabb(object_type* obj, float3& aabb_min, float3& aabb_max) const;
+	void collect_leaves(const int32_t node_id, vector<object_type*>& result, vector<int32_t>& stack) const;
+
+};
+
+class a2emodel;
+typedef bvh_tree<a2emodel> bvh;
+
+template <typename object_type> void bvh_tree<object_type>::clear() {
+	nodes.clear();
+	leaves.clear();
+	dirty_leaves.clear();
+	root = null_node;
+	free_list = null_node;
+	leaf_count = 0;
+}
+
+template <typename object_type> size_t bvh_tree<object_type>::size() const {
+	return leaf_count;
+}
+
+template <typename object_type> int32_t bvh_tree<object_type>::get_height() const {
+	if(root == null_node) return 0;
+	return nodes[(size_t)root].height;
+}
+
+template <typename object_type> void bvh_tree<object_type>::set_fat_margin(const float& margin) {
+	fat_margin = margin;
+}
+
+template <typename object_type> float bvh_tree<object_type>::get_fat_margin() const {
+	return fat_margin;
+}
+
+template <typename object_type> void bvh_tree<object_type>::compute_fat_aabb(object_type* obj, float3& aabb_min,
+																						  float3& aabb_max) const {
+	compute_aabb(*obj->get_bounding_box(), aabb_min, aabb_max);
+	aabb_min -= float3(fat_margin);
+	aabb_max += float3(fat_margin);
+}
+
+template <typename object_type> int32_t bvh_tree<object_type>::allocate_node() {
+	int32_t node_id;
+	if(free_list != null_node) {
+		node_id = free_list;
+		free_list = nodes[(size_t)node_id].parent;
+	}
+	else {
+		node_id = (int32_t)nodes.size();
+		nodes.emplace_back();
+	}
+	
+	node& n = nodes[(size_t)node_id];
+	n.parent = null_node;
+	n.children[0] = null_node;
+	n.children[1] = null_node;
+	n.height = 0;
+	n.object = nullptr;
+	n.dirty = false;
+	return node_id;
+}
+
+template <typename object_type> void bvh_tree<object_type>::free_node(const int32_t node_id) {
+	node& n = nodes[(size_t)node_id];
+	n.parent = free_list;
+	n.height = -1;
+	n.object = nullptr;
+	free_list = node_id;
+}
+
+template <typename object_type> void bvh_tree<object_type>::insert(object_type* obj) {
+	if(leaves.count(obj) != 0) {
+		log_error("object already exists in the bvh!");
+		return;
+	}
+	
+	const int32_t leaf = allocate_node();
+	node& n = nodes[(size_t)leaf];
+	n.object = obj;
+	compute_fat_aabb(obj, n.aabb_min, n.aabb_max);
+	leaves.emplace(obj, leaf);
+	leaf_count++;
+	insert_leaf(leaf);
+}
+
+template <typename object_type> bool bvh_tree<object_type>::remove(object_type* obj) {
+	const auto iter = leaves.find(obj);
+	if(iter == leaves.end()) return false;
+	
+	const int32_t leaf = iter->second;
+	leaves.erase(iter);
+	if(nodes[(size_t)leaf].dirty) {
+		dirty_leaves.erase(find(begin(dirty_leaves), end(dirty_leaves), leaf));
+	}
+	remove_leaf(leaf);
+	free_node(leaf);
+	leaf_count--;
+	return true;
+}
+
+template <typename object_type> bool bvh_tree<object_type>::contains(const object_type* obj) const {
+	return (leaves.count(obj) != 0);
+}
+
+template <typename object_type> void bvh_tree<object_type>::mark_dirty(object_type* obj) {
+	const auto iter = leaves.find(obj);
+	if(iter == leaves.end()) return; // not (yet) part of the bvh
+	
+	node& n = nodes[(size_t)iter->second];
+	if(n.dirty) return;
+	n.dirty = true;
+	dirty_leaves.push_back(iter->second);
+}
+
+template <typename object_type> void bvh_tree<object_type>::refit() {
+	for(const auto& leaf : dirty_leaves) {
+		node& n = nodes[(size_t)leaf];
+		n.dirty = false;
+		
+		float3 aabb_min, aabb_max;
+		compute_aabb(*n.object->get_bounding_box(), aabb_min, aabb_max);
+		if(aabb_contains(n.aabb_min, n.aabb_max, aabb_min, aabb_max)) {
+			// still inside the fat aabb -> nothing to do
+			continue;
+		}
+		
+		remove_leaf(leaf);
+		n.aabb_min = aabb_min - float3(fat_margin);
+		n.aabb_max = aabb_max + float3(fat_margin);
+		insert_leaf(leaf);
+	}
+	dirty_leaves.clear();
+}
+
+template <typename object_type> void bvh_tree<object_type>::insert_leaf(const int32_t leaf) {
+	if(root == null_node) {
+		root = leaf;
+		nodes[(size_t)root].parent = null_node;
+		return;
+	}
+	
+	// find the best sibling (surface area heuristic)
+	const float3 leaf_min(nodes[(size_t)leaf].aabb_min), leaf_max(nodes[(size_t)leaf].aabb_max);
+	int32_t index = root;
+	while(!nodes[(size_t)index].is_leaf()) {
+		const node& n = nodes[(size_t)index];
+		const int32_t child_0 = n.children[0];
+		const int32_t child_1 = n.children[1];
+		
+		const float area = aabb_surface_area(n.aabb_min, n.aabb_max);
+		const float combined_area = aabb_surface_area(float3(n.aabb_min).min(leaf_min),
+													   float3(n.aabb_max).max(leaf_max));
+		
+		// cost of creating a new parent for this node and the new leaf
+		const float cost = 2.0f * combined_area;
+		// minimum cost of pushing the leaf further down the tree
+		const float inheritance_cost = 2.0f * (combined_area - area);
+		
+		const auto child_cost = [&](const int32_t child) {
+			const node& c = nodes[(size_t)child];
+			const float new_area = aabb_surface_area(float3(c.aabb_min).min(leaf_min),
+													  float3(c.aabb_max).max(leaf_max));
+			if(c.is_leaf()) return new_area + inheritance_cost;
+			return (new_area - aabb_surface_area(c.aabb_min, c.aabb_max)) + inheritance_cost;
+		};
+		const float cost_0 = child_cost(child_0);
+		const float cost_1 = child_cost(child_1);
+		
+		if(cost < cost_0 && cost < cost_1) break;
+		index = (cost_0 < cost_1 ? child_0 : child_1);
+	}
+	const int32_t sibling = index;
+	
+	// create a new parent
+	const int32_t old_parent = nodes[(size_t)sibling].parent;
+	const int32_t new_parent = allocate_node(); // note: may reallocate "nodes"
+	node& p = nodes[(size_t)new_parent];
+	p.parent = old_parent;
+	p.aabb_min = float3(leaf_min).min(nodes[(size_t)sibling].aabb_min);
+	p.aabb_max = float3(leaf_max).max(nodes[(size_t)sibling].aabb_max);
+	p.height = nodes[(size_t)sibling].height + 1;
+	p.children[0] = sibling;
+	p.children[1] = leaf;
+	nodes[(size_t)sibling].parent = new_parent;
+	nodes[(size_t)leaf].parent = new_parent;
+	
+	if(old_parent != null_node) {
+		node& op = nodes[(size_t)old_parent];
+		op.children[op.children[0] == sibling ? 0 : 1] = new_parent;
+	}
+	else root = new_parent;
+	
+	// walk back up the tree, fixing heights and aabbs
+	fix_upwards(nodes[(size_t)leaf].parent);
+}
+
+template <typename object_type> void bvh_tree<object_type>::remove_leaf(const int32_t leaf) {
+	if(leaf == root) {
+		root = null_node;
+		return;
+	}
+	
+	const int32_t parent = nodes[(size_t)leaf].parent;
+	const int32_t grand_parent = nodes[(size_t)parent].parent;
+	const int32_t sibling = (nodes[(size_t)parent].children[0] == leaf ?
+							 nodes[(size_t)parent].children[1] : nodes[(size_t)parent].children[0]);
+	
+	if(grand_parent != null_node) {
+		// destroy the parent and connect the sibling to the grand parent
+		node& gp = nodes[(size_t)grand_parent];
+		gp.children[gp.children[0] == parent ? 0 : 1] = sibling;
+		nodes[(size_t)sibling].parent = grand_parent;
+		free_node(parent);
+		fix_upwards(grand_parent);
+	}
+	else {
+		root = sibling;
+		nodes[(size_t)sibling].parent = null_node;
+		free_node(parent);
+	}
+	nodes[(size_t)leaf].parent = null_node;
+}
+
+template <typename object_type> void bvh_tree<object_type>::fix_upwards(int32_t node_id) {
+	while(node_id != null_node) {
+		node_id = balance(node_id);
+		
+		node& n = nodes[(size_t)node_id];
+		const node& child_0 = nodes[(size_t)n.children[0]];
+		const node& child_1 = nodes[(size_t)n.children[1]];
+		n.height = 1 + std::max(child_0.height, child_1.height);
+		n.aabb_min = float3(child_0.aabb_min).min(child_1.aabb_min);
+		n.aabb_max = float3(child_0.aabb_max).max(child_1.aabb_max);
+		
+		node_id = n.parent;
+	}
+}
+
+/*! performs a left or right rotation if the subtree at "node_id" is imbalanced,
+ *  returns the new root of the subtree
+ */
+template <typename object_type> int32_t bvh_tree<object_type>::balance(const int32_t a_id) {
+	node& a = nodes[(size_t)a_id];
+	if(a.is_leaf() || a.height < 2) return a_id;
+	
+	const int32_t b_id = a.children[0];
+	const int32_t c_id = a.children[1];
+	node& b = nodes[(size_t)b_id];
+	node& c = nodes[(size_t)c_id];
+	const int32_t height_diff = c.height - b.height;
+	if(height_diff >= -1 && height_diff <= 1) return a_id;
+	
+	// rotate the higher child up
+	const bool rotate_c = (height_diff > 1);
+	const int32_t up_id = (rotate_c ? c_id : b_id);
+	const int32_t other_id = (rotate_c ? b_id : c_id);
+	node& up = nodes[(size_t)up_id];
+	const int32_t f_id = up.children[0];
+	const int32_t g_id = up.children[1];
+	node& f = nodes[(size_t)f_id];
+	node& g = nodes[(size_t)g_id];
+	node& other = nodes[(size_t)other_id];
+	
+	// swap "a" and "up"
+	up.children[0] = a_id;
+	up.parent = a.parent;
+	a.parent = up_id;
+	if(up.parent != null_node) {
+		node& up_parent = nodes[(size_t)up.parent];
+		up_parent.children[up_parent.children[0] == a_id ? 0 : 1] = up_id;
+	}
+	else root = up_id;
+	
+	// the higher grand child stays with "up", the other one moves to "a"
+	const bool keep_f = (f.height > g.height);
+	const int32_t keep_id = (keep_f ? f_id : g_id);
+	const int32_t move_id = (keep_f ? g_id : f_id);
+	node& keep = (keep_f ? f : g);
+	node& move = (keep_f ? g : f);
+	up.children[1] = keep_id;
+	a.children[rotate_c ? 1 : 0] = move_id;
+	move.parent = a_id;
+	
+	a.aabb_min = float3(other.aabb_min).min(move.aabb_min);
+	a.aabb_max = float3(other.aabb_max).max(move.aabb_max);
+	up.aabb_min = float3(a.aabb_min).min(keep.aabb_min);
+	up.aabb_max = float3(a.aabb_max).max(keep.aabb_max);
+	a.height = 1 + std::max(other.height, move.height);
+	up.height = 1 + std::max(a.height, keep.height);
+	return up_id;
+}
+
+template <typename object_type> void bvh_tree<object_type>::collect_leaves(const int32_t node_id, vector<object_type*>& result,
+																						vector<int32_t>& stack) const {
+	// pushes all leaves of this subtree to result (used for subtrees that are completely inside a query volume)
+	const size_t stack_base = stack.size();
+	stack.push_back(node_id);
+	while(stack.size() > stack_base) {
+		const node& n = nodes[(size_t)stack.back()];
+		stack.pop_back();
+		if(n.is_leaf()) {
+			result.push_back(n.object);
+			continue;
+		}
+		stack.push_back(n.children[0]);
+		stack.push_back(n.children[1]);
+	}
+}
+
+template <typename object_type> void bvh_tree<object_type>::query(const frustum& view_frustum,
+																 vector<object_type*>& result) const {
+	if(root == null_node) return;
+	
+	vector<int32_t> stack;
+	stack.reserve(64);
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const int32_t node_id = stack.back();
+		stack.pop_back();
+		
+		const node& n = nodes[(size_t)node_id];
+		const auto intersection = view_frustum.classify(n.aabb_min, n.aabb_max);
+		if(intersection == frustum::INTERSECTION::OUTSIDE) continue;
+		if(n.is_leaf()) {
+			result.push_back(n.object);
+		}
+		else if(intersection == frustum::INTERSECTION::INSIDE) {
+			collect_leaves(node_id, result, stack);
+		}
+		else {
+			stack.push_back(n.children[0]);
+			stack.push_back(n.children[1]);
+		}
+	}
+}
+
+template <typename object_type> void bvh_tree<object_type>::query(const float3& sphere_center, const float& sphere_radius,
+																 vector<object_type*>& result) const {
+	if(root == null_node) return;
+	
+	const float sq_radius = sphere_radius * sphere_radius;
+	vector<int32_t> stack;
+	stack.reserve(64);
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const node& n = nodes[(size_t)stack.back()];
+		stack.pop_back();
+		
+		// squared distance between the sphere center and the closest point of the aabb
+		const float3 closest(float3(sphere_center).max(n.aabb_min).min(n.aabb_max));
+		const float3 diff(closest - sphere_center);
+		if(diff.dot(diff) > sq_radius) continue;
+		
+		if(n.is_leaf()) {
+			result.push_back(n.object);
+			continue;
+		}
+		stack.push_back(n.children[0]);
+		stack.push_back(n.children[1]);
+	}
+}
+
+template <typename object_type> void bvh_tree<object_type>::query(const float3& aabb_min, const float3& aabb_max,
+																 vector<object_type*>& result) const {
+	if(root == null_node) return;
+	
+	vector<int32_t> stack;
+	stack.reserve(64);
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const int32_t node_id = stack.back();
+		stack.pop_back();
+		
+		const node& n = nodes[(size_t)node_id];
+		if(!aabb_overlaps(n.aabb_min, n.aabb_max, aabb_min, aabb_max)) continue;
+		if(n.is_leaf()) {
+			result.push_back(n.object);
+		}
+		else if(aabb_contains(aabb_min, aabb_max, n.aabb_min, n.aabb_max)) {
+			collect_leaves(node_id, result, stack);
+		}
+		else {
+			stack.push_back(n.children[0]);
+			stack.push_back(n.children[1]);
+		}
+	}
+}
+
+template <typename object_type> void bvh_tree<object_type>::query_ray(const float3& origin, const float3& direction,
+																			 const float& max_distance,
+																			 vector<object_type*>& result) const {
+	if(root == null_node) return;
+	
+	// slab test, division by 0 results in +/-inf which is handled correctly by min/max
+	const float3 inv_dir(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	const auto intersects = [&](const node& n) {
+		const float3 t_0((n.aabb_min - origin) * inv_dir);
+		const float3 t_1((n.aabb_max - origin) * inv_dir);
+		const float t_near = std::max(std::max(std::min(t_0.x, t_1.x), std::min(t_0.y, t_1.y)),
+									  std::max(std::min(t_0.z, t_1.z), 0.0f));
+		const float t_far = std::min(std::min(std::max(t_0.x, t_1.x), std::max(t_0.y, t_1.y)),
+									 std::min(std::max(t_0.z, t_1.z), max_distance));
+		return (t_near <= t_far);
+	};
+	
+	vector<int32_t> stack;
+	stack.reserve(64);
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const node& n = nodes[(size_t)stack.back()];
+		stack.pop_back();
+		if(!intersects(n)) continue;
+		
+		if(n.is_leaf()) {
+			result.push_back(n.object);
+			continue;
+		}
+		stack.push_back(n.children[0]);
+		stack.push_back(n.children[1]);
+	}
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "frustum.hpp"
+
+void frustum::extract(const matrix4f& mvpm) {
+	// vertices are transformed as (v * mvpm) -> clip space column j is: sum_i v_i * data[i*4 + j]
+	const auto& m = mvpm.data;
+	for(size_t i = 0; i < 3; i++) {
+		const size_t col = i;
+		planes[i * 2].set(m[3] + m[col], m[7] + m[4 + col], m[11] + m[8 + col], m[15] + m[12 + col]);
+		planes[i * 2 + 1].set(m[3] - m[col], m[7] - m[4 + col], m[11] - m[8 + col], m[15] - m[12 + col]);
+	}
+	normalize_planes();
+}
+
+void frustum::create_box(const float3& position, const float& half_size) {
+	planes[0].set(1.0f, 0.0f, 0.0f, half_size - position.x);
+	planes[1].set(-1.0f, 0.0f, 0.0f, half_size + position.x);
+	planes[2].set(0.0f, 1.0f, 0.0f, half_size - position.y);
+	planes[3].set(0.0f, -1.0f, 0.0f, half_size + position.y);
+	planes[4].set(0.0f, 0.0f, 1.0f, half_size - position.z);
+	planes[5].set(0.0f, 0.0f, -1.0f, half_size + position.z);
+}
+
+void frustum::normalize_planes() {
+	for(auto& plane : planes) {
+		const float len = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if(len > 0.0f) plane /= len;
+	}
+}
+
+bool frustum::is_visible(const extbbox& box) const {
+	// the box is oriented: world = (local * mview) + pos
+	// -> transform the center and project the extents onto each plane normal (using the rotated axes)
+	const float3 local_center((box.min + box.max) * 0.5f);
+	const float3 half_extent((box.max - box.min) * 0.5f);
+	const float3 center((local_center * box.mview) + box.pos);
+	
+	const auto& m = box.mview.data;
+	const float3 axis_x(m[0], m[1], m[2]);
+	const float3 axis_y(m[4], m[5], m[6]);
+	const float3 axis_z(m[8], m[9], m[10]);
+	
+	for(const auto& plane : planes) {
+		const float dist = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		const float radius = (half_extent.x * fabsf(plane.x * axis_x.x + plane.y * axis_x.y + plane.z * axis_x.z) +
+							  half_extent.y * fabsf(plane.x * axis_y.x + plane.y * axis_y.y + plane.z * axis_y.z) +
+							  half_extent.z * fabsf(plane.x * axis_z.x + plane.y * axis_z.y + plane.z * axis_z.z));
+		if(dist < -radius) return false;
+	}
+	return true;
+}
+
+bool frustum::is_visible(const float3& center, const float& radius) const {
+	for(const auto& plane : planes) {
+		const float dist = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		if(dist < -radius) return false;
+	}
+	return true;
+}
+
+frustum::INTERSECTION frustum::classify(const float3& aabb_min, const float3& aabb_max) const {
+	INTERSECTION ret = INTERSECTION::INSIDE;
+	for(const auto& plane : planes) {
+		// p-vertex: corner furthest along the plane normal, n-vertex: corner furthest against it
+		const float3 p_vertex(plane.x >= 0.0f ? aabb_max.x : aabb_min.x,
+							  plane.y >= 0.0f ? aabb_max.y : aabb_min.y,
+							  plane.z >= 0.0f ? aabb_max.z : aabb_min.z);
+		if(plane.x * p_vertex.x + plane.y * p_vertex.y + plane.z * p_vertex.z + plane.w < 0.0f) {
+			return INTERSECTION::OUTSIDE;
+		}
+		
+		const float3 n_vertex(plane.x >= 0.0f ? aabb_min.x : aabb_max.x,
+							  plane.y >= 0.0f ? aabb_min.y : aabb_max.y,
+							  plane.z >= 0.0f ? aabb_min.z : aabb_max.z);
+		if(plane.x * n_vertex.x + plane.y * n_vertex.y + plane.z * n_vertex.z + plane.w < 0.0f) {
+			ret = INTERSECTION::INTERSECT;
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,61 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef __A2E_FRUSTUM_HPP__
+#define __A2E_FRUSTUM_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+#include <floor/math/matrix4.hpp>
+#include <floor/math/bbox.hpp>
+
+//! view frustum (6 planes: left, right, bottom, top, near, far), used for visibility culling
+class frustum {
+public:
+	frustum() = default;
+	
+	//! extracts the frustum planes from a (modelview * projection) matrix
+	void extract(const matrix4f& mvpm);
+	//! creates a box shaped "frustum" around the specified position (e.g. for env probes,
+	//! which capture the whole sphere around them and are only limited by the far plane)
+	void create_box(const float3& position, const float& half_size);
+	
+	//! returns true if the (transformed) extended bounding box intersects or is contained in the frustum
+	bool is_visible(const extbbox& box) const;
+	//! returns true if the sphere intersects or is contained in the frustum
+	bool is_visible(const float3& center, const float& radius) const;
+	
+	//! classifies an axis-aligned (world space) bounding box against the frustum
+	enum class INTERSECTION : unsigned int {
+		OUTSIDE,
+		INTERSECT,
+		INSIDE
+	};
+	INTERSECTION classify(const float3& aabb_min, const float3& aabb_max) const;
+	
+	//! xyz: plane normal (pointing inwards), w: distance
+	const array<float4, 6>& get_planes() const { return planes; }
+	
+protected:
+	array<float4, 6> planes;
+	
+	void normalize_planes();
+	
+};
+
+#endif
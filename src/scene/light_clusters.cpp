@@ -0,0 +1,347 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "light_clusters.hpp"
+#include "scene/light.hpp"
+#include "task_scheduler.hpp"
+#include <thread>
+
+// don't bother spawning threads for small light counts
+static constexpr size_t min_lights_per_worker = 256;
+
+light_clusters::light_clusters(const uint3 grid_size_, const uint32_t max_lights_per_cluster_) :
+grid_size(grid_size_), max_lights_per_cluster(max_lights_per_cluster_) {
+}
+
+light_clusters::~light_clusters() {
+}
+
+void light_clusters::set_grid_size(const uint3& grid_size_) {
+	if(grid_size_.x == 0 || grid_size_.y == 0 || grid_size_.z == 0) {
+		log_error("invalid light cluster grid size: %v", grid_size_);
+		return;
+	}
+	grid_size = grid_size_;
+}
+
+const uint3& light_clusters::get_grid_size() const {
+	return grid_size;
+}
+
+void light_clusters::set_max_lights_per_cluster(const uint32_t max_lights) {
+	max_lights_per_cluster = max_lights;
+}
+
+uint32_t light_clusters::get_max_lights_per_cluster() const {
+	return max_lights_per_cluster;
+}
+
+void light_clusters::set_worker_count(const size_t count) {
+	worker_count = count;
+}
+
+size_t light_clusters::get_worker_count() const {
+	return worker_count;
+}
+
+void light_clusters::set_task_scheduler(task_scheduler* scheduler_) {
+	scheduler = scheduler_;
+}
+
+const vector<uint2>& light_clusters::get_clusters() const {
+	return clusters;
+}
+
+const vector<uint32_t>& light_clusters::get_light_indices() const {
+	return light_indices;
+}
+
+const vector<float4>& light_clusters::get_light_data() const {
+	return light_data;
+}
+
+size_t light_clusters::get_light_count() const {
+	return light_data.size() / 2;
+}
+
+const float2& light_clusters::get_depth_slice_params() const {
+	return depth_slice_params;
+}
+
+size_t light_clusters::get_cluster_index(const uint3& cluster) const {
+	return cluster.x + (cluster.y + cluster.z * grid_size.y) * grid_size.x;
+}
+
+void light_clusters::build(const vector<light*>& lights, const matrix4f& modelview, const matrix4f& projection,
+						   const float2& near_far_plane) {
+	// gather all enabled point lights
+	light_data.clear();
+	for(const auto& li : lights) {
+		if(!li->is_enabled()) continue;
+		if(li->get_type() != light::LIGHT_TYPE::POINT) continue;
+		light_data.emplace_back(li->get_position(), li->get_radius());
+		light_data.emplace_back(li->get_color(), li->get_inv_sqr_radius());
+	}
+	bin(modelview, projection, near_far_plane);
+}
+
+void light_clusters::build(const vector<float4>& light_data_, const matrix4f& modelview, const matrix4f& projection,
+						   const float2& near_far_plane) {
+	if(light_data_.size() % 2 != 0) {
+		log_error("light data must contain 2 float4s per light!");
+		return;
+	}
+	light_data = light_data_;
+	bin(modelview, projection, near_far_plane);
+}
+
+void light_clusters::bin(const matrix4f& modelview, const matrix4f& projection, const float2& near_far_plane) {
+	// transform all light spheres to view space
+	const size_t count = light_data.size() / 2;
+	sphere_x.resize(count);
+	sphere_y.resize(count);
+	sphere_z.resize(count);
+	sphere_radius.resize(count);
+	for(size_t i = 0; i < count; i++) {
+		const float4& sphere = light_data[i * 2];
+		const float3 view_pos(float3(sphere.x, sphere.y, sphere.z) * modelview);
+		sphere_x[i] = view_pos.x;
+		sphere_y[i] = view_pos.y;
+		sphere_z[i] = view_pos.z;
+		sphere_radius[i] = sphere.w;
+	}
+	
+	setup_view(projection, near_far_plane);
+	
+	// split the depth slices among all workers (multi-threaded if there are enough lights)
+	size_t thread_count = (worker_count != 0 ? worker_count :
+						   (scheduler != nullptr ? scheduler->get_worker_count() + 1 :
+							std::max(1u, thread::hardware_concurrency())));
+	thread_count = std::min(thread_count, std::max(size_t(1), count / min_lights_per_worker));
+	thread_count = std::min(thread_count, size_t(grid_size.z));
+	workers.resize(thread_count);
+	
+	const uint32_t slices_per_worker = (grid_size.z + (uint32_t)thread_count - 1) / (uint32_t)thread_count;
+	for(size_t i = 0; i < thread_count; i++) {
+		workers[i].slice_begin = std::min(grid_size.z, (uint32_t)i * slices_per_worker);
+		workers[i].slice_end = std::min(grid_size.z, workers[i].slice_begin + slices_per_worker);
+	}
+	
+	clusters.resize(size_t(grid_size.x) * size_t(grid_size.y) * size_t(grid_size.z));
+	if(thread_count == 1) {
+		bin_slices(workers[0]);
+	}
+	else if(scheduler != nullptr) {
+		scheduler->parallel_for(thread_count, 1, [this](const size_t begin, const size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				bin_slices(workers[i]);
+			}
+		});
+	}
+	else {
+		vector<thread> threads;
+		threads.reserve(thread_count - 1);
+		for(size_t i = 1; i < thread_count; i++) {
+			threads.emplace_back(&light_clusters::bin_slices, this, ref(workers[i]));
+		}
+		bin_slices(workers[0]);
+		for(auto& th : threads) {
+			th.join();
+		}
+	}
+	
+	// merge all worker index lists (workers cover contiguous cluster ranges -> only need to offset them)
+	size_t total_index_count = 0;
+	for(const auto& worker : workers) {
+		total_index_count += worker.indices.size();
+	}
+	light_indices.resize(total_index_count);
+	
+	const size_t slice_cluster_count = size_t(grid_size.x) * size_t(grid_size.y);
+	uint32_t index_offset = 0;
+	for(const auto& worker : workers) {
+		std::copy(worker.indices.begin(), worker.indices.end(), light_indices.begin() + index_offset);
+		if(index_offset != 0) {
+			for(size_t i = worker.slice_begin * slice_cluster_count, end = worker.slice_end * slice_cluster_count;
+				i < end; i++) {
+				clusters[i].x += index_offset;
+			}
+		}
+		index_offset += (uint32_t)worker.indices.size();
+	}
+}
+
+void light_clusters::setup_view(const matrix4f& projection, const float2& near_far_plane) {
+	near_far = near_far_plane;
+	
+	// exponential depth slices: d_k = near * (far / near)^(k / slice_count)
+	const float log_depth_ratio = logf(near_far.y / near_far.x);
+	depth_slice_params.x = float(grid_size.z) / log_depth_ratio;
+	depth_slice_params.y = -logf(near_far.x) * depth_slice_params.x;
+	slice_depths.resize(grid_size.z + 1);
+	for(uint32_t k = 0; k <= grid_size.z; k++) {
+		slice_depths[k] = near_far.x * expf(log_depth_ratio * float(k) / float(grid_size.z));
+	}
+	
+	// for a perspective projection: ndc.x * d = m[0] * x + m[8] * z with z = -d
+	// -> x = d * (ndc.x + m[8]) / m[0] (likewise for y)
+	const auto& m = projection.data;
+	tile_x_factors.resize(grid_size.x + 1);
+	for(uint32_t i = 0; i <= grid_size.x; i++) {
+		const float ndc_x = (float(i) / float(grid_size.x)) * 2.0f - 1.0f;
+		tile_x_factors[i] = (ndc_x + m[8]) / m[0];
+	}
+	tile_y_factors.resize(grid_size.y + 1);
+	for(uint32_t j = 0; j <= grid_size.y; j++) {
+		const float ndc_y = (float(j) / float(grid_size.y)) * 2.0f - 1.0f;
+		tile_y_factors[j] = (ndc_y + m[9]) / m[5];
+	}
+}
+
+void light_clusters::bin_slices(worker_data& worker) {
+	worker.indices.clear();
+	const size_t light_count = sphere_x.size();
+	const uint32_t max_count = max_lights_per_cluster;
+	
+	worker.rows.resize(grid_size.y);
+	worker.row_y_min.resize(grid_size.y);
+	worker.row_y_max.resize(grid_size.y);
+	worker.column_x_min.resize(grid_size.x);
+	worker.column_x_max.resize(grid_size.x);
+	worker.column_counts.resize(grid_size.x);
+	
+	// bucket all lights into the depth slices of this worker (a light usually only covers a few slices)
+	const uint32_t worker_slice_count = worker.slice_end - worker.slice_begin;
+	worker.slice_candidates.resize(worker_slice_count);
+	for(auto& candidates : worker.slice_candidates) {
+		candidates.clear();
+	}
+	const float worker_z_min = -slice_depths[worker.slice_end], worker_z_max = -slice_depths[worker.slice_begin];
+	const auto slice_of = [this](const float& z) {
+		// view space z -> slice via the (positive) distance
+		const float dist = std::max(-z, near_far.x);
+		return (int32_t)floorf(logf(dist) * depth_slice_params.x + depth_slice_params.y);
+	};
+	for(size_t i = 0; i < light_count; i++) {
+		const float z_near = sphere_z[i] + sphere_radius[i], z_far = sphere_z[i] - sphere_radius[i];
+		if(z_far > worker_z_max || z_near < worker_z_min) continue;
+		
+		// clamp to the worker range while still signed (slice_of can be -1 at the near plane due to rounding
+		// and >= grid_size.z beyond the far plane)
+		const int32_t first = std::max((int32_t)worker.slice_begin, slice_of(z_near));
+		const int32_t last = std::min((int32_t)worker.slice_end - 1, slice_of(z_far));
+		if(last < first) continue;
+		for(uint32_t k = (uint32_t)first; k <= (uint32_t)last; k++) {
+			worker.slice_candidates[k - worker.slice_begin].push_back((uint32_t)i);
+		}
+	}
+	
+	for(uint32_t k = worker.slice_begin; k < worker.slice_end; k++) {
+		const float d_near = slice_depths[k];
+		const float d_far = slice_depths[k + 1];
+		const float z_min = -d_far, z_max = -d_near; // view space looks down -z
+		const auto& slice_candidates = worker.slice_candidates[k - worker.slice_begin];
+		
+		// x extent of each column of froxels (minimum/maximum over both depths), these are monotonic in i
+		for(uint32_t i = 0; i < grid_size.x; i++) {
+			const float x_0 = tile_x_factors[i], x_1 = tile_x_factors[i + 1];
+			worker.column_x_min[i] = std::min(std::min(x_0 * d_near, x_0 * d_far), std::min(x_1 * d_near, x_1 * d_far));
+			worker.column_x_max[i] = std::max(std::max(x_0 * d_near, x_0 * d_far), std::max(x_1 * d_near, x_1 * d_far));
+		}
+		const float slice_x_min = worker.column_x_min[0];
+		const float slice_x_max = worker.column_x_max[grid_size.x - 1];
+		
+		// y extent of each row of froxels (monotonic in j as well)
+		for(uint32_t j = 0; j < grid_size.y; j++) {
+			const float y_0 = tile_y_factors[j], y_1 = tile_y_factors[j + 1];
+			worker.row_y_min[j] = std::min(std::min(y_0 * d_near, y_0 * d_far), std::min(y_1 * d_near, y_1 * d_far));
+			worker.row_y_max[j] = std::max(std::max(y_0 * d_near, y_0 * d_far), std::max(y_1 * d_near, y_1 * d_far));
+			worker.rows[j].candidates.clear();
+			worker.rows[j].x.clear();
+			worker.rows[j].half_width.clear();
+		}
+		
+		// distribute all slice candidates among the rows they intersect (stored as soa for the inner loop)
+		for(const auto& idx : slice_candidates) {
+			const float x = sphere_x[idx], y = sphere_y[idx], z = sphere_z[idx], radius = sphere_radius[idx];
+			if(x + radius < slice_x_min || x - radius > slice_x_max) continue;
+			
+			const float dz = std::max(std::max(z_min - z, 0.0f), z - z_max);
+			const float sqr_radius_z = radius * radius - dz * dz;
+			for(uint32_t j = 0; j < grid_size.y; j++) {
+				if(worker.row_y_max[j] < y - radius) continue;
+				if(worker.row_y_min[j] > y + radius) break;
+				
+				// the y/z distance is constant for the whole row -> only store the remaining extent in x
+				const float dy = std::max(std::max(worker.row_y_min[j] - y, 0.0f), y - worker.row_y_max[j]);
+				const float sqr_radius = sqr_radius_z - dy * dy;
+				if(sqr_radius < 0.0f) continue;
+				
+				auto& row = worker.rows[j];
+				row.candidates.push_back(idx);
+				row.x.push_back(x);
+				row.half_width.push_back(sqrtf(sqr_radius));
+			}
+		}
+		
+		for(uint32_t j = 0; j < grid_size.y; j++) {
+			const auto& row = worker.rows[j];
+			const size_t row_count = row.candidates.size();
+			worker.spans.resize(row_count);
+			std::fill(begin(worker.column_counts), end(worker.column_counts), 0u);
+			
+			// with y/z already accounted for, a sphere intersects a froxel iff [x - w, x + w] overlaps its x extent
+			// -> since the column extents are monotonic, the intersected columns are [#(max < x - w), #(min <= x + w))
+			// (the inner loop is branch-free and gets vectorized)
+			const float* __restrict column_x_min = worker.column_x_min.data();
+			const float* __restrict column_x_max = worker.column_x_max.data();
+			for(size_t c = 0; c < row_count; c++) {
+				const float lo = row.x[c] - row.half_width[c];
+				const float hi = row.x[c] + row.half_width[c];
+				uint32_t first = 0, end = 0;
+				for(uint32_t i = 0; i < grid_size.x; i++) {
+					first += (column_x_max[i] < lo ? 1u : 0u);
+					end += (column_x_min[i] <= hi ? 1u : 0u);
+				}
+				worker.spans[c].set(first, end);
+				for(uint32_t i = first; i < end; i++) {
+					worker.column_counts[i]++;
+				}
+			}
+			
+			// allocate the index ranges of all clusters in this row, then scatter
+			size_t offset = worker.indices.size();
+			for(uint32_t i = 0; i < grid_size.x; i++) {
+				uint2& cluster = clusters[get_cluster_index(uint3(i, j, k))];
+				cluster.set((uint32_t)offset, 0);
+				offset += std::min(worker.column_counts[i], max_count);
+			}
+			worker.indices.resize(offset);
+			
+			uint2* row_clusters = &clusters[get_cluster_index(uint3(0, j, k))];
+			for(size_t c = 0; c < row_count; c++) {
+				for(uint32_t i = worker.spans[c].x; i < worker.spans[c].y; i++) {
+					uint2& cluster = row_clusters[i];
+					if(cluster.y >= max_count) continue;
+					worker.indices[cluster.x + cluster.y] = row.candidates[c];
+					cluster.y++;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,116 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_LIGHT_CLUSTERS_HPP__
+#define __A2E_LIGHT_CLUSTERS_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+#include <floor/math/matrix4.hpp>
+
+class light;
+class task_scheduler;
+
+//! clustered (froxel) light assignment: bins point lights into a 3D grid over the view frustum
+//! (screen space tiles in x/y, exponentially distributed depth slices in z).
+//! this is purely cpu side (no gl calls), the resulting flat arrays can be uploaded as-is:
+//!  * clusters: one (offset, count) pair per cluster into the light index list,
+//!    ordered x-major, then y, then z (index = x + y * grid.x + z * grid.x * grid.y)
+//!  * light indices: indices into the light data array
+//!  * light data: 2 float4 per light (world space position + radius, color + inverse squared radius)
+class light_clusters {
+public:
+	light_clusters(const uint3 grid_size = uint3(16, 9, 24), const uint32_t max_lights_per_cluster = 256);
+	~light_clusters();
+	
+	//! bins all enabled point lights
+	void build(const vector<light*>& lights, const matrix4f& modelview, const matrix4f& projection,
+			   const float2& near_far_plane);
+	//! bins already gathered light data (same layout as get_light_data(): 2 float4s per light,
+	//! xyz of the first one must be the world space position and w the radius)
+	void build(const vector<float4>& light_data, const matrix4f& modelview, const matrix4f& projection,
+			   const float2& near_far_plane);
+	
+	void set_grid_size(const uint3& grid_size);
+	const uint3& get_grid_size() const;
+	void set_max_lights_per_cluster(const uint32_t max_lights);
+	uint32_t get_max_lights_per_cluster() const;
+	//! 0 = use all available hardware threads, 1 = always bin on the calling thread
+	void set_worker_count(const size_t count);
+	size_t get_worker_count() const;
+	//! if set, workers are executed as tasks of the scheduler instead of on newly spawned threads
+	//! (a worker count of 0 then uses all scheduler workers + the calling thread)
+	void set_task_scheduler(task_scheduler* scheduler);
+	
+	const vector<uint2>& get_clusters() const;
+	const vector<uint32_t>& get_light_indices() const;
+	const vector<float4>& get_light_data() const;
+	size_t get_light_count() const;
+	//! depth slice of a view space distance d: slice = log(d) * x + y
+	const float2& get_depth_slice_params() const;
+	size_t get_cluster_index(const uint3& cluster) const;
+
+protected:
+	uint3 grid_size;
+	uint32_t max_lights_per_cluster;
+	size_t worker_count = 0;
+	task_scheduler* scheduler = nullptr;
+	
+	// per frame view setup
+	float2 near_far;
+	float2 depth_slice_params;
+	vector<float> slice_depths; // grid_size.z + 1 (positive view space distances)
+	vector<float> tile_x_factors; // grid_size.x + 1 (view space x = distance * factor)
+	vector<float> tile_y_factors; // grid_size.y + 1 (view space y = distance * factor)
+	
+	// view space light spheres (soa)
+	vector<float> sphere_x, sphere_y, sphere_z, sphere_radius;
+	
+	// output
+	vector<uint2> clusters;
+	vector<uint32_t> light_indices;
+	vector<float4> light_data;
+	
+	// a worker bins a contiguous range of depth slices into its own index list
+	struct worker_data {
+		uint32_t slice_begin = 0;
+		uint32_t slice_end = 0;
+		vector<uint32_t> indices;
+		// candidate lists, reused across frames
+		vector<vector<uint32_t>> slice_candidates;
+		struct row_data {
+			vector<uint32_t> candidates;
+			vector<float> x;
+			vector<float> half_width;
+		};
+		vector<row_data> rows;
+		vector<float> row_y_min, row_y_max;
+		vector<float> column_x_min, column_x_max;
+		vector<uint32_t> column_counts;
+		vector<uint2> spans;
+	};
+	vector<worker_data> workers;
+	
+	void bin(const matrix4f& modelview, const matrix4f& projection, const float2& near_far_plane);
+	void setup_view(const matrix4f& projection, const float2& near_far_plane);
+	void bin_slices(worker_data& worker);
+
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "a2einstanced.hpp"
+#include "scene/scene.hpp"
+
+static_assert(sizeof(matrix4f) == 16 * sizeof(float), "matrix4f must be tightly packed (instance buffer layout)");
+
+a2einstanced::a2einstanced(shader* s, scene* sce) : a2estatic(s, sce) {
+}
+
+a2einstanced::~a2einstanced() {
+	if(vbo_instances_id != 0 && glIsBuffer(vbo_instances_id)) { gl_state::delete_buffers(1, &vbo_instances_id); }
+}
+
+size_t a2einstanced::add_instance(const float3& position, const matrix4f& rotation, const float3& scale_) {
+	instances.emplace_back();
+	set_instance(instances.size() - 1, position, rotation, scale_);
+	return instances.size() - 1;
+}
+
+void a2einstanced::set_instance(const size_t& idx, const float3& position, const matrix4f& rotation, const float3& scale_) {
+	if(idx >= instances.size()) return;
+	instance_transform& transform = instances[idx].transform;
+	transform.rotation = rotation;
+	transform.scale = matrix4f().scale(scale_.x, scale_.y, scale_.z);
+	// same order as a2emodel::get_world_matrix
+	transform.world = transform.scale;
+	transform.world *= transform.rotation;
+	transform.world *= matrix4f().translate(position.x, position.y, position.z);
+	instances_changed();
+}
+
+void a2einstanced::remove_instance(const size_t& idx) {
+	if(idx >= instances.size()) return;
+	instances[idx] = instances.back();
+	instances.pop_back();
+	instances_changed();
+}
+
+void a2einstanced::clear_instances() {
+	instances.clear();
+	instances_changed();
+}
+
+size_t a2einstanced::get_instance_count() const {
+	return instances.size();
+}
+
+size_t a2einstanced::get_visible_instance_count() const {
+	return visible_transforms.size();
+}
+
+void a2einstanced::instances_changed() {
+	bounds_dirty = true;
+	// the bvh fetches the new bounding box (-> update_instance_bounds) when it is refit
+	sce->model_bounds_changed(this);
+}
+
+void a2einstanced::build_bounding_box(const float3* sub_object_min, const float3* sub_object_max) {
+	local_sub_min.assign(sub_object_min, sub_object_min + object_count);
+	local_sub_max.assign(sub_object_max, sub_object_max + object_count);
+	instances_changed();
+}
+
+extbbox* a2einstanced::get_bounding_box() {
+	update_instance_bounds();
+	return &bbox;
+}
+
+extbbox* a2einstanced::get_bounding_box(const size_t& sub_object) {
+	update_instance_bounds();
+	return a2estatic::get_bounding_box(sub_object);
+}
+
+void a2einstanced::update_instance_bounds() {
+	if(!bounds_dirty || local_sub_min.size() != object_count || sub_bboxes.size() != object_count) return;
+	bounds_dirty = false;
+	
+	const float3 inf(numeric_limits<float>::max());
+	vector<float3> sub_min(object_count, inf), sub_max(object_count, -inf);
+	float3 model_min(inf), model_max(-inf);
+	for(auto& inst : instances) {
+		// world space aabb of each transformed sub-object aabb (same as bvh::compute_aabb)
+		const auto& m = inst.transform.world.data;
+		inst.aabb_min = inf;
+		inst.aabb_max = -inf;
+		for(unsigned int i = 0; i < object_count; i++) {
+			const float3 local_center((local_sub_min[i] + local_sub_max[i]) * 0.5f);
+			const float3 half_extent((local_sub_max[i] - local_sub_min[i]) * 0.5f);
+			const float3 center(local_center * inst.transform.world);
+			const float3 ext(half_extent.x * fabsf(m[0]) + half_extent.y * fabsf(m[4]) + half_extent.z * fabsf(m[8]),
+							 half_extent.x * fabsf(m[1]) + half_extent.y * fabsf(m[5]) + half_extent.z * fabsf(m[9]),
+							 half_extent.x * fabsf(m[2]) + half_extent.y * fabsf(m[6]) + half_extent.z * fabsf(m[10]));
+			const float3 smin(center - ext), smax(center + ext);
+			inst.aabb_min.min(smin);
+			inst.aabb_max.max(smax);
+			sub_min[i].min(smin);
+			sub_max[i].max(smax);
+		}
+		model_min.min(inst.aabb_min);
+		model_max.max(inst.aabb_max);
+	}
+	
+	// no instances -> empty bounding boxes at the origin
+	if(instances.empty()) {
+		model_min = float3(0.0f);
+		model_max = float3(0.0f);
+		sub_min.assign(object_count, float3(0.0f));
+		sub_max.assign(object_count, float3(0.0f));
+	}
+	
+	for(unsigned int i = 0; i < object_count; i++) {
+		extbbox& sbbox = sub_bboxes[i];
+		sbbox.min = sub_min[i];
+		sbbox.max = sub_max[i];
+		sbbox.mview = matrix4f();
+		sbbox.pos = float3(0.0f);
+	}
+	bbox.min = model_min;
+	bbox.max = model_max;
+	bbox.mview = matrix4f();
+	bbox.pos = float3(0.0f);
+}
+
+bool a2einstanced::get_multi_draw_command(const DRAW_MODE draw_mode floor_unused, const size_t& sub_object floor_unused,
+										  size_t& first_index floor_unused, size_t& index_count floor_unused,
+										  geometry_arena::allocation& alloc floor_unused) const {
+	return false;
+}
+
+size_t a2einstanced::cull(const frustum& view_frustum) {
+	update_instance_bounds();
+	
+	// compact the transforms of all visible instances
+	visible_transforms.clear();
+	visible_world_matrices.clear();
+	for(const auto& inst : instances) {
+		if(view_frustum.classify(inst.aabb_min, inst.aabb_max) == frustum::INTERSECTION::OUTSIDE) continue;
+		visible_transforms.emplace_back(inst.transform);
+		visible_world_matrices.emplace_back(inst.transform.world);
+	}
+	if(visible_transforms.empty()) {
+		is_sub_object_visible.assign(object_count, false);
+		return 0;
+	}
+	
+	// upload them (orphaning the previous buffer contents, which might still be in use by the gpu)
+	if(vbo_instances_id == 0) glGenBuffers(1, &vbo_instances_id);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, vbo_instances_id);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(visible_world_matrices.size() * sizeof(matrix4f)),
+				 visible_world_matrices.data(), GL_STREAM_DRAW);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+	
+	// sub-objects: bounds of all instances
+	size_t visible_count = 0;
+	for(unsigned int i = 0; i < object_count; i++) {
+		const bool visible = view_frustum.is_visible(sub_bboxes[i]);
+		is_sub_object_visible[i] = visible;
+		if(visible) visible_count++;
+	}
+	return visible_count;
+}
+
+void a2einstanced::clear_visibility() {
+	a2estatic::clear_visibility();
+	visible_transforms.clear();
+	visible_world_matrices.clear();
+}
+
+void a2einstanced::pre_draw_setup(const ssize_t sub_object_num) {
+	a2estatic::pre_draw_setup(sub_object_num);
+	draw_instance_count = visible_transforms.size();
+	draw_instance_vbo = vbo_instances_id;
+	draw_instances = visible_transforms.data();
+}
+
+void a2einstanced::post_draw_setup(const ssize_t sub_object_num) {
+	draw_instance_count = 0;
+	draw_instance_vbo = 0;
+	draw_instances = nullptr;
+	a2estatic::post_draw_setup(sub_object_num);
+}
@@ -0,0 +1,89 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_A2EINSTANCED_HPP__
+#define __A2E_A2EINSTANCED_HPP__
+
+#include "global.hpp"
+#include "scene/model/a2estatic.hpp"
+
+//! draws many copies ("instances") of a static model: each sub-object is drawn with a single instanced draw call per pass.
+//! an instance only has its own transform, the material, transparency and all other state is shared by all instances.
+//! the instances are culled individually, the world matrices of all visible instances are uploaded into the instance
+//! buffer each time the model is culled.
+//! NOTE: the instance transforms are world space transforms, the position/rotation/scale of the model itself must be
+//!       left at their defaults (the bounding boxes are computed in world space)
+//! NOTE: shaders need the "*instanced" combiner with a mat4 "instance_matrix" attribute for the instanced draw calls,
+//!       otherwise each visible instance is drawn with its own draw call (see a2emodel::draw_instanced)
+class a2einstanced : public a2estatic {
+public:
+	a2einstanced(shader* s, scene* sce);
+	virtual ~a2einstanced();
+	
+	//! adds an instance and returns its index
+	size_t add_instance(const float3& position, const matrix4f& rotation = matrix4f(), const float3& scale = float3(1.0f));
+	void set_instance(const size_t& instance, const float3& position, const matrix4f& rotation = matrix4f(),
+					  const float3& scale = float3(1.0f));
+	//! removes the instance (the last instance takes its index)
+	void remove_instance(const size_t& instance);
+	void clear_instances();
+	size_t get_instance_count() const;
+	//! returns the amount of instances that were visible in the last cull() call
+	size_t get_visible_instance_count() const;
+	
+	//! instanced sub-objects are never part of a multi-draw batch
+	virtual bool get_multi_draw_command(const DRAW_MODE draw_mode, const size_t& sub_object,
+										size_t& first_index, size_t& index_count,
+										geometry_arena::allocation& alloc) const;
+	
+	virtual size_t cull(const frustum& view_frustum);
+	virtual void clear_visibility();
+	
+	using a2estatic::build_bounding_box;
+	virtual void build_bounding_box(const float3* sub_object_min, const float3* sub_object_max);
+	virtual extbbox* get_bounding_box();
+	virtual extbbox* get_bounding_box(const size_t& sub_object);
+
+protected:
+	struct instance {
+		instance_transform transform;
+		// world space bounds of the whole instance
+		float3 aabb_min;
+		float3 aabb_max;
+	};
+	vector<instance> instances;
+	
+	// local (model space) bounds of each sub-object
+	vector<float3> local_sub_min;
+	vector<float3> local_sub_max;
+	//! recomputes the world space bounds of all instances, sub-objects and the whole model (if anything changed)
+	void update_instance_bounds();
+	bool bounds_dirty = true;
+	void instances_changed();
+	
+	// compacted transforms of all instances that are visible in the current view
+	vector<instance_transform> visible_transforms;
+	vector<matrix4f> visible_world_matrices;
+	GLuint vbo_instances_id = 0;
+	
+	virtual void pre_draw_setup(const ssize_t sub_object_num = -1);
+	virtual void post_draw_setup(const ssize_t sub_object_num = -1);
+
+};
+
+#endif
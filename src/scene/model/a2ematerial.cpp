@@ -18,6 +18,9 @@
 
 #include "a2ematerial.hpp"
 
+// sort ids of all material entries (of all loaded materials), 0 is "no material"
+static atomic<uint32_t> material_sort_id_counter { 1 };
+
 /*! a2ematerial constructor
  */
 a2ematerial::a2ematerial() : t(engine::get_texman()), exts(engine::get_ext()), x(engine::get_xml()) {
@@ -41,7 +44,7 @@ a2ematerial::~a2ematerial() {
 				break;
 			case MATERIAL_TYPE::NONE: break;
 		}
-
+		
 		switch(material.lm_type) {
 			case LIGHTING_MODEL::ASHIKHMIN_SHIRLEY:
 				t->delete_texture(((ashikhmin_shirley_model*)material.model)->anisotropic_texture);
@@ -49,12 +52,12 @@ a2ematerial::~a2ematerial() {
 			case LIGHTING_MODEL::PHONG:
 			case LIGHTING_MODEL::NONE: break;
 		}
-
+		
 		if(material.mat != nullptr) delete material.mat;
 		if(material.model != nullptr) delete material.model;
 	}
 	materials.clear();
-
+	
 	for(const auto& m : mapping) {
 		delete m.second;
 	}
@@ -89,15 +92,15 @@ void a2ematerial::load_material(const string& filename_) {
 	while(!node_stack.empty()) {
 		cur_node = node_stack.top();
 		node_stack.pop();
-
+		
 		if(cur_node->next != nullptr) node_stack.push(cur_node->next);
-
+		
 		if(cur_node->type == XML_ELEMENT_NODE) {
 			xmlElement* cur_elem = (xmlElement*)cur_node;
 			string node_name = (const char*)cur_elem->name;
-
+			
 			if(cur_node->children != nullptr) node_stack.push(cur_node->children);
-
+			
 			if(node_name == "a2e_material") {
 				size_t version = x->get_attribute<size_t>(cur_elem->attributes, "version");
 				if(version != A2E_MATERIAL_VERSION) {
@@ -117,6 +120,7 @@ void a2ematerial::load_material(const string& filename_) {
 				materials.push_back(*new material());
 				cur_material = &materials.back();
 				cur_material->id = (ssize_t)id;
+				cur_material->sort_id = material_sort_id_counter++;
 				cur_material->mat_type = (type == "diffuse" ? MATERIAL_TYPE::DIFFUSE :
 										  (type == "parallax" ? MATERIAL_TYPE::PARALLAX : MATERIAL_TYPE::NONE));
 				cur_material->lm_type = (model == "phong" ? LIGHTING_MODEL::PHONG :
@@ -383,6 +387,14 @@ const a2ematerial::object_mapping* a2ematerial::get_object_mapping(const size_t&
 	return mapping.find(object_id)->second;
 }
 
+uint32_t a2ematerial::get_sort_id(const size_t& object_id) const {
+	const object_mapping* obj = get_object_mapping(object_id);
+	if(obj == nullptr) {
+		return 0;
+	}
+	return obj->mat->sort_id;
+}
+
 a2ematerial::MATERIAL_TYPE a2ematerial::get_material_type(const size_t& object_id) const {
 	const object_mapping* obj = get_object_mapping(object_id);
 	if(obj == nullptr) {
@@ -458,14 +470,14 @@ void a2ematerial::disable_textures(const size_t& object_id) const {
 	// ignore texture_mask for the moment, since this only disables textures
 	switch(obj->mat->mat_type) {
 		case MATERIAL_TYPE::DIFFUSE:
-			glActiveTexture(GL_TEXTURE0);
-			glActiveTexture(GL_TEXTURE1);
+			gl_state::active_texture(GL_TEXTURE0);
+			gl_state::active_texture(GL_TEXTURE1);
 			break;
 		case MATERIAL_TYPE::PARALLAX:
-			glActiveTexture(GL_TEXTURE0);
-			glActiveTexture(GL_TEXTURE1);
-			glActiveTexture(GL_TEXTURE2);
-			glActiveTexture(GL_TEXTURE3);
+			gl_state::active_texture(GL_TEXTURE0);
+			gl_state::active_texture(GL_TEXTURE1);
+			gl_state::active_texture(GL_TEXTURE2);
+			gl_state::active_texture(GL_TEXTURE3);
 			break;
 		case MATERIAL_TYPE::NONE: break;
 	}
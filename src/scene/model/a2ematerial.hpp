@@ -57,11 +57,12 @@ public:
 	};
 	enum_class_bitwise_or(TEXTURE_TYPE)
 	enum_class_bitwise_and(TEXTURE_TYPE)
-
+	
 	struct lighting_model;
 	struct material_object;
 	struct material {
 		ssize_t id = -1;
+		uint32_t sort_id = 0; // unique among all material entries of all materials
 		MATERIAL_TYPE mat_type = MATERIAL_TYPE::NONE;
 		material_object* mat = nullptr;
 		LIGHTING_MODEL lm_type = LIGHTING_MODEL::PHONG;
@@ -101,7 +102,7 @@ public:
 		bool parallax_occlusion = false;
 		parallax_material() : diffuse_material() {}
 	};
-
+	
 	//// functions
 	void load_material(const string& filename);
 	const string& get_filename() const;
@@ -114,7 +115,10 @@ public:
 	const material& get_material(const size_t& material_id) const;
 	material& get_material(const size_t& material_id);
 	size_t get_material_count() const;
-
+	//! returns the id of the material entry that is used by the object, which is unique among the entries of all
+	//! loaded materials - used to sort and batch draw calls by material, 0 if there is no material
+	uint32_t get_sort_id(const size_t& object_id) const;
+	
 	void enable_textures(const size_t& object_id, gl_shader& shd, const TEXTURE_TYPE texture_mask = (TEXTURE_TYPE)~(unsigned int)0) const;
 	void disable_textures(const size_t& object_id) const;
 	
@@ -18,7 +18,12 @@
 
 #include "a2emodel.hpp"
 #include "scene/scene.hpp"
-#include <floor/math/quaternion.hpp>
+
+// builtin inferred rendering shaders (static, so that draw_sub_object doesn't construct a string per draw)
+static const string ir_gp_gbuffer_shd_name { "IR_GP_GBUFFER" };
+static const string ir_gp_gbuffer_parallax_shd_name { "IR_GP_GBUFFER_PARALLAX" };
+static const string ir_mp_diffuse_shd_name { "IR_MP_DIFFUSE" };
+static const string ir_mp_parallax_shd_name { "IR_MP_PARALLAX" };
 
 static size_t _initial_model_id = 0;
 static size_t _create_model_id() {
@@ -73,11 +78,20 @@ a2emodel::a2emodel(shader* s_, scene* sce_) {
 	a2emodel::t = engine::get_texman();
 	a2emodel::exts = engine::get_ext();
 	a2emodel::material = nullptr;
+	
+	// resolve shader permutation ids once (draw_sub_object only works with these)
+	opaque_option_id = s->get_option_id("opaque");
+	alpha_option_id = s->get_option_id("alpha");
+	env_probe_combiner = s->get_combiner_bit("*env_probe");
+	env_map_combiner = s->get_combiner_bit("*env_map");
+	aux_texture_combiner = s->get_combiner_bit("*aux_texture");
+	instanced_combiner = s->get_combiner_bit("*instanced");
 }
 
 /*! a2emodel destructor
  */
 a2emodel::~a2emodel() {
+	invalidate_vertex_arrays();
 	delete_sub_bboxes();
 	is_sub_object_transparent.clear();
 }
@@ -99,34 +113,16 @@ const string& a2emodel::get_filename() const {
 void a2emodel::model_setup() {
 	is_sub_object_transparent.resize(object_count);
 	is_sub_object_transparent.assign(object_count, is_transparent);
+	// nothing is visible until the scene has culled the model (cull_models only clears previously visible models)
+	is_sub_object_visible.assign(object_count, false);
 }
 
 void a2emodel::pre_draw_setup(const ssize_t sub_object_num floor_unused) {
-	// scale the model
-	mvm = scale_mat;
-	
-	// rotate the model (use local inverse model view matrix that we already calculated)
-	mvm *= rot_mat;
-	
-	// translate the model
-	mvm *= *engine::get_translation_matrix();
-	
-	// translate to model origin
-	mvm *= matrix4f().translate(position.x, position.y, position.z);
-	
-	// compute backside mvm/mvpm
-	quaternionf q_x, q_y;
-	q_x.set_rotation(engine::get_rotation()->x, float3(1.0f, 0.0f, 0.0f));
-	q_y.set_rotation(180.0f - engine::get_rotation()->y, float3(0.0f, 1.0f, 0.0f));
-	q_y *= q_x;
-	q_y.normalize();
-	mvpm_backside = mvm * q_y.to_matrix4();
-	
-	//
-	mvm *= *engine::get_rotation_matrix();
-	
-	mvpm = mvm * *engine::get_projection_matrix();
-	mvpm_backside = mvpm_backside * *engine::get_projection_matrix();
+	// the scene usually already computed the matrices of all visible models for the current view,
+	// only recompute them if this didn't happen or the model was moved in the meantime
+	if(world_dirty || view_stamp != sce->get_view_stamp()) {
+		update_view_transforms();
+	}
 	
 	// if the wireframe flag is set, draw the model in wireframe mode
 #if !defined(FLOOR_IOS)
@@ -136,6 +132,33 @@ void a2emodel::pre_draw_setup(const ssize_t sub_object_num floor_unused) {
 #endif
 }
 
+void a2emodel::update_view_transforms() {
+	const scene::view_transforms& view = sce->get_view_transforms();
+	const matrix4f& world = get_world_matrix();
+	mvm = world * view.mvm;
+	mvpm = world * view.mvpm;
+	mvpm_backside = world * view.mvpm_backside;
+	view_stamp = sce->get_view_stamp();
+}
+
+void a2emodel::set_view_transforms(const matrix4f& mvm_, const matrix4f& mvpm_, const matrix4f& mvpm_backside_,
+								   const size_t& view_stamp_) {
+	mvm = mvm_;
+	mvpm = mvpm_;
+	mvpm_backside = mvpm_backside_;
+	view_stamp = view_stamp_;
+}
+
+const matrix4f& a2emodel::get_world_matrix() {
+	if(world_dirty) {
+		world_mat = scale_mat;
+		world_mat *= rot_mat;
+		world_mat *= matrix4f().translate(position.x, position.y, position.z);
+		world_dirty = false;
+	}
+	return world_mat;
+}
+
 void a2emodel::post_draw_setup(const ssize_t sub_object_num floor_unused) {
 	// reset to filled mode
 #if !defined(FLOOR_IOS)
@@ -145,9 +168,78 @@ void a2emodel::post_draw_setup(const ssize_t sub_object_num floor_unused) {
 #endif
 }
 
+bool a2emodel::supports_render_queue() const {
+	return false;
+}
+
+void a2emodel::draw_queued(const render_view& view, const DRAW_MODE draw_mode, const size_t& sub_object) {
+	pre_draw_setup((ssize_t)sub_object);
+	draw_sub_object(view, draw_mode, sub_object, 0);
+	post_draw_setup((ssize_t)sub_object);
+}
+
+bool a2emodel::get_multi_draw_command(const DRAW_MODE draw_mode floor_unused, const size_t& sub_object floor_unused,
+									  size_t& first_index floor_unused, size_t& index_count floor_unused,
+									  geometry_arena::allocation& alloc floor_unused) const {
+	return false;
+}
+
+void a2emodel::draw_multi(const render_view& view, const DRAW_MODE draw_mode, const size_t& sub_object,
+						  const size_t& first_command, const size_t& command_count,
+						  const instance_transform* transforms) {
+	pre_draw_setup((ssize_t)sub_object);
+	draw_multi_first = first_command;
+	draw_multi_count = command_count;
+	draw_instances = transforms;
+	draw_sub_object(view, draw_mode, sub_object, 0);
+	draw_multi_count = 0;
+	draw_instances = nullptr;
+	post_draw_setup((ssize_t)sub_object);
+}
+
+a2emodel::instance_transform a2emodel::get_model_transform() {
+	return { get_world_matrix(), rot_mat, scale_mat };
+}
+
+void a2emodel::get_render_state(const DRAW_MODE draw_mode, const size_t& sub_object,
+								uint32_t& shader_id, uint32_t& material_id, uint32_t& mesh_id) const {
+	const size_t cache_size = size_t(object_count) * render_state_draw_mode_count;
+	if(render_state_cache.size() != cache_size) {
+		render_state_cache.assign(cache_size, uint2(~0u, 0u));
+	}
+	
+	uint2& state = render_state_cache[sub_object * render_state_draw_mode_count + (size_t)draw_mode];
+	if(state.x == ~0u) {
+		// approximates the shader permutation that is selected in draw_sub_object
+		const DRAW_MODE masked_draw_mode(draw_mode & DRAW_MODE::GM_PASSES_MASK);
+		const bool geometry_pass = (masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
+									masked_draw_mode == DRAW_MODE::GEOMETRY_ALPHA_PASS);
+		state.x = (uint32_t)material->get_material_type(sub_object);
+		if(geometry_pass) state.x |= (uint32_t)material->get_lighting_model_type(sub_object) << 2u;
+		else if(env_map != 0) state.x |= 1u << 4u;
+		
+		// custom shaders: anything but 0 is fine, as long as it's the same for the same shader
+		// (bit 5 is never set in the cached id -> never ~0u)
+		const string custom_shader = select_shader(draw_mode);
+		if(!custom_shader.empty()) state.x |= ((uint32_t)hash<string>()(custom_shader) | 1u) << 6u;
+		
+		state.y = material->get_sort_id(sub_object);
+	}
+	
+	// the instance count changes from draw to draw -> not cached
+	shader_id = state.x | (draw_instance_count > 0 ? 1u << 5u : 0u);
+	material_id = state.y;
+	mesh_id = (uint32_t)id;
+}
+
+void a2emodel::invalidate_render_state() {
+	render_state_cache.clear();
+}
+
 /*! draws the model/object (all variables have to be set by the derived class beforehand)
  */
-void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_object_num, const size_t& mask_id) {
+void a2emodel::draw_sub_object(const render_view& view, const DRAW_MODE& draw_mode, const size_t& sub_object_num,
+							   const size_t& mask_id) {
 	if(draw_mode == DRAW_MODE::NONE ||
 	   draw_mode > DRAW_MODE::ENV_GM_PASSES_MASK) {
 		log_error("invalid draw_mode: %u!", draw_mode);
@@ -166,6 +258,9 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 	// check mask id
 	if(mask_id > A2E_MAX_MASK_ID) return;
 	
+	// sub-object is outside of the current view frustum
+	if(!is_sub_object_visible[sub_object_num]) return;
+	
 	// check draw mode
 	const bool transparent_sub_object = is_sub_object_transparent[sub_object_num];
 	if(transparent_sub_object &&
@@ -190,44 +285,44 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 	//
 	gl_shader shd;
 	const bool has_env_map(env_map != 0);
-	const string shd_option = (masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
+	const size_t shd_option = (masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
 							   masked_draw_mode == DRAW_MODE::MATERIAL_PASS ?
-							   "opaque" : "alpha");
-	set<string> shd_combiners;
-	if(env_pass) shd_combiners.insert("*env_probe");
+							   opaque_option_id : alpha_option_id);
+	uint32_t shd_combiners = 0;
+	if(env_pass) shd_combiners |= env_probe_combiner;
+	if(draw_instance_count > 0 || draw_multi_count > 0) shd_combiners |= instanced_combiner;
 	if((masked_draw_mode == DRAW_MODE::MATERIAL_PASS ||
 		masked_draw_mode == DRAW_MODE::MATERIAL_ALPHA_PASS) &&
 	   has_env_map) {
-		shd_combiners.insert("*env_map");
+		shd_combiners |= env_map_combiner;
 	}
 	if((masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
 	   masked_draw_mode == DRAW_MODE::GEOMETRY_ALPHA_PASS) &&
 	   lm_type == a2ematerial::LIGHTING_MODEL::ASHIKHMIN_SHIRLEY) {
 		const a2ematerial::ashikhmin_shirley_model* aslm = (const a2ematerial::ashikhmin_shirley_model*)material->get_lighting_model(sub_object_num);
 		if(aslm->anisotropic_texture != nullptr) {
-			shd_combiners.insert("*aux_texture");
+			shd_combiners |= aux_texture_combiner;
 		}
 	}
 	
-	string shd_name = select_shader(draw_mode);
-	if(shd_name != "") {
-		shd = s->get_gl_shader(shd_name);
+	const string custom_shd_name = select_shader(draw_mode);
+	const bool custom_shader = !custom_shd_name.empty();
+	if(custom_shader) {
+		shd = s->get_gl_shader(custom_shd_name);
 		shd->use(shd_option, shd_combiners);
 	}
 	
 	if(masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
 	   masked_draw_mode == DRAW_MODE::GEOMETRY_ALPHA_PASS) {
-		if(shd_name == "") {
+		if(!custom_shader) {
 			// first, select shader dependent on material type
 			switch(mat_type) {
 				// parallax mapping
 				case a2ematerial::MATERIAL_TYPE::PARALLAX: {
-					shd_name = material->is_parallax_occlusion(sub_object_num) ? "IR_GP_GBUFFER_PARALLAX" : "IR_GP_GBUFFER_PARALLAX";
-					
-					shd = s->get_gl_shader(shd_name);
+					shd = s->get_gl_shader(ir_gp_gbuffer_parallax_shd_name);
 					shd->use(shd_option, shd_combiners);
-					shd->uniform("cam_position", -float3(*engine::get_position()));
-					shd->uniform("model_position", position);
+					shd->uniform(A2E_SHADER_VAR("cam_position"), view.get_camera_position());
+					shd->uniform(A2E_SHADER_VAR("model_position"), position);
 					
 					attr_array_mask |= VERTEX_ATTRIBUTE::TEXTURE_COORD | VERTEX_ATTRIBUTE::BINORMAL | VERTEX_ATTRIBUTE::TANGENT;
 					texture_mask |= a2ematerial::TEXTURE_TYPE::NORMAL | a2ematerial::TEXTURE_TYPE::HEIGHT;
@@ -236,7 +331,7 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 				// diffuse mapping
 				case a2ematerial::MATERIAL_TYPE::DIFFUSE:
 				case a2ematerial::MATERIAL_TYPE::NONE: {
-					shd = s->get_gl_shader("IR_GP_GBUFFER");
+					shd = s->get_gl_shader(ir_gp_gbuffer_shd_name);
 					shd->use(shd_option, shd_combiners);
 				}
 				break;
@@ -248,15 +343,15 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 			case a2ematerial::LIGHTING_MODEL::ASHIKHMIN_SHIRLEY: {
 				const a2ematerial::ashikhmin_shirley_model* aslm = (const a2ematerial::ashikhmin_shirley_model*)material->get_lighting_model(sub_object_num);
 				if(aslm->anisotropic_texture != nullptr) {
-					shd->texture("aux_texture", aslm->anisotropic_texture);
+					shd->texture(A2E_SHADER_VAR("aux_texture"), aslm->anisotropic_texture);
 				}
-				else shd->uniform("Nuv", aslm->anisotropic_roughness.x, aslm->anisotropic_roughness.y);
+				else shd->uniform(A2E_SHADER_VAR("Nuv"), aslm->anisotropic_roughness.x, aslm->anisotropic_roughness.y);
 			}
 			break;
 			// phong lighting
 			case a2ematerial::LIGHTING_MODEL::PHONG:
 			case a2ematerial::LIGHTING_MODEL::NONE:
-				shd->uniform("Nuv", 16.0f, 16.0f);
+				shd->uniform(A2E_SHADER_VAR("Nuv"), 16.0f, 16.0f);
 				break;
 		}
 		
@@ -270,17 +365,15 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 		attr_array_mask |= VERTEX_ATTRIBUTE::TEXTURE_COORD;
 		texture_mask |= a2ematerial::TEXTURE_TYPE::DIFFUSE | a2ematerial::TEXTURE_TYPE::SPECULAR | a2ematerial::TEXTURE_TYPE::REFLECTANCE;
 		
-		if(shd_name == "") {
+		if(!custom_shader) {
 			// first, select shader dependent on material type
 			switch(mat_type) {
 				// parallax mapping
 				case a2ematerial::MATERIAL_TYPE::PARALLAX: {
-					shd_name = material->is_parallax_occlusion(sub_object_num) ? "IR_MP_PARALLAX" : "IR_MP_PARALLAX";
-					
-					shd = s->get_gl_shader(shd_name);
+					shd = s->get_gl_shader(ir_mp_parallax_shd_name);
 					shd->use(shd_option, shd_combiners);
-					shd->uniform("cam_position", -float3(*engine::get_position()));
-					shd->uniform("model_position", position);
+					shd->uniform(A2E_SHADER_VAR("cam_position"), view.get_camera_position());
+					shd->uniform(A2E_SHADER_VAR("model_position"), position);
 					
 					attr_array_mask |= VERTEX_ATTRIBUTE::NORMAL | VERTEX_ATTRIBUTE::BINORMAL | VERTEX_ATTRIBUTE::TANGENT;
 					texture_mask |= a2ematerial::TEXTURE_TYPE::HEIGHT;
@@ -289,7 +382,7 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 				// diffuse mapping
 				case a2ematerial::MATERIAL_TYPE::DIFFUSE:
 				case a2ematerial::MATERIAL_TYPE::NONE: {
-					shd = s->get_gl_shader("IR_MP_DIFFUSE");
+					shd = s->get_gl_shader(ir_mp_diffuse_shd_name);
 					shd->use(shd_option, shd_combiners);
 				}
 				break;
@@ -297,42 +390,55 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 		}
 		
 		// inferred rendering setup
-		ir_mp_setup(shd, shd_option, shd_combiners);
+		ir_mp_setup(view, shd, shd_option, shd_combiners);
 		
 		// custom pre-draw setup
 		pre_draw_material(shd, attr_array_mask, texture_mask);
 		
 		if(has_env_map) {
-			shd->texture("environment_map", env_map);
+			shd->texture(A2E_SHADER_VAR("environment_map"), env_map);
 		}
 	}
 	if(masked_draw_mode == DRAW_MODE::GEOMETRY_ALPHA_PASS ||
 	   masked_draw_mode == DRAW_MODE::MATERIAL_ALPHA_PASS) {
-		shd->uniform("mask_id", (float)mask_id);
-		shd->uniform("id", model_id);
+		shd->uniform(A2E_SHADER_VAR("mask_id"), (float)mask_id);
+		shd->uniform(A2E_SHADER_VAR("id"), model_id);
 	}
 	
-	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0) shd->uniform("local_mview", rot_mat);
-	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0) shd->uniform("local_scale", scale_mat);
+	// multi-draw batches: the model transforms are applied per command (as instance transforms)
+	const bool multi_draw = (draw_multi_count > 0);
+	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0) shd->uniform(A2E_SHADER_VAR("local_mview"), multi_draw ? matrix4f() : rot_mat);
+	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0) shd->uniform(A2E_SHADER_VAR("local_scale"), multi_draw ? matrix4f() : scale_mat);
 	
 	//
 	material->enable_textures(sub_object_num, shd, texture_mask);
 	
-	shd->uniform("mvpm", mvpm);
+	shd->uniform(A2E_SHADER_VAR("mvpm"), multi_draw ? sce->get_view_transforms().mvpm : mvpm);
 	if(env_pass) {
-		shd->uniform("mvpm_backside", mvpm_backside);
+		shd->uniform(A2E_SHADER_VAR("mvpm_backside"), multi_draw ? sce->get_view_transforms().mvpm_backside : mvpm_backside);
 	}
+
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	// all vertex attributes and the index buffer are stored in a vao
+	gl_state::bind_vertex_array(get_vertex_array(shd, sub_object_num, attr_array_mask));
+	if(multi_draw) draw_multi_indirect(shd, attr_array_mask, env_pass);
+	else if(draw_instance_count > 0) draw_instanced(shd, attr_array_mask, env_pass);
+	else draw_elements(1);
+	gl_state::bind_vertex_array(engine::get_global_vao());
+#else
+	const auto& fmt = draw_vertex_format;
+	shd->attribute_array(A2E_SHADER_VAR("in_vertex"), draw_vertices_vbo, fmt[0].size, fmt[0].type, fmt[0].normalized, fmt[0].stride, fmt[0].offset);
+	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0) shd->attribute_array(A2E_SHADER_VAR("normal"), draw_normals_vbo, fmt[1].size, fmt[1].type, fmt[1].normalized, fmt[1].stride, fmt[1].offset);
+	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::TEXTURE_COORD) != 0) shd->attribute_array(A2E_SHADER_VAR("texture_coord"), draw_tex_coords_vbo, fmt[2].size, fmt[2].type, fmt[2].normalized, fmt[2].stride, fmt[2].offset);
+	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::BINORMAL) != 0) shd->attribute_array(A2E_SHADER_VAR("binormal"), draw_binormals_vbo, fmt[3].size, fmt[3].type, fmt[3].normalized, fmt[3].stride, fmt[3].offset);
+	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::TANGENT) != 0) shd->attribute_array(A2E_SHADER_VAR("tangent"), draw_tangents_vbo, fmt[4].size, fmt[4].type, fmt[4].normalized, fmt[4].stride, fmt[4].offset);
 	
-	shd->attribute_array("in_vertex", draw_vertices_vbo, 3);
-	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0) shd->attribute_array("normal", draw_normals_vbo, 3);
-	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::TEXTURE_COORD) != 0) shd->attribute_array("texture_coord", draw_tex_coords_vbo, 2);
-	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::BINORMAL) != 0) shd->attribute_array("binormal", draw_binormals_vbo, 3);
-	if((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::TANGENT) != 0) shd->attribute_array("tangent", draw_tangents_vbo, 3);
-	
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, draw_indices_vbo);
-	glDrawElements(GL_TRIANGLES, (GLsizei)draw_index_count, GL_UNSIGNED_INT, nullptr);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	
+	gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, draw_indices_vbo);
+	if(draw_instance_count > 0) draw_instanced(shd, attr_array_mask, env_pass);
+	else draw_elements(1);
+	gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+#endif
+
 	material->disable_textures(sub_object_num);
 	
 	if(masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
@@ -347,54 +453,215 @@ void a2emodel::draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_obj
 	}
 	
 	shd->disable();
-
+	
 	if(masked_draw_mode == DRAW_MODE::GEOMETRY_ALPHA_PASS ||
 	   masked_draw_mode == DRAW_MODE::MATERIAL_ALPHA_PASS) {
 		post_draw_setup((ssize_t)sub_object_num);
 	}
 }
 
-void a2emodel::ir_mp_setup(gl_shader& shd, const string& option, const set<string>& combiners) {
-	const rtt::fbo* cur_buffer = engine::get_rtt()->get_current_buffer();
-	const float2 screen_size = float2(float(cur_buffer->width), float(cur_buffer->height));
+void a2emodel::draw_elements(const size_t& instance_count) {
+#if !defined(FLOOR_IOS)
+	if(draw_base_vertex != 0) {
+		if(instance_count > 1) {
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)draw_index_count, draw_index_type,
+											  (const void*)draw_index_offset, (GLsizei)instance_count, draw_base_vertex);
+		}
+		else glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)draw_index_count, draw_index_type,
+									  (const void*)draw_index_offset, draw_base_vertex);
+		return;
+	}
+#endif
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	if(instance_count > 1) {
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)draw_index_count, draw_index_type, (const void*)draw_index_offset,
+								(GLsizei)instance_count);
+		return;
+	}
+#endif
+	glDrawElements(GL_TRIANGLES, (GLsizei)draw_index_count, draw_index_type, (const void*)draw_index_offset);
+}
+
+void a2emodel::draw_instanced(gl_shader& shd, const VERTEX_ATTRIBUTE& attr_array_mask, const bool env_pass) {
+	if(bind_instance_matrices(shd, draw_instance_vbo)) {
+		draw_elements(draw_instance_count);
+		return;
+	}
+	
+	// no instancing support in this shader -> one draw call per instance (the instance is applied before the model transform)
+	const bool normals = ((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0);
+	for(size_t i = 0; i < draw_instance_count; i++) {
+		const instance_transform& instance = draw_instances[i];
+		shd->uniform(A2E_SHADER_VAR("mvpm"), instance.world * mvpm);
+		if(env_pass) {
+			shd->uniform(A2E_SHADER_VAR("mvpm_backside"), instance.world * mvpm_backside);
+		}
+		if(normals) {
+			shd->uniform(A2E_SHADER_VAR("local_mview"), instance.rotation * rot_mat);
+			shd->uniform(A2E_SHADER_VAR("local_scale"), instance.scale * scale_mat);
+		}
+		draw_elements(1);
+	}
+}
+
+bool a2emodel::bind_instance_matrices(gl_shader& shd floor_unused, const GLuint& matrix_vbo floor_unused) {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	if(!shd->has_attribute(A2E_SHADER_VAR("instance_matrix"))) return false;
+	
+	// a mat4 attribute occupies 4 consecutive locations (one per row), this is stored in the currently bound vao
+	const GLuint location = (GLuint)shd->get_attribute_position(A2E_SHADER_VAR("instance_matrix"));
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, matrix_vbo);
+	for(GLuint i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(location + i);
+		glVertexAttribPointer(location + i, 4, GL_FLOAT, GL_FALSE, (GLsizei)sizeof(matrix4f),
+							  (const void*)(sizeof(float4) * i));
+		glVertexAttribDivisor(location + i, 1);
+	}
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void a2emodel::draw_multi_indirect(gl_shader& shd, const VERTEX_ATTRIBUTE& attr_array_mask, const bool env_pass) {
+	const geometry_arena* arena = engine::get_geometry_arena();
+	if(arena->is_multi_draw_supported() && bind_instance_matrices(shd, arena->get_matrix_buffer())) {
+		arena->draw_commands(draw_multi_first, draw_multi_count);
+		return;
+	}
+	
+	// fallback: one base vertex draw call per command (the view transform + instance transform of each model)
+	const auto& view = sce->get_view_transforms();
+	const bool normals = ((unsigned int)(attr_array_mask & VERTEX_ATTRIBUTE::NORMAL) != 0);
+	for(size_t i = 0; i < draw_multi_count; i++) {
+		const instance_transform& instance = draw_instances[i];
+		shd->uniform(A2E_SHADER_VAR("mvpm"), instance.world * view.mvpm);
+		if(env_pass) {
+			shd->uniform(A2E_SHADER_VAR("mvpm_backside"), instance.world * view.mvpm_backside);
+		}
+		if(normals) {
+			shd->uniform(A2E_SHADER_VAR("local_mview"), instance.rotation);
+			shd->uniform(A2E_SHADER_VAR("local_scale"), instance.scale);
+		}
+		
+		const geometry_arena::draw_command& cmd = arena->get_command(draw_multi_first + i);
+		draw_index_count = cmd.count;
+		draw_index_type = GL_UNSIGNED_INT;
+		draw_index_offset = cmd.first_index * sizeof(uint32_t);
+		draw_base_vertex = cmd.base_vertex;
+		draw_elements(1);
+	}
+}
+
+GLuint a2emodel::get_vertex_array(gl_shader& shd, const size_t& sub_object_num, const VERTEX_ATTRIBUTE& attr_array_mask) {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	// attribute locations may have changed if the shaders were reloaded -> start over
+	if(vertex_arrays_reload_count != s->get_reload_count()) {
+		invalidate_vertex_arrays();
+		vertex_arrays_reload_count = s->get_reload_count();
+	}
+	if(vertex_arrays.size() != object_count) vertex_arrays.resize(object_count);
 	
-	if(option == "opaque") {
-		shd->texture("light_buffer_diffuse", l_buffer->tex[0]);
-		shd->texture("light_buffer_specular", l_buffer->tex[1]);
+	struct vertex_attribute {
+		const shader_var_name name;
+		const VERTEX_ATTRIBUTE flag;
+		const GLuint buffer;
+	};
+	const vertex_attribute attributes[] {
+		{ A2E_SHADER_VAR("in_vertex"), (VERTEX_ATTRIBUTE)0, draw_vertices_vbo },
+		{ A2E_SHADER_VAR("normal"), VERTEX_ATTRIBUTE::NORMAL, draw_normals_vbo },
+		{ A2E_SHADER_VAR("texture_coord"), VERTEX_ATTRIBUTE::TEXTURE_COORD, draw_tex_coords_vbo },
+		{ A2E_SHADER_VAR("binormal"), VERTEX_ATTRIBUTE::BINORMAL, draw_binormals_vbo },
+		{ A2E_SHADER_VAR("tangent"), VERTEX_ATTRIBUTE::TANGENT, draw_tangents_vbo },
+	};
+	uint64_t layout = 0;
+	for(size_t i = 0; i < 5; i++) {
+		if(i > 0 && (unsigned int)(attr_array_mask & attributes[i].flag) == 0) continue;
+		layout |= uint64_t(shd->get_attribute_position(attributes[i].name) + 1) << (i * 8);
+	}
+	const array<GLuint, 6> buffers {{
+		draw_vertices_vbo, draw_normals_vbo, draw_tex_coords_vbo, draw_binormals_vbo, draw_tangents_vbo, draw_indices_vbo
+	}};
+	
+	// already exists? (if the buffers changed, the vao for this layout is recreated)
+	auto& sub_object_vaos = vertex_arrays[sub_object_num];
+	vertex_array_object* entry = nullptr;
+	for(auto& vao : sub_object_vaos) {
+		if(vao.layout != layout) continue;
+		if(vao.buffers == buffers) return vao.vao;
+		gl_state::delete_vertex_arrays(1, &vao.vao);
+		entry = &vao;
+		break;
+	}
+	if(entry == nullptr) {
+		sub_object_vaos.push_back({ layout, buffers, 0 });
+		entry = &sub_object_vaos.back();
 	}
-	else if(option == "alpha") {
-		shd->uniform("screen_size", screen_size); // TODO: remove this in shader
-		shd->texture("light_buffer_diffuse", l_buffer->tex[0]);
-		shd->texture("light_buffer_specular", l_buffer->tex[1]);
+	entry->buffers = buffers;
+	
+	// create it
+	glGenVertexArrays(1, &entry->vao);
+	gl_state::bind_vertex_array(entry->vao);
+	for(size_t i = 0; i < 5; i++) {
+		if(i > 0 && (unsigned int)(attr_array_mask & attributes[i].flag) == 0) continue;
+		const auto& fmt = draw_vertex_format[i];
+		shd->attribute_array(attributes[i].name, attributes[i].buffer, fmt.size, fmt.type, fmt.normalized, fmt.stride, fmt.offset);
+	}
+	gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, draw_indices_vbo);
+	return entry->vao;
+#else
+	return 0;
+#endif
+}
+
+void a2emodel::invalidate_vertex_arrays() {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	for(const auto& sub_object_vaos : vertex_arrays) {
+		for(const auto& vao : sub_object_vaos) {
+			gl_state::delete_vertex_arrays(1, &vao.vao);
+		}
+	}
+#endif
+	vertex_arrays.clear();
+}
+
+void a2emodel::ir_mp_setup(const render_view& view, gl_shader& shd, const size_t& option, const uint32_t& combiners) {
+	if(option == opaque_option_id) {
+		shd->texture(A2E_SHADER_VAR("light_buffer_diffuse"), l_buffer->tex[0]);
+		shd->texture(A2E_SHADER_VAR("light_buffer_specular"), l_buffer->tex[1]);
+	}
+	else if(option == alpha_option_id) {
+		const rtt::fbo* cur_buffer = engine::get_rtt()->get_current_buffer();
+		shd->uniform(A2E_SHADER_VAR("screen_size"), float2(float(cur_buffer->width), float(cur_buffer->height))); // TODO: remove this in shader
+		shd->texture(A2E_SHADER_VAR("light_buffer_diffuse"), l_buffer->tex[0]);
+		shd->texture(A2E_SHADER_VAR("light_buffer_specular"), l_buffer->tex[1]);
 		
 		// global mvm is currently only used in the material alpha pass
-		shd->uniform("mvm", mvm);
+		shd->uniform(A2E_SHADER_VAR("mvm"), mvm);
 		
-		// compute projection constants (necessary to reconstruct world pos)
-		const float2 near_far_plane = floor::get_near_far_plane();
-		const float2 projection_ab = float2(near_far_plane.y / (near_far_plane.y - near_far_plane.x),
-											(-near_far_plane.y * near_far_plane.x) / (near_far_plane.y - near_far_plane.x));
-		shd->uniform("projection_ab", projection_ab);
+		// projection constants (necessary to reconstruct world pos)
+		shd->uniform(A2E_SHADER_VAR("projection_ab"), view.get_projection_ab());
 		
 		const float2 l_buffer_size = float2(float(l_buffer_alpha->width), float(l_buffer_alpha->height));
-		shd->uniform("l_buffer_size", l_buffer_size);
-		shd->uniform("texel_size", float2(1.0f)/l_buffer_size);
+		shd->uniform(A2E_SHADER_VAR("l_buffer_size"), l_buffer_size);
+		shd->uniform(A2E_SHADER_VAR("texel_size"), float2(1.0f)/l_buffer_size);
 		
-		shd->texture("dsf_buffer", g_buffer_alpha->tex[1]);
-		shd->texture("depth_buffer", g_buffer_alpha->depth_buffer);
+		shd->texture(A2E_SHADER_VAR("dsf_buffer"), g_buffer_alpha->tex[1]);
+		shd->texture(A2E_SHADER_VAR("depth_buffer"), g_buffer_alpha->depth_buffer);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
 	}
 	
-	if(combiners.count("*env_map") > 0) {
-		shd->uniform("local_mview", rot_mat);
-		shd->uniform("local_scale", scale_mat);
-		shd->uniform("model_position", position);
-		shd->uniform("cam_position", -float3(*engine::get_position()));
-		if(option == "opaque") {
-			shd->texture("normal_buffer", g_buffer->tex[0]);
+	if((combiners & env_map_combiner) != 0) {
+		shd->uniform(A2E_SHADER_VAR("local_mview"), rot_mat);
+		shd->uniform(A2E_SHADER_VAR("local_scale"), scale_mat);
+		shd->uniform(A2E_SHADER_VAR("model_position"), position);
+		shd->uniform(A2E_SHADER_VAR("cam_position"), view.get_camera_position());
+		if(option == opaque_option_id) {
+			shd->texture(A2E_SHADER_VAR("normal_buffer"), g_buffer->tex[0]);
 		}
-		else if(option == "alpha") {
-			shd->texture("normal_buffer", g_buffer_alpha->tex[0]);
+		else if(option == alpha_option_id) {
+			shd->texture(A2E_SHADER_VAR("normal_buffer"), g_buffer_alpha->tex[0]);
 		}
 	}
 }
@@ -428,11 +695,7 @@ void a2emodel::draw_phys_obj() {
  */
 void a2emodel::set_position(const float x, const float y, const float z) {
 	position.set(x, y, z);
-	
-	bbox.pos.set(x, y, z);
-	for(unsigned int i = 0; i < object_count; i++) {
-		sub_bboxes[i].pos.set(x, y, z);
-	}
+	bounds_changed();
 }
 
 /*! sets the position of the model
@@ -450,12 +713,7 @@ void a2emodel::set_position(const float3& pos) {
 void a2emodel::set_rotation(const float x, const float y, const float z) {
 	rot_mat = matrix4f().rotate_x(x) * matrix4f().rotate_y(y) * matrix4f().rotate_z(z);
 	rot_mat.invert();
-	
-	// update bounding boxes mview matrix
-	bbox.mview = rot_mat;
-	for(unsigned int i = 0; i < object_count; i++) {
-		sub_bboxes[i].mview = rot_mat;
-	}
+	bounds_changed();
 }
 
 /*! sets the rotation of the model
@@ -508,33 +766,40 @@ void a2emodel::set_hard_position(const float3& hpos) {
 
 /*! returns the position of the model
  */
-float3& a2emodel::get_position() {
-	return position;
-}
 const float3& a2emodel::get_position() const {
 	return position;
 }
 
 /*! returns the scale of the model
  */
-float3& a2emodel::get_scale() {
-	return scale;
-}
 const float3& a2emodel::get_scale() const {
 	return scale;
 }
 
 /*! returns the rotation of the model
  */
-matrix4f& a2emodel::get_rotation_matrix() {
-	return rot_mat;
-}
 const matrix4f& a2emodel::get_rotation_matrix() const {
 	return rot_mat;
 }
 
 void a2emodel::set_rotation_matrix(const matrix4f& mat) {
 	rot_mat = mat;
+	bounds_changed();
+}
+
+/*! updates the world matrix, the bounding box position/rotation and the scene bvh after the position
+ *  or rotation has been modified
+ */
+void a2emodel::bounds_changed() {
+	world_dirty = true;
+	
+	bbox.pos.set(position);
+	bbox.mview = rot_mat;
+	for(unsigned int i = 0; i < object_count; i++) {
+		sub_bboxes[i].pos.set(position);
+		sub_bboxes[i].mview = rot_mat;
+	}
+	sce->model_bounds_changed(this);
 }
 
 /*! updates the local scale matrix
@@ -542,21 +807,32 @@ void a2emodel::set_rotation_matrix(const matrix4f& mat) {
 void a2emodel::update_scale_matrix() {
 	scale_mat.identity();
 	scale_mat.scale(scale.x, scale.y, scale.z);
+	world_dirty = true;
 }
 
 /*! builds the bounding box
  */
 void a2emodel::build_bounding_box() {
-	float3 min(model_vertices[0][0]), max(model_vertices[0][0]);
+	vector<float3> sub_object_min(object_count), sub_object_max(object_count);
 	for(unsigned int i = 0; i < object_count; i++) {
 		float3 smin(model_vertices[i][0]), smax(model_vertices[i][0]);
-		extbbox& sbbox = sub_bboxes[i];
-		
 		for(unsigned int j = 0; j < model_vertex_count[i]; j++) {
 			const float3& vert = model_vertices[i][j];
 			smin.min(vert);
 			smax.max(vert);
 		}
+		sub_object_min[i] = smin;
+		sub_object_max[i] = smax;
+	}
+	build_bounding_box(sub_object_min.data(), sub_object_max.data());
+}
+
+void a2emodel::build_bounding_box(const float3* sub_object_min, const float3* sub_object_max) {
+	float3 min(sub_object_min[0]), max(sub_object_max[0]);
+	for(unsigned int i = 0; i < object_count; i++) {
+		const float3& smin = sub_object_min[i];
+		const float3& smax = sub_object_max[i];
+		extbbox& sbbox = sub_bboxes[i];
 		
 		min.min(smin);
 		max.max(smax);
@@ -581,6 +857,9 @@ void a2emodel::build_bounding_box() {
 	
 	// set bbox position
 	bbox.pos.set(position);
+	
+	// note: this also handles set_scale and set_hard_* (which rebuild the bounding box)
+	sce->model_bounds_changed(this);
 }
 
 /*! returns the bounding box of the model
@@ -635,6 +914,59 @@ bool a2emodel::get_visible() {
 	return a2emodel::is_visible;
 }
 
+size_t a2emodel::cull(const frustum& view_frustum) {
+	if(!view_frustum.is_visible(bbox)) {
+		is_sub_object_visible.assign(object_count, false);
+		return 0;
+	}
+	
+	size_t visible_count = 0;
+	for(unsigned int i = 0; i < object_count; i++) {
+		const bool visible = view_frustum.is_visible(sub_bboxes[i]);
+		is_sub_object_visible[i] = visible;
+		if(visible) visible_count++;
+	}
+	return visible_count;
+}
+
+bool a2emodel::get_sub_object_visible(const size_t& sub_object) const {
+	if(sub_object >= is_sub_object_visible.size()) return false;
+	return is_sub_object_visible[sub_object];
+}
+
+void a2emodel::clear_visibility() {
+	is_sub_object_visible.assign(object_count, false);
+}
+
+void a2emodel::set_occluder(const bool state) {
+	is_occluder = state;
+}
+
+bool a2emodel::get_occluder() const {
+	return is_occluder;
+}
+
+size_t a2emodel::cull_occluded(const occlusion_buffer& occlusion) {
+	float3 aabb_min, aabb_max;
+	bvh::compute_aabb(*get_bounding_box(), aabb_min, aabb_max);
+	if(occlusion.is_occluded(aabb_min, aabb_max)) {
+		is_sub_object_visible.assign(object_count, false);
+		return 0;
+	}
+	
+	size_t visible_count = 0;
+	for(unsigned int i = 0; i < object_count; i++) {
+		if(!is_sub_object_visible[i]) continue;
+		bvh::compute_aabb(*get_bounding_box(i), aabb_min, aabb_max);
+		if(occlusion.is_occluded(aabb_min, aabb_max)) {
+			is_sub_object_visible[i] = false;
+			continue;
+		}
+		visible_count++;
+	}
+	return visible_count;
+}
+
 /*! returns true if the model has a collision model
  */
 bool a2emodel::is_collision_model() {
@@ -647,6 +979,7 @@ bool a2emodel::is_collision_model() {
 void a2emodel::set_material(a2ematerial* material_) {
 	a2emodel::material = material_;
 	a2emodel::is_material = true;
+	invalidate_render_state();
 }
 
 a2ematerial* a2emodel::get_material() const {
@@ -817,6 +1150,7 @@ unsigned int a2emodel::get_col_index_count() {
 
 void a2emodel::set_environment_map(const GLuint env_map_) {
 	env_map = env_map_;
+	invalidate_render_state();
 }
 
 GLuint a2emodel::get_environment_map() const {
@@ -856,7 +1190,8 @@ void a2emodel::set_transparent(const size_t& sub_object, const bool state) {
 		if(state) {
 			// TODO: handle draw_sub_object is function is overwritten
 			sce->add_alpha_object(&sub_bboxes[sub_object], sub_object, bind(&a2emodel::draw_sub_object, this,
-																			placeholders::_1, placeholders::_2, placeholders::_3));
+																			placeholders::_1, placeholders::_2, placeholders::_3,
+																			placeholders::_4));
 		}
 		else {
 			sce->delete_alpha_object(&sub_bboxes[sub_object]);
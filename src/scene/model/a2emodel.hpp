@@ -31,6 +31,10 @@
 #include <floor/math/matrix4.hpp>
 #include "scene/light.hpp"
 #include "rendering/extensions.hpp"
+#include "scene/frustum.hpp"
+#include "scene/render_view.hpp"
+#include "scene/occlusion_buffer.hpp"
+#include "rendering/geometry_arena.hpp"
 
 #define A2E_MAX_MASK_ID 3
 
@@ -42,16 +46,50 @@ public:
 	a2emodel(shader* s, scene* sce);
 	virtual ~a2emodel();
 	
-	// ret: void, args: draw_mode, sub_object_num
-	typedef function<void(const DRAW_MODE&, const size_t&, const size_t&)> draw_callback;
+	// ret: void, args: view, draw_mode, sub_object_num, mask_id
+	typedef function<void(const render_view&, const DRAW_MODE&, const size_t&, const size_t&)> draw_callback;
+	
+	//! transform of a drawn instance (see a2einstanced) or of a model in a multi-draw batch (see draw_multi)
+	struct instance_transform {
+		matrix4f world; // scale * rotation * translation
+		matrix4f rotation;
+		matrix4f scale;
+	};
 	
 	virtual void load_model(const string& filename) = 0;
 	virtual const string& get_filename() const;
 	
 	// draw functions
-	virtual void draw(const DRAW_MODE draw_mode) = 0;
+	//! all draw functions draw the model from the specified view (this must be the view the scene last computed the
+	//! view transforms for, see set_view_transforms)
+	virtual void draw(const render_view& view, const DRAW_MODE draw_mode) = 0;
 	virtual void draw_phys_obj();
 	
+	//! if true, the opaque sub-objects of this model are drawn individually via draw_queued() in the order of the
+	//! scene render queue, otherwise the model is drawn as a whole via draw()
+	virtual bool supports_render_queue() const;
+	//! draws a single opaque sub-object (including the pre/post draw setup)
+	virtual void draw_queued(const render_view& view, const DRAW_MODE draw_mode, const size_t& sub_object);
+	//! returns the render state of the sub-object that is used to sort the render queue (see render_queue::make_key),
+	//! the shader and material ids are only computed once per sub-object and draw mode (see invalidate_render_state)
+	virtual void get_render_state(const DRAW_MODE draw_mode, const size_t& sub_object,
+								  uint32_t& shader_id, uint32_t& material_id, uint32_t& mesh_id) const;
+	//! must be called when the shader or material of any sub-object changes (done by set_material and
+	//! set_environment_map, derived classes must call this when the result of select_shader changes)
+	virtual void invalidate_render_state();
+	//! returns true if the sub-object is stored in the geometry arena and can be drawn as part of a multi-draw batch
+	//! in this draw mode, "first_index" is relative to the first index of the arena allocation "alloc"
+	virtual bool get_multi_draw_command(const DRAW_MODE draw_mode, const size_t& sub_object,
+										size_t& first_index, size_t& index_count,
+										geometry_arena::allocation& alloc) const;
+	//! draws the arena commands [first_command, first_command + command_count) with the shader and material of this
+	//! sub-object (i.e. all batched sub-objects must have the same render state, see get_render_state), each command
+	//! is transformed by its instance transform instead of the transform of this model
+	void draw_multi(const render_view& view, const DRAW_MODE draw_mode, const size_t& sub_object,
+					const size_t& first_command, const size_t& command_count, const instance_transform* transforms);
+	//! returns the transform of this model as an instance transform (for multi-draw batches)
+	instance_transform get_model_transform();
+	
 	// misc model manipulation functions
 	virtual void set_position(const float x, const float y, const float z);
 	virtual void set_position(const float3& pos);
@@ -64,15 +102,23 @@ public:
 	virtual void set_hard_position(const float x, const float y, const float z) = 0;
 	virtual void set_hard_position(const float3& hpos);
 	virtual void scale_tex_coords(const float su, const float sv) = 0;
-	virtual float3& get_position();
-	virtual float3& get_scale();
+	//! NOTE: the transform can only be modified through the setters (so that the world matrix, the bounding boxes and
+	//! the scene bvh are always updated)
 	virtual const float3& get_position() const;
 	virtual const float3& get_scale() const;
 	virtual void set_rotation_matrix(const matrix4f& mat);
-	virtual matrix4f& get_rotation_matrix();
 	virtual const matrix4f& get_rotation_matrix() const;
+	//! updates the world matrix, the bounding boxes and the scene bvh (done by all setters)
+	virtual void bounds_changed();
 	virtual void update_scale_matrix();
+	//! scale * rotation * translation, this is only recomputed after the position, rotation or scale changed
+	virtual const matrix4f& get_world_matrix();
+	//! sets the view dependent matrices of the current scene view (done in a batch by the scene for all visible models)
+	virtual void set_view_transforms(const matrix4f& mvm, const matrix4f& mvpm, const matrix4f& mvpm_backside,
+									 const size_t& view_stamp);
 	virtual void build_bounding_box();
+	//! same as build_bounding_box(), but with already known sub-object bounds (e.g. stored in the model file)
+	virtual void build_bounding_box(const float3* sub_object_min, const float3* sub_object_max);
 	virtual extbbox* get_bounding_box();
 	virtual extbbox* get_bounding_box(const size_t& sub_object);
 	virtual void set_environment_map(const GLuint env_map);
@@ -86,6 +132,21 @@ public:
 	virtual void set_visible(bool state);
 	virtual bool get_visible();
 	
+	//! computes the visibility of the model and all of its sub-objects for the specified view frustum,
+	//! returns the amount of visible sub-objects (0 if the whole model is outside of the frustum)
+	virtual size_t cull(const frustum& view_frustum);
+	virtual bool get_sub_object_visible(const size_t& sub_object) const;
+	//! marks the model and all of its sub-objects as not visible (until the next cull() call)
+	virtual void clear_visibility();
+	
+	//! occluders are rasterized into the occlusion buffer of the scene (via their collision mesh, models without one are
+	//! ignored), all other visible models are then tested against it. occluders themselves are never occlusion culled.
+	virtual void set_occluder(const bool state);
+	virtual bool get_occluder() const;
+	//! hides all visible sub-objects that are completely occluded (must be called after cull()),
+	//! returns the amount of sub-objects that are still visible
+	virtual size_t cull_occluded(const occlusion_buffer& occlusion);
+	
 	//! note: set/get transparent w/o a specified sub-object applies to the whole model (all sub-objects)
 	//! also note that set_transparent overwrites all previously set sub-object transparency flags,
 	//! and get_transparent only stores the value of the last set_transparent
@@ -130,7 +191,7 @@ public:
 						const rtt::fbo* l_buffer,
 						const rtt::fbo* g_buffer_alpha,
 						const rtt::fbo* l_buffer_alpha);
-	
+
 protected:
 	// classes
 	texman* t;
@@ -168,6 +229,25 @@ protected:
 	GLuint draw_tangents_vbo;
 	GLuint draw_indices_vbo;
 	size_t draw_index_count;
+	GLenum draw_index_type = GL_UNSIGNED_INT;
+	GLint draw_base_vertex = 0; // only supported with desktop opengl
+	size_t draw_index_offset = 0; // in bytes
+	// layout of the draw_* vertex buffers (vertices, normals, tex coords, binormals, tangents),
+	// by default each attribute has its own tightly packed float buffer
+	struct vertex_attribute_format {
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei stride;
+		size_t offset;
+	};
+	array<vertex_attribute_format, 5> draw_vertex_format {{
+		{ 3, GL_FLOAT, GL_FALSE, 0, 0 },
+		{ 3, GL_FLOAT, GL_FALSE, 0, 0 },
+		{ 2, GL_FLOAT, GL_FALSE, 0, 0 },
+		{ 3, GL_FLOAT, GL_FALSE, 0, 0 },
+		{ 3, GL_FLOAT, GL_FALSE, 0, 0 },
+	}};
 	
 	//
 	enum class VERTEX_ATTRIBUTE : unsigned int {
@@ -179,9 +259,45 @@ protected:
 	enum_class_bitwise_or(VERTEX_ATTRIBUTE)
 	enum_class_bitwise_and(VERTEX_ATTRIBUTE)
 	
+	// vertex array objects: one per sub-object and shader attribute layout (built on first use)
+	struct vertex_array_object {
+		uint64_t layout; // 8 bits per attribute: location + 1 (0: unused)
+		array<GLuint, 6> buffers; // vertices, normals, tex coords, binormals, tangents, indices
+		GLuint vao;
+	};
+	vector<vector<vertex_array_object>> vertex_arrays;
+	size_t vertex_arrays_reload_count = 0;
+	//! returns the vao of the current draw_* buffers of the sub-object for the attribute layout of the current program
+	GLuint get_vertex_array(gl_shader& shd, const size_t& sub_object_num, const VERTEX_ATTRIBUTE& attr_array_mask);
+	//! deletes all vaos (must be called when a vertex or index buffer is re-created)
+	void invalidate_vertex_arrays();
+	
+	// instanced drawing (set by the derived class, see a2einstanced): if draw_instance_count > 0, each sub-object is
+	// drawn once per instance. the world matrices of the instances are read from draw_instance_vbo via the
+	// "instance_matrix" vertex attribute of the "*instanced" shader combiner (in addition to mvpm, local_mview, ...).
+	// shaders that don't have this attribute fall back to one draw call per instance, using draw_instances.
+	size_t draw_instance_count = 0;
+	GLuint draw_instance_vbo = 0;
+	const instance_transform* draw_instances = nullptr;
+	//! issues the draw call of the current draw_* buffers (instance_count > 1: instanced draw call)
+	void draw_elements(const size_t& instance_count);
+	//! draws all draw_instances with the current shader (the vao or the vertex attributes must already be set up)
+	void draw_instanced(gl_shader& shd, const VERTEX_ATTRIBUTE& attr_array_mask, const bool env_pass);
+	//! binds the "instance_matrix" attribute of the shader to the matrix buffer (returns false if there is none)
+	bool bind_instance_matrices(gl_shader& shd, const GLuint& matrix_vbo);
+	
+	// multi-draw batches (set by draw_multi): if draw_multi_count > 0, the geometry arena commands starting at
+	// draw_multi_first are drawn instead of the current sub-object (with draw_instances as their transforms)
+	size_t draw_multi_first = 0;
+	size_t draw_multi_count = 0;
+	//! draws all commands of the current batch with a single multi-draw call, or with one draw call per command
+	//! if this isn't supported by the context or the shader
+	void draw_multi_indirect(gl_shader& shd, const VERTEX_ATTRIBUTE& attr_array_mask, const bool env_pass);
+	
 	// internal draw functions (override these in derived classes if you have to do custom rendering)
-	virtual void draw_sub_object(const DRAW_MODE& draw_mode, const size_t& sub_object_num, const size_t& mask_id);
-	virtual void ir_mp_setup(gl_shader& shd, const string& option, const set<string>& combiners);
+	virtual void draw_sub_object(const render_view& view, const DRAW_MODE& draw_mode, const size_t& sub_object_num,
+								 const size_t& mask_id);
+	virtual void ir_mp_setup(const render_view& view, gl_shader& shd, const size_t& option, const uint32_t& combiners);
 	virtual void pre_draw_setup(const ssize_t sub_object_num = -1); // -1, no sub-object
 	virtual void post_draw_setup(const ssize_t sub_object_num = -1);
 	virtual void pre_draw_geometry(gl_shader& shd, VERTEX_ATTRIBUTE& attr_array_mask, a2ematerial::TEXTURE_TYPE& texture_mask);
@@ -189,8 +305,14 @@ protected:
 		virtual void pre_draw_material(gl_shader& shd, VERTEX_ATTRIBUTE& attr_array_mask, a2ematerial::TEXTURE_TYPE& texture_mask);
 	virtual void post_draw_material(gl_shader& shd);
 	//! return an empty string if no custom shader should be used
+	//! NOTE: if this changes for the same draw mode, invalidate_render_state() must be called
 	virtual const string select_shader(const DRAW_MODE& draw_mode) const;
 	
+	// cached (shader id, material id) of all sub-objects, indexed by sub-object * draw mode count + draw mode
+	// (x == ~0u: not computed yet)
+	static constexpr size_t render_state_draw_mode_count = (size_t)DRAW_MODE::ENV_GM_PASSES_MASK + 1;
+	mutable vector<uint2> render_state_cache;
+	
 	// orientation
 	float3 position;
 	float3 scale;
@@ -205,6 +327,12 @@ protected:
 	matrix4f mvpm_backside; // only used while rendering (global mvm)
 	matrix4f mvm; // only used while rendering (global mvm)
 	
+	// cached transforms (world: until the model is moved, mvm/mvpm/mvpm_backside: for the scene view "view_stamp")
+	matrix4f world_mat;
+	bool world_dirty = true;
+	size_t view_stamp = 0;
+	void update_view_transforms();
+	
 	
 	// some flags
 	bool draw_wireframe;
@@ -213,13 +341,15 @@ protected:
 	bool is_draw_phys_obj;
 	bool is_transparent;
 	vector<bool> is_sub_object_transparent;
+	vector<bool> is_sub_object_visible; // result of the last cull() call
+	bool is_occluder = false;
 	
 	
 	// some variables for collision detection
 	float radius;
 	float length;
 	float3 phys_scale;
-		
+	
 	
 	// inferred rendering
 	const rtt::fbo* g_buffer;
@@ -236,6 +366,14 @@ protected:
 	
 	GLuint env_map = 0;
 	
+	// shader permutation ids (see shader::get_option_id/get_combiner_bit)
+	size_t opaque_option_id;
+	size_t alpha_option_id;
+	uint32_t env_probe_combiner;
+	uint32_t env_map_combiner;
+	uint32_t aux_texture_combiner;
+	uint32_t instanced_combiner;
+
 };
 
 #endif
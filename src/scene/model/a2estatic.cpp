@@ -17,61 +17,30 @@
  */
 
 #include "a2estatic.hpp"
+#include "scene/model/vertex_packing.hpp"
+#include "scene/model/a2m_file.hpp"
 
 /*! a2estatic constructor
  */
 a2estatic::a2estatic(shader* s, scene* sce) : a2emodel(s, sce) {
-	vertices = nullptr;
-	tex_coords = nullptr;
-	indices = nullptr;
-	vertex_count = 0;
-	index_count = nullptr;
-	min_index = nullptr;
-	max_index = nullptr;
-	vbo_indices_ids = nullptr;
-	
-	normals = nullptr;
-	binormals = nullptr;
-	tangents = nullptr;
 }
 
 /*! a2estatic destructor
  */
 a2estatic::~a2estatic() {
-	if(vertices != nullptr) { delete [] vertices; }
-	if(tex_coords != nullptr) { delete [] tex_coords; }
-	if(indices != nullptr) { // no additional delete for tex_indices needed, b/c it points to the same data as indices
-	    for(unsigned int i = 0; i < object_count; i++) {
-	        delete [] indices[i];
-	    }
-	    delete [] indices;
-    }
-	if(index_count != nullptr) { delete [] index_count; }
-	if(min_index != nullptr) { delete [] min_index; }
-	if(max_index != nullptr) { delete [] max_index; }
-
-	if(normals != nullptr) { delete [] normals; }
-	if(binormals != nullptr) { delete [] binormals; }
-	if(tangents != nullptr) { delete [] tangents; }
-	
+	// the model data itself belongs to the (shared) mesh, only the per-model pointer arrays have to be deleted
 	if(model_vertices != nullptr) { delete [] model_vertices; }
+	if(model_tex_coords != nullptr) { delete [] model_tex_coords; }
 	if(model_vertex_count != nullptr) { delete [] model_vertex_count; }
-
-	// delete vbos
-	if(glIsBuffer(vbo_vertices_id)) { glDeleteBuffers(1, &vbo_vertices_id); }
-	if(glIsBuffer(vbo_tex_coords_id)) { glDeleteBuffers(1, &vbo_tex_coords_id); }
-	if(vbo_indices_ids != nullptr) {
-		if(glIsBuffer(vbo_indices_ids[0])) { glDeleteBuffers((GLsizei)object_count, vbo_indices_ids); }
-		delete [] vbo_indices_ids;
-	}
-	if(glIsBuffer(vbo_normals_id)) { glDeleteBuffers(1, &vbo_normals_id); }
-	if(glIsBuffer(vbo_binormals_id)) { glDeleteBuffers(1, &vbo_binormals_id); }
-	if(glIsBuffer(vbo_tangents_id)) { glDeleteBuffers(1, &vbo_tangents_id); }
+	
+	// the vaos reference the buffers of the mesh -> delete them while the buffers are still alive
+	invalidate_vertex_arrays();
+	mesh = nullptr;
 }
 
 /*! draws the model
  */
-void a2estatic::draw(const DRAW_MODE draw_mode) {
+void a2estatic::draw(const render_view& view, const DRAW_MODE draw_mode) {
 	if(is_draw_phys_obj) {
 		draw_phys_obj();
 	}
@@ -79,17 +48,12 @@ void a2estatic::draw(const DRAW_MODE draw_mode) {
 	if(!is_draw_phys_obj && engine::get_init_mode() == engine::INIT_MODE::GRAPHICAL) {
 		pre_draw_setup();
 		
-		// vbo setup, part one (the same for all sub-objects)
-		draw_vertices_vbo = vbo_vertices_id;
-		draw_tex_coords_vbo = vbo_tex_coords_id;
-		draw_normals_vbo = vbo_normals_id;
-		draw_binormals_vbo = vbo_binormals_id;
-		draw_tangents_vbo = vbo_tangents_id;
 		for(size_t i = 0; i < object_count; i++) {
+			if(!is_sub_object_visible[i]) continue;
+			
 			// vbo setup, part two
-			draw_indices_vbo = vbo_indices_ids[i];
-			draw_index_count = index_count[i] * 3;
-			draw_sub_object(draw_mode, i, 0);
+			set_sub_object_buffers(i);
+			draw_sub_object(view, draw_mode, i, 0);
 		}
 		
 		post_draw_setup();
@@ -98,345 +62,486 @@ void a2estatic::draw(const DRAW_MODE draw_mode) {
 
 void a2estatic::pre_draw_setup(const ssize_t sub_object_num) {
 	a2emodel::pre_draw_setup(sub_object_num);
+	
+	// vbo setup, part one (the same for all sub-objects)
+	if(mesh->arena != nullptr) {
+		// the arena buffers are re-created when they grow or are defragmented -> rebuild the vaos
+		if(arena_buffer_generation != mesh->arena->get_buffer_generation()) {
+			invalidate_vertex_arrays();
+			arena_buffer_generation = mesh->arena->get_buffer_generation();
+		}
+		draw_vertices_vbo = mesh->arena->get_vertex_buffer();
+		draw_tex_coords_vbo = draw_vertices_vbo;
+		draw_normals_vbo = draw_vertices_vbo;
+		draw_binormals_vbo = draw_vertices_vbo;
+		draw_tangents_vbo = draw_vertices_vbo;
+	}
+	else if(!compact_vertex_format) {
+		draw_vertices_vbo = mesh->vbo_vertices_id;
+		draw_tex_coords_vbo = mesh->vbo_tex_coords_id;
+		draw_normals_vbo = mesh->vbo_normals_id;
+		draw_binormals_vbo = mesh->vbo_binormals_id;
+		draw_tangents_vbo = mesh->vbo_tangents_id;
+	}
+	else {
+		// all attributes are stored in the interleaved vertex buffer
+		draw_vertices_vbo = mesh->vbo_vertices_id;
+		draw_tex_coords_vbo = mesh->vbo_vertices_id;
+		draw_normals_vbo = mesh->vbo_vertices_id;
+		draw_binormals_vbo = mesh->vbo_vertices_id;
+		draw_tangents_vbo = mesh->vbo_vertices_id;
+	}
+	
 	if(sub_object_num >= 0) {
 		// vbo setup, part two
-		draw_indices_vbo = vbo_indices_ids[sub_object_num];
-		draw_index_count = index_count[sub_object_num] * 3;
+		set_sub_object_buffers((size_t)sub_object_num);
+	}
+}
+
+void a2estatic::set_sub_object_buffers(const size_t& sub_object_num) {
+	draw_index_count = model_index_count[sub_object_num] * 3;
+	if(mesh->arena != nullptr) {
+		draw_indices_vbo = mesh->arena->get_index_buffer();
+		draw_index_type = GL_UNSIGNED_INT;
+		draw_base_vertex = mesh->arena->get_base_vertex(mesh->arena_alloc);
+		draw_index_offset = ((mesh->arena->get_first_index(mesh->arena_alloc) + mesh->arena_index_offsets[sub_object_num]) *
+							 sizeof(uint32_t));
+		return;
 	}
+	draw_indices_vbo = mesh->vbo_indices_ids[sub_object_num];
+	draw_index_type = mesh->index_types[sub_object_num];
+	draw_base_vertex = mesh->base_vertices[sub_object_num];
+	draw_index_offset = 0;
 }
 
 void a2estatic::post_draw_setup(const ssize_t sub_object_num) {
 	a2emodel::post_draw_setup(sub_object_num);
 }
 
-/*! loads a .a2m model file
+bool a2estatic::get_multi_draw_command(const DRAW_MODE draw_mode, const size_t& sub_object,
+										size_t& first_index, size_t& index_count,
+										geometry_arena::allocation& alloc) const {
+	if(mesh->arena == nullptr || draw_wireframe || env_map != 0) return false;
+	// custom shaders (bits 6+ of the cached shader id, see a2emodel::get_render_state) aren't batched
+	uint32_t shader_id = 0, material_id = 0, mesh_id = 0;
+	get_render_state(draw_mode, sub_object, shader_id, material_id, mesh_id);
+	if((shader_id >> 6u) != 0) return false;
+	// parallax mapping needs the model position
+	if(material->get_material_type(sub_object) == a2ematerial::MATERIAL_TYPE::PARALLAX) return false;
+	
+	first_index = mesh->arena_index_offsets[sub_object];
+	index_count = model_index_count[sub_object] * 3;
+	alloc = mesh->arena_alloc;
+	return true;
+}
+
+bool a2estatic::supports_render_queue() const {
+	return (!is_draw_phys_obj && mesh != nullptr && engine::get_init_mode() == engine::INIT_MODE::GRAPHICAL);
+}
+
+void a2estatic::get_render_state(const DRAW_MODE draw_mode, const size_t& sub_object,
+								 uint32_t& shader_id, uint32_t& material_id, uint32_t& mesh_id) const {
+	a2emodel::get_render_state(draw_mode, sub_object, shader_id, material_id, mesh_id);
+	// models that share their geometry also share their buffers
+	mesh_id = mesh->vbo_vertices_id;
+}
+
+/*! loads a .a2m model file (version 2 or 3)
  *  @param filename the name of the .a2m model file
- *  @param vbo flag that specifies if vertex buffer objects should be used
  */
 void a2estatic::load_model(const string& filename_) {
-	file_io file(filename_, file_io::OPEN_TYPE::READ_BINARY);
-	if(!file.is_open()) {
+	// already loaded by another model?
+	const string key = mesh_cache::file_key(filename_, get_load_options());
+	auto cached_mesh = mesh_cache::get(key);
+	if(cached_mesh != nullptr) {
+		filename = filename_;
+		mesh = cached_mesh;
+		init_from_mesh();
 		return;
 	}
-	filename = filename_;
-
-	// get type and name
-	char* file_type = new char[9];
-	file.get_block(file_type, 8);
-	file_type[8] = 0;
-
-	if(strcmp(file_type, "A2EMODEL") != 0) {
-		log_error("non supported file type for %s: %s!", filename, file_type);
-		delete [] file_type;
-		file.close();
-		return;
-	}
-	delete [] file_type;
 	
-	// get model version
-	unsigned int version = file.get_uint();
-	if(version != A2M_VERSION) {
-		log_error("wrong model file version %u - should be %u!", version, A2M_VERSION);
-		file.close();
+	auto new_mesh = make_shared<static_mesh>();
+	if(!a2m_file::load(filename_, new_mesh->data)) {
 		return;
 	}
+	filename = filename_;
+	mesh = new_mesh;
+	
+	// models that were converted offline are already optimized
+	if(!mesh->data.optimized) optimize_mesh();
+	
+	create_buffers();
+	mesh_cache::add(key, mesh);
+	
+	init_from_mesh();
+}
 
-	// get model type and abort if it's not 0x00 or 0x02
-	auto mtype = file.get_char();
-	if(mtype != 0x00 && mtype != 0x02) {
-		log_error("non supported model type: %u!", (unsigned int)(mtype & 0xFF));
-		file.close();
+void a2estatic::load_from_memory(unsigned int object_count_, unsigned int vertex_count_,
+								 float3* vertices_, float2* tex_coords_,
+								 unsigned int* index_count_, uint3** indices_) {
+	filename = "<memory>";
+	
+	// identical data was already loaded by another model?
+	vector<uint8_t> source_data = mesh_cache::memory_data(object_count_, vertex_count_, vertices_, tex_coords_,
+														  index_count_, indices_);
+	const string key = mesh_cache::memory_key(object_count_, vertex_count_, source_data, get_load_options());
+	auto cached_mesh = mesh_cache::get(key, source_data);
+	if(cached_mesh != nullptr) {
+		// this model owns the passed arrays, but doesn't need them
+		delete [] vertices_;
+		delete [] tex_coords_;
+		for(unsigned int i = 0; i < object_count_; i++) {
+			delete [] indices_[i];
+		}
+		delete [] indices_;
+		delete [] index_count_;
+		
+		mesh = cached_mesh;
+		init_from_mesh();
 		return;
 	}
-
-	if(mtype == 0x02) collision_model = true;
-
-	vertex_count = file.get_uint();
-	tex_coord_count = file.get_uint();
-	vertices = new float3[vertex_count];
-	normals = new float3[vertex_count];
-	binormals = new float3[vertex_count];
-	tangents = new float3[vertex_count];
-	tex_coords = new float2[tex_coord_count];
-
-	for(unsigned int i = 0; i < vertex_count; i++) {
-		vertices[i].x = file.get_float();
-		vertices[i].y = file.get_float();
-		vertices[i].z = file.get_float();
+	
+	mesh = make_shared<static_mesh>();
+	a2m_file::model_data& data = mesh->data;
+	data.vertex_count = vertex_count_;
+	data.vertices = vertices_;
+	data.tex_coords = tex_coords_;
+	data.index_count = index_count_;
+	data.indices = indices_;
+	data.normals = new float3[data.vertex_count];
+	data.binormals = new float3[data.vertex_count];
+	data.tangents = new float3[data.vertex_count];
+	
+	data.object_count = object_count_;
+	data.min_index = new unsigned int[data.object_count];
+	data.max_index = new unsigned int[data.object_count];
+	memset(data.min_index, 0xFF, sizeof(unsigned int)*data.object_count);
+	memset(data.max_index, 0, sizeof(unsigned int)*data.object_count);
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		if(data.index_count[i] == 0) {
+			data.min_index[i] = 0;
+			data.max_index[i] = 0;
+		}
+		for(unsigned int j = 0; j < data.index_count[i]; j++) {
+			// also get the max/highest and min/lowest index number
+			for(size_t k = 0; k < 3; k++) {
+				const unsigned int& idx = data.indices[i][j][k];
+				if(idx > data.max_index[i]) data.max_index[i] = idx;
+				if(idx < data.min_index[i]) data.min_index[i] = idx;
+			}
+		}
 	}
-	for(unsigned int i = 0; i < tex_coord_count; i++) {
-		tex_coords[i].x = file.get_float();
-		tex_coords[i].y = 1.0f - file.get_float();
+	
+	data.object_names.resize(data.object_count);
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		data.object_names[i] = "object #" + to_string(i);
 	}
+	
+	generate_normals();
+	optimize_mesh();
+	
+	create_buffers();
+	mesh->source_data = std::move(source_data);
+	mesh_cache::add(key, mesh);
+	
+	init_from_mesh();
+}
 
-	object_count = file.get_uint();
+mesh_cache::load_options a2estatic::get_load_options() const {
+	return { compact_vertex_format, mesh_optimization, mesh_overdraw_optimization, use_geometry_arena };
+}
+
+void a2estatic::init_from_mesh() {
+	// the previous sub-object data (if any) is still needed to remove the sub-objects from the scene
 	delete_sub_bboxes();
+	if(model_vertices != nullptr) { delete [] model_vertices; model_vertices = nullptr; }
+	if(model_tex_coords != nullptr) { delete [] model_tex_coords; model_tex_coords = nullptr; }
+	if(model_vertex_count != nullptr) { delete [] model_vertex_count; model_vertex_count = nullptr; }
+	invalidate_vertex_arrays();
+	
+	bind_mesh();
+	if(compact_vertex_format) set_compact_draw_vertex_format();
+	
+	object_names = mesh->data.object_names;
 	sub_bboxes.resize(object_count);
+	
+	// version 3 files also contain the sub-object bounding boxes
+	if(mesh->data.bbox_min.size() == object_count) {
+		build_bounding_box(mesh->data.bbox_min.data(), mesh->data.bbox_max.data());
+	}
+	else build_bounding_box();
+	
+	// general model setup
+	model_setup();
+}
 
-	object_names.clear();
-	object_names.resize(object_count);
+void a2estatic::bind_mesh() {
+	const a2m_file::model_data& data = mesh->data;
+	object_count = data.object_count;
+	model_indices = data.indices;
+	model_index_count = data.index_count;
+	
+	if(model_vertices == nullptr) {
+		model_vertices = new float3*[object_count];
+		model_tex_coords = new float2*[object_count];
+		model_vertex_count = new unsigned int[object_count];
+	}
 	for(unsigned int i = 0; i < object_count; i++) {
-		file.get_terminated_block(object_names[i], 0xFF);
+		model_vertices[i] = &data.vertices[data.min_index[i]];
+		model_tex_coords[i] = &data.tex_coords[data.min_index[i]];
+		model_vertex_count[i] = (data.min_index[i] <= data.max_index[i] ? data.max_index[i] - data.min_index[i] + 1 : 0);
+	}
+	
+	collision_model = (data.type == 0x02);
+	if(collision_model) {
+		col_vertex_count = data.col_vertex_count;
+		col_vertices = data.col_vertices;
+		col_index_count = data.col_index_count;
+		col_indices = data.col_indices;
 	}
+}
 
-	indices = new uint3*[object_count];
-	tex_indices = new uint3*[object_count];
-	index_count = new unsigned int[object_count];
-	min_index = new unsigned int[object_count];
-	max_index = new unsigned int[object_count];
-	memset(min_index, 0xFF, sizeof(unsigned int)*object_count);
-	memset(max_index, 0, sizeof(unsigned int)*object_count);
-	for(unsigned int i = 0; i < object_count; i++) {
-		index_count[i] = file.get_uint();
-		indices[i] = new uint3[index_count[i]];
-		tex_indices[i] = new uint3[index_count[i]];
-		for(unsigned int j = 0; j < index_count[i]; j++) {
-			indices[i][j].x = file.get_uint();
-			indices[i][j].y = file.get_uint();
-			indices[i][j].z = file.get_uint();
-		}
-		for(unsigned int j = 0; j < index_count[i]; j++) {
-			tex_indices[i][j].x = file.get_uint();
-			tex_indices[i][j].y = file.get_uint();
-			tex_indices[i][j].z = file.get_uint();
-		}
+void a2estatic::make_mesh_unique() {
+	if(mesh_cache::make_unique(mesh)) {
+		// this is now an own copy of the model data -> needs its own buffers
+		create_buffers();
+		bind_mesh();
 	}
+}
 
-	if(collision_model) {
-		col_vertex_count = file.get_uint();
-		col_vertices = new float3[col_vertex_count];
-		for(unsigned int i = 0; i < col_vertex_count; i++) {
-			col_vertices[i].x = file.get_float();
-			col_vertices[i].y = file.get_float();
-			col_vertices[i].z = file.get_float();
-		}
+void a2estatic::set_compact_vertex_format(const bool state) {
+#if defined(FLOOR_IOS) && !defined(PLATFORM_X64)
+	if(state) {
+		log_error("the compact vertex format is not supported in OpenGL ES 2.0!");
+		return;
+	}
+#endif
+	if(mesh != nullptr) {
+		log_error("the vertex format must be set before the model is loaded!");
+		return;
+	}
+	compact_vertex_format = state;
+}
 
-		col_index_count = file.get_uint();
-		col_indices = new uint3[col_index_count];
-		for(unsigned int i = 0; i < col_index_count; i++) {
-			col_indices[i].x = file.get_uint();
-			col_indices[i].y = file.get_uint();
-			col_indices[i].z = file.get_uint();
-		}
+bool a2estatic::get_compact_vertex_format() const {
+	return compact_vertex_format;
+}
+
+void a2estatic::set_mesh_optimization(const bool state, const bool reduce_overdraw) {
+	if(mesh != nullptr) {
+		log_error("the mesh optimization must be set before the model is loaded!");
+		return;
 	}
+	mesh_optimization = state;
+	mesh_overdraw_optimization = reduce_overdraw;
+}
 
-	file.close();
-	
-	// set this stuff for normal generating
-	model_indices = indices;
-	model_index_count = index_count;
+bool a2estatic::get_mesh_optimization() const {
+	return mesh_optimization;
+}
 
-	generate_normals();
-	reorganize_model_data();
-	
-	// set the actual model data after everything is computed correctly and its final state
-	model_indices = indices;
-	model_index_count = index_count;
-	
-	model_vertices = new float3*[object_count];
-	model_tex_coords = new float2*[object_count];
-	model_vertex_count = new unsigned int[object_count];
-	for(unsigned int i = 0; i < object_count; i++) {
-		model_vertices[i] = &vertices[min_index[i]];
-		model_tex_coords[i] = &tex_coords[min_index[i]];
-		model_vertex_count[i] = max_index[i] - min_index[i] + 1;
+void a2estatic::set_use_geometry_arena(const bool state) {
+#if defined(FLOOR_IOS)
+	if(state) {
+		log_error("the geometry arena is not supported in OpenGL ES!");
+		return;
+	}
+#endif
+	if(mesh != nullptr) {
+		log_error("the geometry arena usage must be set before the model is loaded!");
+		return;
 	}
+	use_geometry_arena = state;
+	if(state) compact_vertex_format = true;
+}
 
-	build_bounding_box();
-	
-	// vertices vbo
-	glGenBuffers(1, &vbo_vertices_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), vertices, GL_STATIC_DRAW);
-	
-	// tex_coords vbo
-	glGenBuffers(1, &vbo_tex_coords_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_tex_coords_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), tex_coords, GL_STATIC_DRAW);
-	
-	// normals/binormals/tangents vbo
-	glGenBuffers(1, &vbo_normals_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_normals_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), normals, GL_STATIC_DRAW);
+bool a2estatic::get_use_geometry_arena() const {
+	return use_geometry_arena;
+}
+
+void a2estatic::optimize_mesh() {
+	if(!mesh_optimization) return;
+	a2m_file::optimize(mesh->data, mesh_overdraw_optimization, filename);
+}
+
+void a2estatic::create_buffers() {
+	// (re)creating all buffers -> all vaos must be rebuilt
+	invalidate_vertex_arrays();
+	mesh->delete_buffers();
+	mesh->compact_vertex_format = compact_vertex_format;
 	
-	glGenBuffers(1, &vbo_binormals_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_binormals_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), binormals, GL_STATIC_DRAW);
+	// stored in the geometry arena (if this fails, the model falls back to its own buffers)
+	if(use_geometry_arena && create_arena_buffers(engine::get_geometry_arena())) {
+		return;
+	}
 	
-	glGenBuffers(1, &vbo_tangents_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_tangents_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), tangents, GL_STATIC_DRAW);
+	const a2m_file::model_data& data = mesh->data;
+	if(!compact_vertex_format) {
+		// vertices vbo
+		glGenBuffers(1, &mesh->vbo_vertices_id);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_vertices_id);
+		glBufferData(GL_ARRAY_BUFFER, data.vertex_count * 3 * sizeof(float), data.vertices, GL_STATIC_DRAW);
+		
+		// tex_coords vbo
+		glGenBuffers(1, &mesh->vbo_tex_coords_id);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_tex_coords_id);
+		glBufferData(GL_ARRAY_BUFFER, data.vertex_count * 2 * sizeof(float), data.tex_coords, GL_STATIC_DRAW);
+		
+		// normals/binormals/tangents vbo
+		glGenBuffers(1, &mesh->vbo_normals_id);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_normals_id);
+		glBufferData(GL_ARRAY_BUFFER, data.vertex_count * 3 * sizeof(float), data.normals, GL_STATIC_DRAW);
+		
+		glGenBuffers(1, &mesh->vbo_binormals_id);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_binormals_id);
+		glBufferData(GL_ARRAY_BUFFER, data.vertex_count * 3 * sizeof(float), data.binormals, GL_STATIC_DRAW);
+		
+		glGenBuffers(1, &mesh->vbo_tangents_id);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_tangents_id);
+		glBufferData(GL_ARRAY_BUFFER, data.vertex_count * 3 * sizeof(float), data.tangents, GL_STATIC_DRAW);
+	}
+	else {
+		// single interleaved vbo
+		glGenBuffers(1, &mesh->vbo_vertices_id);
+		upload_compact_vertices(true);
+	}
 	
 	// indices vbos
-	vbo_indices_ids = new GLuint[object_count];
-	for(unsigned int i = 0; i < object_count; i++) {
-		glGenBuffers(1, &vbo_indices_ids[i]);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_indices_ids[i]);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count[i] * 3 * sizeof(unsigned int), indices[i], GL_STATIC_DRAW);
+	mesh->index_types.assign(data.object_count, GL_UNSIGNED_INT);
+	mesh->base_vertices.assign(data.object_count, 0);
+	mesh->vbo_indices_ids.resize(data.object_count);
+	vector<uint16_t> short_indices;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		glGenBuffers(1, &mesh->vbo_indices_ids[i]);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->vbo_indices_ids[i]);
+		
+		// use 16-bit indices if all indices of the sub-object fit (relative to the base vertex, if supported)
+#if !defined(FLOOR_IOS)
+		const unsigned int base_vertex = data.min_index[i];
+#else
+		const unsigned int base_vertex = 0; // no base vertex support in opengl es
+#endif
+		if(compact_vertex_format && data.index_count[i] > 0 && data.min_index[i] <= data.max_index[i] &&
+		   (data.max_index[i] - base_vertex) < 65536u) {
+			short_indices.resize(data.index_count[i] * 3);
+			for(unsigned int j = 0; j < data.index_count[i]; j++) {
+				short_indices[j * 3] = (uint16_t)(data.indices[i][j].x - base_vertex);
+				short_indices[j * 3 + 1] = (uint16_t)(data.indices[i][j].y - base_vertex);
+				short_indices[j * 3 + 2] = (uint16_t)(data.indices[i][j].z - base_vertex);
+			}
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(short_indices.size() * sizeof(uint16_t)),
+						 short_indices.data(), GL_STATIC_DRAW);
+			mesh->index_types[i] = GL_UNSIGNED_SHORT;
+			mesh->base_vertices[i] = (GLint)base_vertex;
+			continue;
+		}
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.index_count[i] * 3 * sizeof(unsigned int), data.indices[i], GL_STATIC_DRAW);
 	}
 	
 	// reset buffer
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	
-	// general model setup
-	model_setup();
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+	gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void a2estatic::load_from_memory(unsigned int object_count_, unsigned int vertex_count_,
-								 float3* vertices_, float2* tex_coords_,
-								 unsigned int* index_count_, uint3** indices_) {
-	filename = "<memory>";
-	a2estatic::vertex_count = vertex_count_;
-	a2estatic::vertices = vertices_;
-	
-	a2estatic::tex_coord_count = vertex_count_;
-	a2estatic::tex_coords = tex_coords_;
-	
-	a2estatic::index_count = index_count_;
-	a2estatic::indices = indices_;
-	a2estatic::tex_indices = indices_;
-	normals = new float3[vertex_count];
-	binormals = new float3[vertex_count];
-	tangents = new float3[vertex_count];
-	
-	a2estatic::object_count = object_count_;
-	min_index = new unsigned int[object_count];
-	max_index = new unsigned int[object_count];
-	memset(min_index, 0xFF, sizeof(unsigned int)*object_count);
-	memset(max_index, 0, sizeof(unsigned int)*object_count);
-	for(unsigned int i = 0; i < object_count; i++) {
-		if(index_count[i] == 0) {
-			min_index[i] = 0;
-			max_index[i] = 0;
-		}
-		for(unsigned int j = 0; j < index_count[i]; j++) {			
-			// also get the max/highest and min/lowest index number
-			if(tex_indices[i][j].x > max_index[i]) max_index[i] = tex_indices[i][j].x;
-			if(tex_indices[i][j].y > max_index[i]) max_index[i] = tex_indices[i][j].y;
-			if(tex_indices[i][j].z > max_index[i]) max_index[i] = tex_indices[i][j].z;
-			if(tex_indices[i][j].x < min_index[i]) min_index[i] = tex_indices[i][j].x;
-			if(tex_indices[i][j].y < min_index[i]) min_index[i] = tex_indices[i][j].y;
-			if(tex_indices[i][j].z < min_index[i]) min_index[i] = tex_indices[i][j].z;
-		}
+static_assert(vertex_packing::compact_stride(false) == geometry_arena::vertex_stride,
+			  "the geometry arena vertex layout must match the compact vertex format");
+
+size_t a2estatic::pack_compact_vertices(vector<uint8_t>& vertex_data, const bool half_tex_coords) const {
+	const a2m_file::model_data& data = mesh->data;
+	const size_t stride = vertex_packing::compact_stride(half_tex_coords);
+	vertex_data.resize(data.vertex_count * stride);
+	for(unsigned int i = 0; i < data.vertex_count; i++) {
+		vertex_packing::pack_compact_vertex(&vertex_data[i * stride], data.vertices[i], data.normals[i], data.binormals[i],
+											data.tangents[i], data.tex_coords[i], half_tex_coords);
 	}
+	return stride;
+}
+
+void a2estatic::upload_compact_vertices(const bool create floor_unused) {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	const a2m_file::model_data& data = mesh->data;
+	vector<uint8_t> vertex_data;
 	
-	delete_sub_bboxes();
-	sub_bboxes.resize(object_count);
-	
-	object_names.clear();
-	object_names.resize(object_count);
-	for(unsigned int i = 0; i < object_count; i++) {
-		object_names[i] = "object #" + to_string(i);
+	// the arena always uses full precision tex coords
+	if(mesh->arena != nullptr) {
+		pack_compact_vertices(vertex_data, false);
+		mesh->arena->update_vertices(mesh->arena_alloc, vertex_data.data());
+		return;
 	}
 	
-	// set this stuff for normal generating
-	model_indices = indices;
-	model_index_count = index_count;
-	
-	generate_normals();
-	
-	// set the actual model data after everything is computed correctly and its final state
-	model_indices = indices;
-	model_index_count = index_count;
-	
-	model_vertices = new float3*[object_count];
-	model_vertex_count = new unsigned int[object_count];
-	for(unsigned int i = 0; i < object_count; i++) {
-		model_vertices[i] = &vertices[min_index[i]];
-		model_vertex_count[i] = (min_index[i] != 0xFFFFFFFF ? max_index[i] - min_index[i] + 1 : 0);
+	// half floats are precise enough for tex coords within [-4, 4] (max error: 2^-10)
+	bool half_tex_coords = true;
+	for(unsigned int i = 0; i < data.vertex_count; i++) {
+		if(fabsf(data.tex_coords[i].x) > vertex_packing::max_half_tex_coord ||
+		   fabsf(data.tex_coords[i].y) > vertex_packing::max_half_tex_coord) {
+			half_tex_coords = false;
+			break;
+		}
 	}
+	pack_compact_vertices(vertex_data, half_tex_coords);
 	
-	build_bounding_box();
-	
-	// vertices vbo
-	glGenBuffers(1, &vbo_vertices_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), vertices, GL_STATIC_DRAW);
-	
-	// tex_coords vbo
-	glGenBuffers(1, &vbo_tex_coords_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_tex_coords_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), tex_coords, GL_STATIC_DRAW);
-	
-	// normals/binormals/tangents vbo
-	glGenBuffers(1, &vbo_normals_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_normals_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), normals, GL_STATIC_DRAW);
-	
-	glGenBuffers(1, &vbo_binormals_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_binormals_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), binormals, GL_STATIC_DRAW);
-	
-	glGenBuffers(1, &vbo_tangents_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_tangents_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 3 * sizeof(float), tangents, GL_STATIC_DRAW);
-	
-	// indices vbos
-	vbo_indices_ids = new GLuint[object_count];
-	for(unsigned int i = 0; i < object_count; i++) {
-		glGenBuffers(1, &vbo_indices_ids[i]);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_indices_ids[i]);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count[i] * 3 * sizeof(unsigned int), indices[i], GL_STATIC_DRAW);
+	// the attribute format is part of the vao state -> rebuild them if it changed
+	const bool format_changed = (mesh->half_tex_coords != half_tex_coords);
+	mesh->half_tex_coords = half_tex_coords;
+	if(!create && format_changed) {
+		invalidate_vertex_arrays();
 	}
+	set_compact_draw_vertex_format();
 	
-	// reset buffer
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	
-	// general model setup
-	model_setup();
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_vertices_id);
+	if(create || format_changed) {
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertex_data.size(), vertex_data.data(), GL_STATIC_DRAW);
+	}
+	else {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)vertex_data.size(), vertex_data.data());
+	}
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+#endif
 }
 
-/*! reorganizes the model data, giving each texture coordinate an own vertex (generating more vertices so that
- *! we have an equal count of vertices and texture coordinates) and "merging" the indices so that we only have
- *! one index array (which is a requirement of opengl).
- */
-void a2estatic::reorganize_model_data() {
-	float3* old_vertices = vertices;
-	float3* old_normals = normals;
-	float3* old_binormals = binormals;
-	float3* old_tangents = tangents;
-	
-	vertex_count = tex_coord_count;
-	vertices = new float3[vertex_count];
-	normals = new float3[vertex_count];
-	binormals = new float3[vertex_count];
-	tangents = new float3[vertex_count];
+bool a2estatic::create_arena_buffers(geometry_arena* arena) {
+	if(arena == nullptr) return false;
+	const a2m_file::model_data& data = mesh->data;
 	
-	for(unsigned int i = 0; i < object_count; i++) {
-		for(unsigned int j = 0; j < index_count[i]; j++) {
-			vertices[tex_indices[i][j].x] = old_vertices[indices[i][j].x];
-			vertices[tex_indices[i][j].y] = old_vertices[indices[i][j].y];
-			vertices[tex_indices[i][j].z] = old_vertices[indices[i][j].z];
-			
-			normals[tex_indices[i][j].x] = old_normals[indices[i][j].x];
-			normals[tex_indices[i][j].y] = old_normals[indices[i][j].y];
-			normals[tex_indices[i][j].z] = old_normals[indices[i][j].z];
-			
-			binormals[tex_indices[i][j].x] = old_binormals[indices[i][j].x];
-			binormals[tex_indices[i][j].y] = old_binormals[indices[i][j].y];
-			binormals[tex_indices[i][j].z] = old_binormals[indices[i][j].z];
-			
-			tangents[tex_indices[i][j].x] = old_tangents[indices[i][j].x];
-			tangents[tex_indices[i][j].y] = old_tangents[indices[i][j].y];
-			tangents[tex_indices[i][j].z] = old_tangents[indices[i][j].z];
-			
-			// also get the max/highest and min/lowest index number
-			if(tex_indices[i][j].x > max_index[i]) max_index[i] = tex_indices[i][j].x;
-			if(tex_indices[i][j].y > max_index[i]) max_index[i] = tex_indices[i][j].y;
-			if(tex_indices[i][j].z > max_index[i]) max_index[i] = tex_indices[i][j].z;
-			if(tex_indices[i][j].x < min_index[i]) min_index[i] = tex_indices[i][j].x;
-			if(tex_indices[i][j].y < min_index[i]) min_index[i] = tex_indices[i][j].y;
-			if(tex_indices[i][j].z < min_index[i]) min_index[i] = tex_indices[i][j].z;
-		}
+	vector<uint8_t> vertex_data;
+	pack_compact_vertices(vertex_data, false);
+	
+	// all sub-objects are stored consecutively in one index range (indices relative to the first vertex of the mesh)
+	vector<uint32_t> indices;
+	mesh->arena_index_offsets.resize(data.object_count);
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		mesh->arena_index_offsets[i] = indices.size();
+		const uint32_t* sub_indices = (const uint32_t*)data.indices[i];
+		indices.insert(indices.end(), sub_indices, sub_indices + data.index_count[i] * 3);
 	}
 	
-	for(unsigned int i = 0; i < object_count; i++) {
-		delete [] indices[i];
+	mesh->arena_alloc = arena->allocate(vertex_data.data(), data.vertex_count, indices.data(), indices.size());
+	if(!mesh->arena_alloc.is_valid()) {
+		mesh->arena_index_offsets.clear();
+		return false;
 	}
-	delete [] indices;
-	indices = tex_indices;
+	mesh->arena = arena;
+	mesh->compact_vertex_format = true;
+	mesh->half_tex_coords = false;
+	mesh->index_types.assign(data.object_count, GL_UNSIGNED_INT);
+	mesh->base_vertices.assign(data.object_count, 0);
+	set_compact_draw_vertex_format();
+	arena_buffer_generation = arena->get_buffer_generation();
+	return true;
+}
+
+void a2estatic::set_compact_draw_vertex_format() {
+#if !defined(FLOOR_IOS) || defined(PLATFORM_X64)
+	const GLsizei gl_stride = (GLsizei)vertex_packing::compact_stride(mesh->half_tex_coords);
+	const GLenum tex_coord_type = (mesh->half_tex_coords ? GL_HALF_FLOAT : GL_FLOAT);
+	draw_vertex_format = {{
+		{ 3, GL_FLOAT, GL_FALSE, gl_stride, 0 },
+		{ 4, GL_INT_2_10_10_10_REV, GL_TRUE, gl_stride, vertex_packing::compact_normal_offset },
+		{ 2, tex_coord_type, GL_FALSE, gl_stride, vertex_packing::compact_tex_coord_offset },
+		{ 4, GL_INT_2_10_10_10_REV, GL_TRUE, gl_stride, vertex_packing::compact_binormal_offset },
+		{ 4, GL_INT_2_10_10_10_REV, GL_TRUE, gl_stride, vertex_packing::compact_tangent_offset },
+	}};
+#endif
 }
 
 /*! sets the "vertex scale" of the model (the model itself is scaled)
@@ -445,16 +550,21 @@ void a2estatic::reorganize_model_data() {
  *  @param z the z scale
  */
 void a2estatic::set_hard_scale(const float x, const float y, const float z) {
-	for(unsigned int i = 0; i < vertex_count; i++) {
-		vertices[i].x *= x;
-		vertices[i].y *= y;
-		vertices[i].z *= z;
+	make_mesh_unique();
+	a2m_file::model_data& data = mesh->data;
+	for(unsigned int i = 0; i < data.vertex_count; i++) {
+		data.vertices[i].x *= x;
+		data.vertices[i].y *= y;
+		data.vertices[i].z *= z;
 	}
 	
 	// reupload vertices stuff to vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices_id);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * 3 * sizeof(float), vertices);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if(compact_vertex_format) upload_compact_vertices(false);
+	else {
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_vertices_id);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, data.vertex_count * 3 * sizeof(float), data.vertices);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+	}
 	
 	if(collision_model) {
 		for(unsigned int i = 0; i < col_vertex_count; i++) {
@@ -464,21 +574,28 @@ void a2estatic::set_hard_scale(const float x, const float y, const float z) {
 		}
 	}
 	
-	// rebuild the bounding box
+	// rebuild the bounding box (the stored sub-object bounding boxes are no longer valid)
+	data.bbox_min.clear();
+	data.bbox_max.clear();
 	build_bounding_box();
 }
 
 void a2estatic::set_hard_position(const float x, const float y, const float z) {
-	for(unsigned int i = 0; i < vertex_count; i++) {
-		vertices[i].x += x;
-		vertices[i].y += y;
-		vertices[i].z += z;
+	make_mesh_unique();
+	a2m_file::model_data& data = mesh->data;
+	for(unsigned int i = 0; i < data.vertex_count; i++) {
+		data.vertices[i].x += x;
+		data.vertices[i].y += y;
+		data.vertices[i].z += z;
 	}
 	
 	// reupload vertices stuff to vbo
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices_id);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_count * 3 * sizeof(float), vertices);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	if(compact_vertex_format) upload_compact_vertices(false);
+	else {
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_vertices_id);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, data.vertex_count * 3 * sizeof(float), data.vertices);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+	}
 	
 	if(collision_model) {
 		for(unsigned int i = 0; i < col_vertex_count; i++) {
@@ -488,39 +605,19 @@ void a2estatic::set_hard_position(const float x, const float y, const float z) {
 		}
 	}
 	
-	// rebuild the bounding box
+	// rebuild the bounding box (the stored sub-object bounding boxes are no longer valid)
+	data.bbox_min.clear();
+	data.bbox_max.clear();
 	build_bounding_box();
 }
 
 /*! generates the normals, binormals and tangents of the model
  */
 void a2estatic::generate_normals() {
-	float3 normal, binormal, tangent;
-	for(unsigned int i = 0; i < object_count; i++) {
-		for(unsigned int j = 0; j < index_count[i]; j++) {
-			core::compute_normal_tangent_binormal(vertices[indices[i][j].x],
-												  vertices[indices[i][j].y],
-												  vertices[indices[i][j].z],
-												  normal, binormal, tangent,
-												  tex_coords[tex_indices[i][j].x],
-												  tex_coords[tex_indices[i][j].y],
-												  tex_coords[tex_indices[i][j].z]);
-			normals[indices[i][j].x] += normal;
-			normals[indices[i][j].y] += normal;
-			normals[indices[i][j].z] += normal;
-			binormals[indices[i][j].x] += binormal;
-			binormals[indices[i][j].y] += binormal;
-			binormals[indices[i][j].z] += binormal;
-			tangents[indices[i][j].x] += tangent;
-			tangents[indices[i][j].y] += tangent;
-			tangents[indices[i][j].z] += tangent;
-		}
-	}
-	for(unsigned int i = 0; i < vertex_count; i++) {
-		normals[i].normalize();
-		binormals[i].normalize();
-		tangents[i].normalize();
-	}
+	const a2m_file::model_data& data = mesh->data;
+	a2m_file::generate_normals(data.object_count, data.index_count, data.indices, data.indices,
+							   data.vertices, data.tex_coords, data.vertex_count,
+							   data.normals, data.binormals, data.tangents);
 }
 
 /*! scales the texture coordinates by (su, sv) - note that this is a "hard scale" and the vbo is updated automatically
@@ -528,17 +625,28 @@ void a2estatic::generate_normals() {
  *  @param sv the sv scale factor
  */
 void a2estatic::scale_tex_coords(const float su, const float sv) {
-	for(unsigned int i = 0; i < vertex_count; i++) {
-		tex_coords[i].x *= su;
-		tex_coords[i].y *= sv;
+	make_mesh_unique();
+	a2m_file::model_data& data = mesh->data;
+	for(unsigned int i = 0; i < data.vertex_count; i++) {
+		data.tex_coords[i].x *= su;
+		data.tex_coords[i].y *= sv;
+	}
+	
+	if(compact_vertex_format) {
+		// (the tex coord format might change, in which case the vaos are rebuilt)
+		upload_compact_vertices(false);
+		return;
 	}
 	
 	// delete old vertex coordinates
-	if(glIsBuffer(vbo_tex_coords_id)) { glDeleteBuffers(1, &vbo_tex_coords_id); }
+	if(glIsBuffer(mesh->vbo_tex_coords_id)) { gl_state::delete_buffers(1, &mesh->vbo_tex_coords_id); }
 	// create new buffer
-	glGenBuffers(1, &vbo_tex_coords_id);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_tex_coords_id);
-	glBufferData(GL_ARRAY_BUFFER, vertex_count * 2 * sizeof(float), tex_coords, GL_STATIC_DRAW);
+	glGenBuffers(1, &mesh->vbo_tex_coords_id);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, mesh->vbo_tex_coords_id);
+	glBufferData(GL_ARRAY_BUFFER, data.vertex_count * 2 * sizeof(float), data.tex_coords, GL_STATIC_DRAW);
+	
+	// the vaos still reference the old buffer
+	invalidate_vertex_arrays();
 }
 
 /*! returns a pointer to the models collision model vertices
@@ -31,15 +31,25 @@
 #include <floor/math/matrix4.hpp>
 #include "scene/light.hpp"
 #include "scene/model/a2emodel.hpp"
+#include "scene/model/static_mesh.hpp"
 
 //! class for loading and displaying an a2e static model
 class a2estatic : public a2emodel {
 public:
 	a2estatic(shader* s, scene* sce);
 	virtual ~a2estatic();
-
-	virtual void draw(const DRAW_MODE draw_mode);
+	
+	virtual void draw(const render_view& view, const DRAW_MODE draw_mode);
+	virtual bool supports_render_queue() const;
+	virtual void get_render_state(const DRAW_MODE draw_mode, const size_t& sub_object,
+								  uint32_t& shader_id, uint32_t& material_id, uint32_t& mesh_id) const;
+	virtual bool get_multi_draw_command(const DRAW_MODE draw_mode, const size_t& sub_object,
+										size_t& first_index, size_t& index_count,
+										geometry_arena::allocation& alloc) const;
+	//! NOTE: models that are loaded from the same file (or the same data) with the same load options share their
+	//! geometry and gl buffers (see mesh_cache), the set_hard_* functions and scale_tex_coords first create an own copy
 	virtual void load_model(const string& filename);
+	//! NOTE: this takes ownership of all passed arrays (they are deleted right away if the data is already cached)
 	void load_from_memory(unsigned int object_count, unsigned int vertex_count,
 						  float3* vertices, float2* tex_coords,
 						  unsigned int* index_count, uint3** indices);
@@ -47,50 +57,86 @@ public:
 	virtual void set_hard_scale(const float x, const float y, const float z);
 	virtual void set_hard_position(const float x, const float y, const float z);
 	virtual void scale_tex_coords(const float su, const float sv);
-
+	
+	//! if enabled, all vertex data is stored in a single interleaved buffer with packed normals/binormals/tangents
+	//! (10:10:10:2 snorm), half float tex coords (if they are within [-4, 4]) and 16-bit indices (if possible)
+	//! NOTE: must be set before the model is loaded, not supported with opengl es 2.0
+	void set_compact_vertex_format(const bool state);
+	bool get_compact_vertex_format() const;
+	
+	//! if enabled (default), the mesh is optimized when it is loaded: duplicate vertices are removed, the triangles are
+	//! reordered for vertex cache locality (and optionally for reduced overdraw) and the vertices for fetch locality
+	//! NOTE: must be set before the model is loaded, this changes the vertex order and count of the model data
+	void set_mesh_optimization(const bool state, const bool reduce_overdraw = true);
+	bool get_mesh_optimization() const;
+	
+	//! if enabled, the geometry is stored in the engine geometry arena instead of own buffers, which allows drawing
+	//! it together with other models in a single multi-draw call (this also enables the compact vertex format,
+	//! but always with full precision tex coords and 32-bit indices)
+	//! NOTE: must be set before the model is loaded, not supported with opengl es
+	void set_use_geometry_arena(const bool state);
+	bool get_use_geometry_arena() const;
+	
 	float3* get_col_vertices();
 	uint3* get_col_indices();
 	unsigned int get_col_vertex_count();
 	unsigned int get_col_index_count();
-
+	
 	//
-	GLuint get_vbo_vertices() const { return vbo_vertices_id; }
-	GLuint get_vbo_tex_coords() const { return vbo_tex_coords_id; }
-	GLuint get_vbo_indices(const size_t& sub_object) const { return vbo_indices_ids[sub_object]; }
-	GLuint get_vbo_normals() const { return vbo_normals_id; }
-	GLuint get_vbo_binormals() const { return vbo_binormals_id; }
-	GLuint get_vbo_tangents() const { return vbo_tangents_id; }
+	//! NOTE: with the compact vertex format, this is the interleaved buffer and all other vertex buffers are 0,
+	//!       if the mesh is stored in the geometry arena, all of these are 0
+	GLuint get_vbo_vertices() const { return mesh->vbo_vertices_id; }
+	GLuint get_vbo_tex_coords() const { return mesh->vbo_tex_coords_id; }
+	GLuint get_vbo_indices(const size_t& sub_object) const { return mesh->vbo_indices_ids[sub_object]; }
+	GLuint get_vbo_normals() const { return mesh->vbo_normals_id; }
+	GLuint get_vbo_binormals() const { return mesh->vbo_binormals_id; }
+	GLuint get_vbo_tangents() const { return mesh->vbo_tangents_id; }
 
 protected:
-	float3* vertices;
-	float2* tex_coords;
-	uint3** indices;
-	uint3** tex_indices;
-	unsigned int vertex_count;
-	unsigned int tex_coord_count;
-	unsigned int* index_count;
-	unsigned int* min_index;
-	unsigned int* max_index;
-	GLuint vbo_vertices_id;
-	GLuint vbo_tex_coords_id;
-	GLuint* vbo_indices_ids;
-	GLuint vbo_normals_id;
-	GLuint vbo_binormals_id;
-	GLuint vbo_tangents_id;
-
-	float3* normals;
-	float3* binormals;
-	float3* tangents;
-
-	// normal stuff
-	void reorganize_model_data();
-
+	// shared geometry (model data + gl buffers)
+	shared_ptr<static_mesh> mesh;
+	
+	mesh_cache::load_options get_load_options() const;
+	//! sets up this model for the (newly loaded or cached) mesh: model data pointers, bounding boxes, model setup
+	void init_from_mesh();
+	//! points all a2emodel model data pointers to the data of the current mesh
+	void bind_mesh();
+	//! copy-on-write: must be called before the mesh data is modified (see mesh_cache::make_unique)
+	void make_mesh_unique();
+	
+	// compact vertex format
+	bool compact_vertex_format = false;
+	
+	// geometry arena
+	bool use_geometry_arena = false;
+	size_t arena_buffer_generation = 0;
+	//! stores the mesh in the geometry arena, returns false if this failed (-> own buffers must be created)
+	bool create_arena_buffers(geometry_arena* arena);
+	
+	// load-time mesh optimization
+	bool mesh_optimization = true;
+	bool mesh_overdraw_optimization = true;
+	
+	//! runs the mesh optimizer on the model data (see a2m_file::optimize)
+	void optimize_mesh();
+	
+	//! creates all vertex and index buffers of the mesh (after the model data was loaded)
+	void create_buffers();
+	//! packs the model data into the interleaved compact vertex format, returns the vertex stride
+	size_t pack_compact_vertices(vector<uint8_t>& vertex_data, const bool half_tex_coords) const;
+	//! packs and (re)uploads the interleaved vertex buffer of the compact vertex format
+	void upload_compact_vertices(const bool create);
+	//! sets the draw vertex format of the compact vertex format (depends on the tex coord format of the mesh)
+	void set_compact_draw_vertex_format();
+	
 	// used for parallax mapping
 	void generate_normals();
 	
 	virtual void pre_draw_setup(const ssize_t sub_object_num = -1);
 	virtual void post_draw_setup(const ssize_t sub_object_num = -1);
-	
+	//! sets the draw_* index buffer state of the sub-object
+	void set_sub_object_buffers(const size_t& sub_object_num);
+
 };
 
 #endif
@@ -0,0 +1,824 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "a2m_file.hpp"
+#include "scene/model/mesh_optimizer.hpp"
+#include "engine.hpp"
+#include <thread>
+
+#if !defined(__WINDOWS__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// version 3 file layout (little endian, all blocks are 16-byte aligned and tightly packed):
+// header | sub-objects | object names (0-terminated) | vertices | tex coords | normals | binormals | tangents |
+// indices (of all sub-objects, in sub-object order) | collision vertices | collision indices
+enum class A2M_V3_BLOCK : uint32_t {
+	OBJECTS,
+	NAMES,
+	VERTICES,
+	TEX_COORDS,
+	NORMALS,
+	BINORMALS,
+	TANGENTS,
+	INDICES,
+	COL_VERTICES,
+	COL_INDICES,
+	__MAX_A2M_V3_BLOCK
+};
+static constexpr size_t a2m_v3_block_count = (size_t)A2M_V3_BLOCK::__MAX_A2M_V3_BLOCK;
+
+struct a2m_v3_header {
+	char magic[8]; // "A2EMODEL"
+	uint32_t version; // 3
+	uint32_t type; // 0x00 or 0x02
+	uint32_t flags; // bit 0: mesh is optimized
+	uint32_t vertex_count;
+	uint32_t object_count;
+	uint32_t triangle_count; // of all sub-objects
+	uint32_t col_vertex_count;
+	uint32_t col_triangle_count;
+	uint32_t names_size; // in bytes
+	uint32_t _unused;
+	uint64_t file_size;
+	uint64_t offsets[a2m_v3_block_count];
+};
+
+struct a2m_v3_object {
+	uint32_t triangle_count;
+	uint32_t first_triangle;
+	uint32_t min_index;
+	uint32_t max_index;
+	float bbox_min[3];
+	float bbox_max[3];
+};
+
+static constexpr uint32_t a2m_v3_flag_optimized = 1u;
+static_assert(sizeof(float3) == 12 && sizeof(float2) == 8 && sizeof(uint3) == 12,
+			  "vector types must be tightly packed for the a2m v3 format");
+
+static array<uint64_t, a2m_v3_block_count> a2m_v3_block_sizes(const a2m_v3_header& header) {
+	return {{
+		uint64_t(header.object_count) * sizeof(a2m_v3_object),
+		uint64_t(header.names_size),
+		uint64_t(header.vertex_count) * sizeof(float3),
+		uint64_t(header.vertex_count) * sizeof(float2),
+		uint64_t(header.vertex_count) * sizeof(float3),
+		uint64_t(header.vertex_count) * sizeof(float3),
+		uint64_t(header.vertex_count) * sizeof(float3),
+		uint64_t(header.triangle_count) * sizeof(uint3),
+		uint64_t(header.col_vertex_count) * sizeof(float3),
+		uint64_t(header.col_triangle_count) * sizeof(uint3),
+	}};
+}
+
+static uint64_t a2m_v3_align(const uint64_t& offset) {
+	return (offset + 15u) & ~uint64_t(15u);
+}
+
+//! read-only view of a whole file (memory-mapped if possible, otherwise the file is read into memory)
+class a2m_mapped_file {
+public:
+	a2m_mapped_file(const string& filename) {
+#if !defined(__WINDOWS__)
+		const int fd = ::open(filename.c_str(), O_RDONLY);
+		if(fd < 0) return;
+		struct stat info;
+		if(fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapping != MAP_FAILED) {
+				data = (const uint8_t*)mapping;
+				size = (size_t)info.st_size;
+			}
+		}
+		// the mapping stays valid after the file was closed
+		::close(fd);
+#else
+		file_io file(filename, file_io::OPEN_TYPE::READ_BINARY);
+		if(!file.is_open()) return;
+		buffer.resize((size_t)file.get_filesize());
+		file.get_block((char*)buffer.data(), buffer.size());
+		file.close();
+		data = buffer.data();
+		size = buffer.size();
+#endif
+	}
+	~a2m_mapped_file() {
+#if !defined(__WINDOWS__)
+		if(data != nullptr) munmap((void*)data, size);
+#endif
+	}
+	a2m_mapped_file(const a2m_mapped_file&) = delete;
+	a2m_mapped_file& operator=(const a2m_mapped_file&) = delete;
+	
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+
+protected:
+#if defined(__WINDOWS__)
+	vector<uint8_t> buffer;
+#endif
+};
+
+void a2m_file::model_data::clear() {
+	if(indices != nullptr) {
+		for(unsigned int i = 0; i < object_count; i++) {
+			delete [] indices[i];
+		}
+		delete [] indices;
+	}
+	delete [] vertices;
+	delete [] tex_coords;
+	delete [] normals;
+	delete [] binormals;
+	delete [] tangents;
+	delete [] index_count;
+	delete [] min_index;
+	delete [] max_index;
+	delete [] col_vertices;
+	delete [] col_indices;
+	*this = model_data();
+}
+
+bool a2m_file::load(const string& filename, model_data& data) {
+	file_io file(filename, file_io::OPEN_TYPE::READ_BINARY);
+	if(!file.is_open()) {
+		return false;
+	}
+	
+	// get type and name
+	char file_type[9];
+	file.get_block(file_type, 8);
+	file_type[8] = 0;
+	if(strcmp(file_type, "A2EMODEL") != 0) {
+		log_error("non supported file type for %s: %s!", filename, file_type);
+		file.close();
+		return false;
+	}
+	
+	// get model version
+	const unsigned int version = file.get_uint();
+	if(version == 2) {
+		return load_v2(file, filename, data);
+	}
+	file.close();
+	if(version == A2M_VERSION) {
+		return load_v3(filename, data);
+	}
+	log_error("wrong model file version %u - should be 2 or %u!", version, A2M_VERSION);
+	return false;
+}
+
+bool a2m_file::load_v2(file_io& file, const string& filename floor_unused, model_data& data) {
+	// get model type and abort if it's not 0x00 or 0x02
+	auto mtype = file.get_char();
+	if(mtype != 0x00 && mtype != 0x02) {
+		log_error("non supported model type: %u!", (unsigned int)(mtype & 0xFF));
+		file.close();
+		return false;
+	}
+	data.type = (uint32_t)mtype;
+	
+	const unsigned int vertex_count = file.get_uint();
+	const unsigned int tex_coord_count = file.get_uint();
+	float3* vertices = new float3[vertex_count];
+	float2* tex_coords = new float2[tex_coord_count];
+	for(unsigned int i = 0; i < vertex_count; i++) {
+		vertices[i].x = file.get_float();
+		vertices[i].y = file.get_float();
+		vertices[i].z = file.get_float();
+	}
+	for(unsigned int i = 0; i < tex_coord_count; i++) {
+		tex_coords[i].x = file.get_float();
+		tex_coords[i].y = 1.0f - file.get_float();
+	}
+	
+	const unsigned int object_count = file.get_uint();
+	data.object_count = object_count;
+	data.object_names.clear();
+	data.object_names.resize(object_count);
+	for(unsigned int i = 0; i < object_count; i++) {
+		file.get_terminated_block(data.object_names[i], 0xFF);
+	}
+	
+	uint3** indices = new uint3*[object_count];
+	uint3** tex_indices = new uint3*[object_count];
+	unsigned int* index_count = new unsigned int[object_count];
+	unsigned int* min_index = new unsigned int[object_count];
+	unsigned int* max_index = new unsigned int[object_count];
+	memset(min_index, 0xFF, sizeof(unsigned int)*object_count);
+	memset(max_index, 0, sizeof(unsigned int)*object_count);
+	for(unsigned int i = 0; i < object_count; i++) {
+		index_count[i] = file.get_uint();
+		indices[i] = new uint3[index_count[i]];
+		tex_indices[i] = new uint3[index_count[i]];
+		for(unsigned int j = 0; j < index_count[i]; j++) {
+			indices[i][j].x = file.get_uint();
+			indices[i][j].y = file.get_uint();
+			indices[i][j].z = file.get_uint();
+		}
+		for(unsigned int j = 0; j < index_count[i]; j++) {
+			tex_indices[i][j].x = file.get_uint();
+			tex_indices[i][j].y = file.get_uint();
+			tex_indices[i][j].z = file.get_uint();
+		}
+	}
+	
+	if(data.type == 0x02) {
+		data.col_vertex_count = file.get_uint();
+		data.col_vertices = new float3[data.col_vertex_count];
+		for(unsigned int i = 0; i < data.col_vertex_count; i++) {
+			data.col_vertices[i].x = file.get_float();
+			data.col_vertices[i].y = file.get_float();
+			data.col_vertices[i].z = file.get_float();
+		}
+		
+		data.col_index_count = file.get_uint();
+		data.col_indices = new uint3[data.col_index_count];
+		for(unsigned int i = 0; i < data.col_index_count; i++) {
+			data.col_indices[i].x = file.get_uint();
+			data.col_indices[i].y = file.get_uint();
+			data.col_indices[i].z = file.get_uint();
+		}
+	}
+	
+	file.close();
+	
+	// normals/binormals/tangents are computed per vertex position
+	float3* normals = new float3[vertex_count];
+	float3* binormals = new float3[vertex_count];
+	float3* tangents = new float3[vertex_count];
+	generate_normals(object_count, index_count, indices, tex_indices, vertices, tex_coords, vertex_count,
+					 normals, binormals, tangents);
+	
+	// reorganize the model data, giving each texture coordinate an own vertex (generating more vertices so that
+	// we have an equal count of vertices and texture coordinates) and "merging" the indices so that we only have
+	// one index array (which is a requirement of opengl)
+	data.vertex_count = tex_coord_count;
+	data.vertices = new float3[tex_coord_count];
+	data.normals = new float3[tex_coord_count];
+	data.binormals = new float3[tex_coord_count];
+	data.tangents = new float3[tex_coord_count];
+	data.tex_coords = tex_coords;
+	for(unsigned int i = 0; i < object_count; i++) {
+		for(unsigned int j = 0; j < index_count[i]; j++) {
+			for(size_t k = 0; k < 3; k++) {
+				const unsigned int& idx = tex_indices[i][j][k];
+				const unsigned int& vertex_idx = indices[i][j][k];
+				data.vertices[idx] = vertices[vertex_idx];
+				data.normals[idx] = normals[vertex_idx];
+				data.binormals[idx] = binormals[vertex_idx];
+				data.tangents[idx] = tangents[vertex_idx];
+				
+				// also get the max/highest and min/lowest index number
+				if(idx > max_index[i]) max_index[i] = idx;
+				if(idx < min_index[i]) min_index[i] = idx;
+			}
+		}
+	}
+	
+	delete [] vertices;
+	delete [] normals;
+	delete [] binormals;
+	delete [] tangents;
+	for(unsigned int i = 0; i < object_count; i++) {
+		delete [] indices[i];
+	}
+	delete [] indices;
+	
+	data.indices = tex_indices;
+	data.index_count = index_count;
+	data.min_index = min_index;
+	data.max_index = max_index;
+	data.optimized = false;
+	return true;
+}
+
+bool a2m_file::load_v3(const string& filename, model_data& data) {
+	const a2m_mapped_file file(filename);
+	if(file.data == nullptr) {
+		log_error("failed to map model file %s!", filename);
+		return false;
+	}
+	
+	// validate the header and all block ranges
+	a2m_v3_header header;
+	if(file.size < sizeof(a2m_v3_header)) {
+		log_error("invalid model file %s: file is too small!", filename);
+		return false;
+	}
+	memcpy(&header, file.data, sizeof(a2m_v3_header));
+	if(header.file_size != file.size || (header.type != 0x00 && header.type != 0x02)) {
+		log_error("invalid model file %s: invalid header!", filename);
+		return false;
+	}
+	const auto block_sizes = a2m_v3_block_sizes(header);
+	for(size_t i = 0; i < a2m_v3_block_count; i++) {
+		if((header.offsets[i] & 15u) != 0 || block_sizes[i] > file.size || header.offsets[i] > file.size - block_sizes[i]) {
+			log_error("invalid model file %s: invalid block #%u!", filename, (uint32_t)i);
+			return false;
+		}
+	}
+	const auto block = [&file, &header](const A2M_V3_BLOCK& type) {
+		return file.data + header.offsets[(size_t)type];
+	};
+	
+	// sub-objects and names
+	vector<a2m_v3_object> objects(header.object_count);
+	memcpy(objects.data(), block(A2M_V3_BLOCK::OBJECTS), objects.size() * sizeof(a2m_v3_object));
+	const uint3* indices = (const uint3*)block(A2M_V3_BLOCK::INDICES);
+	for(const auto& obj : objects) {
+		if(obj.first_triangle > header.triangle_count || obj.triangle_count > header.triangle_count - obj.first_triangle ||
+		   (obj.triangle_count > 0 && (obj.min_index > obj.max_index || obj.max_index >= header.vertex_count))) {
+			log_error("invalid model file %s: invalid sub-object!", filename);
+			return false;
+		}
+		
+		// every index must be inside the index range of its sub-object (which is inside the vertex range, see above)
+		for(uint32_t tri = obj.first_triangle; tri < obj.first_triangle + obj.triangle_count; tri++) {
+			for(const auto& index : { indices[tri].x, indices[tri].y, indices[tri].z }) {
+				if(index < obj.min_index || index > obj.max_index) {
+					log_error("invalid model file %s: invalid index %u in triangle #%u!", filename, index, tri);
+					return false;
+				}
+			}
+		}
+	}
+	if(header.type == 0x02) {
+		const uint3* col_indices = (const uint3*)block(A2M_V3_BLOCK::COL_INDICES);
+		for(uint32_t tri = 0; tri < header.col_triangle_count; tri++) {
+			for(const auto& index : { col_indices[tri].x, col_indices[tri].y, col_indices[tri].z }) {
+				if(index >= header.col_vertex_count) {
+					log_error("invalid model file %s: invalid collision index %u in triangle #%u!", filename, index, tri);
+					return false;
+				}
+			}
+		}
+	}
+	if(header.names_size == 0 || block(A2M_V3_BLOCK::NAMES)[header.names_size - 1] != 0) {
+		log_error("invalid model file %s: invalid object names!", filename);
+		return false;
+	}
+	data.object_names.clear();
+	data.object_names.reserve(header.object_count);
+	const char* names = (const char*)block(A2M_V3_BLOCK::NAMES);
+	for(size_t i = 0, offset = 0; i < header.object_count; i++) {
+		if(offset >= header.names_size) {
+			log_error("invalid model file %s: invalid object names!", filename);
+			return false;
+		}
+		data.object_names.emplace_back(names + offset);
+		offset += data.object_names.back().size() + 1;
+	}
+	
+	// everything is valid -> copy all blocks
+	data.type = header.type;
+	data.optimized = ((header.flags & a2m_v3_flag_optimized) != 0);
+	data.vertex_count = header.vertex_count;
+	data.vertices = new float3[header.vertex_count];
+	data.tex_coords = new float2[header.vertex_count];
+	data.normals = new float3[header.vertex_count];
+	data.binormals = new float3[header.vertex_count];
+	data.tangents = new float3[header.vertex_count];
+	memcpy(data.vertices, block(A2M_V3_BLOCK::VERTICES), header.vertex_count * sizeof(float3));
+	memcpy(data.tex_coords, block(A2M_V3_BLOCK::TEX_COORDS), header.vertex_count * sizeof(float2));
+	memcpy(data.normals, block(A2M_V3_BLOCK::NORMALS), header.vertex_count * sizeof(float3));
+	memcpy(data.binormals, block(A2M_V3_BLOCK::BINORMALS), header.vertex_count * sizeof(float3));
+	memcpy(data.tangents, block(A2M_V3_BLOCK::TANGENTS), header.vertex_count * sizeof(float3));
+	
+	data.object_count = header.object_count;
+	data.indices = new uint3*[header.object_count];
+	data.index_count = new unsigned int[header.object_count];
+	data.min_index = new unsigned int[header.object_count];
+	data.max_index = new unsigned int[header.object_count];
+	data.bbox_min.resize(header.object_count);
+	data.bbox_max.resize(header.object_count);
+	for(uint32_t i = 0; i < header.object_count; i++) {
+		const auto& obj = objects[i];
+		data.index_count[i] = obj.triangle_count;
+		data.min_index[i] = obj.min_index;
+		data.max_index[i] = obj.max_index;
+		data.indices[i] = new uint3[obj.triangle_count];
+		memcpy(data.indices[i], indices + obj.first_triangle, obj.triangle_count * sizeof(uint3));
+		data.bbox_min[i].set(obj.bbox_min[0], obj.bbox_min[1], obj.bbox_min[2]);
+		data.bbox_max[i].set(obj.bbox_max[0], obj.bbox_max[1], obj.bbox_max[2]);
+	}
+	
+	if(header.type == 0x02) {
+		data.col_vertex_count = header.col_vertex_count;
+		data.col_index_count = header.col_triangle_count;
+		data.col_vertices = new float3[header.col_vertex_count];
+		data.col_indices = new uint3[header.col_triangle_count];
+		memcpy(data.col_vertices, block(A2M_V3_BLOCK::COL_VERTICES), header.col_vertex_count * sizeof(float3));
+		memcpy(data.col_indices, block(A2M_V3_BLOCK::COL_INDICES), header.col_triangle_count * sizeof(uint3));
+	}
+	return true;
+}
+
+bool a2m_file::save(const string& filename, const model_data& data) {
+	a2m_v3_header header;
+	memset(&header, 0, sizeof(a2m_v3_header));
+	memcpy(header.magic, "A2EMODEL", 8);
+	header.version = A2M_VERSION;
+	header.type = data.type;
+	header.flags = (data.optimized ? a2m_v3_flag_optimized : 0u);
+	header.vertex_count = data.vertex_count;
+	header.object_count = data.object_count;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		header.triangle_count += data.index_count[i];
+		header.names_size += (uint32_t)data.object_names[i].size() + 1u;
+	}
+	if(header.names_size == 0) header.names_size = 1; // always contains at least one 0
+	if(data.type == 0x02) {
+		header.col_vertex_count = data.col_vertex_count;
+		header.col_triangle_count = data.col_index_count;
+	}
+	
+	const auto block_sizes = a2m_v3_block_sizes(header);
+	uint64_t offset = a2m_v3_align(sizeof(a2m_v3_header));
+	for(size_t i = 0; i < a2m_v3_block_count; i++) {
+		header.offsets[i] = offset;
+		offset = a2m_v3_align(offset + block_sizes[i]);
+	}
+	header.file_size = offset;
+	
+	vector<uint8_t> buffer((size_t)header.file_size, 0);
+	const auto block = [&buffer, &header](const A2M_V3_BLOCK& type) {
+		return buffer.data() + header.offsets[(size_t)type];
+	};
+	memcpy(buffer.data(), &header, sizeof(a2m_v3_header));
+	
+	// sub-objects (with their bounding boxes) + names
+	a2m_v3_object* objects = (a2m_v3_object*)block(A2M_V3_BLOCK::OBJECTS);
+	char* names = (char*)block(A2M_V3_BLOCK::NAMES);
+	uint3* indices = (uint3*)block(A2M_V3_BLOCK::INDICES);
+	uint32_t first_triangle = 0;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		a2m_v3_object& obj = objects[i];
+		obj.triangle_count = data.index_count[i];
+		obj.first_triangle = first_triangle;
+		obj.min_index = data.min_index[i];
+		obj.max_index = data.max_index[i];
+		memcpy(indices + first_triangle, data.indices[i], data.index_count[i] * sizeof(uint3));
+		first_triangle += data.index_count[i];
+		
+		// same as a2emodel::build_bounding_box: bounds of the sub-object vertex range
+		float3 bmin, bmax;
+		if(data.vertex_count > 0 && obj.min_index < data.vertex_count) {
+			bmin = data.vertices[obj.min_index];
+			bmax = data.vertices[obj.min_index];
+			for(unsigned int j = obj.min_index; j <= obj.max_index && j < data.vertex_count; j++) {
+				bmin.min(data.vertices[j]);
+				bmax.max(data.vertices[j]);
+			}
+		}
+		memcpy(obj.bbox_min, &bmin, sizeof(float3));
+		memcpy(obj.bbox_max, &bmax, sizeof(float3));
+		
+		memcpy(names, data.object_names[i].c_str(), data.object_names[i].size() + 1);
+		names += data.object_names[i].size() + 1;
+	}
+	
+	// vertex data
+	memcpy(block(A2M_V3_BLOCK::VERTICES), data.vertices, data.vertex_count * sizeof(float3));
+	memcpy(block(A2M_V3_BLOCK::TEX_COORDS), data.tex_coords, data.vertex_count * sizeof(float2));
+	memcpy(block(A2M_V3_BLOCK::NORMALS), data.normals, data.vertex_count * sizeof(float3));
+	memcpy(block(A2M_V3_BLOCK::BINORMALS), data.binormals, data.vertex_count * sizeof(float3));
+	memcpy(block(A2M_V3_BLOCK::TANGENTS), data.tangents, data.vertex_count * sizeof(float3));
+	if(data.type == 0x02) {
+		memcpy(block(A2M_V3_BLOCK::COL_VERTICES), data.col_vertices, data.col_vertex_count * sizeof(float3));
+		memcpy(block(A2M_V3_BLOCK::COL_INDICES), data.col_indices, data.col_index_count * sizeof(uint3));
+	}
+	
+	file_io file(filename, file_io::OPEN_TYPE::WRITE_BINARY);
+	if(!file.is_open()) {
+		log_error("failed to open %s for writing!", filename);
+		return false;
+	}
+	file.write_block((const char*)buffer.data(), buffer.size());
+	file.close();
+	return true;
+}
+
+// triangles are processed in blocks: the per-triangle math runs on a struct of arrays, so that it can be vectorized
+static constexpr size_t normals_block_size = 64;
+// don't start a worker for less than this many triangles
+static constexpr size_t min_triangles_per_normals_worker = 16384;
+// upper limit for the additional per-worker accumulation buffers
+static constexpr size_t max_normals_worker_memory = 256u * 1024u * 1024u;
+
+struct normals_block {
+	// input: edges v2 - v1, v3 - v1 and tex coord deltas
+	float e1[3][normals_block_size];
+	float e2[3][normals_block_size];
+	float du1[normals_block_size], dv1[normals_block_size];
+	float du2[normals_block_size], dv2[normals_block_size];
+	// output
+	float n[3][normals_block_size];
+	float b[3][normals_block_size];
+	float t[3][normals_block_size];
+};
+
+// same math as core::compute_normal_tangent_binormal (except for degenerate triangles, which contribute nothing here)
+static void compute_normals_block(normals_block& blk, const size_t count) {
+	for(size_t i = 0; i < count; i++) {
+		const float e1x = blk.e1[0][i], e1y = blk.e1[1][i], e1z = blk.e1[2][i];
+		const float e2x = blk.e2[0][i], e2y = blk.e2[1][i], e2z = blk.e2[2][i];
+		
+		// normal = e1 x e2
+		float nx = e1y * e2z - e1z * e2y;
+		float ny = e1z * e2x - e1x * e2z;
+		float nz = e1x * e2y - e1y * e2x;
+		// binormal = e1 * du2 - e2 * du1
+		float bx = e1x * blk.du2[i] - e2x * blk.du1[i];
+		float by = e1y * blk.du2[i] - e2y * blk.du1[i];
+		float bz = e1z * blk.du2[i] - e2z * blk.du1[i];
+		// tangent = e1 * dv2 - e2 * dv1
+		float tx = e1x * blk.dv2[i] - e2x * blk.dv1[i];
+		float ty = e1y * blk.dv2[i] - e2y * blk.dv1[i];
+		float tz = e1z * blk.dv2[i] - e2z * blk.dv1[i];
+		
+		const float n_len = nx * nx + ny * ny + nz * nz;
+		const float b_len = bx * bx + by * by + bz * bz;
+		const float t_len = tx * tx + ty * ty + tz * tz;
+		const float n_scale = (n_len > 0.0f ? 1.0f / sqrtf(n_len) : 0.0f);
+		const float b_scale = (b_len > 0.0f ? 1.0f / sqrtf(b_len) : 0.0f);
+		const float t_scale = (t_len > 0.0f ? 1.0f / sqrtf(t_len) : 0.0f);
+		nx *= n_scale; ny *= n_scale; nz *= n_scale;
+		bx *= b_scale; by *= b_scale; bz *= b_scale;
+		tx *= t_scale; ty *= t_scale; tz *= t_scale;
+		
+		// flip the tangent if n . (t x b) > 0, otherwise flip the binormal
+		const float txb_x = ty * bz - tz * by;
+		const float txb_y = tz * bx - tx * bz;
+		const float txb_z = tx * by - ty * bx;
+		const float t_sign = (nx * txb_x + ny * txb_y + nz * txb_z > 0.0f ? -1.0f : 1.0f);
+		const float b_sign = -t_sign;
+		
+		blk.n[0][i] = nx;
+		blk.n[1][i] = ny;
+		blk.n[2][i] = nz;
+		blk.b[0][i] = bx * b_sign;
+		blk.b[1][i] = by * b_sign;
+		blk.b[2][i] = bz * b_sign;
+		blk.t[0][i] = tx * t_sign;
+		blk.t[1][i] = ty * t_sign;
+		blk.t[2][i] = tz * t_sign;
+	}
+}
+
+// accumulates the normals/binormals/tangents of the triangles [first_triangle, last_triangle) (over all sub-objects)
+static void accumulate_normals(const size_t first_triangle, const size_t last_triangle,
+							   const unsigned int object_count, const unsigned int* index_count,
+							   const uint3* const* indices, const uint3* const* tex_indices,
+							   const float3* vertices, const float2* tex_coords,
+							   float3* normals, float3* binormals, float3* tangents) {
+	unique_ptr<normals_block> blk_ptr(new normals_block());
+	normals_block& blk = *blk_ptr;
+	const uint3* blk_indices[normals_block_size];
+	
+	size_t object_first = 0;
+	for(unsigned int obj = 0; obj < object_count; obj++) {
+		const size_t object_last = object_first + index_count[obj];
+		const size_t begin = std::max(first_triangle, object_first);
+		const size_t end = std::min(last_triangle, object_last);
+		
+		for(size_t blk_begin = begin; blk_begin < end; blk_begin += normals_block_size) {
+			const size_t count = std::min(normals_block_size, end - blk_begin);
+			const uint3* tris = indices[obj] + (blk_begin - object_first);
+			const uint3* tex_tris = tex_indices[obj] + (blk_begin - object_first);
+			
+			// gather
+			for(size_t i = 0; i < count; i++) {
+				const float3& v1 = vertices[tris[i].x];
+				const float3& v2 = vertices[tris[i].y];
+				const float3& v3 = vertices[tris[i].z];
+				const float2& t1 = tex_coords[tex_tris[i].x];
+				const float2& t2 = tex_coords[tex_tris[i].y];
+				const float2& t3 = tex_coords[tex_tris[i].z];
+				for(size_t k = 0; k < 3; k++) {
+					blk.e1[k][i] = v2[k] - v1[k];
+					blk.e2[k][i] = v3[k] - v1[k];
+				}
+				blk.du1[i] = t2.x - t1.x;
+				blk.dv1[i] = t2.y - t1.y;
+				blk.du2[i] = t3.x - t1.x;
+				blk.dv2[i] = t3.y - t1.y;
+				blk_indices[i] = &tris[i];
+			}
+			
+			compute_normals_block(blk, count);
+			
+			// scatter
+			for(size_t i = 0; i < count; i++) {
+				const float3 normal(blk.n[0][i], blk.n[1][i], blk.n[2][i]);
+				const float3 binormal(blk.b[0][i], blk.b[1][i], blk.b[2][i]);
+				const float3 tangent(blk.t[0][i], blk.t[1][i], blk.t[2][i]);
+				for(size_t k = 0; k < 3; k++) {
+					const unsigned int idx = (*blk_indices[i])[k];
+					normals[idx] += normal;
+					binormals[idx] += binormal;
+					tangents[idx] += tangent;
+				}
+			}
+		}
+		object_first = object_last;
+	}
+}
+
+void a2m_file::generate_normals(const unsigned int object_count, const unsigned int* index_count,
+								const uint3* const* indices, const uint3* const* tex_indices,
+								const float3* vertices, const float2* tex_coords, const unsigned int vertex_count,
+								float3* normals, float3* binormals, float3* tangents,
+								const size_t worker_count) {
+	size_t triangle_count = 0;
+	for(unsigned int i = 0; i < object_count; i++) {
+		triangle_count += index_count[i];
+	}
+	
+	// split the triangles among all workers: the first worker accumulates directly into the output arrays,
+	// all others into their own buffers, which are then summed up (also multi-threaded, over vertex ranges)
+	size_t thread_count = (worker_count != 0 ? worker_count : std::max(1u, thread::hardware_concurrency()));
+	thread_count = std::min(thread_count, std::max(size_t(1), triangle_count / min_triangles_per_normals_worker));
+	if(vertex_count > 0) {
+		thread_count = std::min(thread_count, 1 + max_normals_worker_memory / (size_t(vertex_count) * sizeof(float3) * 3));
+	}
+	
+	if(thread_count == 1) {
+		accumulate_normals(0, triangle_count, object_count, index_count, indices, tex_indices, vertices, tex_coords,
+						   normals, binormals, tangents);
+		for(unsigned int i = 0; i < vertex_count; i++) {
+			normals[i].normalize();
+			binormals[i].normalize();
+			tangents[i].normalize();
+		}
+		return;
+	}
+	
+	vector<vector<float3>> worker_buffers(thread_count - 1);
+	const size_t triangles_per_worker = (triangle_count + thread_count - 1) / thread_count;
+	const auto accumulate_worker = [&](const size_t worker) {
+		float3* worker_normals = normals;
+		float3* worker_binormals = binormals;
+		float3* worker_tangents = tangents;
+		if(worker > 0) {
+			auto& buffer = worker_buffers[worker - 1];
+			buffer.resize(size_t(vertex_count) * 3);
+			worker_normals = &buffer[0];
+			worker_binormals = &buffer[vertex_count];
+			worker_tangents = &buffer[size_t(vertex_count) * 2];
+		}
+		const size_t first_triangle = std::min(triangle_count, worker * triangles_per_worker);
+		const size_t last_triangle = std::min(triangle_count, first_triangle + triangles_per_worker);
+		accumulate_normals(first_triangle, last_triangle, object_count, index_count, indices, tex_indices,
+						   vertices, tex_coords, worker_normals, worker_binormals, worker_tangents);
+	};
+	
+	const size_t vertices_per_worker = (vertex_count + thread_count - 1) / thread_count;
+	const auto reduce_worker = [&](const size_t worker) {
+		const size_t first_vertex = std::min(size_t(vertex_count), worker * vertices_per_worker);
+		const size_t last_vertex = std::min(size_t(vertex_count), first_vertex + vertices_per_worker);
+		for(const auto& buffer : worker_buffers) {
+			for(size_t i = first_vertex; i < last_vertex; i++) {
+				normals[i] += buffer[i];
+				binormals[i] += buffer[vertex_count + i];
+				tangents[i] += buffer[size_t(vertex_count) * 2 + i];
+			}
+		}
+		for(size_t i = first_vertex; i < last_vertex; i++) {
+			normals[i].normalize();
+			binormals[i].normalize();
+			tangents[i].normalize();
+		}
+	};
+	
+	for(const auto& work : { function<void(size_t)>(accumulate_worker), function<void(size_t)>(reduce_worker) }) {
+		vector<thread> threads;
+		threads.reserve(thread_count - 1);
+		for(size_t i = 1; i < thread_count; i++) {
+			threads.emplace_back(work, i);
+		}
+		work(0);
+		for(auto& th : threads) {
+			th.join();
+		}
+	}
+}
+
+void a2m_file::optimize(model_data& data, const bool reduce_overdraw, const string& name) {
+	if(data.vertex_count == 0) return;
+	
+	size_t triangle_count = 0;
+	float misses_before = 0.0f, misses_after = 0.0f;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		misses_before += mesh_optimizer::compute_acmr(data.indices[i], data.index_count[i], data.vertex_count) * float(data.index_count[i]);
+		triangle_count += data.index_count[i];
+	}
+	
+	// only vertices with the exact same data are merged
+	const auto canonical = mesh_optimizer::find_duplicate_vertices(data.vertex_count, {
+		{ data.vertices, sizeof(float3) },
+		{ data.tex_coords, sizeof(float2) },
+		{ data.normals, sizeof(float3) },
+		{ data.binormals, sizeof(float3) },
+		{ data.tangents, sizeof(float3) },
+	});
+	
+	// each sub-object gets its own contiguous vertex range (vertices that are shared between sub-objects are duplicated),
+	// vertices that aren't referenced at all are removed
+	vector<uint32_t> vertex_map; // new vertex -> old vertex
+	vertex_map.reserve(data.vertex_count);
+	vector<uint32_t> local_vertices;
+	vector<float3> local_positions;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		uint3* tris = data.indices[i];
+		const size_t tri_count = data.index_count[i];
+		for(size_t j = 0; j < tri_count; j++) {
+			tris[j].set(canonical[tris[j].x], canonical[tris[j].y], canonical[tris[j].z]);
+		}
+		
+		// sub-object local vertex indices
+		size_t local_count = 0;
+		const auto local_remap = mesh_optimizer::optimize_vertex_fetch(tris, tri_count, data.vertex_count, local_count);
+		local_vertices.resize(local_count);
+		for(size_t j = 0; j < data.vertex_count; j++) {
+			if(local_remap[j] != ~0u) local_vertices[local_remap[j]] = (uint32_t)j;
+		}
+		
+		mesh_optimizer::optimize_vertex_cache(tris, tri_count, local_count);
+		if(reduce_overdraw) {
+			local_positions.resize(local_count);
+			for(size_t j = 0; j < local_count; j++) {
+				local_positions[j] = data.vertices[local_vertices[j]];
+			}
+			mesh_optimizer::optimize_overdraw(tris, tri_count, local_positions.data(), local_count);
+		}
+		size_t fetch_count = 0;
+		const auto fetch_remap = mesh_optimizer::optimize_vertex_fetch(tris, tri_count, local_count, fetch_count);
+		misses_after += mesh_optimizer::compute_acmr(tris, tri_count, fetch_count) * float(tri_count);
+		
+		// -> global indices
+		const uint32_t base_index = (uint32_t)vertex_map.size();
+		vertex_map.resize(base_index + fetch_count);
+		for(size_t j = 0; j < local_count; j++) {
+			vertex_map[base_index + fetch_remap[j]] = local_vertices[j];
+		}
+		for(size_t j = 0; j < tri_count; j++) {
+			tris[j].x += base_index;
+			tris[j].y += base_index;
+			tris[j].z += base_index;
+		}
+		data.min_index[i] = (fetch_count > 0 ? base_index : 0);
+		data.max_index[i] = (fetch_count > 0 ? base_index + (uint32_t)fetch_count - 1 : 0);
+	}
+	
+	// reorder/copy the vertex data
+	const unsigned int new_vertex_count = (unsigned int)vertex_map.size();
+	float3* new_vertices = new float3[new_vertex_count];
+	float2* new_tex_coords = new float2[new_vertex_count];
+	float3* new_normals = new float3[new_vertex_count];
+	float3* new_binormals = new float3[new_vertex_count];
+	float3* new_tangents = new float3[new_vertex_count];
+	for(unsigned int i = 0; i < new_vertex_count; i++) {
+		new_vertices[i] = data.vertices[vertex_map[i]];
+		new_tex_coords[i] = data.tex_coords[vertex_map[i]];
+		new_normals[i] = data.normals[vertex_map[i]];
+		new_binormals[i] = data.binormals[vertex_map[i]];
+		new_tangents[i] = data.tangents[vertex_map[i]];
+	}
+	delete [] data.vertices;
+	delete [] data.tex_coords;
+	delete [] data.normals;
+	delete [] data.binormals;
+	delete [] data.tangents;
+	data.vertices = new_vertices;
+	data.tex_coords = new_tex_coords;
+	data.normals = new_normals;
+	data.binormals = new_binormals;
+	data.tangents = new_tangents;
+	
+	log_debug("%s: optimized mesh: %u -> %u vertices, acmr %f -> %f", name, data.vertex_count, new_vertex_count,
+			  (triangle_count > 0 ? misses_before / float(triangle_count) : 0.0f),
+			  (triangle_count > 0 ? misses_after / float(triangle_count) : 0.0f));
+	data.vertex_count = new_vertex_count;
+	data.optimized = true;
+	// the bounding boxes don't change (same vertices per sub-object)
+}
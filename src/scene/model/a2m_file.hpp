@@ -0,0 +1,93 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_A2M_FILE_HPP__
+#define __A2E_A2M_FILE_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+#include <floor/core/file_io.hpp>
+
+//! cpu side loading/writing of .a2m static model files (no gl dependencies, this is also used by the a2m_converter)
+//! version 2: plain stream of floats/uints, normals/binormals/tangents are generated and the data is reorganized on load
+//! version 3: aligned blocks of the final vertex/index data + bounding boxes, the file is memory-mapped on load
+class a2m_file {
+public:
+	a2m_file() = delete;
+	~a2m_file() = delete;
+	
+	//! model data in its final state (one vertex per vertex/tex coord combination, one index array per sub-object)
+	//! NOTE: all arrays are allocated with new[] and ownership is passed on to whoever takes them (e.g. static_mesh)
+	struct model_data {
+		uint32_t type = 0; // 0x00: static model, 0x02: static model + collision model
+		bool optimized = false; // true if the mesh optimizer already ran (see optimize())
+		
+		unsigned int vertex_count = 0;
+		float3* vertices = nullptr;
+		float2* tex_coords = nullptr;
+		float3* normals = nullptr;
+		float3* binormals = nullptr;
+		float3* tangents = nullptr;
+		
+		unsigned int object_count = 0;
+		vector<string> object_names;
+		uint3** indices = nullptr;
+		unsigned int* index_count = nullptr; // triangle count of each sub-object
+		unsigned int* min_index = nullptr;
+		unsigned int* max_index = nullptr;
+		// sub-object bounding boxes (only stored in version 3 files, empty otherwise)
+		vector<float3> bbox_min;
+		vector<float3> bbox_max;
+		
+		unsigned int col_vertex_count = 0;
+		float3* col_vertices = nullptr;
+		unsigned int col_index_count = 0;
+		uint3* col_indices = nullptr;
+		
+		//! deletes all arrays (only use this if the ownership wasn't passed on)
+		void clear();
+	};
+	
+	//! loads a version 2 or 3 .a2m file
+	static bool load(const string& filename, model_data& data);
+	//! writes the model data as a version 3 .a2m file
+	static bool save(const string& filename, const model_data& data);
+	
+	//! runs the mesh optimizer on the model data: removes duplicate vertices, reorders the triangles for vertex cache
+	//! locality (and optionally for reduced overdraw) and the vertices for fetch locality. each sub-object gets its own
+	//! contiguous vertex range (min_index/max_index), vertices that aren't referenced at all are removed
+	static void optimize(model_data& data, const bool reduce_overdraw, const string& name);
+	
+	//! accumulates the per-triangle normals, binormals and tangents of all sub-objects at their vertices and normalizes them,
+	//! "indices" reference "vertices", "tex_indices" reference "tex_coords" and the output arrays must be zero-initialized.
+	//! large models are processed by multiple threads (worker_count: 0 = use all available hardware threads, 1 = only use
+	//! the calling thread), note that the summation order (and thereby the result) differs slightly with the worker count
+	static void generate_normals(const unsigned int object_count, const unsigned int* index_count,
+								 const uint3* const* indices, const uint3* const* tex_indices,
+								 const float3* vertices, const float2* tex_coords, const unsigned int vertex_count,
+								 float3* normals, float3* binormals, float3* tangents,
+								 const size_t worker_count = 0);
+
+protected:
+	static bool load_v2(file_io& file, const string& filename, model_data& data);
+	static bool load_v3(const string& filename, model_data& data);
+
+};
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "mesh_optimizer.hpp"
+
+constexpr size_t mesh_optimizer::max_cache_size;
+
+float mesh_optimizer::compute_acmr(const uint3* indices, const size_t triangle_count, const size_t vertex_count,
+								   const size_t cache_size) {
+	if(triangle_count == 0) return 0.0f;
+	vector<uint32_t> timestamps(vertex_count, 0);
+	uint32_t time = (uint32_t)cache_size + 1;
+	size_t misses = 0;
+	for(size_t i = 0; i < triangle_count; i++) {
+		misses += simulate_fifo(indices[i], timestamps, time, cache_size);
+	}
+	return float(misses) / float(triangle_count);
+}
+
+uint32_t mesh_optimizer::simulate_fifo(const uint3& tri, vector<uint32_t>& timestamps, uint32_t& time, const size_t cache_size) {
+	// a vertex is in the cache if less than "cache_size" vertices were added since it was added itself
+	uint32_t misses = 0;
+	for(size_t i = 0; i < 3; i++) {
+		const uint32_t& idx = tri[i];
+		if(time - timestamps[idx] > cache_size) {
+			timestamps[idx] = time++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+vector<uint32_t> mesh_optimizer::find_duplicate_vertices(const size_t vertex_count, const vector<vertex_stream>& streams) {
+	const auto hash_vertex = [&streams](const size_t& idx) {
+		// fnv-1a over all attribute bytes
+		uint64_t hash = 14695981039346656037ull;
+		for(const auto& stream : streams) {
+			const uint8_t* data = (const uint8_t*)stream.data + idx * stream.size;
+			for(size_t i = 0; i < stream.size; i++) {
+				hash = (hash ^ data[i]) * 1099511628211ull;
+			}
+		}
+		return hash;
+	};
+	const auto equal_vertices = [&streams](const size_t& idx_0, const size_t& idx_1) {
+		for(const auto& stream : streams) {
+			if(memcmp((const uint8_t*)stream.data + idx_0 * stream.size,
+					  (const uint8_t*)stream.data + idx_1 * stream.size, stream.size) != 0) {
+				return false;
+			}
+		}
+		return true;
+	};
+	
+	// open addressing hash table of vertex indices (at most half full)
+	size_t table_size = 1;
+	while(table_size < vertex_count * 2) table_size <<= 1;
+	const size_t table_mask = table_size - 1;
+	vector<uint32_t> table(table_size, ~0u);
+	
+	vector<uint32_t> canonical(vertex_count);
+	for(size_t i = 0; i < vertex_count; i++) {
+		size_t slot = (size_t)hash_vertex(i) & table_mask;
+		for(;;) {
+			if(table[slot] == ~0u) {
+				table[slot] = (uint32_t)i;
+				canonical[i] = (uint32_t)i;
+				break;
+			}
+			if(equal_vertices(table[slot], i)) {
+				canonical[i] = table[slot];
+				break;
+			}
+			slot = (slot + 1) & table_mask;
+		}
+	}
+	return canonical;
+}
+
+float mesh_optimizer::vertex_score(const int32_t cache_position, const uint32_t remaining_valence) {
+	// no triangles left that use this vertex
+	if(remaining_valence == 0) return -1.0f;
+	
+	float score = 0.0f;
+	if(cache_position >= 0) {
+		// the vertices of the last triangle get a fixed score, so that the next triangle doesn't just reuse an edge of it
+		if(cache_position < 3) score = 0.75f;
+		else {
+			score = powf(1.0f - float(cache_position - 3) / float(max_cache_size - 3), 1.5f);
+		}
+	}
+	// prefer vertices with few remaining triangles (gets rid of lone triangles)
+	score += 2.0f / sqrtf(float(remaining_valence));
+	return score;
+}
+
+void mesh_optimizer::optimize_vertex_cache(uint3* indices, const size_t triangle_count, const size_t vertex_count) {
+	if(triangle_count == 0) return;
+	
+	// vertex -> triangles adjacency (the first "valence[v]" entries of each vertex are the not yet emitted triangles)
+	vector<uint32_t> valence(vertex_count, 0);
+	for(size_t i = 0; i < triangle_count; i++) {
+		for(size_t j = 0; j < 3; j++) valence[indices[i][j]]++;
+	}
+	vector<uint32_t> offsets(vertex_count + 1, 0);
+	for(size_t i = 0; i < vertex_count; i++) {
+		offsets[i + 1] = offsets[i] + valence[i];
+	}
+	vector<uint32_t> adjacency(triangle_count * 3);
+	{
+		vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for(size_t i = 0; i < triangle_count; i++) {
+			for(size_t j = 0; j < 3; j++) adjacency[fill[indices[i][j]]++] = (uint32_t)i;
+		}
+	}
+	
+	// initial scores
+	vector<int32_t> cache_position(vertex_count, -1);
+	vector<float> vertex_scores(vertex_count);
+	for(size_t i = 0; i < vertex_count; i++) {
+		vertex_scores[i] = vertex_score(-1, valence[i]);
+	}
+	vector<float> triangle_scores(triangle_count);
+	size_t best_triangle = 0;
+	for(size_t i = 0; i < triangle_count; i++) {
+		triangle_scores[i] = (vertex_scores[indices[i].x] + vertex_scores[indices[i].y] + vertex_scores[indices[i].z]);
+		if(triangle_scores[i] > triangle_scores[best_triangle]) best_triangle = i;
+	}
+	
+	vector<uint8_t> emitted(triangle_count, 0);
+	vector<uint3> output;
+	output.reserve(triangle_count);
+	array<uint32_t, max_cache_size + 3> cache, new_cache;
+	size_t cache_count = 0;
+	size_t input_cursor = 0;
+	
+	while(output.size() < triangle_count) {
+		if(best_triangle == ~size_t(0)) {
+			// dead end: continue with the next triangle in input order
+			while(emitted[input_cursor] != 0) input_cursor++;
+			best_triangle = input_cursor;
+		}
+		
+		// emit the triangle and remove it from the adjacency of its vertices
+		const uint3 tri = indices[best_triangle];
+		output.push_back(tri);
+		emitted[best_triangle] = 1;
+		for(size_t i = 0; i < 3; i++) {
+			const uint32_t& vertex = tri[i];
+			uint32_t* adj = &adjacency[offsets[vertex]];
+			for(uint32_t j = 0; j < valence[vertex]; j++) {
+				if(adj[j] == best_triangle) {
+					adj[j] = adj[valence[vertex] - 1];
+					valence[vertex]--;
+					break;
+				}
+			}
+		}
+		
+		// lru cache update: triangle vertices go to the front
+		size_t new_cache_count = 0;
+		for(size_t i = 0; i < 3; i++) {
+			bool contained = false;
+			for(size_t j = 0; j < new_cache_count; j++) {
+				if(new_cache[j] == tri[i]) contained = true;
+			}
+			if(!contained) new_cache[new_cache_count++] = tri[i];
+		}
+		for(size_t i = 0; i < cache_count; i++) {
+			const uint32_t& vertex = cache[i];
+			if(vertex != tri.x && vertex != tri.y && vertex != tri.z) new_cache[new_cache_count++] = vertex;
+		}
+		
+		// update the scores of all vertices that were or are in the cache (and the scores of their triangles)
+		best_triangle = ~size_t(0);
+		float best_score = -1.0f;
+		for(size_t i = 0; i < new_cache_count; i++) {
+			const uint32_t& vertex = new_cache[i];
+			cache_position[vertex] = (i < max_cache_size ? (int32_t)i : -1);
+			const float score = vertex_score(cache_position[vertex], valence[vertex]);
+			const float score_diff = score - vertex_scores[vertex];
+			vertex_scores[vertex] = score;
+			
+			const uint32_t* adj = &adjacency[offsets[vertex]];
+			for(uint32_t j = 0; j < valence[vertex]; j++) {
+				const uint32_t& triangle = adj[j];
+				triangle_scores[triangle] += score_diff;
+				if(i < max_cache_size && triangle_scores[triangle] > best_score) {
+					best_score = triangle_scores[triangle];
+					best_triangle = triangle;
+				}
+			}
+		}
+		cache_count = min(new_cache_count, max_cache_size);
+		copy(new_cache.begin(), new_cache.begin() + (ssize_t)cache_count, cache.begin());
+	}
+	
+	copy(output.begin(), output.end(), indices);
+}
+
+void mesh_optimizer::optimize_overdraw(uint3* indices, const size_t triangle_count, const float3* positions, const size_t vertex_count,
+									   const float threshold) {
+	if(triangle_count == 0) return;
+	static constexpr size_t cache_size = 16;
+	vector<uint32_t> timestamps(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	
+	// hard boundaries: triangles where all vertices miss the cache (a new "strip" starts)
+	vector<size_t> hard_clusters;
+	for(size_t i = 0; i < triangle_count; i++) {
+		if(simulate_fifo(indices[i], timestamps, time, cache_size) == 3 || i == 0) {
+			hard_clusters.push_back(i);
+		}
+	}
+	hard_clusters.push_back(triangle_count);
+	
+	// soft boundaries: split each hard cluster as soon as the acmr of the current part is within "threshold" of the
+	// acmr of the whole hard cluster (the cache is flushed at each boundary, so this only degrades the acmr by "threshold")
+	vector<size_t> clusters;
+	for(size_t i = 0, count = hard_clusters.size() - 1; i < count; i++) {
+		const size_t start = hard_clusters[i], end = hard_clusters[i + 1];
+		
+		time += cache_size + 1;
+		size_t cluster_misses = 0;
+		for(size_t j = start; j < end; j++) {
+			cluster_misses += simulate_fifo(indices[j], timestamps, time, cache_size);
+		}
+		const float cluster_threshold = threshold * float(cluster_misses) / float(end - start);
+		
+		clusters.push_back(start);
+		time += cache_size + 1;
+		size_t running_misses = 0, running_triangles = 0;
+		for(size_t j = start; j < end; j++) {
+			running_misses += simulate_fifo(indices[j], timestamps, time, cache_size);
+			running_triangles++;
+			if(float(running_misses) / float(running_triangles) <= cluster_threshold) {
+				clusters.push_back(j + 1);
+				time += cache_size + 1;
+				running_misses = 0;
+				running_triangles = 0;
+			}
+		}
+		
+		// the last part either is empty or didn't reach the target acmr -> merge it with the previous one
+		if(clusters.back() != start) clusters.pop_back();
+	}
+	clusters.push_back(triangle_count);
+	
+	// mesh centroid
+	float3 mesh_centroid;
+	for(size_t i = 0; i < triangle_count; i++) {
+		mesh_centroid += positions[indices[i].x] + positions[indices[i].y] + positions[indices[i].z];
+	}
+	mesh_centroid /= float(triangle_count * 3);
+	
+	// sort key: how much the cluster is facing outward (clusters facing away from the mesh center are drawn first)
+	// NOTE: this is the area weighted average over the triangles of the cluster instead of the dot product of the cluster
+	//       centroid and the average cluster normal, which cancels out for large curved clusters (e.g. half a sphere)
+	const size_t cluster_count = clusters.size() - 1;
+	vector<pair<float, size_t>> cluster_keys(cluster_count);
+	for(size_t i = 0; i < cluster_count; i++) {
+		float outwardness = 0.0f, area_sum = 0.0f;
+		for(size_t j = clusters[i]; j < clusters[i + 1]; j++) {
+			const float3& p0 = positions[indices[j].x];
+			const float3& p1 = positions[indices[j].y];
+			const float3& p2 = positions[indices[j].z];
+			const float3 area_normal = (p1 - p0).crossed(p2 - p0);
+			outwardness += ((p0 + p1 + p2) / 3.0f - mesh_centroid).dot(area_normal);
+			area_sum += area_normal.length();
+		}
+		cluster_keys[i] = make_pair(area_sum > 0.0f ? -outwardness / area_sum : 0.0f, i);
+	}
+	stable_sort(cluster_keys.begin(), cluster_keys.end(), [](const pair<float, size_t>& lhs, const pair<float, size_t>& rhs) {
+		return lhs.first < rhs.first;
+	});
+	
+	vector<uint3> output;
+	output.reserve(triangle_count);
+	for(const auto& key : cluster_keys) {
+		output.insert(output.end(), indices + clusters[key.second], indices + clusters[key.second + 1]);
+	}
+	copy(output.begin(), output.end(), indices);
+}
+
+vector<uint32_t> mesh_optimizer::optimize_vertex_fetch(uint3* indices, const size_t triangle_count, const size_t vertex_count,
+													   size_t& used_vertex_count) {
+	vector<uint32_t> remap(vertex_count, ~0u);
+	uint32_t next_index = 0;
+	for(size_t i = 0; i < triangle_count; i++) {
+		for(size_t j = 0; j < 3; j++) {
+			uint32_t& idx = indices[i][j];
+			if(remap[idx] == ~0u) remap[idx] = next_index++;
+			idx = remap[idx];
+		}
+	}
+	used_vertex_count = next_index;
+	return remap;
+}
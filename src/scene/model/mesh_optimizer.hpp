@@ -0,0 +1,69 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_MESH_OPTIMIZER_HPP__
+#define __A2E_MESH_OPTIMIZER_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+
+//! load-time triangle mesh optimizations (cpu only and deterministic: the same input always results in the same output)
+//! all functions work on indexed triangle lists that reference vertices in [0, vertex_count)
+class mesh_optimizer {
+public:
+	mesh_optimizer() = delete;
+	~mesh_optimizer() = delete;
+	
+	//! average cache miss ratio (transformed vertices per triangle) when drawing the triangles with a fifo post-transform cache,
+	//! 0.5 is the optimum for large regular meshes, 3.0 the worst case
+	static float compute_acmr(const uint3* indices, const size_t triangle_count, const size_t vertex_count,
+							  const size_t cache_size = 16);
+	
+	//! a vertex attribute array: element i is stored at data + i * size
+	struct vertex_stream {
+		const void* data;
+		size_t size;
+	};
+	//! returns the index of the first vertex with the exact same attribute data (over all streams) for each vertex
+	static vector<uint32_t> find_duplicate_vertices(const size_t vertex_count, const vector<vertex_stream>& streams);
+	
+	//! reorders the triangles for post-transform vertex cache locality (tom forsyth: "linear-speed vertex cache optimisation")
+	static void optimize_vertex_cache(uint3* indices, const size_t triangle_count, const size_t vertex_count);
+	
+	//! reorders clusters of triangles, so that outward facing clusters are drawn first (sander et al.: "fast triangle reordering
+	//! for vertex locality and reduced overdraw"). the triangles must already be in vertex cache order, "threshold" specifies
+	//! how much the acmr may degrade in exchange for smaller clusters (1.0: none)
+	static void optimize_overdraw(uint3* indices, const size_t triangle_count, const float3* positions, const size_t vertex_count,
+								  const float threshold = 1.05f);
+	
+	//! renumbers the vertices in the order in which they are first referenced by the triangles (updates the indices),
+	//! returns the new index of each vertex (~0u if a vertex is unreferenced) and sets "used_vertex_count"
+	static vector<uint32_t> optimize_vertex_fetch(uint3* indices, const size_t triangle_count, const size_t vertex_count,
+												  size_t& used_vertex_count);
+
+protected:
+	static constexpr size_t max_cache_size = 32;
+	static float vertex_score(const int32_t cache_position, const uint32_t remaining_valence);
+	
+	//! cache simulation used for cluster generation: returns the cache misses of the triangle
+	static uint32_t simulate_fifo(const uint3& tri, vector<uint32_t>& timestamps, uint32_t& time, const size_t cache_size);
+
+};
+
+#endif
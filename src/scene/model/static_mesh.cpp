@@ -0,0 +1,222 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "static_mesh.hpp"
+#include "engine.hpp"
+#include <cstdlib>
+#include <cstring>
+
+unordered_map<string, weak_ptr<static_mesh>> mesh_cache::meshes;
+
+static_mesh::~static_mesh() {
+	if(!cache_key.empty()) {
+		mesh_cache::remove(cache_key);
+	}
+	delete_buffers();
+	data.clear();
+}
+
+void static_mesh::delete_buffers() {
+	for(GLuint* vbo : { &vbo_vertices_id, &vbo_tex_coords_id, &vbo_normals_id, &vbo_binormals_id, &vbo_tangents_id }) {
+		if(*vbo != 0 && glIsBuffer(*vbo)) { gl_state::delete_buffers(1, vbo); }
+		*vbo = 0;
+	}
+	if(!vbo_indices_ids.empty() && glIsBuffer(vbo_indices_ids[0])) {
+		gl_state::delete_buffers((GLsizei)vbo_indices_ids.size(), vbo_indices_ids.data());
+	}
+	vbo_indices_ids.clear();
+	index_types.clear();
+	base_vertices.clear();
+	
+	if(arena != nullptr) {
+		arena->free(arena_alloc);
+		arena = nullptr;
+	}
+	arena_index_offsets.clear();
+}
+
+static string load_options_suffix(const mesh_cache::load_options& options) {
+	string suffix = "#";
+	suffix += (options.compact_vertex_format ? 'c' : '-');
+	suffix += (options.mesh_optimization ? 'o' : '-');
+	suffix += (options.mesh_optimization && options.reduce_overdraw ? 'r' : '-');
+	suffix += (options.use_geometry_arena ? 'a' : '-');
+	return suffix;
+}
+
+string mesh_cache::file_key(const string& filename, const load_options& options) {
+	// the same file might be referenced via different (relative) paths
+	string path = filename;
+#if !defined(__WINDOWS__)
+	char* canonical_path = realpath(filename.c_str(), nullptr);
+	if(canonical_path != nullptr) {
+		path = canonical_path;
+		free(canonical_path);
+	}
+#else
+	char canonical_path[_MAX_PATH];
+	if(_fullpath(canonical_path, filename.c_str(), _MAX_PATH) != nullptr) {
+		path = canonical_path;
+	}
+#endif
+	return "file:" + path + load_options_suffix(options);
+}
+
+// 64-bit fnv-1a
+static void hash_data(uint64_t& hash, const void* data, const size_t size) {
+	const uint8_t* bytes = (const uint8_t*)data;
+	for(size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+}
+
+vector<uint8_t> mesh_cache::memory_data(const unsigned int object_count, const unsigned int vertex_count,
+									   const float3* vertices, const float2* tex_coords,
+									   const unsigned int* index_count, const uint3* const* indices) {
+	size_t size = vertex_count * (sizeof(float3) + sizeof(float2)) + object_count * sizeof(unsigned int);
+	for(unsigned int i = 0; i < object_count; i++) {
+		size += index_count[i] * sizeof(uint3);
+	}
+	
+	vector<uint8_t> data(size);
+	uint8_t* dst = data.data();
+	const auto append = [&dst](const void* src, const size_t src_size) {
+		if(src_size == 0) return;
+		memcpy(dst, src, src_size);
+		dst += src_size;
+	};
+	append(vertices, vertex_count * sizeof(float3));
+	append(tex_coords, vertex_count * sizeof(float2));
+	append(index_count, object_count * sizeof(unsigned int));
+	for(unsigned int i = 0; i < object_count; i++) {
+		append(indices[i], index_count[i] * sizeof(uint3));
+	}
+	return data;
+}
+
+string mesh_cache::memory_key(const unsigned int object_count, const unsigned int vertex_count,
+							  const vector<uint8_t>& data, const load_options& options) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash_data(hash, data.data(), data.size());
+	// also include the sizes, so that a hash collision would additionally require the exact same amount of data
+	return ("memory:" + to_string(object_count) + ":" + to_string(vertex_count) + ":" + to_string(hash) +
+			load_options_suffix(options));
+}
+
+shared_ptr<static_mesh> mesh_cache::get(const string& key) {
+	const auto iter = meshes.find(key);
+	if(iter == meshes.end()) return nullptr;
+	return iter->second.lock();
+}
+
+shared_ptr<static_mesh> mesh_cache::get(const string& key, const vector<uint8_t>& data) {
+	auto mesh = get(key);
+	if(mesh == nullptr) return nullptr;
+	// compares the sizes (-> vertex/index counts) first, then the bytes
+	if(mesh->source_data != data) return nullptr;
+	return mesh;
+}
+
+void mesh_cache::add(const string& key, const shared_ptr<static_mesh>& mesh) {
+	const auto iter = meshes.find(key);
+	if(iter != meshes.end()) {
+		const auto prev_mesh = iter->second.lock();
+		if(prev_mesh != nullptr) prev_mesh->cache_key = "";
+	}
+	meshes[key] = mesh;
+	mesh->cache_key = key;
+}
+
+void mesh_cache::remove(const string& key) {
+	// only remove the entry if it doesn't already reference a different mesh
+	const auto iter = meshes.find(key);
+	if(iter != meshes.end() && iter->second.expired()) {
+		meshes.erase(iter);
+	}
+}
+
+bool mesh_cache::make_unique(shared_ptr<static_mesh>& mesh) {
+	if(mesh.use_count() == 1) {
+		// only used by the caller -> can be modified in place, but must no longer be found in the cache
+		if(!mesh->cache_key.empty()) {
+			meshes.erase(mesh->cache_key);
+			mesh->cache_key = "";
+		}
+		mesh->source_data.clear();
+		return false;
+	}
+	
+	// copy the model data
+	const a2m_file::model_data& src = mesh->data;
+	auto copy = make_shared<static_mesh>();
+	a2m_file::model_data& dst = copy->data;
+	dst.type = src.type;
+	dst.optimized = src.optimized;
+	
+	dst.vertex_count = src.vertex_count;
+	dst.vertices = new float3[src.vertex_count];
+	dst.tex_coords = new float2[src.vertex_count];
+	dst.normals = new float3[src.vertex_count];
+	dst.binormals = new float3[src.vertex_count];
+	dst.tangents = new float3[src.vertex_count];
+	copy_n(src.vertices, src.vertex_count, dst.vertices);
+	copy_n(src.tex_coords, src.vertex_count, dst.tex_coords);
+	copy_n(src.normals, src.vertex_count, dst.normals);
+	copy_n(src.binormals, src.vertex_count, dst.binormals);
+	copy_n(src.tangents, src.vertex_count, dst.tangents);
+	
+	dst.object_count = src.object_count;
+	dst.object_names = src.object_names;
+	dst.indices = new uint3*[src.object_count];
+	dst.index_count = new unsigned int[src.object_count];
+	dst.min_index = new unsigned int[src.object_count];
+	dst.max_index = new unsigned int[src.object_count];
+	copy_n(src.index_count, src.object_count, dst.index_count);
+	copy_n(src.min_index, src.object_count, dst.min_index);
+	copy_n(src.max_index, src.object_count, dst.max_index);
+	for(unsigned int i = 0; i < src.object_count; i++) {
+		dst.indices[i] = new uint3[src.index_count[i]];
+		copy_n(src.indices[i], src.index_count[i], dst.indices[i]);
+	}
+	dst.bbox_min = src.bbox_min;
+	dst.bbox_max = src.bbox_max;
+	
+	if(src.col_vertices != nullptr) {
+		dst.col_vertex_count = src.col_vertex_count;
+		dst.col_vertices = new float3[src.col_vertex_count];
+		copy_n(src.col_vertices, src.col_vertex_count, dst.col_vertices);
+	}
+	if(src.col_indices != nullptr) {
+		dst.col_index_count = src.col_index_count;
+		dst.col_indices = new uint3[src.col_index_count];
+		copy_n(src.col_indices, src.col_index_count, dst.col_indices);
+	}
+	
+	copy->compact_vertex_format = mesh->compact_vertex_format;
+	mesh = copy;
+	return true;
+}
+
+size_t mesh_cache::get_mesh_count() {
+	size_t count = 0;
+	for(const auto& entry : meshes) {
+		if(!entry.second.expired()) count++;
+	}
+	return count;
+}
@@ -0,0 +1,116 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_STATIC_MESH_HPP__
+#define __A2E_STATIC_MESH_HPP__
+
+#include "global.hpp"
+#include "scene/model/a2m_file.hpp"
+#include "rendering/geometry_arena.hpp"
+
+//! the geometry of an a2estatic model (model data in its final state + the gl buffers created from it),
+//! this is shared by all models that were loaded from the same file/data (see mesh_cache)
+//! NOTE: the gl buffers are deleted together with the mesh, i.e. when the last model using it is destroyed
+struct static_mesh {
+	static_mesh() = default;
+	~static_mesh();
+	static_mesh(const static_mesh&) = delete;
+	static_mesh& operator=(const static_mesh&) = delete;
+	
+	a2m_file::model_data data;
+	
+	// gl buffers (created by a2estatic::create_buffers)
+	// NOTE: with the compact vertex format, vbo_vertices_id is the interleaved buffer and all other vertex buffers are 0
+	bool compact_vertex_format = false;
+	bool half_tex_coords = false; // compact vertex format only
+	GLuint vbo_vertices_id = 0;
+	GLuint vbo_tex_coords_id = 0;
+	GLuint vbo_normals_id = 0;
+	GLuint vbo_binormals_id = 0;
+	GLuint vbo_tangents_id = 0;
+	vector<GLuint> vbo_indices_ids; // per sub-object
+	vector<GLenum> index_types; // per sub-object: GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+	vector<GLint> base_vertices; // per sub-object, only != 0 for 16-bit indices
+	
+	// geometry arena: if the mesh is stored in the arena, all vbo_* ids are 0 (always the compact vertex format)
+	geometry_arena* arena = nullptr;
+	geometry_arena::allocation arena_alloc;
+	vector<size_t> arena_index_offsets; // per sub-object, relative to the first index of the allocation
+	
+	//! key of this mesh in the mesh_cache (empty if it isn't cached)
+	string cache_key = "";
+	//! only for meshes that were cached by their data in memory: a copy of that data (see mesh_cache::memory_data),
+	//! which must match exactly before the mesh is shared (the key only contains a hash of it)
+	vector<uint8_t> source_data;
+	
+	//! deletes all gl buffers (the buffer ids are reset to 0) and frees the arena allocation
+	void delete_buffers();
+};
+
+//! ref-counted cache of all static meshes: models that are loaded from the same file (keyed by its canonical path)
+//! or from the same data in memory (keyed by a hash of the data) with the same load options share one mesh.
+//! the cache only holds weak references, a mesh is freed as soon as the last model using it is destroyed.
+//! NOTE: only use this from the thread that owns the gl context
+class mesh_cache {
+public:
+	mesh_cache() = delete;
+	~mesh_cache() = delete;
+	
+	//! everything that changes the mesh data or buffers when loading a model
+	struct load_options {
+		bool compact_vertex_format;
+		bool mesh_optimization;
+		bool reduce_overdraw;
+		bool use_geometry_arena;
+	};
+	
+	//! returns the key of a model file: its canonical path + the load options
+	static string file_key(const string& filename, const load_options& options);
+	//! returns a copy of model data in memory as one byte array: vertices, tex coords, index counts and indices
+	static vector<uint8_t> memory_data(const unsigned int object_count, const unsigned int vertex_count,
+									   const float3* vertices, const float2* tex_coords,
+									   const unsigned int* index_count, const uint3* const* indices);
+	//! returns the key of model data in memory (see memory_data): a 64-bit hash of the data + the load options
+	static string memory_key(const unsigned int object_count, const unsigned int vertex_count,
+							 const vector<uint8_t>& data, const load_options& options);
+	
+	//! returns the cached mesh with the specified key (nullptr if there is none)
+	static shared_ptr<static_mesh> get(const string& key);
+	//! returns the cached mesh with the specified memory key, but only if it was created from exactly the same data
+	//! (a matching hash alone could also be a collision), nullptr otherwise
+	static shared_ptr<static_mesh> get(const string& key, const vector<uint8_t>& data);
+	//! adds the mesh to the cache (a previously cached mesh with the same key stays valid, but is no longer cached)
+	static void add(const string& key, const shared_ptr<static_mesh>& mesh);
+	//! copy-on-write: must be called before the mesh data is modified. if the mesh is also used by other models, it is
+	//! replaced by an uncached copy of its model data (without any gl buffers -> returns true), otherwise it is only
+	//! removed from the cache (-> returns false)
+	static bool make_unique(shared_ptr<static_mesh>& mesh);
+	
+	//! returns the amount of currently cached meshes
+	static size_t get_mesh_count();
+
+protected:
+	friend struct static_mesh;
+	static unordered_map<string, weak_ptr<static_mesh>> meshes;
+	
+	//! removes the cache entry of a mesh that is being destroyed
+	static void remove(const string& key);
+
+};
+
+#endif
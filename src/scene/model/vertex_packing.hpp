@@ -0,0 +1,145 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_VERTEX_PACKING_HPP__
+#define __A2E_VERTEX_PACKING_HPP__
+
+#include "global.hpp"
+#include <floor/math/vector_lib.hpp>
+
+//! conversion functions for compact vertex formats (all of these match the gl vertex fetch conversion)
+class vertex_packing {
+public:
+	vertex_packing() = delete;
+	~vertex_packing() = delete;
+	
+	//! float -> half float (GL_HALF_FLOAT), rounds to nearest even, overflows to +/-inf
+	static uint16_t float_to_half(const float& val) {
+		uint32_t bits;
+		memcpy(&bits, &val, sizeof(uint32_t));
+		const uint16_t sign = (uint16_t)((bits >> 16u) & 0x8000u);
+		const uint32_t abs_bits = bits & 0x7FFFFFFFu;
+		
+		// nan/inf
+		if(abs_bits >= 0x7F800000u) {
+			return (uint16_t)(sign | 0x7C00u | (abs_bits > 0x7F800000u ? 0x200u : 0u));
+		}
+		// overflow
+		if(abs_bits >= 0x477FF000u) {
+			return (uint16_t)(sign | 0x7C00u);
+		}
+		// normal half
+		if(abs_bits >= 0x38800000u) {
+			const uint32_t rounded = abs_bits + 0xFFFu + ((abs_bits >> 13u) & 1u);
+			return (uint16_t)(sign | ((rounded - 0x38000000u) >> 13u));
+		}
+		// denormal half (or zero)
+		if(abs_bits < 0x33000000u) return sign;
+		const uint32_t exponent = abs_bits >> 23u;
+		const uint32_t mantissa = (abs_bits & 0x7FFFFFu) | 0x800000u;
+		// value = mantissa * 2^(exponent - 150), half denormals are multiples of 2^-24
+		const uint32_t shift = 126u - exponent;
+		const uint32_t half_mantissa = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const uint32_t halfway = 1u << (shift - 1u);
+		const uint32_t round_up = (remainder > halfway || (remainder == halfway && (half_mantissa & 1u) != 0) ? 1u : 0u);
+		return (uint16_t)(sign | (half_mantissa + round_up));
+	}
+	
+	//! half float -> float
+	static float half_to_float(const uint16_t& val) {
+		const uint32_t sign = (uint32_t)(val & 0x8000u) << 16u;
+		const uint32_t exponent = (val >> 10u) & 0x1Fu;
+		uint32_t mantissa = val & 0x3FFu;
+		uint32_t bits;
+		if(exponent == 0x1Fu) {
+			bits = sign | 0x7F800000u | (mantissa << 13u);
+		}
+		else if(exponent != 0) {
+			bits = sign | ((exponent + 112u) << 23u) | (mantissa << 13u);
+		}
+		else if(mantissa != 0) {
+			// denormal -> normalize
+			uint32_t exp = 113u;
+			while((mantissa & 0x400u) == 0) {
+				mantissa <<= 1u;
+				exp--;
+			}
+			bits = sign | (exp << 23u) | ((mantissa & 0x3FFu) << 13u);
+		}
+		else bits = sign;
+		float ret;
+		memcpy(&ret, &bits, sizeof(float));
+		return ret;
+	}
+	
+	//! normalized vector -> GL_INT_2_10_10_10_REV (signed normalized, w is always 0)
+	static uint32_t pack_snorm_10_10_10_2(const float3& vec) {
+		const auto pack = [](const float& f) -> uint32_t {
+			const float clamped = (f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f));
+			const int32_t ival = (int32_t)(clamped * 511.0f + (clamped < 0.0f ? -0.5f : 0.5f));
+			return (uint32_t)ival & 0x3FFu;
+		};
+		return pack(vec.x) | (pack(vec.y) << 10u) | (pack(vec.z) << 20u);
+	}
+	
+	//! GL_INT_2_10_10_10_REV -> vector (uses the gl 4.2+/es 3.0 conversion rule: max(c / 511, -1))
+	static float3 unpack_snorm_10_10_10_2(const uint32_t& packed) {
+		const auto unpack = [](const uint32_t& bits) -> float {
+			const int32_t ival = (int32_t)(bits << 22u) >> 22; // sign extend
+			const float f = float(ival) / 511.0f;
+			return (f < -1.0f ? -1.0f : f);
+		};
+		return float3(unpack(packed & 0x3FFu), unpack((packed >> 10u) & 0x3FFu), unpack((packed >> 20u) & 0x3FFu));
+	}
+	
+	// compact interleaved vertex layout:
+	// position (float3), normal/binormal/tangent (10:10:10:2 snorm each), tex coord (half2 or float2)
+	static constexpr size_t compact_normal_offset = sizeof(float3);
+	static constexpr size_t compact_binormal_offset = compact_normal_offset + sizeof(uint32_t);
+	static constexpr size_t compact_tangent_offset = compact_binormal_offset + sizeof(uint32_t);
+	static constexpr size_t compact_tex_coord_offset = compact_tangent_offset + sizeof(uint32_t);
+	//! half float tex coords are only used if all tex coords are within [-max, max] (-> max error: 2^-10)
+	static constexpr float max_half_tex_coord = 4.0f;
+	static constexpr size_t compact_stride(const bool half_tex_coords) {
+		return compact_tex_coord_offset + (half_tex_coords ? 2 * sizeof(uint16_t) : sizeof(float2));
+	}
+	
+	//! writes one vertex in the compact layout (compact_stride(half_tex_coords) bytes)
+	static void pack_compact_vertex(uint8_t* vertex, const float3& position, const float3& normal, const float3& binormal,
+									const float3& tangent, const float2& tex_coord, const bool half_tex_coords) {
+		const uint32_t packed_frame[3] {
+			pack_snorm_10_10_10_2(normal),
+			pack_snorm_10_10_10_2(binormal),
+			pack_snorm_10_10_10_2(tangent),
+		};
+		memcpy(vertex, &position, sizeof(float3));
+		memcpy(vertex + compact_normal_offset, packed_frame, sizeof(packed_frame));
+		if(half_tex_coords) {
+			const uint16_t packed_tex_coord[2] {
+				float_to_half(tex_coord.x),
+				float_to_half(tex_coord.y),
+			};
+			memcpy(vertex + compact_tex_coord_offset, packed_tex_coord, sizeof(packed_tex_coord));
+		}
+		else memcpy(vertex + compact_tex_coord_offset, &tex_coord, sizeof(float2));
+	}
+
+};
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "occlusion_buffer.hpp"
+#include "task_scheduler.hpp"
+#include <thread>
+#include <cmath>
+
+constexpr uint32_t occlusion_buffer::block_width;
+
+// don't bother spawning threads for a few triangles or a few rows
+static constexpr size_t min_triangles_per_worker = 64;
+static constexpr uint32_t min_rows_per_worker = 16;
+
+occlusion_buffer::occlusion_buffer(const uint2 size_) {
+	set_size(size_);
+}
+
+occlusion_buffer::~occlusion_buffer() {
+}
+
+void occlusion_buffer::set_size(const uint2& size_) {
+	if(size_.x == 0 || size_.y == 0 || (size_.x % block_width) != 0) {
+		log_error("invalid occlusion buffer size (width must be a multiple of %u): %u * %u",
+				  block_width, size_.x, size_.y);
+		return;
+	}
+	size = size_;
+	depth.assign(size.x * size.y, 0.0f);
+	
+	// level sizes are rounded up, so that each texel of a level covers exactly 2x2 texels of the previous level
+	levels.clear();
+	level_sizes.clear();
+	level_sizes.emplace_back(size);
+	while(level_sizes.back().x > 1 || level_sizes.back().y > 1) {
+		const uint2 prev_size(level_sizes.back());
+		const uint2 level_size((prev_size.x + 1) / 2, (prev_size.y + 1) / 2);
+		level_sizes.emplace_back(level_size);
+		levels.emplace_back(level_size.x * level_size.y, 0.0f);
+	}
+}
+
+const uint2& occlusion_buffer::get_size() const {
+	return size;
+}
+
+void occlusion_buffer::set_worker_count(const size_t count) {
+	worker_count = count;
+}
+
+size_t occlusion_buffer::get_worker_count() const {
+	return worker_count;
+}
+
+void occlusion_buffer::set_task_scheduler(task_scheduler* scheduler_) {
+	scheduler = scheduler_;
+}
+
+const vector<float>& occlusion_buffer::get_depth() const {
+	return depth;
+}
+
+size_t occlusion_buffer::get_level_count() const {
+	return level_sizes.size();
+}
+
+const vector<float>& occlusion_buffer::get_level(const size_t& level) const {
+	return (level == 0 ? depth : levels[level - 1]);
+}
+
+const uint2& occlusion_buffer::get_level_size(const size_t& level) const {
+	return level_sizes[level];
+}
+
+const occlusion_buffer::stats& occlusion_buffer::get_stats() const {
+	return cur_stats;
+}
+
+void occlusion_buffer::begin(const matrix4f& mvpm_) {
+	mvpm = mvpm_;
+	triangles.clear();
+	cur_stats = stats();
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	for(auto& level : levels) {
+		std::fill(level.begin(), level.end(), 0.0f);
+	}
+}
+
+void occlusion_buffer::add_occluder(const float3* vertices, const size_t vertex_count,
+									const uint3* indices, const size_t index_count,
+									const matrix4f& world) {
+	if(vertices == nullptr || indices == nullptr) return;
+	cur_stats.occluder_count++;
+	
+	const matrix4f world_mvpm(world * mvpm);
+	clip_vertices.resize(vertex_count);
+	for(size_t i = 0; i < vertex_count; i++) {
+		clip_vertices[i] = float4(vertices[i], 1.0f) * world_mvpm;
+	}
+	
+	for(size_t i = 0; i < index_count; i++) {
+		const uint3& tri = indices[i];
+		if(tri.x >= vertex_count || tri.y >= vertex_count || tri.z >= vertex_count) continue;
+		const float4* tri_vertices[3] { &clip_vertices[tri.x], &clip_vertices[tri.y], &clip_vertices[tri.z] };
+		
+		// signed distances to the near plane (z = -w)
+		float dist[3];
+		size_t inside_count = 0;
+		for(size_t j = 0; j < 3; j++) {
+			dist[j] = tri_vertices[j]->z + tri_vertices[j]->w;
+			if(dist[j] >= 0.0f) inside_count++;
+		}
+		if(inside_count == 3) {
+			add_triangle(*tri_vertices[0], *tri_vertices[1], *tri_vertices[2]);
+			continue;
+		}
+		if(inside_count == 0) {
+			cur_stats.clipped_triangle_count++;
+			continue;
+		}
+		
+		// clip against the near plane (-> 3 or 4 vertices) and draw the result as a triangle fan
+		float4 poly[4];
+		size_t poly_count = 0;
+		for(size_t j = 0; j < 3; j++) {
+			const size_t k = (j + 1) % 3;
+			if(dist[j] >= 0.0f) poly[poly_count++] = *tri_vertices[j];
+			if((dist[j] >= 0.0f) != (dist[k] >= 0.0f)) {
+				const float t = dist[j] / (dist[j] - dist[k]);
+				poly[poly_count++] = *tri_vertices[j] + (*tri_vertices[k] - *tri_vertices[j]) * t;
+			}
+		}
+		for(size_t j = 2; j < poly_count; j++) {
+			add_triangle(poly[0], poly[j - 1], poly[j]);
+		}
+	}
+}
+
+void occlusion_buffer::add_triangle(const float4& v0, const float4& v1, const float4& v2) {
+	// to pixel coordinates (pixel centers are at +0.5, y points down)
+	const float2 half_size(float(size.x) * 0.5f, float(size.y) * 0.5f);
+	float x[3], y[3], iw[3];
+	const float4* verts[3] { &v0, &v1, &v2 };
+	for(size_t i = 0; i < 3; i++) {
+		iw[i] = 1.0f / std::max(verts[i]->w, 1e-6f);
+		x[i] = half_size.x * (verts[i]->x * iw[i] + 1.0f);
+		y[i] = half_size.y * (1.0f - verts[i]->y * iw[i]);
+	}
+	
+	// both faces are rasterized -> flip back facing triangles, so that the edge functions are positive inside
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if(fabsf(area) < 1e-8f) {
+		cur_stats.clipped_triangle_count++;
+		return;
+	}
+	if(area < 0.0f) {
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(iw[1], iw[2]);
+		area = -area;
+	}
+	
+	// covered pixels: all pixels with their center inside the triangle bounds
+	const float min_x = std::min(std::min(x[0], x[1]), x[2]), max_x = std::max(std::max(x[0], x[1]), x[2]);
+	const float min_y = std::min(std::min(y[0], y[1]), y[2]), max_y = std::max(std::max(y[0], y[1]), y[2]);
+	const int rect[4] {
+		(int)std::max(ceilf(min_x - 0.5f), 0.0f),
+		(int)std::max(ceilf(min_y - 0.5f), 0.0f),
+		(int)std::min(floorf(max_x - 0.5f), float(size.x - 1)),
+		(int)std::min(floorf(max_y - 0.5f), float(size.y - 1)),
+	};
+	if(rect[0] > rect[2] || rect[1] > rect[3]) {
+		cur_stats.clipped_triangle_count++;
+		return;
+	}
+	
+	triangles.emplace_back();
+	triangle& tri = triangles.back();
+	std::copy(rect, rect + 4, tri.rect);
+	
+	// edge i is opposite to vertex i: e(p) = (x_b - x_a) * (p.y - y_a) - (y_b - y_a) * (p.x - x_a)
+	const float inv_area = 1.0f / area;
+	for(size_t i = 0; i < 3; i++) {
+		const size_t a = (i + 1) % 3, b = (i + 2) % 3;
+		tri.edge[i][0] = -(y[b] - y[a]);
+		tri.edge[i][1] = x[b] - x[a];
+		tri.edge[i][2] = (y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a];
+	}
+	
+	// 1/w is linear in screen space: barycentric interpolation (edge i / area == weight of vertex i)
+	for(size_t i = 0; i < 3; i++) {
+		tri.depth_plane[i] = (tri.edge[0][i] * iw[0] + tri.edge[1][i] * iw[1] + tri.edge[2][i] * iw[2]) * inv_area;
+	}
+	cur_stats.triangle_count++;
+}
+
+void occlusion_buffer::rasterize() {
+	// split the rows among all workers (multi-threaded if there are enough triangles)
+	size_t thread_count = (worker_count != 0 ? worker_count :
+						   (scheduler != nullptr ? scheduler->get_worker_count() + 1 :
+							std::max(1u, thread::hardware_concurrency())));
+	thread_count = std::min(thread_count, std::max(size_t(1), triangles.size() / min_triangles_per_worker));
+	thread_count = std::min(thread_count, size_t(std::max(1u, size.y / min_rows_per_worker)));
+	workers.resize(thread_count);
+	
+	const uint32_t rows_per_worker = (size.y + (uint32_t)thread_count - 1) / (uint32_t)thread_count;
+	for(size_t i = 0; i < thread_count; i++) {
+		workers[i].row_begin = std::min(size.y, (uint32_t)i * rows_per_worker);
+		workers[i].row_end = std::min(size.y, workers[i].row_begin + rows_per_worker);
+	}
+	
+	if(thread_count == 1) {
+		rasterize_rows(workers[0]);
+	}
+	else if(scheduler != nullptr) {
+		scheduler->parallel_for(thread_count, 1, [this](const size_t begin, const size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				rasterize_rows(workers[i]);
+			}
+		});
+	}
+	else {
+		vector<thread> threads;
+		threads.reserve(thread_count - 1);
+		for(size_t i = 1; i < thread_count; i++) {
+			threads.emplace_back(&occlusion_buffer::rasterize_rows, this, cref(workers[i]));
+		}
+		rasterize_rows(workers[0]);
+		for(auto& th : threads) {
+			th.join();
+		}
+	}
+	
+	build_hi_z();
+}
+
+void occlusion_buffer::rasterize_rows(const worker_data& worker) {
+	if(worker.row_begin >= worker.row_end) return;
+	for(const auto& tri : triangles) {
+		const int row_begin = std::max(tri.rect[1], (int)worker.row_begin);
+		const int row_end = std::min(tri.rect[3], (int)worker.row_end - 1);
+		if(row_begin > row_end) continue;
+		
+		// whole blocks (the width is a multiple of the block width -> never out of bounds)
+		const int block_begin = tri.rect[0] & ~int(block_width - 1);
+		const int block_end = tri.rect[2];
+		const float ea[3] { tri.edge[0][0], tri.edge[1][0], tri.edge[2][0] };
+		const float da = tri.depth_plane[0];
+		for(int row = row_begin; row <= row_end; row++) {
+			const float py = float(row) + 0.5f;
+			const float e0_row = tri.edge[0][1] * py + tri.edge[0][2];
+			const float e1_row = tri.edge[1][1] * py + tri.edge[1][2];
+			const float e2_row = tri.edge[2][1] * py + tri.edge[2][2];
+			const float d_row = tri.depth_plane[1] * py + tri.depth_plane[2];
+			float* row_depth = &depth[size_t(row) * size.x];
+			for(int block = block_begin; block <= block_end; block += (int)block_width) {
+				// plain fixed size loop -> vectorized by the compiler (no branches, one masked max per pixel)
+				float* block_depth = row_depth + block;
+				const float block_x = float(block) + 0.5f;
+				for(uint32_t i = 0; i < block_width; i++) {
+					const float px = block_x + float(i);
+					const float e0 = ea[0] * px + e0_row;
+					const float e1 = ea[1] * px + e1_row;
+					const float e2 = ea[2] * px + e2_row;
+					const float d = std::max(da * px + d_row, block_depth[i]);
+					const bool inside = (e0 >= 0.0f) & (e1 >= 0.0f) & (e2 >= 0.0f);
+					block_depth[i] = (inside ? d : block_depth[i]);
+				}
+			}
+		}
+	}
+}
+
+void occlusion_buffer::build_hi_z() {
+	// each texel stores the farthest (min 1/w) depth of the 2x2 texels below it
+	for(size_t level = 1; level < level_sizes.size(); level++) {
+		const vector<float>& src = get_level(level - 1);
+		vector<float>& dst = levels[level - 1];
+		const uint2& src_size = level_sizes[level - 1];
+		const uint2& dst_size = level_sizes[level];
+		for(uint32_t y = 0; y < dst_size.y; y++) {
+			const uint32_t y0 = y * 2, y1 = std::min(y * 2 + 1, src_size.y - 1);
+			for(uint32_t x = 0; x < dst_size.x; x++) {
+				const uint32_t x0 = x * 2, x1 = std::min(x * 2 + 1, src_size.x - 1);
+				dst[y * dst_size.x + x] = std::min(std::min(src[y0 * src_size.x + x0], src[y0 * src_size.x + x1]),
+												   std::min(src[y1 * src_size.x + x0], src[y1 * src_size.x + x1]));
+			}
+		}
+	}
+}
+
+bool occlusion_buffer::is_occluded(const float3& aabb_min, const float3& aabb_max) const {
+	if(triangles.empty()) return false;
+	
+	// project all 8 corners: screen rect + closest depth
+	const float2 half_size(float(size.x) * 0.5f, float(size.y) * 0.5f);
+	float2 rect_min(numeric_limits<float>::max()), rect_max(-numeric_limits<float>::max());
+	float max_iw = 0.0f;
+	for(size_t corner = 0; corner < 8; corner++) {
+		const float4 clip(float4((corner & 1) ? aabb_max.x : aabb_min.x,
+								 (corner & 2) ? aabb_max.y : aabb_min.y,
+								 (corner & 4) ? aabb_max.z : aabb_min.z, 1.0f) * mvpm);
+		// crosses the near plane -> can't be occluded by anything in front of it
+		if(clip.z + clip.w < 0.0f || clip.w <= 0.0f) return false;
+		
+		const float iw = 1.0f / clip.w;
+		const float2 screen_pos(half_size.x * (clip.x * iw + 1.0f), half_size.y * (1.0f - clip.y * iw));
+		rect_min.min(screen_pos);
+		rect_max.max(screen_pos);
+		max_iw = std::max(max_iw, iw);
+	}
+	
+	// all pixels the rect touches (completely off-screen -> not our business, the frustum decides)
+	if(rect_max.x < 0.0f || rect_max.y < 0.0f || rect_min.x >= float(size.x) || rect_min.y >= float(size.y)) {
+		return false;
+	}
+	const uint32_t x0 = (uint32_t)std::max(rect_min.x, 0.0f), y0 = (uint32_t)std::max(rect_min.y, 0.0f);
+	const uint32_t x1 = std::min((uint32_t)rect_max.x, size.x - 1), y1 = std::min((uint32_t)rect_max.y, size.y - 1);
+	
+	// find the level on which the rect covers at most 2x2 texels
+	size_t level = 0;
+	while(level + 1 < level_sizes.size() &&
+		  ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+		level++;
+	}
+	
+	// occluded if the closest point of the box is behind the farthest occluder depth of all covered texels
+	const vector<float>& hi_z = get_level(level);
+	const uint32_t level_width = level_sizes[level].x;
+	for(uint32_t y = (y0 >> level); y <= (y1 >> level); y++) {
+		for(uint32_t x = (x0 >> level); x <= (x1 >> level); x++) {
+			if(max_iw >= hi_z[y * level_width + x]) return false;
+		}
+	}
+	return true;
+}
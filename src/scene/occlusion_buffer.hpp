@@ -0,0 +1,117 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_OCCLUSION_BUFFER_HPP__
+#define __A2E_OCCLUSION_BUFFER_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+#include <floor/math/matrix4.hpp>
+
+class task_scheduler;
+
+//! software occlusion culling: the triangles of a few large occluders (usually low-poly collision meshes) are
+//! rasterized on the cpu into a low resolution depth buffer, from which a hierarchical-z pyramid is built.
+//! occludees (world space aabbs) are then tested against the pyramid level on which their screen rect covers
+//! at most 2x2 texels. this is purely cpu side (no gl calls).
+//!  * depth is stored as 1/w (linear in screen space, larger = closer, 0 = nothing rasterized)
+//!  * the buffer is rasterized in 8 pixel wide blocks, rows are split into bands that are rasterized in parallel
+//!  * occluder triangles are clipped against the near plane, both faces are rasterized
+//! NOTE: this requires a perspective projection (w == view space depth)
+class occlusion_buffer {
+public:
+	occlusion_buffer(const uint2 size = uint2(256, 128));
+	~occlusion_buffer();
+	
+	void set_size(const uint2& size);
+	const uint2& get_size() const;
+	//! 0 = use all available hardware threads, 1 = always rasterize on the calling thread
+	void set_worker_count(const size_t count);
+	size_t get_worker_count() const;
+	//! if set, workers are executed as tasks of the scheduler instead of on newly spawned threads
+	//! (a worker count of 0 then uses all scheduler workers + the calling thread)
+	void set_task_scheduler(task_scheduler* scheduler);
+	
+	//! starts a new view (clears all occluders and the depth buffer)
+	void begin(const matrix4f& mvpm);
+	//! transforms, clips and projects the triangles of an occluder (model space vertices + world matrix)
+	void add_occluder(const float3* vertices, const size_t vertex_count,
+					  const uint3* indices, const size_t index_count,
+					  const matrix4f& world);
+	//! rasterizes all added occluders and builds the hi-z pyramid
+	void rasterize();
+	
+	//! returns true if the world space aabb is completely hidden behind the rasterized occluders
+	//! (must be called after rasterize(), this is thread-safe)
+	bool is_occluded(const float3& aabb_min, const float3& aabb_max) const;
+	
+	//! the rasterized depth buffer (row-major, top row first, get_size().x * get_size().y values)
+	const vector<float>& get_depth() const;
+	//! all hi-z levels (level 0 is the depth buffer itself, each further level stores the min 1/w of 2x2 texels)
+	size_t get_level_count() const;
+	const vector<float>& get_level(const size_t& level) const;
+	const uint2& get_level_size(const size_t& level) const;
+	
+	struct stats {
+		size_t occluder_count = 0;
+		size_t triangle_count = 0; // after clipping and culling
+		size_t clipped_triangle_count = 0; // triangles that were completely off-screen or behind the near plane
+	};
+	const stats& get_stats() const;
+
+protected:
+	uint2 size;
+	size_t worker_count = 0;
+	task_scheduler* scheduler = nullptr;
+	stats cur_stats;
+	
+	// the width must be a multiple of the block width (-> blocks never cross rows)
+	static constexpr uint32_t block_width = 8;
+	vector<float> depth;
+	
+	// hi-z levels 1+ (level 0 is the depth buffer), level sizes of all levels
+	vector<vector<float>> levels;
+	vector<uint2> level_sizes;
+	
+	matrix4f mvpm;
+	vector<float4> clip_vertices;
+	
+	// screen space triangle setup: edge functions (a * x + b * y + c >= 0 inside), 1/w plane equation
+	// and the covered pixel rect (inclusive)
+	struct triangle {
+		float edge[3][3];
+		float depth_plane[3];
+		int rect[4];
+	};
+	vector<triangle> triangles;
+	//! projects a clip space triangle (all vertices must be in front of the near plane)
+	void add_triangle(const float4& v0, const float4& v1, const float4& v2);
+	
+	// a worker rasterizes all triangles into a contiguous range of rows
+	struct worker_data {
+		uint32_t row_begin = 0;
+		uint32_t row_end = 0;
+	};
+	vector<worker_data> workers;
+	void rasterize_rows(const worker_data& worker);
+	void build_hi_z();
+
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "render_view.hpp"
+#include <floor/math/quaternion.hpp>
+
+render_view::render_view(const float3& position_, const float2& rotation_, const matrix4f& projection_matrix_,
+						 const float2& near_far_plane_, const uint4& viewport_) :
+near_far_plane(near_far_plane_), viewport(viewport_), projection_matrix(projection_matrix_) {
+	set_camera(position_, rotation_);
+}
+
+void render_view::set_camera(const float3& position_, const float2& rotation_) {
+	position = position_;
+	rotation = rotation_;
+	
+	// same as engine::set_position/set_rotation
+	translation_matrix = matrix4f().translate(position.x, position.y, position.z);
+	rotation_matrix = matrix4f().rotate_y(rotation.y) * matrix4f().rotate_x(rotation.x);
+	modelview_matrix = translation_matrix * rotation_matrix;
+	mvp_matrix = modelview_matrix * projection_matrix;
+	
+	if(omnidirectional) set_omnidirectional(view_distance);
+	else view_frustum.extract(mvp_matrix);
+}
+
+void render_view::set_omnidirectional(const float view_distance_) {
+	omnidirectional = true;
+	view_distance = view_distance_;
+	view_frustum.create_box(get_camera_position(),
+							(view_distance > 0.0f ? std::min(view_distance, near_far_plane.y) : near_far_plane.y));
+}
+
+float3 render_view::get_camera_position() const {
+	return -position;
+}
+
+matrix4f render_view::get_backside_mvp_matrix() const {
+	quaternionf q_x, q_y;
+	q_x.set_rotation(rotation.x, float3(1.0f, 0.0f, 0.0f));
+	q_y.set_rotation(180.0f - rotation.y, float3(0.0f, 1.0f, 0.0f));
+	q_y *= q_x;
+	q_y.normalize();
+	return translation_matrix * q_y.to_matrix4() * projection_matrix;
+}
+
+float2 render_view::get_projection_ab() const {
+	return float2(near_far_plane.y / (near_far_plane.y - near_far_plane.x),
+				  (-near_far_plane.y * near_far_plane.x) / (near_far_plane.y - near_far_plane.x));
+}
@@ -0,0 +1,68 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_RENDER_VIEW_HPP__
+#define __A2E_RENDER_VIEW_HPP__
+
+#include "global.hpp"
+#include <floor/core/core.hpp>
+#include <floor/math/vector_lib.hpp>
+#include <floor/math/matrix4.hpp>
+#include "scene/frustum.hpp"
+
+//! a single rendered view (main camera, env probe, ...): camera, matrices, culling frustum and viewport.
+//! views are plain values that don't depend on any global state once they've been created, every pass only reads the
+//! view it is given -> several views can be set up concurrently (e.g. on the task scheduler).
+//! NOTE: as with engine::set_position, "position" is the negated camera position (use get_camera_position())
+struct render_view {
+	float3 position;
+	float2 rotation; // x and y rotation (in degrees)
+	float2 near_far_plane;
+	uint4 viewport; // x, y, width, height (in pixels)
+	
+	matrix4f projection_matrix;
+	matrix4f translation_matrix;
+	matrix4f rotation_matrix;
+	matrix4f modelview_matrix; // translation * rotation
+	matrix4f mvp_matrix; // modelview * projection
+	
+	//! culling volume: the frustum of mvp_matrix, or a box around the camera for omnidirectional views
+	frustum view_frustum;
+	//! true if the view captures everything around the camera (dual-paraboloid env probes)
+	bool omnidirectional = false;
+	float view_distance = 0.0f; // omnidirectional views: culling distance (0 = far plane)
+	
+	render_view() = default;
+	render_view(const float3& position, const float2& rotation, const matrix4f& projection_matrix,
+				const float2& near_far_plane, const uint4& viewport);
+	
+	//! sets the camera and recomputes all view dependent matrices and the frustum
+	void set_camera(const float3& position, const float2& rotation);
+	//! turns this into an omnidirectional view, which is only limited by the far plane or view_distance (if > 0)
+	void set_omnidirectional(const float view_distance = 0.0f);
+	
+	//! world space position of the camera
+	float3 get_camera_position() const;
+	//! dual-paraboloid back side: the view translation, followed by the view rotation turned around by 180 degrees
+	matrix4f get_backside_mvp_matrix() const;
+	//! projection constants that are necessary to reconstruct the view space position from a depth value
+	float2 get_projection_ab() const;
+
+};
+
+#endif
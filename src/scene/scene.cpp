@@ -19,6 +19,11 @@
 #include "scene.hpp"
 #include "particle/particle.hpp"
 #include "rendering/gl_timer.hpp"
+#include "rendering/geometry_arena.hpp"
+#include <chrono>
+
+// don't bother splitting per-model work into tasks for less models
+static constexpr size_t min_models_per_task = 128;
 
 #if defined(A2E_INFERRED_RENDERING_CL)
 constexpr size_t scene::frame_buffers::cl_frame_buffers::max_ir_lights;
@@ -29,13 +34,21 @@ constexpr size_t scene::frame_buffers::cl_frame_buffers::max_ir_lights;
 /*! scene constructor
  */
 scene::scene() :
-s(engine::get_shader()), exts(engine::get_ext()), r(engine::get_rtt()),
+s(engine::get_shader()), exts(engine::get_ext()), r(engine::get_rtt()), scheduler(engine::get_task_scheduler()),
+light_cluster_group(*scheduler),
 window_handler(bind(&scene::window_event_handler, this, placeholders::_1, placeholders::_2))
 {
 	//
 	stereo = floor::get_stereo();
 	
-	recreate_buffers(frames[0], size2(floor::get_physical_width(), floor::get_physical_height()));
+	// shader permutation ids of the light pass
+	default_option_id = s->get_option_id("#");
+	directional_option_id = s->get_option_id("directional");
+	
+	clustered_lights.set_task_scheduler(scheduler);
+	occlusion.set_task_scheduler(scheduler);
+	
+	recreate_buffers(main_buffers, size2(floor::get_physical_width(), floor::get_physical_height()));
 	
 	floor::get_event()->add_internal_event_handler(window_handler, EVENT_TYPE::WINDOW_RESIZE);
 	
@@ -51,22 +64,27 @@ scene::~scene() {
 	log_debug("deleting scene object");
 	
 	floor::get_event()->remove_event_handler(window_handler);
-
+	
 	log_debug("deleting models and lights");
 	models.clear();
 	lights.clear();
-
+	
 	//
-	delete_buffers(frames[0]);
+	delete_buffers(main_buffers);
 	delete light_sphere;
-
+	
+	for(size_t i = 0; i < A2E_CONCURRENT_FRAMES; i++) {
+		if(light_cluster_textures[i][0] != 0) gl_state::delete_textures(3, &light_cluster_textures[i][0]);
+		if(light_cluster_buffers[i][0] != 0) gl_state::delete_buffers(3, &light_cluster_buffers[i][0]);
+	}
+	
 	log_debug("scene object deleted");
 }
 
 void scene::delete_buffers(frame_buffers& buffers) {
 #if defined(A2E_INFERRED_RENDERING_CL)
 	if(buffers.cl.depth_copy_tex != 0) {
-		glDeleteBuffers(1, &buffers.cl.depth_copy_tex);
+		gl_state::delete_buffers(1, &buffers.cl.depth_copy_tex);
 		buffers.cl.depth_copy_tex = 0;
 	}
 	if(buffers.cl.depth_copy_fbo != 0) {
@@ -128,10 +146,21 @@ void scene::delete_buffers(frame_buffers& buffers) {
 	}
 }
 
-void scene::recreate_buffers(frame_buffers& buffers, const size2 unscaled_buffer_size, const bool create_alpha_buffer) {
-	if(engine::get_init_mode() != engine::INIT_MODE::GRAPHICAL) return;
-	
+void scene::compute_buffer_sizes(const size2 unscaled_buffer_size, uint2& render_buffer_size, uint2& final_buffer_size) {
 	const size2 buffer_size = size2(float2(unscaled_buffer_size) / engine::get_upscaling());
+	float2 inferred_scale(engine::get_geometry_light_scaling());
+	inferred_scale *= float2(buffer_size);
+	render_buffer_size = uint2(inferred_scale);
+	if(render_buffer_size.x % 2 == 1) render_buffer_size.x++;
+	if(render_buffer_size.y % 2 == 1) render_buffer_size.y++;
+	final_buffer_size = uint2(buffer_size);
+	if(final_buffer_size.x % 2 == 1) final_buffer_size.x++;
+	if(final_buffer_size.y % 2 == 1) final_buffer_size.y++;
+}
+
+void scene::recreate_buffers(frame_buffers& buffers, const size2 unscaled_buffer_size, const bool create_alpha_buffer,
+							 const bool create_scene_buffer) {
+	if(engine::get_init_mode() != engine::INIT_MODE::GRAPHICAL) return;
 	
 	// check if buffers have already been created (and delete them, if so)
 	delete_buffers(buffers);
@@ -161,16 +190,8 @@ void scene::recreate_buffers(frame_buffers& buffers, const size2 unscaled_buffer
 	constexpr GLenum types[] { f16_format_type, f16_format_type };
 	
 	//
-	float2 inferred_scale(engine::get_geometry_light_scaling());
-	inferred_scale *= float2(buffer_size);
-	uint2 render_buffer_size = uint2(inferred_scale);
-	if(render_buffer_size.x % 2 == 1) render_buffer_size.x++;
-	if(render_buffer_size.y % 2 == 1) render_buffer_size.y++;
-	uint2 final_buffer_size = uint2(buffer_size);
-	if(final_buffer_size.x % 2 == 1) final_buffer_size.x++;
-	if(final_buffer_size.y % 2 == 1) final_buffer_size.y++;
-	
-	const float aa_scale = r->get_anti_aliasing_scale(engine::get_anti_aliasing());
+	uint2 render_buffer_size, final_buffer_size;
+	compute_buffer_sizes(unscaled_buffer_size, render_buffer_size, final_buffer_size);
 	
 	// create geometry buffer
 	// note that depth must be a 2d texture, because we will read it later inside a shader
@@ -215,31 +236,20 @@ void scene::recreate_buffers(frame_buffers& buffers, const size2 unscaled_buffer
 	else buffers.l_buffer[1] = nullptr;
 	
 	// scene/final buffer (material pass)
-	if(final_buffer_size.x == render_buffer_size.x && final_buffer_size.y == render_buffer_size.y) {
-		// reuse the g-buffer depth buffer (performance and memory!)
-		buffers.scene_buffer = r->add_buffer(final_buffer_size.x, final_buffer_size.y, GL_TEXTURE_2D, (aa_scale > 1.0f ? TEXTURE_FILTERING::LINEAR : TEXTURE_FILTERING::POINT), taa, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 1, rtt::DEPTH_TYPE::NONE);
-		buffers.scene_buffer->depth_type = rtt::DEPTH_TYPE::TEXTURE_2D;
-		buffers.scene_buffer->stencil_type = rtt::STENCIL_TYPE::STENCIL_8;
-		buffers.scene_buffer->depth_attachment_type = GL_DEPTH_STENCIL_ATTACHMENT;
-		buffers.scene_buffer->depth_buffer = buffers.g_buffer[0]->depth_buffer;
-	}
-	else {
-		// sadly, the depth buffer optimization can't be used here, because the buffers are of a different size
-		buffers.scene_buffer = r->add_buffer(final_buffer_size.x, final_buffer_size.y, GL_TEXTURE_2D, (aa_scale > 1.0f ? TEXTURE_FILTERING::LINEAR : TEXTURE_FILTERING::POINT), taa, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 1, rtt::DEPTH_TYPE::RENDERBUFFER);
-	}
+	if(create_scene_buffer) add_scene_buffer(buffers, render_buffer_size, final_buffer_size);
 	
 	buffers.fxaa_buffer = r->add_buffer(final_buffer_size.x, final_buffer_size.y, GL_TEXTURE_2D, TEXTURE_FILTERING::LINEAR, taa, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 1, rtt::DEPTH_TYPE::NONE);
 	
 #if defined(A2E_INFERRED_RENDERING_CL)
 	glGenFramebuffers(1, &buffers.cl.depth_copy_fbo); // doesn't need to be bound
 	glGenTextures(1, &buffers.cl.depth_copy_tex);
-	glBindTexture(GL_TEXTURE_2D, buffers.cl.depth_copy_tex);
+	gl_state::bind_texture(GL_TEXTURE_2D, buffers.cl.depth_copy_tex);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, render_buffer_size.x, render_buffer_size.y, 0, GL_RED, GL_FLOAT, nullptr);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_state::bind_texture(GL_TEXTURE_2D, 0);
 	
 	buffers.cl.lights_buffer = cl->create_buffer(opencl::BT_READ, frame_buffers::cl_frame_buffers::max_ir_lights * sizeof(frame_buffers::cl_frame_buffers::ir_light), nullptr);
 	
@@ -261,15 +271,34 @@ void scene::recreate_buffers(frame_buffers& buffers, const size2 unscaled_buffer
 	
 	log_debug("g/l-buffer @%v", size2(buffers.g_buffer[0]->width,
 									  buffers.g_buffer[0]->height));
-	log_debug("scene-buffer @%v", size2(buffers.scene_buffer->width,
-										buffers.scene_buffer->height));
+	if(buffers.scene_buffer != nullptr) {
+		log_debug("scene-buffer @%v", size2(buffers.scene_buffer->width,
+											buffers.scene_buffer->height));
+	}
+}
+
+void scene::add_scene_buffer(frame_buffers& buffers, const uint2& render_buffer_size, const uint2& final_buffer_size) {
+	const rtt::TEXTURE_ANTI_ALIASING taa = engine::get_anti_aliasing();
+	const float aa_scale = r->get_anti_aliasing_scale(taa);
+	if(final_buffer_size.x == render_buffer_size.x && final_buffer_size.y == render_buffer_size.y) {
+		// reuse the g-buffer depth buffer (performance and memory!)
+		buffers.scene_buffer = r->add_buffer(final_buffer_size.x, final_buffer_size.y, GL_TEXTURE_2D, (aa_scale > 1.0f ? TEXTURE_FILTERING::LINEAR : TEXTURE_FILTERING::POINT), taa, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 1, rtt::DEPTH_TYPE::NONE);
+		buffers.scene_buffer->depth_type = rtt::DEPTH_TYPE::TEXTURE_2D;
+		buffers.scene_buffer->stencil_type = rtt::STENCIL_TYPE::STENCIL_8;
+		buffers.scene_buffer->depth_attachment_type = GL_DEPTH_STENCIL_ATTACHMENT;
+		buffers.scene_buffer->depth_buffer = buffers.g_buffer[0]->depth_buffer;
+	}
+	else {
+		// sadly, the depth buffer optimization can't be used here, because the buffers are of a different size
+		buffers.scene_buffer = r->add_buffer(final_buffer_size.x, final_buffer_size.y, GL_TEXTURE_2D, (aa_scale > 1.0f ? TEXTURE_FILTERING::LINEAR : TEXTURE_FILTERING::POINT), taa, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 1, rtt::DEPTH_TYPE::RENDERBUFFER);
+	}
 }
 
 bool scene::window_event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
 	if(!enabled) return false;
 	if(type == EVENT_TYPE::WINDOW_RESIZE) {
 		const window_resize_event& evt = (const window_resize_event&)*obj;
-		recreate_buffers(frames[0], evt.size);
+		recreate_buffers(main_buffers, evt.size);
 	}
 	return true;
 }
@@ -281,184 +310,211 @@ void scene::draw() {
 	if(!enabled) return;
 	
 	gl_timer::mark("SCE_START");
-	// scene setup (run particle systems, ...)
-	setup_scene();
+	cull_stats = culling_stats {};
+	
+	// everything is drawn from the view of the camera at this point (env probes derive their own views from it)
+	const render_view main_view(engine::get_camera_view());
+	
+	// scene setup (run particle systems, ...) and concurrently sort transparency/alpha objects (+assign mask ids)
+	// NOTE: the alpha sort only reads the view and the bboxes of the models (not modified by particle systems)
+	{
+		task_scheduler::task_group setup_group(*scheduler);
+		setup_group.run([this, &main_view] { sort_alpha_objects(main_view); });
+		setup_scene();
+		setup_group.wait();
+	}
 	gl_timer::mark("SCE_SETUP");
 	
-	// sort transparency/alpha objects (+assign mask ids)
-	sort_alpha_objects();
-	gl_timer::mark("SCE_ALPHA_SORT");
-	
 	// TODO: stereo rendering
 	
-	// render env probes
-	if(!env_probes.empty()) {
-		engine::push_modelview_matrix();
-		engine::push_projection_matrix();
-		const float3 engine_pos(*engine::get_position());
-		const float3 engine_rot(*engine::get_rotation());
-		for(const auto& probe : env_probes) {
-			bool render_probe = false;
-			switch (probe->freq) {
-				case env_probe::PROBE_FREQUENCY::ONCE:
-					if(probe->frame_counter > 0) {
-						probe->frame_counter--;
-						render_probe = true;
-					}
-					break;
-				case env_probe::PROBE_FREQUENCY::EVERY_FRAME:
-					render_probe = true;
-					break;
-				case env_probe::PROBE_FREQUENCY::NTH_FRAME:
-					probe->frame_counter--;
-					if(probe->frame_counter == 0) {
-						probe->frame_counter = probe->frame_freq;
-						render_probe = true;
-					}
-					break;
-			}
-			if(render_probe) {
-				engine::set_position(-probe->position.x,
-									 -probe->position.y,
-									 -probe->position.z);
-				engine::set_rotation(probe->rotation.x, probe->rotation.y);
-				geometry_pass(probe->buffers, DRAW_MODE::ENVIRONMENT_PASS);
-				light_and_material_pass(probe->buffers, DRAW_MODE::ENVIRONMENT_PASS);
-			}
-		}
-		engine::pop_modelview_matrix();
-		engine::pop_projection_matrix();
-		engine::set_position(engine_pos.x, engine_pos.y, engine_pos.z);
-		engine::set_rotation(engine_rot.x, engine_rot.y);
-	}
+	// render env probes (within the probe budget)
+	update_env_probes(main_view);
 	gl_timer::mark("ENV_PROBES");
 	
 	// render to actual scene frame buffers
-	geometry_pass(frames[0]);
+	cull_models(main_view);
+	update_model_transforms(main_view);
+#if !defined(FLOOR_IOS) && !defined(A2E_INFERRED_RENDERING_CL)
+	// the clusters are only needed (and built) if the clustered light pass shader exists, otherwise all lights are
+	// rendered by the per-light stencil + sphere path (see light_and_material_pass)
+	if(clustered_lighting && s->get_gl_shader("IR_LP_CLUSTERED") != nullptr) {
+		light_clusters_pending = true;
+		light_cluster_group.run([this, main_view] {
+			clustered_lights.build(lights, main_view.modelview_matrix, main_view.projection_matrix,
+								   main_view.near_far_plane);
+		});
+	}
+#endif
+	gl_timer::mark("SCE_CULL");
+	geometry_pass(main_view, main_buffers);
 	gl_timer::mark("GEOM_PASS");
-	light_and_material_pass(frames[0]);
+	light_and_material_pass(main_view, main_buffers);
 	gl_timer::mark("SCE_END");
 }
 
-void scene::sort_alpha_objects() {
-	// sort transparency/alpha objects + assign mask ids
-	
-	// first, sort objects from front to back
-	struct alpha_object_cmp {
-		const float3 position;
-		alpha_object_cmp(const float3& cam_position) : position(cam_position) {}
-		bool operator()(const pair<const extbbox*, size_t>& lhs, const pair<const extbbox*, size_t>& rhs) const {
-			float3 lmid((lhs.first->min + lhs.first->max) / 2.0f);
-			float3 rmid((rhs.first->min + rhs.first->max) / 2.0f);
-			return (position - lhs.first->pos - lmid).length() < (position - rhs.first->pos - rmid).length();
+void scene::update_env_probes(const render_view& camera_view) {
+	probe_stats = env_probe_stats {};
+	probe_frame++;
+	if(env_probes.empty()) return;
+	
+	// gather all due probes and prioritize them: the longer a probe is overdue, the higher its priority,
+	// probes in the view frustum of the camera are preferred, and priority falls off with the distance to the camera
+	const float3 cam_position(camera_view.get_camera_position());
+	const frustum& camera_frustum = camera_view.view_frustum;
+	probe_queue.clear();
+	for(const auto& probe : env_probes) {
+		const size_t frames_since_update = probe_frame - probe->last_update_frame;
+		size_t overdue_frames = 0;
+		switch (probe->freq) {
+			case env_probe::PROBE_FREQUENCY::ONCE:
+				if(probe->frame_counter == 0) continue;
+				overdue_frames = frames_since_update - 1;
+				break;
+			case env_probe::PROBE_FREQUENCY::EVERY_FRAME:
+				overdue_frames = frames_since_update - 1;
+				break;
+			case env_probe::PROBE_FREQUENCY::NTH_FRAME:
+				if(frames_since_update < probe->frame_freq) continue;
+				overdue_frames = frames_since_update - probe->frame_freq;
+				break;
+		}
+		const float distance = (probe->position - cam_position).length();
+		const bool visible = camera_frustum.is_visible(probe->position, 0.0f);
+		const float priority = (float(overdue_frames + 1) * (visible ? 4.0f : 1.0f)) / std::max(distance, 1.0f);
+		probe_queue.emplace_back(priority, probe);
+	}
+	probe_stats.due_probes = probe_queue.size();
+	if(probe_queue.empty()) return;
+	std::sort(probe_queue.begin(), probe_queue.end(), [](const pair<float, env_probe*>& lhs,
+														 const pair<float, env_probe*>& rhs) {
+		return lhs.first > rhs.first;
+	});
+	
+	// update probes in priority order until the budget is used up (based on the time of their previous updates)
+	for(const auto& entry : probe_queue) {
+		env_probe* probe = entry.second;
+		if(probe_stats.updated_probes > 0) {
+			if(probe_budget_updates != 0 && probe_stats.updated_probes >= probe_budget_updates) break;
+			if(probe_budget_time > 0.0f && probe_stats.update_time + probe->update_time > probe_budget_time) continue;
 		}
-	} alpha_object_cmp_obj(-(*engine::get_position())); // create cmp obj and as usual, flip pos
-	std::sort(sorted_alpha_objects.begin(), sorted_alpha_objects.end(), alpha_object_cmp_obj);
-	
-	// second, compute the transformed corners of each bbox
-	const size_t obj_count = sorted_alpha_objects.size();
-	float3 (*bbox_corners)[8] = new float3[obj_count][8];
-	size_t cur_obj = 0;
-	for(const auto& obj_iter : sorted_alpha_objects) {
-		const extbbox& box = *(obj_iter.first);
 		
-		// compute bbox corners and transform them
-		float3 corners[8] = {
-			box.min,
-			box.max,
-			float3(box.min.x, box.min.y, box.max.z),
-			float3(box.min.x, box.max.y, box.min.z),
-			float3(box.max.x, box.min.y, box.min.z),
-			float3(box.max.x, box.min.y, box.max.z),
-			float3(box.max.x, box.max.y, box.min.z),
-			float3(box.min.x, box.max.y, box.max.z),
-		};
+		const auto start = chrono::steady_clock::now();
+		draw_env_probe(make_env_probe_view(camera_view, probe), probe);
+		const float time = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
 		
-		for(size_t i = 0; i < 8; i++) {
-			bbox_corners[cur_obj][i] = (corners[i] * box.mview) + box.pos;
-		}
-		cur_obj++;
+		probe->update_time = (probe->update_time == 0.0f ? time : probe->update_time * 0.75f + time * 0.25f);
+		probe->last_update_frame = probe_frame;
+		if(probe->freq == env_probe::PROBE_FREQUENCY::ONCE) probe->frame_counter--;
+		probe_stats.updated_probes++;
+		probe_stats.update_time += time;
 	}
-	
-	// third, project corners onto current near plane
-	int2 (*bbox_proj)[8] = new int2[obj_count][8];
-	int4 viewport(0, 0, (int)floor::get_physical_width(), (int)floor::get_physical_height());
-	matrix4f mviewt = engine::get_modelview_matrix();
-	matrix4f mprojt = engine::get_projection_matrix();
+	probe_stats.deferred_probes = probe_stats.due_probes - probe_stats.updated_probes;
+}
+
+render_view scene::make_env_probe_view(const render_view& camera_view, const env_probe* probe) const {
+	render_view probe_view(-probe->position, probe->rotation, camera_view.projection_matrix,
+						   camera_view.near_far_plane, uint4(0, 0, probe->buffers.scene_buffer->width,
+															 probe->buffers.scene_buffer->height));
+	probe_view.set_omnidirectional(probe->view_distance);
+	return probe_view;
+}
+
+void scene::draw_env_probe(const render_view& probe_view, env_probe* probe) {
+	cull_models(probe_view, DRAW_MODE::ENVIRONMENT_PASS);
+	update_model_transforms(probe_view);
+	geometry_pass(probe_view, probe->buffers, DRAW_MODE::ENVIRONMENT_PASS);
+	light_and_material_pass(probe_view, probe->buffers, DRAW_MODE::ENVIRONMENT_PASS);
+}
+
+void scene::sort_alpha_objects(const render_view& view) {
+	// sort transparency/alpha objects + assign mask ids
+	const size_t obj_count = alpha_objects.size();
+	sorted_alpha_objects.resize(obj_count);
+	if(obj_count == 0) return;
+	
+	// first, sort objects from front to back (by the squared distance of their bbox center to the camera)
+	const float3 cam_position(view.get_camera_position());
+	auto& keys = alpha_sort.keys;
+	keys.resize(obj_count);
 	for(size_t i = 0; i < obj_count; i++) {
-		for(size_t j = 0; j < 8; j++) {
-			bbox_proj[i][j] = core::get_2d_from_3d(bbox_corners[i][j], mviewt, mprojt, viewport);
-		}
+		const extbbox* box = alpha_objects[i].bbox;
+		const float3 dir(cam_position - box->pos - (box->min + box->max) * 0.5f);
+		keys[i] = make_pair(dir.dot(dir), (uint32_t)i);
 	}
-	
-	// fourth, check projected bbox overlap, TODO: use polygon/polygon intersection/overlap test
-	// TODO: http://stackoverflow.com/questions/115426/algorithm-to-detect-intersection-of-two-rectangles
-	// for the moment, do a simple rectangle/rectangle overlap test
-	int2 screen_dim((int)floor::get_physical_width(), (int)floor::get_physical_height());
-	int2 (*bbox_rects)[2] = new int2[obj_count][2];
+	std::sort(keys.begin(), keys.end(), [](const pair<float, uint32_t>& lhs, const pair<float, uint32_t>& rhs) {
+		return lhs.first < rhs.first;
+	});
 	for(size_t i = 0; i < obj_count; i++) {
-		// compute rectangle
-		bbox_rects[i][0] = int2(numeric_limits<int>::max()); // pmin
-		bbox_rects[i][1] = int2(numeric_limits<int>::min()); // pmax
-		for(size_t j = 0; j < 8; j++) {
-			if(bbox_proj[i][j].x == numeric_limits<int>::min()) continue;
-			bbox_rects[i][0].min(bbox_proj[i][j]);
-			bbox_rects[i][1].max(bbox_proj[i][j]);
-		}
-		if(bbox_rects[i][0].x == numeric_limits<int>::max() || bbox_rects[i][1].x == numeric_limits<int>::min()) {
-			// invisible
-			continue;
-		}
-		
-		// clamp to screen
-		bbox_rects[i][0].clamp(int2(0, 0), screen_dim);
-		bbox_rects[i][1].clamp(int2(0, 0), screen_dim);
+		sorted_alpha_objects[i].first = keys[i].second;
 	}
+	
+	// second, project the bbox corners onto the screen and compute the enclosing rectangles
+	// -> (local * mview + pos) * (modelview * projection) == local * (mview' * modelview * projection),
+	// with mview' being mview + the bbox position as translation. since the corners are (min + selected extents),
+	// all 8 clip space corners can be computed from the transformed min corner and the 3 transformed extents.
+	const int2 screen_dim((int)view.viewport.z, (int)view.viewport.w);
+	const float2 half_screen(float(screen_dim.x) * 0.5f, float(screen_dim.y) * 0.5f);
+	const matrix4f& mvpm(view.mvp_matrix);
+	auto& rects = alpha_sort.rects;
+	rects.resize(obj_count);
 	for(size_t i = 0; i < obj_count; i++) {
-		if(bbox_rects[i][0].x == numeric_limits<int>::max() || bbox_rects[i][1].x == numeric_limits<int>::min()) {
-			sorted_alpha_objects[i].second = numeric_limits<int>::max();
-			continue;
-		}
+		const extbbox& box = *alpha_objects[sorted_alpha_objects[i].first].bbox;
+		matrix4f box_mat(box.mview);
+		box_mat.data[12] += box.pos.x;
+		box_mat.data[13] += box.pos.y;
+		box_mat.data[14] += box.pos.z;
+		box_mat *= mvpm;
 		
-		vector<size_t> intersections;
-		for(size_t j = 0; j < obj_count; j++) {
-			if(i == j) continue;
-			if(bbox_rects[i][0].x < bbox_rects[j][1].x &&
-			   bbox_rects[i][1].x > bbox_rects[j][0].x &&
-			   bbox_rects[i][0].y < bbox_rects[j][1].y &&
-			   bbox_rects[i][1].y > bbox_rects[j][0].y) {
-				intersections.push_back(j);
-			}
-		}
+		const auto& m = box_mat.data;
+		const float3 ext(box.max - box.min);
+		const float4 base(float4(box.min, 1.0f) * box_mat);
+		const float4 axes[3] {
+			float4(m[0], m[1], m[2], m[3]) * ext.x,
+			float4(m[4], m[5], m[6], m[7]) * ext.y,
+			float4(m[8], m[9], m[10], m[11]) * ext.z,
+		};
 		
-		if(intersections.size() == 0) {
-			// if we have no intersections, simply assign mask id #1
-			sorted_alpha_objects[i].second = 1;
+		float2 rect_min(numeric_limits<float>::max()), rect_max(-numeric_limits<float>::max());
+		bool visible = false;
+		for(size_t corner = 0; corner < 8; corner++) {
+			float4 clip(base);
+			if(corner & 1) clip = clip + axes[0];
+			if(corner & 2) clip = clip + axes[1];
+			if(corner & 4) clip = clip + axes[2];
+			if(clip.w <= 0.0f) continue; // behind the camera
+			
+			const float2 screen_pos(half_screen.x * (clip.x / clip.w + 1.0f),
+									half_screen.y * (1.0f - clip.y / clip.w));
+			rect_min.min(screen_pos);
+			rect_max.max(screen_pos);
+			visible = true;
 		}
-		else {
-			// else, check which bbox is the closest and assign ids
-			// TODO: dependency list + resolving?
-			size_t mask_id = 1;
-			for(const auto& inter_iter : intersections) {
-				if(inter_iter < i) mask_id++;
-				else if(inter_iter > i) {
-					sorted_alpha_objects[i].second = std::min(mask_id, (size_t)A2E_MAX_MASK_ID);
-					break;
-				}
-			}
+		
+		if(!visible) {
+			// mark as invisible
+			rects[i].set(numeric_limits<int>::max(), numeric_limits<int>::max(),
+						 numeric_limits<int>::min(), numeric_limits<int>::min());
+			continue;
 		}
+		
+		// clamp to screen
+		rects[i].set(std::min(std::max((int)rect_min.x, 0), screen_dim.x),
+					 std::min(std::max((int)rect_min.y, 0), screen_dim.y),
+					 std::min(std::max((int)rect_max.x, 0), screen_dim.x),
+					 std::min(std::max((int)rect_max.y, 0), screen_dim.y));
 	}
 	
-	// cleanup
-	delete [] bbox_corners;
-	delete [] bbox_proj;
-	delete [] bbox_rects;
+	// third, check projected bbox overlap (TODO: use polygon/polygon intersection/overlap test)
+	alpha_sort.mask_grid.assign(rects, screen_dim, A2E_MAX_MASK_ID, sorted_alpha_objects);
 }
 
 void scene::add_alpha_object(const extbbox* bbox, const size_t& sub_object_id, a2emodel::draw_callback cb) {
 	delete_alpha_object(bbox); // clean up old data if there is any
-	alpha_objects[bbox] = make_pair(sub_object_id, cb);
-	sorted_alpha_objects.push_back(make_pair(bbox, 0));
+	alpha_object_indices.emplace(bbox, (uint32_t)alpha_objects.size());
+	alpha_objects.emplace_back(alpha_object { bbox, sub_object_id, cb });
+	// until the next sort, the object is drawn last (farthest away) with the max mask id, which is the bin it would
+	// be assigned to if it overlapped all objects in front of it (the view is only known when sorting)
+	sorted_alpha_objects.emplace_back((uint32_t)(alpha_objects.size() - 1), A2E_MAX_MASK_ID);
 }
 
 void scene::add_alpha_objects(const size_t count, const extbbox** bboxes, const size_t* sub_object_ids,
@@ -477,14 +533,29 @@ void scene::add_alpha_objects(const size_t count, const extbbox** bboxes, const
 }
 
 void scene::delete_alpha_object(const extbbox* bbox) {
-	if(alpha_objects.count(bbox) != 0) {
-		alpha_objects.erase(bbox);
-		// O(n) ... TODO: improve this
-		for(auto objiter = sorted_alpha_objects.begin(); objiter != sorted_alpha_objects.end(); objiter++) {
-			if(objiter->first == bbox) {
-				sorted_alpha_objects.erase(objiter);
-				break;
-			}
+	const auto iter = alpha_object_indices.find(bbox);
+	if(iter == alpha_object_indices.end()) return;
+	
+	// move the last object into the freed slot
+	const uint32_t index = iter->second;
+	const uint32_t last_index = (uint32_t)(alpha_objects.size() - 1);
+	alpha_object_indices.erase(iter);
+	if(index != last_index) {
+		alpha_objects[index] = std::move(alpha_objects.back());
+		alpha_object_indices[alpha_objects[index].bbox] = index;
+	}
+	alpha_objects.pop_back();
+	
+	// keep the current draw order valid (this might be called in between the alpha passes of a frame):
+	// the entry of the deleted object is disabled (mask id 0) and the entry of the moved object is redirected,
+	// the disabled entry is removed with the next sort_alpha_objects()
+	for(auto& sorted_obj : sorted_alpha_objects) {
+		if(sorted_obj.second == 0) continue;
+		if(sorted_obj.first == index) {
+			sorted_obj.second = 0;
+		}
+		else if(sorted_obj.first == last_index) {
+			sorted_obj.first = index;
 		}
 	}
 }
@@ -503,9 +574,225 @@ void scene::setup_scene() {
 	}
 }
 
+/*! culls all models against the frustum of the view
+ *  (env probes capture the complete sphere around them -> their views use a box shaped frustum)
+ */
+void scene::cull_models(const render_view& view, const DRAW_MODE draw_mode_or_mask) {
+	view_frustum = view.view_frustum;
+	
+	// reset the previous view (models that aren't found by the bvh query below are not visible at all)
+	for(const auto& model : visible_models) {
+		model->clear_visibility();
+	}
+	
+	// update moved models and gather all models that are potentially visible
+	model_bvh.refit();
+	visible_models.clear();
+	model_bvh.query(view_frustum, visible_models);
+	cull_stats.culled_models += models.size() - visible_models.size();
+	
+	// exact per-model/sub-object test
+	size_t visible_count = 0;
+	for(const auto& model : visible_models) {
+		if(!model->get_visible()) continue;
+		
+		const size_t sub_object_count = model->get_object_count();
+		const size_t visible_sub_objects = model->cull(view_frustum);
+		cull_stats.drawn_sub_objects += visible_sub_objects;
+		cull_stats.culled_sub_objects += sub_object_count - visible_sub_objects;
+		if(visible_sub_objects == 0) {
+			cull_stats.culled_models++;
+			continue;
+		}
+		cull_stats.drawn_models++;
+		visible_models[visible_count++] = model;
+	}
+	visible_models.resize(visible_count);
+	
+	// env probes capture everything around them -> only occlusion cull the main view
+	if(occlusion_culling && (draw_mode_or_mask & DRAW_MODE::ENVIRONMENT_PASS) == DRAW_MODE::NONE) {
+		cull_occluded_models(view);
+	}
+}
+
+void scene::cull_occluded_models(const render_view& view) {
+	// rasterize the collision meshes of all visible occluders
+	occlusion.begin(view.mvp_matrix);
+	for(const auto& model : visible_models) {
+		if(!model->get_occluder()) continue;
+		if(model->get_col_vertices() == nullptr || model->get_col_indices() == nullptr) continue;
+		occlusion.add_occluder(model->get_col_vertices(), model->get_col_vertex_count(),
+							   model->get_col_indices(), model->get_col_index_count(),
+							   model->get_world_matrix());
+	}
+	if(occlusion.get_stats().occluder_count == 0) return;
+	occlusion.rasterize();
+	
+	// test all other models against it (in parallel, each model only modifies its own visibility)
+	occlusion_results.resize(visible_models.size());
+	scheduler->parallel_for(visible_models.size(), min_models_per_task, [this](const size_t begin, const size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			a2emodel* model = visible_models[i];
+			if(model->get_occluder()) continue;
+			
+			size_t prev_visible_sub_objects = 0;
+			const size_t sub_object_count = model->get_object_count();
+			for(size_t j = 0; j < sub_object_count; j++) {
+				if(model->get_sub_object_visible(j)) prev_visible_sub_objects++;
+			}
+			occlusion_results[i] = make_pair(prev_visible_sub_objects, model->cull_occluded(occlusion));
+		}
+	});
+	
+	// remove all occluded models + update the stats (in the original order)
+	size_t visible_count = 0;
+	for(size_t model_idx = 0, model_count = visible_models.size(); model_idx < model_count; model_idx++) {
+		a2emodel* model = visible_models[model_idx];
+		if(model->get_occluder()) {
+			visible_models[visible_count++] = model;
+			continue;
+		}
+		
+		const size_t visible_sub_objects = occlusion_results[model_idx].second;
+		const size_t occluded_sub_objects = occlusion_results[model_idx].first - visible_sub_objects;
+		cull_stats.drawn_sub_objects -= occluded_sub_objects;
+		cull_stats.culled_sub_objects += occluded_sub_objects;
+		cull_stats.occluded_sub_objects += occluded_sub_objects;
+		if(visible_sub_objects == 0) {
+			cull_stats.drawn_models--;
+			cull_stats.culled_models++;
+			cull_stats.occluded_models++;
+			continue;
+		}
+		visible_models[visible_count++] = model;
+	}
+	visible_models.resize(visible_count);
+}
+
+void scene::update_model_transforms(const render_view& view) {
+	// new view
+	view_stamp++;
+	cur_view_transforms.mvm = view.modelview_matrix;
+	cur_view_transforms.mvpm = view.mvp_matrix;
+	cur_view_transforms.mvpm_backside = view.get_backside_mvp_matrix();
+	
+	// view dependent matrices of all visible models (world matrices are cached and only change when a model is moved)
+	scheduler->parallel_for(visible_models.size(), min_models_per_task, [this](const size_t begin, const size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			a2emodel* model = visible_models[i];
+			const matrix4f& world = model->get_world_matrix();
+			model->set_view_transforms(world * cur_view_transforms.mvm,
+									   world * cur_view_transforms.mvpm,
+									   world * cur_view_transforms.mvpm_backside,
+									   view_stamp);
+		}
+	});
+}
+
+const scene::view_transforms& scene::get_view_transforms() const {
+	return cur_view_transforms;
+}
+
+size_t scene::get_view_stamp() const {
+	return view_stamp;
+}
+
+void scene::draw_opaque_models(const render_view& view, const DRAW_MODE draw_mode) {
+	// pass bits: the environment pass is drawn with different shader options
+	const uint32_t pass = ((draw_mode & DRAW_MODE::ENVIRONMENT_PASS) != DRAW_MODE::NONE ? 1u : 0u);
+	const float3 cam_position(view.get_camera_position());
+	const float inv_far_plane = 1.0f / view.near_far_plane.y;
+	
+	opaque_queue.clear();
+	for(const auto& model : visible_models) {
+		// models that can't be drawn per sub-object (or aren't drawn at all) are drawn as a whole right away
+		if(!model->supports_render_queue()) {
+			model->draw(view, draw_mode);
+			continue;
+		}
+		
+		const unsigned int object_count = model->get_object_count();
+		for(unsigned int i = 0; i < object_count; i++) {
+			if(!model->get_sub_object_visible(i) || model->get_transparent(i)) continue;
+			
+			// front to back: distance of the sub-object bbox center to the camera, normalized by the far plane
+			float depth = 0.0f;
+			const extbbox* box = model->get_bounding_box(i);
+			if(box != nullptr) {
+				depth = (cam_position - box->pos - (box->min + box->max) * 0.5f).length() * inv_far_plane;
+			}
+			
+			uint32_t shader_id = 0, material_id = 0, mesh_id = 0;
+			model->get_render_state(draw_mode, i, shader_id, material_id, mesh_id);
+			opaque_queue.push(render_queue::make_key(pass, shader_id, material_id, mesh_id, depth), model, i,
+							  shader_id, material_id);
+		}
+	}
+	opaque_queue.sort();
+	build_opaque_draws(draw_mode);
+	
+	for(const auto& draw : opaque_draws) {
+		const render_queue::item& item = opaque_queue[draw.item];
+		if(draw.command_count == 0) {
+			item.model->draw_queued(view, draw_mode, item.sub_object);
+		}
+		else {
+			item.model->draw_multi(view, draw_mode, item.sub_object, draw.first_command, draw.command_count,
+								   &multi_draw_transforms[draw.first_command]);
+		}
+	}
+}
+
+void scene::build_opaque_draws(const DRAW_MODE draw_mode) {
+	opaque_draws.clear();
+	multi_draw_transforms.clear();
+	geometry_arena* arena = engine::get_geometry_arena();
+	if(arena != nullptr) arena->clear_commands();
+	
+	const size_t item_count = opaque_queue.size();
+	size_t first_index = 0, index_count = 0;
+	geometry_arena::allocation alloc;
+	for(size_t i = 0; i < item_count;) {
+		const render_queue::item& item = opaque_queue[i];
+		if(arena == nullptr ||
+		   !item.model->get_multi_draw_command(draw_mode, item.sub_object, first_index, index_count, alloc)) {
+			opaque_draws.push_back({ i, 0, 0 });
+			i++;
+			continue;
+		}
+		
+		// the sort key may be truncated -> compare the full render state
+		size_t batch_end = i + 1;
+		for(; batch_end < item_count; batch_end++) {
+			const render_queue::item& next = opaque_queue[batch_end];
+			size_t next_first_index = 0, next_index_count = 0;
+			geometry_arena::allocation next_alloc;
+			if(!next.model->get_multi_draw_command(draw_mode, next.sub_object, next_first_index, next_index_count,
+												   next_alloc)) break;
+			if(next.shader_id != item.shader_id || next.material_id != item.material_id) break;
+		}
+		
+		// a single sub-object isn't worth the batch setup
+		if(batch_end - i == 1) {
+			opaque_draws.push_back({ i, 0, 0 });
+			i++;
+			continue;
+		}
+		
+		opaque_draws.push_back({ i, arena->get_command_count(), batch_end - i });
+		for(; i < batch_end; i++) {
+			const render_queue::item& batch_item = opaque_queue[i];
+			batch_item.model->get_multi_draw_command(draw_mode, batch_item.sub_object, first_index, index_count, alloc);
+			multi_draw_transforms.emplace_back(batch_item.model->get_model_transform());
+			arena->add_command(alloc, first_index, index_count, multi_draw_transforms.back().world);
+		}
+	}
+	if(arena != nullptr) arena->upload_commands();
+}
+
 /*! starts drawing the scene
  */
-void scene::geometry_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_mask) {
+void scene::geometry_pass(const render_view& view, frame_buffers& buffers, const DRAW_MODE draw_mode_or_mask) {
 	const DRAW_MODE geom_pass_masked = DRAW_MODE::GEOMETRY_PASS | draw_mode_or_mask;
 	const DRAW_MODE geom_alpha_pass_masked = DRAW_MODE::GEOMETRY_ALPHA_PASS | draw_mode_or_mask;
 	
@@ -518,16 +805,14 @@ void scene::geometry_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_m
 	glDrawBuffers(1, draw_buffers);
 #endif
 	
-	// render models (opaque)
-	for(const auto& iter : models) {
-		if(iter->get_visible()) iter->draw(geom_pass_masked);
-	}
+	// render models (opaque, only those that survived culling)
+	draw_opaque_models(view, geom_pass_masked);
 	
 	// render skybox
 	if(render_skybox) {
 		// TODO: GL3 (-> freealbion code)
 	}
-
+	
 	// render physical objects
 	for(const auto& model : models) {
 		if(model->get_draw_phys_obj()) model->draw_phys_obj();
@@ -535,7 +820,7 @@ void scene::geometry_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_m
 	
 	// render callbacks (opaque)
 	for(const auto& draw_cb : draw_callbacks) {
-		(*draw_cb.second)(geom_pass_masked);
+		(*draw_cb.second)(view, geom_pass_masked);
 	}
 	
 	r->stop_draw();
@@ -548,13 +833,14 @@ void scene::geometry_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_m
 		glDrawBuffers(2, draw_buffers);
 		
 		for(auto iter = sorted_alpha_objects.crbegin(); iter != sorted_alpha_objects.crend(); iter++) {
+			if(iter->second == 0) continue; // deleted since the last sort
 			const auto& obj = alpha_objects[iter->first];
-			obj.second(geom_alpha_pass_masked, obj.first, iter->second);
+			obj.draw_cb(view, geom_alpha_pass_masked, obj.sub_object_id, iter->second);
 		}
 		
 		// render callbacks (alpha)
 		for(const auto& draw_cb : draw_callbacks) {
-			(*draw_cb.second)(geom_alpha_pass_masked);
+			(*draw_cb.second)(view, geom_alpha_pass_masked);
 		}
 		
 		r->stop_draw();
@@ -564,7 +850,65 @@ void scene::geometry_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_m
 	}
 }
 
-void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_mask) {
+/*! uploads the current light cluster data to the texture buffers (light_clusters: RG32UI (offset, count),
+ *  light_indices: R32UI, light_data: RGBA32F (2 texels per light)), buffers are created on first use.
+ *  interface of the "IR_LP_CLUSTERED" shader: the three buffers are bound as the samplerBuffer/usamplerBuffer
+ *  uniforms "light_clusters", "light_indices" and "light_data" (layouts: see light_clusters.hpp), plus the
+ *  "cluster_grid" (uvec3) and "cluster_depth_params" (vec2, slice = log(view depth) * x + y) uniforms
+ */
+void scene::upload_light_clusters() {
+#if !defined(FLOOR_IOS)
+	// the buffers of this frame slot are no longer used by the gpu (-> no orphaning necessary)
+	light_cluster_slot = engine::get_frame_sync()->get_frame_slot();
+#if defined(A2E_DEBUG)
+	engine::get_frame_sync()->check_writable(light_cluster_slot, "light clusters");
+#endif
+	GLuint* buffers = light_cluster_buffers[light_cluster_slot];
+	GLuint* textures = light_cluster_textures[light_cluster_slot];
+	size_t* buffer_sizes = light_cluster_buffer_sizes[light_cluster_slot];
+	if(buffers[0] == 0) {
+		glGenBuffers(3, buffers);
+		glGenTextures(3, textures);
+	}
+	
+	const auto& clusters = clustered_lights.get_clusters();
+	const auto& indices = clustered_lights.get_light_indices();
+	const auto& data = clustered_lights.get_light_data();
+	
+	// note: empty buffers are not allowed -> always allocate at least one element
+	static const uint32_t empty_data[4] { 0, 0, 0, 0 };
+	const struct {
+		const void* data;
+		size_t size;
+		GLenum format;
+	} uploads[3] {
+		{ clusters.data(), clusters.size() * sizeof(uint2), GL_RG32UI },
+		{ indices.data(), indices.size() * sizeof(uint32_t), GL_R32UI },
+		{ data.data(), data.size() * sizeof(float4), GL_RGBA32F },
+	};
+	for(size_t i = 0; i < 3; i++) {
+		const bool empty = (uploads[i].size == 0);
+		const size_t size = (empty ? sizeof(empty_data) : uploads[i].size);
+		const void* data_ptr = (empty ? empty_data : uploads[i].data);
+		gl_state::bind_buffer(GL_TEXTURE_BUFFER, buffers[i]);
+		if(size <= buffer_sizes[i]) {
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)size, data_ptr);
+			continue;
+		}
+		
+		// grow the storage (the texture must be re-attached to it)
+		glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)size, data_ptr, GL_DYNAMIC_DRAW);
+		buffer_sizes[i] = size;
+		gl_state::bind_texture(GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, uploads[i].format, buffers[i]);
+	}
+	gl_state::bind_texture(GL_TEXTURE_BUFFER, 0);
+	gl_state::bind_buffer(GL_TEXTURE_BUFFER, 0);
+#endif
+}
+
+void scene::light_and_material_pass(const render_view& view, frame_buffers& buffers,
+									const DRAW_MODE draw_mode_or_mask) {
 	//
 	rtt::fbo* scene_buffer = buffers.scene_buffer;
 	rtt::fbo* fxaa_buffer = buffers.fxaa_buffer;
@@ -572,10 +916,9 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 	
 	// some parameters required both by the shader and the opencl version
 	// compute projection constants (necessary to reconstruct world pos)
-	const float2 near_far_plane = floor::get_near_far_plane();
-	const float2 projection_ab = float2(near_far_plane.y / (near_far_plane.y - near_far_plane.x),
-										(-near_far_plane.y * near_far_plane.x) / (near_far_plane.y - near_far_plane.x));
-	const float3 cam_position = -float3(*engine::get_position());
+	const float2 near_far_plane = view.near_far_plane;
+	const float2 projection_ab = view.get_projection_ab();
+	const float3 cam_position = view.get_camera_position();
 	const float2 screen_size = float2(float(l_buffer->width), float(l_buffer->height));
 #if !defined(FLOOR_IOS)
 	const bool light_alpha_objects = (!alpha_objects.empty() &&
@@ -586,9 +929,9 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 #endif
 	
 	// TODO: cleanup
-	const matrix4f projection_matrix = *engine::get_projection_matrix();
-	const matrix4f modelview_matrix = *engine::get_modelview_matrix();
-	const matrix4f mvpm = modelview_matrix * projection_matrix;
+	const matrix4f& projection_matrix = view.projection_matrix;
+	const matrix4f& modelview_matrix = view.modelview_matrix;
+	const matrix4f& mvpm = view.mvp_matrix;
 	const matrix4f inv_modelview_matrix = matrix4f(modelview_matrix).invert();
 	
 #if !defined(A2E_INFERRED_RENDERING_CL)
@@ -597,13 +940,43 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 	// light 1st: opaque geometry, 2nd: alpha geometry
 	
 	// set blend mode (add all light results)
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+	gl_state::enable(GL_BLEND);
+	gl_state::blend_func(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
 	
 	// shader init
 	gl_shader ir_lighting = s->get_gl_shader("IR_LP_ASHIKHMIN_SHIRLEY");
 	gl_shader ir_stencil = s->get_gl_shader("IR_LP_STENCIL");
 	
+	// sets the view dependent uniforms of the current program (once per pass, not per light)
+	const auto set_view_uniforms = [&](gl_shader& shd, const bool set_mvpm) {
+		if(set_mvpm) shd->uniform(A2E_SHADER_VAR("mvpm"), mvpm);
+		shd->uniform(A2E_SHADER_VAR("imvm"), inv_modelview_matrix);
+		shd->uniform(A2E_SHADER_VAR("cam_position"), cam_position);
+		shd->uniform(A2E_SHADER_VAR("screen_size"), screen_size);
+		shd->uniform(A2E_SHADER_VAR("projection_ab"), projection_ab);
+	};
+	
+	// clustered lighting only works with a perspective projection (-> not for the dual-paraboloid env probes)
+	gl_shader ir_clustered = nullptr;
+#if !defined(FLOOR_IOS)
+	if(clustered_lighting &&
+	   (draw_mode_or_mask & DRAW_MODE::ENVIRONMENT_PASS) == DRAW_MODE::NONE) {
+		ir_clustered = s->get_gl_shader("IR_LP_CLUSTERED");
+		// the clusters of the main view have usually been built concurrently to the geometry pass (see draw)
+		if(light_clusters_pending) {
+			light_cluster_group.wait();
+			light_clusters_pending = false;
+		}
+		else if(ir_clustered != nullptr) {
+			clustered_lights.build(lights, modelview_matrix, projection_matrix, near_far_plane);
+		}
+		if(ir_clustered != nullptr) {
+			upload_light_clusters();
+			gl_timer::mark("LIGHT_CLUSTERS");
+		}
+	}
+#endif
+	
 	gl_timer::mark("LIGHT_PASS_START");
 	for(size_t light_pass = 0; light_pass < (light_alpha_objects ? 2 : 1); light_pass++) {
 #if defined(A2E_COPY_DEPTH_BUFFER) // TODO: remove this if it works w/o problems on all graphics cards
@@ -629,20 +1002,57 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 		static const GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
 		glDrawBuffers(2, draw_buffers);
 #endif
-		glDepthMask(GL_FALSE);
+		gl_state::depth_mask(GL_FALSE);
 		
 		for(size_t light_type = 0; light_type < 2; light_type++) {
 			// first: all point and spot (TODO) lights
+#if !defined(FLOOR_IOS)
+			if(light_type == 0 && ir_clustered != nullptr) {
+				// all point lights at once: full-screen pass, the shader looks up the lights of each pixels cluster
+				gl_state::cull_face(GL_BACK);
+				gl_state::front_face(GL_CCW);
+				gl_state::depth_func(GL_LESS);
+				
+				ir_clustered->use();
+				set_view_uniforms(ir_clustered, false);
+				ir_clustered->uniform(A2E_SHADER_VAR("cluster_grid"), clustered_lights.get_grid_size());
+				ir_clustered->uniform(A2E_SHADER_VAR("cluster_depth_params"), clustered_lights.get_depth_slice_params());
+				ir_clustered->texture(A2E_SHADER_VAR("normal_nuv_buffer"), buffers.g_buffer[light_pass]->tex[0], GL_TEXTURE_2D);
+				ir_clustered->texture(A2E_SHADER_VAR("depth_buffer"), buffers.g_buffer[light_pass]->depth_buffer, GL_TEXTURE_2D);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+				const GLuint* cluster_textures = light_cluster_textures[light_cluster_slot];
+				ir_clustered->texture(A2E_SHADER_VAR("light_clusters"), cluster_textures[0], GL_TEXTURE_BUFFER);
+				ir_clustered->texture(A2E_SHADER_VAR("light_indices"), cluster_textures[1], GL_TEXTURE_BUFFER);
+				ir_clustered->texture(A2E_SHADER_VAR("light_data"), cluster_textures[2], GL_TEXTURE_BUFFER);
+				
+				ir_clustered->attribute_array("in_vertex", gfx2d::get_fullscreen_quad_vbo(), 2, GL_FLOAT);
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+				ir_clustered->disable();
+				gl_timer::mark("LIGHT_PASS_CLUSTERED");
+			}
+			else
+#endif
 			if(light_type == 0) {
 				// render outer lights
-				glEnable(GL_STENCIL_TEST);
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, light_sphere->get_vbo_indices(0));
+				gl_state::enable(GL_STENCIL_TEST);
+				gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, light_sphere->get_vbo_indices(0));
+				
+				// uniforms are program state -> set everything that doesn't depend on the light only once
+				ir_stencil->use();
+				ir_stencil->uniform(A2E_SHADER_VAR("mvpm"), mvpm);
+				ir_lighting->use(default_option_id, 0);
+				set_view_uniforms(ir_lighting, true);
+				ir_lighting->texture(A2E_SHADER_VAR("normal_nuv_buffer"), buffers.g_buffer[light_pass]->tex[0], GL_TEXTURE_2D);
+				ir_lighting->texture(A2E_SHADER_VAR("depth_buffer"), buffers.g_buffer[light_pass]->depth_buffer, GL_TEXTURE_2D);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+				ir_lighting->disable();
+				
 				for(const auto& li : lights) {
 					if(!li->is_enabled()) continue;
 					if(li->get_type() != light::LIGHT_TYPE::POINT) continue;
 					
 					//
-					const float light_dist = (cam_position - li->get_position()).length() - floor::get_near_far_plane().x;
+					const float light_dist = (cam_position - li->get_position()).length() - near_far_plane.x;
 					if(light_dist <= li->get_radius()) continue; // if the camera is within a light, skip it for now
 					
 					//
@@ -650,22 +1060,21 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 						if(stencil_light_pass == 0) {
 							glStencilFunc(GL_ALWAYS, 1, 0xFFFFFFFF);
 							glStencilOp(GL_KEEP, GL_INVERT, GL_KEEP);
-							glDisable(GL_CULL_FACE);
-							glEnable(GL_DEPTH_TEST);
-							glDisable(GL_BLEND);
-							glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+							gl_state::disable(GL_CULL_FACE);
+							gl_state::enable(GL_DEPTH_TEST);
+							gl_state::disable(GL_BLEND);
+							gl_state::color_mask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 							
 							ir_stencil->use();
-							ir_stencil->uniform("mvpm", mvpm);
-							ir_stencil->uniform("light_position", float4(li->get_position(), li->get_radius()));
-							ir_stencil->attribute_array("in_vertex", light_sphere->get_vbo_vertices(), 3, GL_FLOAT);
+							ir_stencil->uniform(A2E_SHADER_VAR("light_position"), float4(li->get_position(), li->get_radius()));
+							ir_stencil->attribute_array(A2E_SHADER_VAR("in_vertex"), light_sphere->get_vbo_vertices(), 3, GL_FLOAT);
 						}
 						else {
-							glEnable(GL_CULL_FACE);
-							glCullFace(GL_FRONT);
-							glDisable(GL_DEPTH_TEST);
-							glEnable(GL_BLEND);
-							glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+							gl_state::enable(GL_CULL_FACE);
+							gl_state::cull_face(GL_FRONT);
+							gl_state::disable(GL_DEPTH_TEST);
+							gl_state::enable(GL_BLEND);
+							gl_state::color_mask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 							
 							//glStencilFuncSeparate(GL_FRONT, GL_ALWAYS, 0, 0xFFFFFFFF);
 							//glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_KEEP);
@@ -675,19 +1084,10 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 							glStencilFuncSeparate(GL_BACK, GL_NOTEQUAL, 0, 0xFFFFFFFF);
 							glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_ZERO);
 							
-							ir_lighting->use("#");
-							ir_lighting->uniform("mvpm", mvpm);
-							ir_lighting->uniform("imvm", inv_modelview_matrix);
-							ir_lighting->uniform("cam_position", cam_position);
-							ir_lighting->uniform("screen_size", screen_size);
-							ir_lighting->uniform("projection_ab", projection_ab);
-							ir_lighting->texture("normal_nuv_buffer",  buffers.g_buffer[light_pass]->tex[0], GL_TEXTURE_2D);
-							ir_lighting->texture("depth_buffer", buffers.g_buffer[light_pass]->depth_buffer, GL_TEXTURE_2D);
-							glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
-							
-							ir_lighting->uniform("light_position", float4(li->get_position(), li->get_radius()));
-							ir_lighting->uniform("light_color", float4(li->get_color(), li->get_inv_sqr_radius()));
-							ir_lighting->attribute_array("in_vertex", light_sphere->get_vbo_vertices(), 3, GL_FLOAT);
+							ir_lighting->use(default_option_id, 0);
+							ir_lighting->uniform(A2E_SHADER_VAR("light_position"), float4(li->get_position(), li->get_radius()));
+							ir_lighting->uniform(A2E_SHADER_VAR("light_color"), float4(li->get_color(), li->get_inv_sqr_radius()));
+							ir_lighting->attribute_array(A2E_SHADER_VAR("in_vertex"), light_sphere->get_vbo_vertices(), 3, GL_FLOAT);
 						}
 						
 						glDrawElements(GL_TRIANGLES, (GLsizei)light_sphere->get_index_count(0) * 3, GL_UNSIGNED_INT, nullptr);
@@ -698,61 +1098,51 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 				}
 				gl_timer::mark("LIGHT_PASS_OUTER");
 				
-				glDisable(GL_STENCIL_TEST);
-				glEnable(GL_DEPTH_TEST);
-				glEnable(GL_CULL_FACE);
-				glCullFace(GL_FRONT);
+				gl_state::disable(GL_STENCIL_TEST);
+				gl_state::enable(GL_DEPTH_TEST);
+				gl_state::enable(GL_CULL_FACE);
+				gl_state::cull_face(GL_FRONT);
 				
 				// render inner lights
-				glDepthFunc(GL_GREATER);
-				ir_lighting->use("#");
-				ir_lighting->uniform("mvpm", mvpm);
-				ir_lighting->uniform("imvm", inv_modelview_matrix);
-				ir_lighting->uniform("cam_position", cam_position);
-				ir_lighting->uniform("screen_size", screen_size);
-				ir_lighting->uniform("projection_ab", projection_ab);
-				ir_lighting->texture("normal_nuv_buffer", buffers.g_buffer[light_pass]->tex[0], GL_TEXTURE_2D);
-				ir_lighting->texture("depth_buffer", buffers.g_buffer[light_pass]->depth_buffer, GL_TEXTURE_2D);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+				gl_state::depth_func(GL_GREATER);
+				// (view uniforms and textures were already set above)
+				ir_lighting->use(default_option_id, 0);
 				for(const auto& li : lights) {
 					if(!li->is_enabled()) continue;
 					if(li->get_type() != light::LIGHT_TYPE::POINT) continue;
 					
 					//
-					const float light_dist = (cam_position - li->get_position()).length() - floor::get_near_far_plane().x;
+					const float light_dist = (cam_position - li->get_position()).length() - near_far_plane.x;
 					if(light_dist > li->get_radius()) continue; // skip all outer lights
 					
-					ir_lighting->uniform("light_position", float4(li->get_position(), li->get_radius()));
-					ir_lighting->uniform("light_color", float4(li->get_color(), li->get_inv_sqr_radius()));
-					ir_lighting->attribute_array("in_vertex", light_sphere->get_vbo_vertices(), 3, GL_FLOAT);
+					ir_lighting->uniform(A2E_SHADER_VAR("light_position"), float4(li->get_position(), li->get_radius()));
+					ir_lighting->uniform(A2E_SHADER_VAR("light_color"), float4(li->get_color(), li->get_inv_sqr_radius()));
+					ir_lighting->attribute_array(A2E_SHADER_VAR("in_vertex"), light_sphere->get_vbo_vertices(), 3, GL_FLOAT);
 					glDrawElements(GL_TRIANGLES, (GLsizei)light_sphere->get_index_count(0) * 3, GL_UNSIGNED_INT, nullptr);
 				}
 				ir_lighting->disable();
 				gl_timer::mark("LIGHT_PASS_INNER");
 				
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+				gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 			}
 			// second: all directional lights
 			else if(light_type == 1) {
-				ir_lighting->use("directional");
-				ir_lighting->uniform("imvm", inv_modelview_matrix);
-				ir_lighting->uniform("cam_position", cam_position);
-				ir_lighting->uniform("screen_size", screen_size);
-				ir_lighting->uniform("projection_ab", projection_ab);
-				ir_lighting->texture("normal_nuv_buffer", buffers.g_buffer[light_pass]->tex[0], GL_TEXTURE_2D);
-				ir_lighting->texture("depth_buffer", buffers.g_buffer[light_pass]->depth_buffer, GL_TEXTURE_2D);
+				ir_lighting->use(directional_option_id, 0);
+				set_view_uniforms(ir_lighting, false);
+				ir_lighting->texture(A2E_SHADER_VAR("normal_nuv_buffer"), buffers.g_buffer[light_pass]->tex[0], GL_TEXTURE_2D);
+				ir_lighting->texture(A2E_SHADER_VAR("depth_buffer"), buffers.g_buffer[light_pass]->depth_buffer, GL_TEXTURE_2D);
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
 				
-				glCullFace(GL_BACK);
-				glFrontFace(GL_CCW);
-				glDepthFunc(GL_LESS);
+				gl_state::cull_face(GL_BACK);
+				gl_state::front_face(GL_CCW);
+				gl_state::depth_func(GL_LESS);
 				for(const auto& li : lights) {
 					if(!li->is_enabled()) continue;
 					if(li->get_type() != light::LIGHT_TYPE::DIRECTIONAL) continue;
 					
-					ir_lighting->uniform("light_position", float4(li->get_position(), 0.0f));
-					ir_lighting->uniform("light_color", float4(li->get_color(), 0.0f));
-					ir_lighting->uniform("light_ambient", float4(li->get_ambient(), 0.0f));
+					ir_lighting->uniform(A2E_SHADER_VAR("light_position"), float4(li->get_position(), 0.0f));
+					ir_lighting->uniform(A2E_SHADER_VAR("light_color"), float4(li->get_color(), 0.0f));
+					ir_lighting->uniform(A2E_SHADER_VAR("light_ambient"), float4(li->get_ambient(), 0.0f));
 					
 					ir_lighting->attribute_array("in_vertex", gfx2d::get_fullscreen_quad_vbo(), 2, GL_FLOAT);
 					glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -768,12 +1158,12 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 	}
 	
 	// reset state
-	glDisable(GL_STENCIL_TEST);
-	glDepthMask(GL_TRUE);
-	glEnable(GL_DEPTH_TEST);
-	glCullFace(GL_BACK);
-	glEnable(GL_CULL_FACE);
-	glDisable(GL_BLEND);
+	gl_state::disable(GL_STENCIL_TEST);
+	gl_state::depth_mask(GL_TRUE);
+	gl_state::enable(GL_DEPTH_TEST);
+	gl_state::cull_face(GL_BACK);
+	gl_state::enable(GL_CULL_FACE);
+	gl_state::disable(GL_BLEND);
 	
 	gl_timer::mark("LIGHT_PASS_END");
 	
@@ -823,10 +1213,10 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 	
 	// copy depth texture
 	glBindFramebuffer(GL_FRAMEBUFFER, buffers.cl.depth_copy_fbo);
-	glBindTexture(GL_TEXTURE_2D, buffers.cl.depth_copy_tex);
+	gl_state::bind_texture(GL_TEXTURE_2D, buffers.cl.depth_copy_tex);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buffers.g_buffer[0]->depth_buffer, 0);
 	glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, 0, 0, buffers.g_buffer[0]->width, buffers.g_buffer[0]->height, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_state::bind_texture(GL_TEXTURE_2D, 0);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	
 	r->start_draw(buffers.l_buffer[0]);
@@ -871,52 +1261,48 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 #endif
 	if(scene_buffer->depth_type == rtt::DEPTH_TYPE::TEXTURE_2D) {
 		r->clear(GL_COLOR_BUFFER_BIT); // only clear color, keep depth
-		glDepthFunc(GL_EQUAL);
-		glDepthMask(GL_FALSE);
+		gl_state::depth_func(GL_EQUAL);
+		gl_state::depth_mask(GL_FALSE);
 	}
 	else r->clear();
 	
 	// render models (opaque)
-	size_t model_counter = 0;
 	gl_timer::mark("MAT_PASS_OPAQUE_START");
-	for(const auto& iter : models) {
-		if(iter->get_visible()) {
-			iter->set_ir_buffers(buffers.g_buffer[0], buffers.l_buffer[0],
-								 buffers.g_buffer[1], buffers.l_buffer[1]);
-			iter->draw(mat_pass_masked);
-			gl_timer::mark("MDL #"+to_string(model_counter));
-			model_counter++;
-		}
+	for(const auto& model : visible_models) {
+		model->set_ir_buffers(buffers.g_buffer[0], buffers.l_buffer[0],
+							  buffers.g_buffer[1], buffers.l_buffer[1]);
 	}
+	draw_opaque_models(view, mat_pass_masked);
 	gl_timer::mark("MAT_PASS_OPAQUE");
 	
 	// render callbacks (opaque pass)
 	for(const auto& draw_cb : draw_callbacks) {
-		(*draw_cb.second)(mat_pass_masked);
+		(*draw_cb.second)(view, mat_pass_masked);
 	}
 	gl_timer::mark("MAT_PASS_OPAQUE_CB");
 	
 	// for alpha objects and particles rendering, switch back to LEQUAL,
 	// b/c they are not contained in the current depth buffer
-	glDepthFunc(GL_LESS);
-	glDepthMask(GL_TRUE);
+	gl_state::depth_func(GL_LESS);
+	gl_state::depth_mask(GL_TRUE);
 	
 #if !defined(FLOOR_IOS)
 	if(sorted_alpha_objects.size() > 0 || draw_callbacks.size() > 0) {
 		// render models (transparent/alpha)
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // pre-multiplied alpha blending
+		gl_state::enable(GL_BLEND);
+		gl_state::blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA); // pre-multiplied alpha blending
 		for(auto iter = sorted_alpha_objects.crbegin(); iter != sorted_alpha_objects.crend(); iter++) {
+			if(iter->second == 0) continue; // deleted since the last sort
 			const auto& obj = alpha_objects[iter->first];
-			obj.second(mat_alpha_pass_masked, obj.first, iter->second);
+			obj.draw_cb(view, mat_alpha_pass_masked, obj.sub_object_id, iter->second);
 		}
 		gl_timer::mark("MAT_PASS_ALPHA");
 		// render callbacks (alpha pass)
 		for(const auto& draw_cb : draw_callbacks) {
-			(*draw_cb.second)(mat_alpha_pass_masked);
+			(*draw_cb.second)(view, mat_alpha_pass_masked);
 		}
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glDisable(GL_BLEND);
+		gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		gl_state::disable(GL_BLEND);
 		gl_timer::mark("MAT_PASS_ALPHA_CB");
 	}
 #else
@@ -925,7 +1311,7 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 	
 	// render/draw particle managers
 	for(const auto& pm : particle_managers) {
-		pm->draw(buffers.g_buffer[0]);
+		pm->draw(view, buffers.g_buffer[0]);
 	}
 	gl_timer::mark("MAT_PASS_PARTICLES");
 	
@@ -960,9 +1346,9 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
 		fxaa_shd->uniform("texel_size",
 						  float2(1.0f) / float2(fxaa_buffer->width, fxaa_buffer->height));
 		
-		glFrontFace(GL_CW);
+		gl_state::front_face(GL_CW);
 		gfx2d::draw_fullscreen_triangle();
-		glFrontFace(GL_CCW);
+		gl_state::front_face(GL_CCW);
 		
 		fxaa_shd->disable();
 		
@@ -985,18 +1371,19 @@ void scene::light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw
  */
 void scene::add_model(a2emodel* model) {
 	models.push_back(model);
+	model_bvh.insert(model);
 }
 
 /*! removes a model from the scene
  *  @param model pointer to the model
  */
 void scene::delete_model(a2emodel* model) {
-	const auto iter = find(models.begin(), models.end(), model);
-	if(iter == models.end()) {
+	if(!model_bvh.remove(model)) {
 		log_error("can't delete model: model doesn't exist!");
 		return;
 	}
-	models.erase(iter);
+	models.erase(find(models.begin(), models.end(), model));
+	visible_models.erase(remove(visible_models.begin(), visible_models.end(), model), end(visible_models));
 }
 
 /*! adds a light to the scene
@@ -1092,15 +1479,11 @@ void scene::set_enabled(const bool& status) {
 	if(status != enabled) {
 		if(!status) {
 			// delete all scene buffers since they aren't needed
-			for(size_t i = 0; i < A2E_CONCURRENT_FRAMES; i++) {
-				delete_buffers(frames[i]);
-			}
+			delete_buffers(main_buffers);
 		}
 		else {
 			// recreate buffers again if the scene gets reenabled
-			for(size_t i = 0; i < A2E_CONCURRENT_FRAMES; i++) {
-				recreate_buffers(frames[i], size2(floor::get_physical_width(), floor::get_physical_height()));
-			}
+			recreate_buffers(main_buffers, size2(floor::get_physical_width(), floor::get_physical_height()));
 		}
 	}
 	enabled = status;
@@ -1140,20 +1523,73 @@ void scene::delete_draw_callback(const string& name) {
 scene::env_probe* scene::add_environment_probe(const float3& pos, const float2& rot, const size2 buffer_size, const bool capture_alpha) {
 	const size2 dual_buffer_size(buffer_size.x * 2, buffer_size.y);
 	env_probe* probe = new env_probe(pos, rot, dual_buffer_size, capture_alpha);
-	recreate_buffers(probe->buffers, probe->buffer_size, probe->capture_alpha);
 	add_environment_probe(probe);
 	return probe;
 }
 
 void scene::add_environment_probe(scene::env_probe* probe) {
 	if(probe == nullptr) return;
+	if(probe->buffers.scene_buffer == nullptr) create_probe_buffers(probe);
+	probe->last_update_frame = probe_frame;
 	env_probes.insert(probe);
 }
 
 void scene::delete_environment_probe(env_probe* probe) {
-	delete_buffers(probe->buffers);
+	if(probe == nullptr) return;
+	delete_probe_buffers(probe);
 	env_probes.erase(probe);
-	if(probe != nullptr) delete probe;
+	delete probe;
+}
+
+void scene::create_probe_buffers(env_probe* probe) {
+	if(engine::get_init_mode() != engine::INIT_MODE::GRAPHICAL) return;
+	
+	// find or create the intermediate buffers for this size/alpha capture
+	auto iter = find_if(probe_buffers.begin(), probe_buffers.end(), [&probe](const env_probe_buffers& shared) {
+		return (shared.buffer_size == probe->buffer_size && shared.capture_alpha == probe->capture_alpha);
+	});
+	if(iter == probe_buffers.end()) {
+		probe_buffers.emplace_back();
+		iter = prev(probe_buffers.end());
+		iter->buffer_size = probe->buffer_size;
+		iter->capture_alpha = probe->capture_alpha;
+		iter->probe_count = 0;
+		recreate_buffers(iter->buffers, probe->buffer_size, probe->capture_alpha, false);
+	}
+	iter->probe_count++;
+	
+	// the probe only owns its scene buffer
+	probe->buffers = iter->buffers;
+	uint2 render_buffer_size, final_buffer_size;
+	compute_buffer_sizes(probe->buffer_size, render_buffer_size, final_buffer_size);
+	add_scene_buffer(probe->buffers, render_buffer_size, final_buffer_size);
+}
+
+void scene::delete_probe_buffers(env_probe* probe) {
+	if(probe->buffers.scene_buffer == nullptr) return;
+	if(probe->buffers.scene_buffer->depth_buffer == probe->buffers.g_buffer[0]->depth_buffer) {
+		probe->buffers.scene_buffer->depth_buffer = 0;
+	}
+	r->delete_buffer(probe->buffers.scene_buffer);
+	
+	// release the shared buffers (deleted with the last probe that uses them)
+	const auto iter = find_if(probe_buffers.begin(), probe_buffers.end(), [&probe](const env_probe_buffers& shared) {
+		return (shared.buffers.g_buffer[0] == probe->buffers.g_buffer[0]);
+	});
+	if(iter != probe_buffers.end() && --iter->probe_count == 0) {
+		delete_buffers(iter->buffers);
+		probe_buffers.erase(iter);
+	}
+	probe->buffers = frame_buffers {};
+}
+
+void scene::set_env_probe_budget(const float milliseconds, const size_t max_updates) {
+	probe_budget_time = milliseconds;
+	probe_budget_updates = max_updates;
+}
+
+const scene::env_probe_stats& scene::get_env_probe_stats() const {
+	return probe_stats;
 }
 
 scene::env_probe::env_probe(const float3& pos_, const float2& rot_, const size2 buffer_size_, const bool capture_alpha_) :
@@ -1164,6 +1600,50 @@ position(pos_), rotation(rot_), buffer_size(buffer_size_), capture_alpha(capture
 scene::env_probe::~env_probe() {
 }
 
+const scene::culling_stats& scene::get_culling_stats() const {
+	return cull_stats;
+}
+
+const frustum& scene::get_view_frustum() const {
+	return view_frustum;
+}
+
+void scene::set_clustered_lighting(const bool state) {
+	clustered_lighting = state;
+}
+
+bool scene::get_clustered_lighting() const {
+	return clustered_lighting;
+}
+
+const light_clusters& scene::get_light_clusters() const {
+	return clustered_lights;
+}
+
+void scene::set_occlusion_culling(const bool state) {
+	occlusion_culling = state;
+}
+
+bool scene::get_occlusion_culling() const {
+	return occlusion_culling;
+}
+
+occlusion_buffer& scene::get_occlusion_buffer() {
+	return occlusion;
+}
+
+const occlusion_buffer& scene::get_occlusion_buffer() const {
+	return occlusion;
+}
+
+const bvh& scene::get_model_bvh() const {
+	return model_bvh;
+}
+
+void scene::model_bounds_changed(a2emodel* model) {
+	model_bvh.mark_dirty(model);
+}
+
 const vector<a2emodel*>& scene::get_models() const {
 	return models;
 }
@@ -19,7 +19,6 @@
 #ifndef __A2E_SCENE_HPP__
 #define __A2E_SCENE_HPP__
 
-#define A2E_CONCURRENT_FRAMES 1
 //#define A2E_INFERRED_RENDERING_CL 1
 
 #include "global.hpp"
@@ -29,7 +28,15 @@
 #include "scene/model/a2estatic.hpp"
 #include "scene/model/a2emodel.hpp"
 #include "scene/light.hpp"
+#include "scene/frustum.hpp"
+#include "scene/bvh.hpp"
+#include "scene/light_clusters.hpp"
+#include "scene/occlusion_buffer.hpp"
+#include "scene/alpha_mask_grid.hpp"
+#include "scene/render_view.hpp"
+#include "task_scheduler.hpp"
 #include "rendering/shader.hpp"
+#include "rendering/render_queue.hpp"
 #include <floor/math/matrix4.hpp>
 #include <floor/math/bbox.hpp>
 #include "rendering/rtt.hpp"
@@ -74,7 +81,7 @@ protected:
 public:
 	scene();
 	~scene();
-
+	
 	void draw();
 	
 	void set_enabled(const bool& status);
@@ -88,11 +95,12 @@ public:
 	void add_particle_manager(particle_manager* pm);
 	void delete_particle_manager(particle_manager* pm);
 	
-	typedef function<void(const DRAW_MODE)> draw_callback;
+	//! called in every pass of every drawn view (main view and env probes) with the view that is being drawn
+	typedef function<void(const render_view&, const DRAW_MODE)> draw_callback;
 	void add_draw_callback(const string& name, draw_callback& cb);
 	void delete_draw_callback(draw_callback& cb);
 	void delete_draw_callback(const string& name);
-
+	
 	void set_skybox_texture(a2e_texture tex);
 	const a2e_texture& get_skybox_texture() const;
 	void set_render_skybox(const bool state);
@@ -114,6 +122,8 @@ public:
 	void delete_post_processing(const post_processing_handler* pph);
 	
 	// environment probing/mapping
+	//! NOTE: a probe only owns its final output (buffers.scene_buffer), the g-buffer, l-buffer and fxaa buffer are
+	//!       shared by all probes with the same buffer size and alpha capture setting
 	struct env_probe {
 		float3 position;
 		float2 rotation;
@@ -122,6 +132,12 @@ public:
 		frame_buffers buffers;
 		size_t frame_freq = 1;
 		size_t frame_counter = frame_freq;
+		//! only models within this distance are drawn into the probe (0 = up to the far plane)
+		float view_distance = 0.0f;
+		
+		// scheduling state (see set_env_probe_budget)
+		size_t last_update_frame = 0;
+		float update_time = 0.0f; // running average of the cpu time of an update (in ms)
 		
 		enum class PROBE_FREQUENCY : unsigned int {
 			ONCE,
@@ -145,12 +161,74 @@ public:
 	void add_environment_probe(env_probe* probe);
 	void delete_environment_probe(env_probe* probe);
 	
+	//! probes that are due (according to their frequency) are updated in priority order until the per-frame budget
+	//! is used up: stale probes, probes in the view frustum and probes close to the camera are updated first.
+	//! the budget is the (estimated) cpu time of all probe updates in ms (0 = no limit) and the max amount of updated
+	//! probes (0 = no limit). at least one due probe is updated each frame, deferred probes stay due.
+	void set_env_probe_budget(const float milliseconds, const size_t max_updates = 0);
+	struct env_probe_stats {
+		size_t due_probes = 0;
+		size_t updated_probes = 0;
+		size_t deferred_probes = 0;
+		float update_time = 0.0f; // cpu time of all updates (in ms)
+	};
+	//! returns the probe update statistics of the last drawn frame
+	const env_probe_stats& get_env_probe_stats() const;
+	
 	// for debugging and other evil purposes:
-	const frame_buffers& get_frame_buffers(const size_t num = 0) const { return frames[num]; }
-	const rtt::fbo* get_geometry_buffer(const size_t type = 0) const { return frames[0].g_buffer[type]; }
-	const rtt::fbo* get_light_buffer(const size_t type = 0) const { return frames[0].l_buffer[type]; }
-	const rtt::fbo* get_fxaa_buffer() const { return frames[0].fxaa_buffer; }
-	const rtt::fbo* get_scene_buffer() const { return frames[0].scene_buffer; }
+	const frame_buffers& get_frame_buffers() const { return main_buffers; }
+	const rtt::fbo* get_geometry_buffer(const size_t type = 0) const { return main_buffers.g_buffer[type]; }
+	const rtt::fbo* get_light_buffer(const size_t type = 0) const { return main_buffers.l_buffer[type]; }
+	const rtt::fbo* get_fxaa_buffer() const { return main_buffers.fxaa_buffer; }
+	const rtt::fbo* get_scene_buffer() const { return main_buffers.scene_buffer; }
+	
+	// visibility culling
+	struct culling_stats {
+		size_t drawn_models = 0;
+		size_t culled_models = 0;
+		size_t drawn_sub_objects = 0;
+		size_t culled_sub_objects = 0;
+		// models/sub-objects hidden by occluders (also included in culled_*)
+		size_t occluded_models = 0;
+		size_t occluded_sub_objects = 0;
+	};
+	//! returns the culling statistics of the last drawn frame (accumulated over all views, including env probes)
+	const culling_stats& get_culling_stats() const;
+	//! returns the frustum of the view that was last culled
+	const frustum& get_view_frustum() const;
+	//! spatial index of all models (use this for frustum/sphere/ray/aabb queries)
+	const bvh& get_model_bvh() const;
+	//! must be called when the bounding box of a model changed (done automatically by a2emodel)
+	void model_bounds_changed(a2emodel* model);
+	
+	// clustered lighting
+	//! if enabled (and the "IR_LP_CLUSTERED" shader was added), all point lights are binned into a froxel grid
+	//! and rendered in a single full-screen pass instead of drawing a stencil + lighting sphere per light.
+	//! NOTE: this shader is not part of the engine shaders (its interface is documented at upload_light_clusters),
+	//! without it no clusters are built and the per-light path is used
+	void set_clustered_lighting(const bool state);
+	bool get_clustered_lighting() const;
+	const light_clusters& get_light_clusters() const;
+	
+	// occlusion culling
+	//! if enabled, the collision meshes of all visible occluders (see a2emodel::set_occluder) are rasterized into a low
+	//! resolution depth buffer on the cpu, all other visible models are then tested against it (main view only)
+	void set_occlusion_culling(const bool state);
+	bool get_occlusion_culling() const;
+	//! for setting the buffer size, the amount of worker threads and for debugging purposes
+	occlusion_buffer& get_occlusion_buffer();
+	const occlusion_buffer& get_occlusion_buffer() const;
+	
+	// view transforms
+	//! view dependent matrices of the current view (model matrices are computed as world * these)
+	struct view_transforms {
+		matrix4f mvm;
+		matrix4f mvpm;
+		matrix4f mvpm_backside; // dual-paraboloid back side (env probes)
+	};
+	const view_transforms& get_view_transforms() const;
+	//! identifies the current view (changes with every drawn view, main view and env probes)
+	size_t get_view_stamp() const;
 	
 	const vector<a2emodel*>& get_models() const;
 	const vector<light*>& get_lights() const;
@@ -161,40 +239,135 @@ protected:
 	shader* s;
 	ext* exts;
 	rtt* r;
+	task_scheduler* scheduler;
 	
+	// all passes of a view only read the view they are given (-> the engine matrices are never modified)
 	void setup_scene();
-	void geometry_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_mask = DRAW_MODE::NONE);
-	void light_and_material_pass(frame_buffers& buffers, const DRAW_MODE draw_mode_or_mask = DRAW_MODE::NONE);
+	//! culls all models against the frustum of the view (occlusion culling is only done for non-environment passes)
+	void cull_models(const render_view& view, const DRAW_MODE draw_mode_or_mask = DRAW_MODE::NONE);
+	//! rasterizes all visible occluders and removes all occluded models from the visible models (after cull_models)
+	void cull_occluded_models(const render_view& view);
+	//! computes the view transforms and the view dependent matrices of all visible models (after cull_models)
+	void update_model_transforms(const render_view& view);
+	void geometry_pass(const render_view& view, frame_buffers& buffers,
+					   const DRAW_MODE draw_mode_or_mask = DRAW_MODE::NONE);
+	void light_and_material_pass(const render_view& view, frame_buffers& buffers,
+								 const DRAW_MODE draw_mode_or_mask = DRAW_MODE::NONE);
+	//! draws the opaque sub-objects of all visible models, sorted by their render state (see render_queue)
+	void draw_opaque_models(const render_view& view, const DRAW_MODE draw_mode);
 	void postprocess();
-	void sort_alpha_objects();
+	void sort_alpha_objects(const render_view& view);
+	void upload_light_clusters();
 	void delete_buffers(frame_buffers& buffers);
-	void recreate_buffers(frame_buffers& buffers, const size2 buffer_size, const bool create_alpha_buffer = true);
-
+	//! NOTE: without a scene buffer, only the intermediate buffers are created (see add_scene_buffer)
+	void recreate_buffers(frame_buffers& buffers, const size2 buffer_size, const bool create_alpha_buffer = true,
+						  const bool create_scene_buffer = true);
+	//! g-buffer/l-buffer and final (scene + fxaa buffer) size of a buffer set
+	void compute_buffer_sizes(const size2 buffer_size, uint2& render_buffer_size, uint2& final_buffer_size);
+	//! creates the final output buffer (after all other buffers, the g-buffer depth is reused if the sizes match)
+	void add_scene_buffer(frame_buffers& buffers, const uint2& render_buffer_size, const uint2& final_buffer_size);
+	
+	// env probes: scheduling + intermediate buffers shared by all probes of the same size/alpha capture
+	struct env_probe_buffers {
+		size2 buffer_size;
+		bool capture_alpha;
+		frame_buffers buffers; // no scene buffer
+		size_t probe_count;
+	};
+	vector<env_probe_buffers> probe_buffers;
+	void create_probe_buffers(env_probe* probe);
+	void delete_probe_buffers(env_probe* probe);
+	//! renders the env probes with the highest priority within the budget (prioritized by the camera view)
+	void update_env_probes(const render_view& camera_view);
+	//! returns the (omnidirectional) view of the probe, based on the projection of the camera view
+	render_view make_env_probe_view(const render_view& camera_view, const env_probe* probe) const;
+	void draw_env_probe(const render_view& probe_view, env_probe* probe);
+	float probe_budget_time = 4.0f;
+	size_t probe_budget_updates = 0;
+	size_t probe_frame = 1;
+	env_probe_stats probe_stats;
+	vector<pair<float, env_probe*>> probe_queue;
+	
 	//
 	vector<a2emodel*> models;
 	vector<light*> lights;
 	vector<particle_manager*> particle_managers;
 	set<env_probe*> env_probes;
 	
-	// <bbox*, <sub-object id, draw functor>>
-	map<const extbbox*, pair<size_t, a2emodel::draw_callback>> alpha_objects;
-	// <bbox*, mask id>, mask id: 0 (invalid), {1, 2, 3}
-	vector<pair<const extbbox*, size_t>> sorted_alpha_objects;
+	// visibility culling (frustum + visible models of the current view)
+	bvh model_bvh;
+	frustum view_frustum;
+	vector<a2emodel*> visible_models;
+	culling_stats cull_stats;
+	render_queue opaque_queue;
+	// submission order of the sorted opaque queue: single sub-objects (command_count == 0) or multi-draw batches of
+	// consecutive sub-objects with the same render state (geometry arena commands + their transforms)
+	struct opaque_draw {
+		size_t item;
+		size_t first_command;
+		size_t command_count;
+	};
+	vector<opaque_draw> opaque_draws;
+	vector<a2emodel::instance_transform> multi_draw_transforms;
+	//! splits the sorted opaque queue into single draws and multi-draw batches
+	void build_opaque_draws(const DRAW_MODE draw_mode);
+	
+	// clustered lighting (cluster ranges, light indices, light data -> texture buffers, one set per frame in flight)
+	light_clusters clustered_lights;
+	bool clustered_lighting = false;
+	GLuint light_cluster_buffers[A2E_CONCURRENT_FRAMES][3] {};
+	GLuint light_cluster_textures[A2E_CONCURRENT_FRAMES][3] {};
+	size_t light_cluster_buffer_sizes[A2E_CONCURRENT_FRAMES][3] {};
+	size_t light_cluster_slot = 0; // frame slot of the last upload
+	// the clusters of the main view are built concurrently to its geometry pass (joined in the light pass)
+	// NOTE: lights must not be added/deleted/modified while the geometry pass is drawn
+	task_scheduler::task_group light_cluster_group;
+	bool light_clusters_pending = false;
+	
+	// occlusion culling
+	occlusion_buffer occlusion;
+	bool occlusion_culling = false;
+	// per visible model: <visible sub-objects before, visible sub-objects after the occlusion test>
+	vector<pair<size_t, size_t>> occlusion_results;
+	
+	// view transforms of the current view
+	view_transforms cur_view_transforms;
+	size_t view_stamp = 0;
+	
+	// alpha objects are stored contiguously (deleting an object moves the last one into its slot)
+	struct alpha_object {
+		const extbbox* bbox;
+		size_t sub_object_id;
+		a2emodel::draw_callback draw_cb;
+	};
+	vector<alpha_object> alpha_objects;
+	// bbox* -> index into alpha_objects (only needed when adding/deleting objects)
+	unordered_map<const extbbox*, uint32_t> alpha_object_indices;
+	// <index into alpha_objects, mask id> in front to back order, mask id: 0 (deleted, not drawn), {1, 2, 3}
+	vector<pair<uint32_t, size_t>> sorted_alpha_objects;
+	// per-frame storage of sort_alpha_objects (kept around to avoid reallocations)
+	struct alpha_sort_data {
+		vector<pair<float, uint32_t>> keys;
+		vector<int4> rects; // screen space rectangle: (min x, min y, max x, max y)
+		alpha_mask_grid mask_grid;
+	} alpha_sort;
 	
 	bool enabled = true;
-
+	
 	a2e_texture skybox_tex = nullptr;
 	bool render_skybox = false;
-
+	
 	a2estatic* light_sphere = nullptr;
-
+	size_t default_option_id = 0;
+	size_t directional_option_id = 0;
+	
 	// render and scene buffer
-	frame_buffers frames[A2E_CONCURRENT_FRAMES];
-	//size_t cur_frame = 0;
+	// NOTE: these are only written by the gpu, so they don't need a slot per frame in flight (see frame_sync)
+	frame_buffers main_buffers;
 	
 	vector<post_processing_handler*> pp_handlers;
 	map<string, draw_callback*> draw_callbacks;
-
+	
 	// stereo rendering (currently unsupported)
 	float eye_distance = -0.3f; // 1.5f?
 	bool stereo = false;
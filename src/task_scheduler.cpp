@@ -0,0 +1,225 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "task_scheduler.hpp"
+
+// scheduler and queue of the current thread (only set for worker threads)
+static thread_local task_scheduler* cur_scheduler { nullptr };
+static thread_local size_t cur_queue_index { 0 };
+
+task_scheduler::task_scheduler(const size_t worker_count) {
+	// one queue per worker + the shared queue of all other threads
+	for(size_t i = 0; i <= worker_count; i++) {
+		queues.emplace_back(make_unique<task_queue>());
+	}
+	for(size_t i = 0; i < worker_count; i++) {
+		workers.emplace_back(&task_scheduler::worker_run, this, i);
+	}
+}
+
+task_scheduler::~task_scheduler() {
+	{
+		lock_guard<mutex> lock(sleep_lock);
+		running = false;
+	}
+	sleep_cv.notify_all();
+	for(auto& worker : workers) {
+		worker.join();
+	}
+}
+
+size_t task_scheduler::get_worker_count() const {
+	return workers.size();
+}
+
+size_t task_scheduler::get_default_worker_count() {
+	const size_t hw_threads = thread::hardware_concurrency();
+	return (hw_threads > 1 ? hw_threads - 1 : 0);
+}
+
+size_t task_scheduler::get_queue_index() const {
+	return (cur_scheduler == this ? cur_queue_index : workers.size());
+}
+
+void task_scheduler::push(task&& t) {
+	auto& queue = *queues[get_queue_index()];
+	{
+		lock_guard<mutex> lock(queue.lock);
+		queue.tasks.emplace_back(move(t));
+	}
+	
+	// wake up a sleeping worker (the sleep lock must be acquired, otherwise the notification could get lost
+	// between a worker checking queued_count and going to sleep)
+	queued_count++;
+	{
+		lock_guard<mutex> lock(sleep_lock);
+	}
+	sleep_cv.notify_one();
+}
+
+bool task_scheduler::execute_one(const size_t queue_index) {
+	if(queued_count == 0) return false;
+	
+	task t;
+	bool found = false;
+	
+	// own queue: newest task first (most likely still in the cache)
+	{
+		auto& queue = *queues[queue_index];
+		lock_guard<mutex> lock(queue.lock);
+		if(!queue.tasks.empty()) {
+			t = move(queue.tasks.back());
+			queue.tasks.pop_back();
+			found = true;
+		}
+	}
+	
+	// steal the oldest task from another queue (usually the largest chunk of remaining work)
+	const size_t queue_count = queues.size();
+	for(size_t i = 1; !found && i < queue_count; i++) {
+		auto& queue = *queues[(queue_index + i) % queue_count];
+		lock_guard<mutex> lock(queue.lock);
+		if(!queue.tasks.empty()) {
+			t = move(queue.tasks.front());
+			queue.tasks.pop_front();
+			found = true;
+		}
+	}
+	if(!found) return false;
+	
+	queued_count--;
+	t.func();
+	t.group->pending--;
+	return true;
+}
+
+void task_scheduler::worker_run(const size_t queue_index) {
+	cur_scheduler = this;
+	cur_queue_index = queue_index;
+	
+	while(running) {
+		if(execute_one(queue_index)) continue;
+		
+		unique_lock<mutex> lock(sleep_lock);
+		sleep_cv.wait(lock, [this] { return (queued_count > 0 || !running); });
+	}
+}
+
+void task_scheduler::parallel_for(const size_t count, const size_t grain_size,
+								  const function<void(const size_t begin, const size_t end)>& func) {
+	const size_t grain = max(grain_size, size_t(1));
+	const size_t chunk_count = (count + grain - 1) / grain;
+	if(chunk_count == 0) return;
+	
+	// the chunk boundaries never depend on the amount of workers
+	task_group group(*this);
+	for(size_t chunk = 1; chunk < chunk_count; chunk++) {
+		group.run([&func, chunk, grain, count] {
+			func(chunk * grain, min((chunk + 1) * grain, count));
+		});
+	}
+	// the calling thread always processes the first chunk itself
+	func(0, min(grain, count));
+	group.wait();
+}
+
+/////////////////////////
+// task_group
+
+task_scheduler::task_group::task_group(task_scheduler& scheduler_) : scheduler(scheduler_) {
+}
+
+task_scheduler::task_group::~task_group() {
+	wait();
+}
+
+void task_scheduler::task_group::run(function<void()> func) {
+	// no workers: execute immediately (-> deterministic submission order)
+	if(scheduler.workers.empty()) {
+		func();
+		return;
+	}
+	
+	pending++;
+	scheduler.push(task { move(func), this });
+}
+
+void task_scheduler::task_group::wait() {
+	// help executing tasks (of any group) until all tasks of this group have finished
+	const size_t queue_index = scheduler.get_queue_index();
+	while(pending > 0) {
+		if(!scheduler.execute_one(queue_index)) {
+			this_thread::yield();
+		}
+	}
+}
+
+/////////////////////////
+// task_graph
+
+task_scheduler::task_graph::node task_scheduler::task_graph::add(function<void()> func, initializer_list<node> dependencies) {
+	const node n = nodes.size();
+	nodes.emplace_back(node_data { move(func), {}, 0 });
+	for(const auto& dep : dependencies) {
+		if(dep >= n) {
+			log_error("invalid dependency %u of task graph node %u (dependencies must be added first)!", dep, n);
+			continue;
+		}
+		nodes[dep].dependents.emplace_back(n);
+		nodes[n].dependency_count++;
+	}
+	return n;
+}
+
+void task_scheduler::task_graph::clear() {
+	nodes.clear();
+}
+
+size_t task_scheduler::task_graph::size() const {
+	return nodes.size();
+}
+
+void task_scheduler::task_graph::run(task_scheduler& scheduler) {
+	if(nodes.empty()) return;
+	
+	if(remaining_size < nodes.size()) {
+		remaining = make_unique<atomic<uint32_t>[]>(nodes.size());
+		remaining_size = nodes.size();
+	}
+	for(size_t i = 0, count = nodes.size(); i < count; i++) {
+		remaining[i] = nodes[i].dependency_count;
+	}
+	
+	// start all nodes without dependencies, all others are started by their last finishing dependency
+	task_group group(scheduler);
+	for(size_t i = 0, count = nodes.size(); i < count; i++) {
+		if(nodes[i].dependency_count == 0) {
+			group.run([this, &group, i] { run_node(group, i); });
+		}
+	}
+	group.wait();
+}
+
+void task_scheduler::task_graph::run_node(task_group& group, const node& n) {
+	nodes[n].func();
+	for(const auto& dependent : nodes[n].dependents) {
+		if(remaining[dependent].fetch_sub(1) == 1) {
+			group.run([this, &group, dependent] { run_node(group, dependent); });
+		}
+	}
+}
@@ -0,0 +1,125 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_TASK_SCHEDULER_HPP__
+#define __A2E_TASK_SCHEDULER_HPP__
+
+#include "global.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+//! work-stealing task scheduler for short-lived cpu work (frame preparation, culling, sorting, ...):
+//! each worker thread has its own task queue, new tasks are pushed onto the queue of the thread that creates them
+//! (lifo for the owner, other threads steal the oldest tasks). a thread that waits for tasks (task_group::wait)
+//! always helps executing tasks, so fork/join can be nested arbitrarily.
+//!  * task_group: fork/join of arbitrary tasks
+//!  * task_graph: tasks with dependencies (a task is started once all of its dependencies have finished)
+//!  * parallel_for: splits a range into fixed size chunks (independent of the amount of threads)
+//! NOTE: with 0 worker threads, all tasks are executed immediately on the thread that creates them (in submission
+//!       order), which makes the execution order fully deterministic (e.g. for testing and debugging)
+//! NOTE: tasks must not throw
+class task_scheduler {
+public:
+	//! worker_count: amount of worker threads in addition to the threads that wait for tasks
+	task_scheduler(const size_t worker_count = get_default_worker_count());
+	~task_scheduler();
+	task_scheduler(const task_scheduler&) = delete;
+	task_scheduler& operator=(const task_scheduler&) = delete;
+	
+	size_t get_worker_count() const;
+	//! hardware threads - 1 (the render thread is the remaining one)
+	static size_t get_default_worker_count();
+	
+	//! fork/join: tasks can be added from any thread (also from within tasks of the group),
+	//! wait() returns once all tasks of the group have finished (the destructor waits as well)
+	class task_group {
+	public:
+		task_group(task_scheduler& scheduler);
+		~task_group();
+		task_group(const task_group&) = delete;
+		task_group& operator=(const task_group&) = delete;
+		
+		void run(function<void()> func);
+		void wait();
+
+	protected:
+		friend class task_scheduler;
+		task_scheduler& scheduler;
+		atomic<size_t> pending { 0 };
+	};
+	
+	//! dependency graph: nodes are added in topological order (dependencies must already exist),
+	//! run() executes all nodes and waits for them. a graph can be run multiple times.
+	class task_graph {
+	public:
+		typedef size_t node;
+		node add(function<void()> func, initializer_list<node> dependencies = {});
+		void run(task_scheduler& scheduler);
+		void clear();
+		size_t size() const;
+
+	protected:
+		struct node_data {
+			function<void()> func;
+			vector<node> dependents;
+			uint32_t dependency_count;
+		};
+		vector<node_data> nodes;
+		unique_ptr<atomic<uint32_t>[]> remaining;
+		size_t remaining_size = 0;
+		void run_node(task_group& group, const node& n);
+	};
+	
+	//! calls func(begin, end) for all chunks [i * grain_size, min((i + 1) * grain_size, count)) and waits for them
+	void parallel_for(const size_t count, const size_t grain_size,
+					  const function<void(const size_t begin, const size_t end)>& func);
+
+protected:
+	struct task {
+		function<void()> func;
+		task_group* group;
+	};
+	// queues of all worker threads + one queue for all other threads (last one)
+	struct task_queue {
+		mutex lock;
+		deque<task> tasks;
+	};
+	vector<unique_ptr<task_queue>> queues;
+	vector<thread> workers;
+	
+	// idle workers sleep until a task is pushed
+	atomic<bool> running { true };
+	atomic<size_t> queued_count { 0 };
+	mutex sleep_lock;
+	condition_variable sleep_cv;
+	
+	void push(task&& t);
+	//! executes one task of the own queue (newest) or steals one from another queue (oldest),
+	//! returns false if there was nothing to execute
+	bool execute_one(const size_t queue_index);
+	size_t get_queue_index() const;
+	void worker_run(const size_t queue_index);
+
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/model/a2m_file.hpp"
+#include <chrono>
+
+//! offline converter: .a2m (version 2 or 3) -> optimized .a2m version 3
+int main(int argc, char* argv[]) {
+	string in_filename, out_filename;
+	bool optimize = true, reduce_overdraw = true;
+	for(int i = 1; i < argc; i++) {
+		const string arg = argv[i];
+		if(arg == "--no-optimize") optimize = false;
+		else if(arg == "--no-overdraw") reduce_overdraw = false;
+		else if(in_filename.empty()) in_filename = arg;
+		else if(out_filename.empty()) out_filename = arg;
+		else {
+			in_filename = "";
+			break;
+		}
+	}
+	if(in_filename.empty() || out_filename.empty()) {
+		cout << "usage: a2m_converter [--no-optimize] [--no-overdraw] <input.a2m> <output.a2m>" << endl;
+		cout << "	converts a version 2 or 3 .a2m model file into a (by default optimized) version 3 .a2m file" << endl;
+		return 1;
+	}
+	
+	const auto start = chrono::steady_clock::now();
+	a2m_file::model_data data;
+	if(!a2m_file::load(in_filename, data)) {
+		cout << "failed to load " << in_filename << endl;
+		return 1;
+	}
+	if(optimize && !data.optimized) {
+		a2m_file::optimize(data, reduce_overdraw, in_filename);
+	}
+	const bool success = a2m_file::save(out_filename, data);
+	
+	size_t triangle_count = 0;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		triangle_count += data.index_count[i];
+	}
+	if(success) {
+		cout << out_filename << ": " << data.object_count << " sub-objects, " << data.vertex_count << " vertices, ";
+		cout << triangle_count << " triangles (" << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		cout << "ms)" << endl;
+	}
+	else cout << "failed to write " << out_filename << endl;
+	data.clear();
+	return (success ? 0 : 1);
+}
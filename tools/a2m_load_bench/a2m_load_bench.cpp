@@ -0,0 +1,243 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/model/a2m_file.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <fstream>
+
+template <typename T> static void write_value(ofstream& file, const T& value) {
+	file.write((const char*)&value, sizeof(T));
+}
+
+//! writes a version 2 .a2m file of a torus (u_count * v_count positions, the tex coords have an extra row/column
+//! at the seams) that is split into "object_count" sub-objects, plus a collision model
+static bool write_v2_model(const string& filename, const uint32_t u_count, const uint32_t v_count, const uint32_t object_count) {
+	ofstream file(filename, ios::out | ios::binary);
+	if(!file.is_open()) return false;
+	file.write("A2EMODEL", 8);
+	write_value(file, uint32_t(2));
+	write_value(file, uint8_t(0x02));
+	
+	const float pi = 3.14159265358979f;
+	write_value(file, u_count * v_count);
+	write_value(file, (u_count + 1) * (v_count + 1));
+	for(uint32_t j = 0; j < v_count; j++) {
+		for(uint32_t i = 0; i < u_count; i++) {
+			const float phi = float(i) / float(u_count) * 2.0f * pi, theta = float(j) / float(v_count) * 2.0f * pi;
+			write_value(file, cosf(phi) * (1.0f + 0.4f * cosf(theta)));
+			write_value(file, 0.4f * sinf(theta));
+			write_value(file, -sinf(phi) * (1.0f + 0.4f * cosf(theta)));
+		}
+	}
+	for(uint32_t j = 0; j <= v_count; j++) {
+		for(uint32_t i = 0; i <= u_count; i++) {
+			write_value(file, float(i) / float(u_count) * 4.0f);
+			write_value(file, float(j) / float(v_count) * 2.0f);
+		}
+	}
+	
+	write_value(file, object_count);
+	for(uint32_t obj = 0; obj < object_count; obj++) {
+		const string name = "part_" + to_string(obj);
+		file.write(name.c_str(), (streamsize)name.size());
+		write_value(file, uint8_t(0xFF));
+	}
+	for(uint32_t obj = 0; obj < object_count; obj++) {
+		// each sub-object is a band of rows
+		const uint32_t first_row = obj * v_count / object_count, end_row = (obj + 1) * v_count / object_count;
+		write_value(file, (end_row - first_row) * u_count * 2);
+		for(const bool tex_indices : { false, true }) {
+			const auto index = [&](const uint32_t i, const uint32_t j) {
+				return (tex_indices ? i + j * (u_count + 1) : (i % u_count) + (j % v_count) * u_count);
+			};
+			for(uint32_t j = first_row; j < end_row; j++) {
+				for(uint32_t i = 0; i < u_count; i++) {
+					write_value(file, index(i, j));
+					write_value(file, index(i + 1, j));
+					write_value(file, index(i + 1, j + 1));
+					write_value(file, index(i, j));
+					write_value(file, index(i + 1, j + 1));
+					write_value(file, index(i, j + 1));
+				}
+			}
+		}
+	}
+	
+	// collision model: a box
+	write_value(file, uint32_t(8));
+	for(uint32_t i = 0; i < 8; i++) {
+		write_value(file, (i & 1u) != 0 ? 1.4f : -1.4f);
+		write_value(file, (i & 2u) != 0 ? 0.4f : -0.4f);
+		write_value(file, (i & 4u) != 0 ? 1.4f : -1.4f);
+	}
+	const uint32_t box_indices[] {
+		0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5,
+	};
+	write_value(file, uint32_t(12));
+	file.write((const char*)box_indices, sizeof(box_indices));
+	return file.good();
+}
+
+//! true if both models contain the exact same (byte-wise) data
+static bool equal_models(const a2m_file::model_data& a, const a2m_file::model_data& b) {
+	if(a.type != b.type || a.optimized != b.optimized || a.vertex_count != b.vertex_count ||
+	   a.object_count != b.object_count || a.object_names != b.object_names ||
+	   a.col_vertex_count != b.col_vertex_count || a.col_index_count != b.col_index_count) {
+		return false;
+	}
+	if(memcmp(a.vertices, b.vertices, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.tex_coords, b.tex_coords, a.vertex_count * sizeof(float2)) != 0 ||
+	   memcmp(a.normals, b.normals, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.binormals, b.binormals, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.tangents, b.tangents, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.col_vertices, b.col_vertices, a.col_vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.col_indices, b.col_indices, a.col_index_count * sizeof(uint3)) != 0) {
+		return false;
+	}
+	for(unsigned int i = 0; i < a.object_count; i++) {
+		if(a.index_count[i] != b.index_count[i] || a.min_index[i] != b.min_index[i] || a.max_index[i] != b.max_index[i] ||
+		   memcmp(a.indices[i], b.indices[i], a.index_count[i] * sizeof(uint3)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//! true if the stored sub-object bounding boxes are the bounds of the sub-object vertex ranges
+static bool valid_bounding_boxes(const a2m_file::model_data& data) {
+	if(data.bbox_min.size() != data.object_count || data.bbox_max.size() != data.object_count) return false;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		float3 bmin(data.vertices[data.min_index[i]]), bmax(data.vertices[data.min_index[i]]);
+		for(unsigned int j = data.min_index[i]; j <= data.max_index[i]; j++) {
+			bmin.min(data.vertices[j]);
+			bmax.max(data.vertices[j]);
+		}
+		if(memcmp(&bmin, &data.bbox_min[i], sizeof(float3)) != 0 || memcmp(&bmax, &data.bbox_max[i], sizeof(float3)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//! copies a version 3 .a2m file and overwrites the first index of the specified sub-object: "value" is either an
+//! absolute index or (if "relative_to_min") added to the min index of the sub-object. the header/object layout is the
+//! one of a2m_v3_header and a2m_v3_object in a2m_file.cpp (offsets at byte 56, indices are block #7)
+static bool write_corrupt_index(const string& src_filename, const string& dst_filename, const uint32_t object,
+								const int64_t value, const bool relative_to_min) {
+	ifstream src(src_filename, ios::in | ios::binary);
+	vector<char> file_data((istreambuf_iterator<char>(src)), istreambuf_iterator<char>());
+	if(file_data.size() < 136) return false;
+	uint64_t objects_offset = 0, indices_offset = 0;
+	memcpy(&objects_offset, &file_data[56], sizeof(uint64_t));
+	memcpy(&indices_offset, &file_data[56 + 7 * sizeof(uint64_t)], sizeof(uint64_t));
+	uint32_t obj_data[4]; // triangle count, first triangle, min index, max index
+	memcpy(obj_data, &file_data[objects_offset + object * 40], sizeof(obj_data));
+	const uint32_t index = (uint32_t)(relative_to_min ? obj_data[2] + value : value);
+	memcpy(&file_data[indices_offset + obj_data[1] * sizeof(uint3)], &index, sizeof(uint32_t));
+	
+	ofstream dst(dst_filename, ios::out | ios::binary);
+	dst.write(file_data.data(), (streamsize)file_data.size());
+	return dst.good();
+}
+
+template <typename F> static double time_ms(const size_t iterations, F&& func) {
+	const auto start = chrono::steady_clock::now();
+	for(size_t i = 0; i < iterations; i++) func();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / double(iterations);
+}
+
+//! converts a version 2 .a2m model (the specified one or a generated torus with 4 sub-objects) to version 3 (as is and
+//! optimized), checks that loading the version 3 files results in exactly the same data as loading (and optimizing) the
+//! version 2 file and that files with out of range indices are rejected, then times loading both formats
+//! usage: a2m_load_bench [model.a2m]
+int main(int argc, char* argv[]) {
+	bool success = true;
+	const string v3_filename = "a2m_load_bench_v3.a2m", v3_opt_filename = "a2m_load_bench_v3_opt.a2m";
+	string v2_filename = "a2m_load_bench_v2.a2m";
+	const bool generated = (argc < 2);
+	if(!generated) v2_filename = argv[1];
+	else if(!check("write v2 model", write_v2_model(v2_filename, 512, 256, 4))) return 1;
+	
+	a2m_file::model_data v2_data;
+	if(!check("load v2 model", a2m_file::load(v2_filename, v2_data))) return 1;
+	success &= check("v2 model", !v2_data.optimized);
+	
+	size_t triangle_count = 0;
+	for(unsigned int i = 0; i < v2_data.object_count; i++) {
+		triangle_count += v2_data.index_count[i];
+	}
+	cout << v2_filename << ": " << v2_data.object_count << " sub-objects, " << v2_data.vertex_count << " vertices, ";
+	cout << triangle_count << " triangles" << endl;
+	
+	// as is
+	a2m_file::model_data v3_data;
+	success &= check("save v3 model", a2m_file::save(v3_filename, v2_data));
+	success &= check("load v3 model", a2m_file::load(v3_filename, v3_data));
+	success &= check("v2 == v3", equal_models(v2_data, v3_data));
+	success &= check("v3 bounding boxes", valid_bounding_boxes(v3_data));
+	
+	// an index outside of the vertex range or outside of the index range of its sub-object must be rejected
+	const string corrupt_filename = "a2m_load_bench_v3_corrupt.a2m";
+	a2m_file::model_data corrupt_data;
+	success &= check("write corrupt v3 model (vertex range)",
+					 write_corrupt_index(v3_filename, corrupt_filename, 0, v2_data.vertex_count, false));
+	success &= check("reject index outside of the vertex range", !a2m_file::load(corrupt_filename, corrupt_data));
+	corrupt_data.clear();
+	if(v2_data.object_count > 1 && v2_data.min_index[v2_data.object_count - 1] > 0) {
+		success &= check("write corrupt v3 model (sub-object range)",
+						 write_corrupt_index(v3_filename, corrupt_filename, v2_data.object_count - 1, -1, true));
+		success &= check("reject index outside of the sub-object range", !a2m_file::load(corrupt_filename, corrupt_data));
+		corrupt_data.clear();
+	}
+	remove(corrupt_filename.c_str());
+	
+	// optimized (the engine optimizes v2 models on load, optimized v3 models are used as is)
+	a2m_file::model_data v3_opt_data;
+	a2m_file::optimize(v2_data, true, v2_filename);
+	success &= check("save optimized v3 model", a2m_file::save(v3_opt_filename, v2_data));
+	success &= check("load optimized v3 model", a2m_file::load(v3_opt_filename, v3_opt_data));
+	success &= check("optimized v2 == v3", v3_opt_data.optimized && equal_models(v2_data, v3_opt_data));
+	success &= check("optimized v3 bounding boxes", valid_bounding_boxes(v3_opt_data));
+	
+	v2_data.clear();
+	v3_data.clear();
+	v3_opt_data.clear();
+	
+	// timing (the file contents are in the page cache after the first load)
+	if(success) {
+		const size_t iterations = 5;
+		const auto time_load = [&iterations](const string& filename, const bool optimize) {
+			return time_ms(iterations, [&filename, &optimize] {
+				a2m_file::model_data data;
+				a2m_file::load(filename, data);
+				if(optimize && !data.optimized) a2m_file::optimize(data, true, filename);
+				data.clear();
+			});
+		};
+		cout << "v2 load " << time_load(v2_filename, false) << "ms, v2 load + optimize " << time_load(v2_filename, true);
+		cout << "ms, v3 load " << time_load(v3_filename, false) << "ms, optimized v3 load " << time_load(v3_opt_filename, false);
+		cout << "ms" << endl;
+	}
+	
+	if(generated) remove(v2_filename.c_str());
+	remove(v3_filename.c_str());
+	remove(v3_opt_filename.c_str());
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,115 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/alpha_mask_grid.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <random>
+
+static constexpr size_t max_mask_id = 3; // A2E_MAX_MASK_ID
+
+//! random screen space rectangles (clamped to the screen like in scene::sort_alpha_objects, every 16th is invisible)
+static vector<int4> make_rects(const size_t count, const int2& screen_dim, const int max_size, mt19937& gen) {
+	uniform_int_distribution<int> x_dist(-max_size / 2, screen_dim.x), y_dist(-max_size / 2, screen_dim.y);
+	uniform_int_distribution<int> size_dist(1, max_size);
+	vector<int4> rects(count);
+	for(size_t i = 0; i < count; i++) {
+		if(i % 16 == 15) {
+			rects[i] = int4(numeric_limits<int>::max(), numeric_limits<int>::max(),
+							numeric_limits<int>::min(), numeric_limits<int>::min());
+			continue;
+		}
+		const int x = x_dist(gen), y = y_dist(gen);
+		rects[i] = int4(std::min(std::max(x, 0), screen_dim.x), std::min(std::max(y, 0), screen_dim.y),
+						std::min(std::max(x + size_dist(gen), 0), screen_dim.x),
+						std::min(std::max(y + size_dist(gen), 0), screen_dim.y));
+	}
+	return rects;
+}
+
+//! the previous O(n^2) overlap test: compare every rectangle with all rectangles in front of it
+static void assign_reference(const vector<int4>& rects, vector<pair<uint32_t, size_t>>& mask_ids) {
+	for(size_t i = 0; i < rects.size(); i++) {
+		const int4& rect = rects[i];
+		if(rect.x > rect.z) {
+			mask_ids[i].second = numeric_limits<int>::max();
+			continue;
+		}
+		size_t overlaps = 0;
+		for(size_t j = 0; j < i; j++) {
+			const int4& other = rects[j];
+			if(other.x > other.z) continue;
+			if(rect.x < other.z && rect.z > other.x &&
+			   rect.y < other.w && rect.w > other.y) {
+				overlaps++;
+			}
+		}
+		mask_ids[i].second = std::min(overlaps + 1, max_mask_id);
+	}
+}
+
+//! checks the mask ids of the screen grid binning against the O(n^2) overlap test and times both
+//! for 256 - 64k alpha objects (small foliage-like and large glass-like screen rectangles)
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	const int2 screen_dim(1920, 1080);
+	const size_t max_reference_count = 16384;
+	mt19937 gen(42);
+	
+	for(const int max_size : { 64, 512 }) {
+		cout << "rectangles up to " << max_size << "px:" << endl;
+		for(size_t obj_count = 256; obj_count <= 65536; obj_count *= 4) {
+			const auto rects = make_rects(obj_count, screen_dim, max_size, gen);
+			vector<pair<uint32_t, size_t>> mask_ids(obj_count), ref_mask_ids(obj_count);
+			
+			// warm-up (grid memory is reused across frames, as in the scene)
+			alpha_mask_grid mask_grid;
+			mask_grid.assign(rects, screen_dim, max_mask_id, mask_ids);
+			const size_t iterations = std::max(size_t(1), 65536 / obj_count);
+			auto start = chrono::steady_clock::now();
+			for(size_t i = 0; i < iterations; i++) {
+				mask_grid.assign(rects, screen_dim, max_mask_id, mask_ids);
+			}
+			const double grid_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / double(iterations);
+			
+			array<size_t, max_mask_id + 1> histogram;
+			histogram.fill(0);
+			for(const auto& mask_id : mask_ids) {
+				if(mask_id.second <= max_mask_id) histogram[mask_id.second]++;
+			}
+			cout << obj_count << " objects: grid " << grid_time << "ms";
+			
+			if(obj_count <= max_reference_count) {
+				start = chrono::steady_clock::now();
+				assign_reference(rects, ref_mask_ids);
+				const double ref_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+				cout << ", O(n^2) " << ref_time << "ms";
+				
+				bool match = true;
+				for(size_t i = 0; i < obj_count; i++) {
+					match &= (mask_ids[i].second == ref_mask_ids[i].second);
+				}
+				success &= check("mask ids", match);
+			}
+			cout << " (mask ids 1/2/3: " << histogram[1] << "/" << histogram[2] << "/" << histogram[3] << ")" << endl;
+		}
+	}
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
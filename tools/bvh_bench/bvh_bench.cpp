@@ -0,0 +1,188 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/bvh.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <random>
+
+//! models can't be created without a gl context -> the bvh is used with objects that only have a bounding box
+struct bench_object {
+	extbbox box;
+	extbbox* get_bounding_box() { return &box; }
+};
+typedef bvh_tree<bench_object> object_bvh;
+
+template <typename F> static double time_ms(const size_t iterations, F&& func) {
+	const auto start = chrono::steady_clock::now();
+	for(size_t i = 0; i < iterations; i++) func();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / double(iterations);
+}
+
+static vector<bench_object*> sorted(vector<bench_object*> objects) {
+	sort(objects.begin(), objects.end());
+	return objects;
+}
+
+//! checks that all bvh queries (frustum, sphere, aabb, ray) return exactly the models a linear scan over the same
+//! (fat) aabbs returns, also after moving models around (refit), then times building the tree, refitting it and
+//! frustum culling with the bvh against the linear per-model frustum test the scene did before (1k - 100k models)
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	const float aspect = 16.0f / 9.0f;
+	const size_t iterations = 20;
+	mt19937 gen(42);
+	uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+	
+	for(const size_t model_count : { 1000u, 10000u, 100000u }) {
+		// random boxes with constant density (-> the visible count grows with the view distance, not the model count)
+		const float world_size = 20.0f * cbrtf(float(model_count));
+		const auto random_pos = [&] {
+			return float3(unit_dist(gen), unit_dist(gen), unit_dist(gen)) * world_size - float3(world_size * 0.5f);
+		};
+		vector<bench_object> objects(model_count);
+		for(auto& obj : objects) {
+			extbbox& box = obj.box;
+			const float3 half_size(0.5f + unit_dist(gen) * 2.0f, 0.5f + unit_dist(gen) * 2.0f, 0.5f + unit_dist(gen) * 2.0f);
+			box.min = -half_size;
+			box.max = half_size;
+			box.pos = random_pos();
+			box.mview = matrix4f().rotate_y(unit_dist(gen) * 360.0f);
+		}
+		
+		object_bvh tree;
+		const double build_time = time_ms(1, [&] {
+			for(auto& obj : objects) tree.insert(&obj);
+		});
+		success &= check("size", tree.size() == model_count);
+		
+		// move 10% of all models (most of them only slightly -> stay inside their fat aabb)
+		const auto move_models = [&] {
+			for(size_t i = 0; i < model_count; i += 10) {
+				const float dist = (i % 100 == 0 ? 10.0f : 0.2f);
+				objects[i].box.pos += (float3(unit_dist(gen), unit_dist(gen), unit_dist(gen)) - float3(0.5f)) * dist;
+				tree.mark_dirty(&objects[i]);
+			}
+			tree.refit();
+		};
+		move_models();
+		
+		// reference: linear scan over the aabbs of all models (enlarged by "enlarge" on each side)
+		const auto linear_query = [&](const float& enlarge, const function<bool(const float3&, const float3&)>& test) {
+			vector<bench_object*> result;
+			float3 aabb_min, aabb_max;
+			for(auto& obj : objects) {
+				object_bvh::compute_aabb(obj.box, aabb_min, aabb_max);
+				if(test(aabb_min - float3(enlarge), aabb_max + float3(enlarge))) result.push_back(&obj);
+			}
+			return sorted(result);
+		};
+		
+		// with a fat margin of 0 and a freshly built tree, the leaf aabbs are exactly the model aabbs
+		{
+			object_bvh exact_tree;
+			exact_tree.set_fat_margin(0.0f);
+			for(auto& obj : objects) exact_tree.insert(&obj);
+			
+			frustum view_frustum;
+			view_frustum.extract(matrix4f().translate(world_size * 0.1f, 0.0f, world_size * 0.2f) *
+								 make_projection(aspect, 0.1f, world_size * 0.5f));
+			vector<bench_object*> result;
+			exact_tree.query(view_frustum, result);
+			success &= check("frustum query", sorted(result) == linear_query(0.0f, [&](const float3& bmin, const float3& bmax) {
+				return (view_frustum.classify(bmin, bmax) != frustum::INTERSECTION::OUTSIDE);
+			}));
+			
+			const float3 sphere_center(random_pos());
+			const float sphere_radius = world_size * 0.1f;
+			result.clear();
+			exact_tree.query(sphere_center, sphere_radius, result);
+			success &= check("sphere query", sorted(result) == linear_query(0.0f, [&](const float3& bmin, const float3& bmax) {
+				const float3 closest(float3(sphere_center).max(bmin).min(bmax));
+				return ((closest - sphere_center).dot(closest - sphere_center) <= sphere_radius * sphere_radius);
+			}));
+			
+			const float3 query_min(random_pos()), query_max(query_min + float3(world_size * 0.15f));
+			result.clear();
+			exact_tree.query(query_min, query_max, result);
+			success &= check("aabb query", sorted(result) == linear_query(0.0f, [&](const float3& bmin, const float3& bmax) {
+				return (bmin.x <= query_max.x && bmax.x >= query_min.x && bmin.y <= query_max.y && bmax.y >= query_min.y &&
+						bmin.z <= query_max.z && bmax.z >= query_min.z);
+			}));
+			
+			const float3 ray_origin(random_pos()), ray_dir(float3(1.0f, 0.25f, -0.5f).normalized());
+			const float ray_length = world_size * 0.5f;
+			result.clear();
+			exact_tree.query_ray(ray_origin, ray_dir, ray_length, result);
+			success &= check("ray query", sorted(result) == linear_query(0.0f, [&](const float3& bmin, const float3& bmax) {
+				const float3 inv_dir(1.0f / ray_dir.x, 1.0f / ray_dir.y, 1.0f / ray_dir.z);
+				const float3 t_0((bmin - ray_origin) * inv_dir), t_1((bmax - ray_origin) * inv_dir);
+				const float t_near = std::max(std::max(std::min(t_0.x, t_1.x), std::min(t_0.y, t_1.y)),
+											  std::max(std::min(t_0.z, t_1.z), 0.0f));
+				const float t_far = std::min(std::min(std::max(t_0.x, t_1.x), std::max(t_0.y, t_1.y)),
+											 std::min(std::max(t_0.z, t_1.z), ray_length));
+				return (t_near <= t_far);
+			}));
+		}
+		
+		// after refitting, the fat leaves must still contain the current model aabbs and can at most be larger by
+		// twice the fat margin on each side (-> the bvh result lies between the linear scans over both)
+		frustum view_frustum;
+		view_frustum.extract(matrix4f().translate(0.0f, 0.0f, world_size * 0.25f) *
+							 make_projection(aspect, 0.1f, world_size * 0.25f));
+		const auto frustum_test = [&view_frustum](const float3& bmin, const float3& bmax) {
+			return (view_frustum.classify(bmin, bmax) != frustum::INTERSECTION::OUTSIDE);
+		};
+		vector<bench_object*> result;
+		tree.query(view_frustum, result);
+		result = sorted(result);
+		const auto inner = linear_query(0.0f, frustum_test);
+		const auto outer = linear_query(2.0f * tree.get_fat_margin(), frustum_test);
+		success &= check("refit (superset)", includes(result.begin(), result.end(), inner.begin(), inner.end()));
+		success &= check("refit (subset)", includes(outer.begin(), outer.end(), result.begin(), result.end()));
+		
+		// removing half of the models
+		for(size_t i = 0; i < model_count; i += 2) tree.remove(&objects[i]);
+		success &= check("remove", tree.size() == model_count / 2 && !tree.contains(&objects[0]) && tree.contains(&objects[1]));
+		for(size_t i = 0; i < model_count; i += 2) tree.insert(&objects[i]);
+		
+		// timing: refit + frustum query vs the per-model frustum test
+		result.reserve(model_count);
+		const double refit_time = time_ms(iterations, move_models);
+		const double bvh_time = time_ms(iterations, [&] {
+			result.clear();
+			tree.query(view_frustum, result);
+		});
+		const size_t bvh_count = result.size();
+		size_t linear_count = 0;
+		const double linear_time = time_ms(iterations, [&] {
+			result.clear();
+			for(auto& obj : objects) {
+				if(view_frustum.is_visible(obj.box)) result.push_back(&obj);
+			}
+			linear_count = result.size();
+		});
+		
+		cout << model_count << " models (tree height " << tree.get_height() << "): build " << build_time << "ms, ";
+		cout << "refit (10% moved) " << refit_time << "ms, frustum query: bvh " << bvh_time << "ms (" << bvh_count;
+		cout << " models), linear " << linear_time << "ms (" << linear_count << " models)" << endl;
+	}
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
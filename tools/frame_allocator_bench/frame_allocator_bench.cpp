@@ -0,0 +1,182 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "frame_allocator.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <new>
+
+// counting allocator: every heap allocation of the process goes through these
+static atomic<size_t> heap_allocations { 0 };
+void* operator new(size_t size) {
+	heap_allocations++;
+	void* ptr = malloc(size > 0 ? size : 1);
+	if(ptr == nullptr) throw bad_alloc();
+	return ptr;
+}
+void* operator new[](size_t size) {
+	heap_allocations++;
+	void* ptr = malloc(size > 0 ? size : 1);
+	if(ptr == nullptr) throw bad_alloc();
+	return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+
+struct point { float x, y; };
+
+//! the transient work of one frame, modeled after the hot paths that use frame memory:
+//! gui primitive point lists (circles, rounded rects + their borders) and text layout (codes copy, ubo data)
+template <template <typename> class vector_type> static float simulate_frame(const size_t primitive_count) {
+	float sum = 0.0f;
+	for(size_t prim = 0; prim < primitive_count; prim++) {
+		// point_compute_circle: mid point + ellipsoid points (no reserve for the mid point)
+		vector_type<point> points;
+		points.push_back(point { float(prim), 0.0f });
+		const size_t steps = 16 + (prim % 48);
+		points.reserve(points.size() + steps);
+		for(size_t i = 0; i < steps; i++) {
+			const float angle = float(i) * 0.1f;
+			points.push_back(point { sinf(angle), -cosf(angle) });
+		}
+		
+		// draw_style_border: duplicated/extruded points (+ a swapped copy for strips)
+		vector_type<point> border_points;
+		border_points.reserve(points.size() * 2 + 2);
+		vector_type<point> swapped_points(points.begin(), points.end());
+		std::swap(swapped_points[2], swapped_points[3]);
+		for(const auto& pnt : swapped_points) {
+			border_points.push_back(pnt);
+			border_points.push_back(point { pnt.x * 1.1f, pnt.y * 1.1f });
+		}
+		sum += border_points.back().x;
+		
+		// text_stepper + create_text_ubo_data: copy of the codes, one ubo entry per glyph
+		if(prim % 4 == 0) {
+			vector_type<unsigned int> codes;
+			for(size_t i = 0; i < 24 + prim % 16; i++) {
+				codes.push_back(0x41u + (unsigned int)(i % 26));
+			}
+			vector_type<unsigned int> codes_copy(codes.begin(), codes.end());
+			vector_type<pair<unsigned int, unsigned int>> ubo_data;
+			for(const auto& code : codes_copy) {
+				ubo_data.emplace_back(code, code * 16u);
+			}
+			sum += float(ubo_data.back().second);
+		}
+	}
+	return sum;
+}
+
+template <typename T> using heap_vector = vector<T>;
+
+//! runs "frame_count" frames (after some warm-up frames) and returns the average heap allocations and time per frame
+template <template <typename> class vector_type>
+static pair<double, double> run_frames(const size_t frame_count, const size_t primitive_count, const bool reset) {
+	const size_t warm_up_frames = 4;
+	volatile float sink = 0.0f;
+	size_t allocations = 0;
+	double time = 0.0;
+	for(size_t frame = 0; frame < warm_up_frames + frame_count; frame++) {
+		if(reset) frame_allocator::reset_all(); // engine::start_draw
+		const size_t allocations_before = heap_allocations;
+		const auto start = chrono::steady_clock::now();
+		sink = sink + simulate_frame<vector_type>(primitive_count);
+		if(frame >= warm_up_frames) {
+			time += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			allocations += heap_allocations - allocations_before;
+		}
+	}
+	return { double(allocations) / double(frame_count), time / double(frame_count) };
+}
+
+//! checks the allocator itself (alignment, rollback, reset, block merging, per-thread allocators),
+//! then compares the heap allocations per frame of the same frame workload with std::allocator and the frame allocator
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	
+	// alignment + rollback of the most recent allocation
+	{
+		frame_allocator alloc(1024);
+		void* ptr_a = alloc.allocate(3, 1);
+		void* ptr_b = alloc.allocate(64, 64);
+		success &= check("alignment", (uintptr_t(ptr_b) & 63u) == 0);
+		alloc.deallocate(ptr_a, 3); // not the most recent one -> nothing happens
+		alloc.deallocate(ptr_b, 64);
+		success &= check("rollback", alloc.allocate(64, 64) == ptr_b);
+		
+		// more than a block -> merged into a single block on reset, which is then reused by the next frame
+		for(size_t i = 0; i < 64; i++) alloc.allocate(100, 16);
+		const auto frame_stats = alloc.get_stats();
+		success &= check("multiple blocks", frame_stats.block_count > 1);
+		alloc.reset();
+		const auto reset_stats = alloc.get_stats();
+		success &= check("merged blocks", reset_stats.block_count == 1 && reset_stats.used == 0 &&
+						 reset_stats.capacity >= frame_stats.high_water);
+		for(size_t i = 0; i < 64; i++) alloc.allocate(100, 16);
+		alloc.reset();
+		success &= check("no heap allocations after warm-up",
+						 alloc.get_stats().heap_allocation_count == reset_stats.heap_allocation_count);
+		
+		// large allocations get their own (large enough) block
+		void* large_ptr = alloc.allocate(1024 * 1024);
+		memset(large_ptr, 0, 1024 * 1024);
+		success &= check("large allocation", alloc.get_stats().capacity >= 1024 * 1024);
+	}
+	
+	// per-thread allocators: containers of different threads never share memory
+	{
+		const size_t thread_count = 4;
+		vector<thread> threads;
+		atomic<size_t> failures { 0 };
+		for(size_t i = 0; i < thread_count; i++) {
+			threads.emplace_back([i, &failures] {
+				frame_vector<size_t> values;
+				for(size_t j = 0; j < 10000; j++) values.push_back(i * 10000 + j);
+				frame_string str("thread string that doesn't fit into the small string buffer");
+				for(size_t j = 0; j < 10000; j++) {
+					if(values[j] != i * 10000 + j) failures++;
+				}
+				if(frame_allocator::get().get_stats().used == 0) failures++;
+			});
+		}
+		for(auto& th : threads) th.join();
+		success &= check("per-thread allocators", failures == 0);
+	}
+	
+	// compare heap allocations per frame
+	const size_t frame_count = 200, primitive_count = 256;
+	const auto heap_result = run_frames<heap_vector>(frame_count, primitive_count, false);
+	const auto frame_result = run_frames<frame_vector>(frame_count, primitive_count, true);
+	success &= check("fewer heap allocations", frame_result.first < heap_result.first);
+	
+	const auto stats = frame_allocator::get().get_stats();
+	cout << primitive_count << " primitives per frame:" << endl;
+	cout << "std::allocator:  " << heap_result.first << " heap allocations per frame, " << heap_result.second << "ms" << endl;
+	cout << "frame_allocator: " << frame_result.first << " heap allocations per frame, " << frame_result.second << "ms" << endl;
+	cout << "frame memory: high-water mark " << stats.high_water << " bytes, " << stats.capacity << " bytes in ";
+	cout << stats.block_count << " block(s), " << stats.heap_allocation_count << " block allocations in total" << endl;
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,202 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rendering/frame_sync.hpp"
+#include <EGL/egl.h>
+#include <chrono>
+#include <thread>
+
+// headless check (linux/mesa): EGL_PLATFORM=surfaceless LIBGL_ALWAYS_SOFTWARE=1 ./frame_sync_check
+// NOTE: llvmpipe mostly finishes a frame when it is flushed, so the fences are usually signaled when they are waited on
+//       (the fence handling and assertions are still exercised, a hardware driver actually has frames in flight)
+
+static const char* vs_src = R"RAWSTR(#version 330 core
+in vec2 in_vertex;
+void main() { gl_Position = vec4(in_vertex, 0.0, 1.0); }
+)RAWSTR";
+// reads the per-frame value from the slot buffer (after some useless work, so that the gpu lags behind)
+static const char* fs_src = R"RAWSTR(#version 330 core
+uniform usamplerBuffer slot_data;
+out uvec4 frag_color;
+void main() {
+	float val = gl_FragCoord.x;
+	for(int i = 0; i < 64; i++) val = sqrt(val * 1.0001 + float(i));
+	frag_color = uvec4(texelFetch(slot_data, 0).x, uint(val) & 0u, 0u, 0u);
+}
+)RAWSTR";
+
+static GLuint compile_program() {
+	const auto compile = [](const GLenum type, const char* src) {
+		const GLuint shd = glCreateShader(type);
+		glShaderSource(shd, 1, &src, nullptr);
+		glCompileShader(shd);
+		GLint status = 0;
+		glGetShaderiv(shd, GL_COMPILE_STATUS, &status);
+		if(status == 0) {
+			char info[1024];
+			glGetShaderInfoLog(shd, sizeof(info), nullptr, info);
+			cout << "shader compilation failed: " << info << endl;
+		}
+		return shd;
+	};
+	const GLuint prog = glCreateProgram();
+	glAttachShader(prog, compile(GL_VERTEX_SHADER, vs_src));
+	glAttachShader(prog, compile(GL_FRAGMENT_SHADER, fs_src));
+	glBindAttribLocation(prog, 0, "in_vertex");
+	glBindFragDataLocation(prog, 0, "frag_color");
+	glLinkProgram(prog);
+	return prog;
+}
+
+//! simulates frames with 1 .. A2E_CONCURRENT_FRAMES frames in flight: each frame writes its frame number into the
+//! buffer of its slot (unsynchronized) and the gpu copies it in a (slow) draw into the layer of the frame, all layers
+//! are read back at the end. if a slot were written while the gpu still used it, a frame would contain the number
+//! of a later frame.
+//! additionally checks that check_writable flags writes into the slot of another frame.
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	// headless gl 3.3 context
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		cout << "failed to initialize egl" << endl;
+		return 1;
+	}
+	eglBindAPI(EGL_OPENGL_API);
+	const EGLint config_attribs[] { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = nullptr;
+	EGLint config_count = 0;
+	eglChooseConfig(display, config_attribs, &config, 1, &config_count);
+	const EGLint context_attribs[] {
+		EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, (config_count > 0 ? config : nullptr), EGL_NO_CONTEXT,
+										  context_attribs);
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		cout << "failed to create a gl 3.3 context" << endl;
+		return 1;
+	}
+	cout << "renderer: " << glGetString(GL_RENDERER) << endl;
+	
+	// render target (one layer per frame), fullscreen triangle, program
+	const size_t frame_count = 120;
+	const GLsizei target_size = 256;
+	GLuint target_tex = 0, fbo = 0, vao = 0, vbo = 0;
+	glGenTextures(1, &target_tex);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, target_tex);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32UI, target_size, target_size, (GLsizei)frame_count, 0,
+				 GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, target_size, target_size);
+	
+	const float fullscreen_triangle[] { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(fullscreen_triangle), fullscreen_triangle, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+	glEnableVertexAttribArray(0);
+	
+	const GLuint prog = compile_program();
+	glUseProgram(prog);
+	glUniform1i(glGetUniformLocation(prog, "slot_data"), 0);
+	
+	// per-frame resources: one buffer (+ texture buffer) per slot
+	GLuint slot_buffers[A2E_CONCURRENT_FRAMES], slot_textures[A2E_CONCURRENT_FRAMES];
+	glGenBuffers(A2E_CONCURRENT_FRAMES, slot_buffers);
+	glGenTextures(A2E_CONCURRENT_FRAMES, slot_textures);
+	for(size_t i = 0; i < A2E_CONCURRENT_FRAMES; i++) {
+		const uint32_t init_data[4] { 0, 0, 0, 0 };
+		glBindBuffer(GL_TEXTURE_BUFFER, slot_buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(init_data), init_data, GL_DYNAMIC_DRAW);
+		glBindTexture(GL_TEXTURE_BUFFER, slot_textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, slot_buffers[i]);
+	}
+	
+	vector<uint32_t> results(size_t(target_size * target_size) * frame_count);
+	bool success = true;
+	for(size_t frames_in_flight = 1; frames_in_flight <= A2E_CONCURRENT_FRAMES; frames_in_flight++) {
+		frame_sync sync(frames_in_flight);
+		const auto start = chrono::steady_clock::now();
+		for(size_t frame = 0; frame < frame_count; frame++) {
+			sync.begin_frame();
+			const size_t slot = sync.get_frame_slot();
+			success &= sync.check_writable(slot, "slot buffer");
+			
+			// no orphaning, no implicit sync: only the fence of begin_frame protects the slot
+			const uint32_t value = (uint32_t)(frame + 1);
+			glBindBuffer(GL_TEXTURE_BUFFER, slot_buffers[slot]);
+			void* mapped_ptr = glMapBufferRange(GL_TEXTURE_BUFFER, 0, sizeof(uint32_t),
+												GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			memcpy(mapped_ptr, &value, sizeof(uint32_t));
+			glUnmapBuffer(GL_TEXTURE_BUFFER);
+			
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_BUFFER, slot_textures[slot]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target_tex, 0, (GLint)frame);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			sync.end_frame();
+			glFlush();
+			
+			// "cpu work" of the next frame
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		sync.wait_idle();
+		const double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		
+		// every frame must have read its own value
+		size_t wrong_frames = 0;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, target_tex);
+		glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, results.data());
+		for(size_t frame = 0; frame < frame_count; frame++) {
+			if(results[(frame * size_t(target_size) + size_t(target_size / 2)) * size_t(target_size) +
+					   size_t(target_size / 2)] != frame + 1) {
+				wrong_frames++;
+			}
+		}
+		if(wrong_frames > 0) {
+			cout << "FAILED: " << wrong_frames << " frames read the data of another frame" << endl;
+			success = false;
+		}
+		
+		// writing the slot of another frame must be flagged
+		if(frames_in_flight > 1) {
+			sync.begin_frame();
+			cout << "expected error: ";
+			success &= !sync.check_writable((sync.get_frame_slot() + 1) % frames_in_flight, "negative check");
+			sync.end_frame();
+			sync.wait_idle();
+		}
+		
+		const auto& stats = sync.get_stats();
+		cout << frames_in_flight << " frame(s) in flight: " << frame_count << " frames in " << time << "ms, ";
+		cout << stats.wait_count << " waits (" << stats.total_wait_time << "ms), ";
+		cout << stats.assertion_failures << " assertion failures" << endl;
+	}
+	
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,97 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/model/a2m_file.hpp"
+#include <chrono>
+#include <random>
+
+//! compares the (multi-threaded) a2m_file::generate_normals against the plain serial computation via
+//! core::compute_normal_tangent_binormal on randomly perturbed grid meshes of increasing size and prints the timings
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	static constexpr float epsilon = 0.001f;
+	mt19937 gen(42);
+	uniform_real_distribution<float> dist(-0.25f, 0.25f);
+	bool success = true;
+	for(const unsigned int grid_size : { 64u, 256u, 512u, 1024u, 2048u }) {
+		// (grid_size + 1)^2 vertices, 2 * grid_size^2 triangles
+		const unsigned int vertex_count = (grid_size + 1) * (grid_size + 1);
+		vector<float3> vertices(vertex_count);
+		vector<float2> tex_coords(vertex_count);
+		for(unsigned int y = 0; y <= grid_size; y++) {
+			for(unsigned int x = 0; x <= grid_size; x++) {
+				vertices[y * (grid_size + 1) + x] = float3(float(x) + dist(gen), dist(gen), float(y) + dist(gen));
+				tex_coords[y * (grid_size + 1) + x] = float2(float(x), float(y)) / float(grid_size);
+			}
+		}
+		vector<uint3> indices;
+		indices.reserve(grid_size * grid_size * 2);
+		for(unsigned int y = 0; y < grid_size; y++) {
+			for(unsigned int x = 0; x < grid_size; x++) {
+				const unsigned int idx = y * (grid_size + 1) + x;
+				indices.emplace_back(idx, idx + grid_size + 1, idx + 1);
+				indices.emplace_back(idx + 1, idx + grid_size + 1, idx + grid_size + 2);
+			}
+		}
+		const unsigned int index_count = (unsigned int)indices.size();
+		const uint3* index_ptr = indices.data();
+		
+		// reference
+		auto start = chrono::steady_clock::now();
+		vector<float3> ref_normals(vertex_count), ref_binormals(vertex_count), ref_tangents(vertex_count);
+		float3 normal, binormal, tangent;
+		for(const auto& tri : indices) {
+			core::compute_normal_tangent_binormal(vertices[tri.x], vertices[tri.y], vertices[tri.z],
+												  normal, binormal, tangent,
+												  tex_coords[tri.x], tex_coords[tri.y], tex_coords[tri.z]);
+			for(size_t k = 0; k < 3; k++) {
+				ref_normals[tri[k]] += normal;
+				ref_binormals[tri[k]] += binormal;
+				ref_tangents[tri[k]] += tangent;
+			}
+		}
+		for(unsigned int i = 0; i < vertex_count; i++) {
+			ref_normals[i].normalize();
+			ref_binormals[i].normalize();
+			ref_tangents[i].normalize();
+		}
+		const double ref_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		
+		cout << grid_size << "x" << grid_size << " (" << index_count << " triangles): reference " << ref_time << "ms";
+		for(const size_t worker_count : { size_t(1), size_t(0) }) {
+			vector<float3> normals(vertex_count), binormals(vertex_count), tangents(vertex_count);
+			start = chrono::steady_clock::now();
+			a2m_file::generate_normals(1, &index_count, &index_ptr, &index_ptr, vertices.data(), tex_coords.data(),
+									   vertex_count, normals.data(), binormals.data(), tangents.data(), worker_count);
+			const double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			
+			float max_diff = 0.0f;
+			for(unsigned int i = 0; i < vertex_count; i++) {
+				max_diff = std::max(max_diff, (normals[i] - ref_normals[i]).length());
+				max_diff = std::max(max_diff, (binormals[i] - ref_binormals[i]).length());
+				max_diff = std::max(max_diff, (tangents[i] - ref_tangents[i]).length());
+			}
+			const bool match = (max_diff <= epsilon);
+			success &= match;
+			cout << ", " << (worker_count == 1 ? "blocked" : "threaded") << " " << time << "ms";
+			cout << " (max diff " << max_diff << (match ? "" : " - MISMATCH") << ")";
+		}
+		cout << endl;
+	}
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,271 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rendering/gl_state.hpp"
+#include "../tools_common.hpp"
+#include <functional>
+
+//! all gl calls that reach the backend, formatted as "function(arg, ...)"
+static vector<string> recorded_calls;
+
+static string format_call(const char* name, const vector<unsigned long long>& args) {
+	string call = string(name) + "(";
+	for(size_t i = 0; i < args.size(); i++) {
+		call += (i > 0 ? ", " : "") + to_string(args[i]);
+	}
+	return call + ")";
+}
+
+//! records every call instead of calling gl (-> no gl context is needed)
+static const gl_state::backend recording_backend {
+	[](GLenum cap) { recorded_calls.emplace_back(format_call("enable", { cap })); },
+	[](GLenum cap) { recorded_calls.emplace_back(format_call("disable", { cap })); },
+	[](GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+		recorded_calls.emplace_back(format_call("blend_func_separate", { src_rgb, dst_rgb, src_alpha, dst_alpha }));
+	},
+	[](GLenum func) { recorded_calls.emplace_back(format_call("depth_func", { func })); },
+	[](GLboolean flag) { recorded_calls.emplace_back(format_call("depth_mask", { flag })); },
+	[](GLenum mode) { recorded_calls.emplace_back(format_call("cull_face", { mode })); },
+	[](GLenum mode) { recorded_calls.emplace_back(format_call("front_face", { mode })); },
+	[](GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+		recorded_calls.emplace_back(format_call("color_mask", { red, green, blue, alpha }));
+	},
+	[](GLenum target, GLuint buffer) { recorded_calls.emplace_back(format_call("bind_buffer", { target, buffer })); },
+	[](GLenum target, GLuint index, GLuint buffer) {
+		recorded_calls.emplace_back(format_call("bind_buffer_base", { target, index, buffer }));
+	},
+	[](GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+		recorded_calls.emplace_back(format_call("bind_buffer_range", { target, index, buffer,
+			(unsigned long long)offset, (unsigned long long)size }));
+	},
+	[](GLuint program) { recorded_calls.emplace_back(format_call("use_program", { program })); },
+	[](GLenum texture_unit) { recorded_calls.emplace_back(format_call("active_texture", { texture_unit })); },
+	[](GLenum target, GLuint texture) { recorded_calls.emplace_back(format_call("bind_texture", { target, texture })); },
+	[](GLuint vao) { recorded_calls.emplace_back(format_call("bind_vertex_array", { vao })); },
+	[](GLsizei count, const GLuint* buffers) {
+		recorded_calls.emplace_back(format_call("delete_buffers", vector<unsigned long long>(buffers, buffers + count)));
+	},
+	[](GLsizei count, const GLuint* textures) {
+		recorded_calls.emplace_back(format_call("delete_textures", vector<unsigned long long>(textures, textures + count)));
+	},
+	[](GLsizei count, const GLuint* vaos) {
+		recorded_calls.emplace_back(format_call("delete_vertex_arrays", vector<unsigned long long>(vaos, vaos + count)));
+	},
+};
+
+//! runs the state changes and checks that exactly the expected calls reached the backend
+static bool check_calls(const char* name, const function<void()>& state_changes, const vector<string>& expected) {
+	recorded_calls.clear();
+	state_changes();
+	if(recorded_calls == expected) return true;
+	cout << "FAILED: " << name << endl;
+	cout << "\texpected:";
+	for(const auto& call : expected) cout << " " << call;
+	cout << endl << "\trecorded:";
+	for(const auto& call : recorded_calls) cout << " " << call;
+	cout << endl;
+	return false;
+}
+
+//! all state changes of a (small) frame, every call changes the state once and then repeats it
+static void set_frame_state() {
+	gl_state::enable(GL_BLEND);
+	gl_state::enable(GL_BLEND);
+	gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state::depth_func(GL_LEQUAL);
+	gl_state::depth_func(GL_LEQUAL);
+	gl_state::depth_mask(GL_FALSE);
+	gl_state::depth_mask(GL_FALSE);
+	gl_state::cull_face(GL_BACK);
+	gl_state::cull_face(GL_BACK);
+	gl_state::front_face(GL_CCW);
+	gl_state::front_face(GL_CCW);
+	gl_state::color_mask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+	gl_state::color_mask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+	gl_state::use_program(3);
+	gl_state::use_program(3);
+	gl_state::bind_vertex_array(4);
+	gl_state::bind_vertex_array(4);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 5);
+	gl_state::bind_buffer(GL_ARRAY_BUFFER, 5);
+	gl_state::active_texture(GL_TEXTURE0);
+	gl_state::active_texture(GL_TEXTURE0);
+	gl_state::bind_texture(GL_TEXTURE_2D, 6);
+	gl_state::bind_texture(GL_TEXTURE_2D, 6);
+}
+
+static const vector<string> frame_calls {
+	format_call("enable", { GL_BLEND }),
+	format_call("blend_func_separate", { GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA }),
+	format_call("depth_func", { GL_LEQUAL }),
+	format_call("depth_mask", { GL_FALSE }),
+	format_call("cull_face", { GL_BACK }),
+	format_call("front_face", { GL_CCW }),
+	format_call("color_mask", { GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE }),
+	format_call("use_program", { 3 }),
+	format_call("bind_vertex_array", { 4 }),
+	format_call("bind_buffer", { GL_ARRAY_BUFFER, 5 }),
+	format_call("active_texture", { GL_TEXTURE0 }),
+	format_call("bind_texture", { GL_TEXTURE_2D, 6 }),
+};
+
+//! checks with a recording backend that gl_state only forwards calls that change the gl state (redundant
+//! enables, blend/depth/cull state changes and buffer/program/texture/vao binds are elided), that bindings
+//! are forgotten/reset where gl does so implicitly, and that invalidate()/start_frame() force a re-issue
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	const gl_state::backend gl_backend = gl_state::get_gl_backend();
+	gl_state::set_backend(recording_backend);
+	
+	// unknown state -> everything is issued once, all repeats are elided
+	success &= check_calls("first frame", set_frame_state, frame_calls);
+	success &= check_calls("repeated frame", set_frame_state, {});
+	
+	// counters: 12 different calls, each issued once and elided once
+	{
+		const auto total = gl_state::get_frame_counters().total();
+		success &= check("issued count", total.issued == 12);
+		success &= check("elided count", total.elided == 12 + 24);
+		success &= check("per call count", gl_state::get_frame_counters().calls[(size_t)gl_state::CALL::BLEND_FUNC].issued == 1 &&
+						 gl_state::get_frame_counters().calls[(size_t)gl_state::CALL::BLEND_FUNC].elided == 1 + 2);
+	}
+	
+	// enable/disable
+	success &= check_calls("disable", [] {
+		gl_state::disable(GL_BLEND);
+		gl_state::disable(GL_BLEND);
+		gl_state::enable(GL_BLEND);
+	}, { format_call("disable", { GL_BLEND }), format_call("enable", { GL_BLEND }) });
+	success &= check_calls("caps are independent", [] {
+		gl_state::enable(GL_DEPTH_TEST);
+		gl_state::disable(GL_CULL_FACE);
+		gl_state::enable(GL_DEPTH_TEST);
+		gl_state::enable(GL_BLEND);
+	}, { format_call("enable", { GL_DEPTH_TEST }), format_call("disable", { GL_CULL_FACE }) });
+	success &= check_calls("untracked caps", [] {
+		gl_state::enable(GL_DITHER);
+		gl_state::enable(GL_DITHER);
+	}, { format_call("enable", { GL_DITHER }), format_call("enable", { GL_DITHER }) });
+	
+	// blend func: blend_func(src, dst) == blend_func_separate(src, dst, src, dst)
+	success &= check_calls("blend func", [] {
+		gl_state::blend_func_separate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		gl_state::blend_func(GL_ONE, GL_ONE);
+		gl_state::blend_func_separate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+		gl_state::blend_func_separate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE);
+	}, {
+		format_call("blend_func_separate", { GL_ONE, GL_ONE, GL_ONE, GL_ONE }),
+		format_call("blend_func_separate", { GL_ONE, GL_ONE, GL_ZERO, GL_ONE }),
+	});
+	
+	// any flag change of the depth/color mask is issued
+	success &= check_calls("masks", [] {
+		gl_state::depth_mask(GL_TRUE);
+		gl_state::color_mask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		gl_state::color_mask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		gl_state::color_mask(GL_FALSE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}, {
+		format_call("depth_mask", { GL_TRUE }),
+		format_call("color_mask", { GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE }),
+		format_call("color_mask", { GL_FALSE, GL_TRUE, GL_TRUE, GL_TRUE }),
+	});
+	
+	// buffer targets are cached separately, the element array buffer binding is vao state
+	success &= check_calls("buffer targets", [] {
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 5);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+	}, { format_call("bind_buffer", { GL_ELEMENT_ARRAY_BUFFER, 5 }) });
+	success &= check_calls("vao change", [] {
+		gl_state::bind_vertex_array(7);
+		gl_state::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 5);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 5);
+	}, { format_call("bind_vertex_array", { 7 }), format_call("bind_buffer", { GL_ELEMENT_ARRAY_BUFFER, 5 }) });
+	
+	// indexed binds are always issued, but also set the generic binding
+	success &= check_calls("indexed buffer binds", [] {
+		gl_state::bind_buffer_base(GL_UNIFORM_BUFFER, 0, 8);
+		gl_state::bind_buffer_base(GL_UNIFORM_BUFFER, 0, 8);
+		gl_state::bind_buffer(GL_UNIFORM_BUFFER, 8);
+		gl_state::bind_buffer_range(GL_UNIFORM_BUFFER, 1, 9, 256, 512);
+		gl_state::bind_buffer(GL_UNIFORM_BUFFER, 9);
+	}, {
+		format_call("bind_buffer_base", { GL_UNIFORM_BUFFER, 0, 8 }),
+		format_call("bind_buffer_base", { GL_UNIFORM_BUFFER, 0, 8 }),
+		format_call("bind_buffer_range", { GL_UNIFORM_BUFFER, 1, 9, 256, 512 }),
+	});
+	
+	// textures are cached per unit and target
+	success &= check_calls("texture units", [] {
+		gl_state::active_texture(GL_TEXTURE1);
+		gl_state::bind_texture(GL_TEXTURE_2D, 6);
+		gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 6);
+		gl_state::active_texture(GL_TEXTURE0);
+		gl_state::bind_texture(GL_TEXTURE_2D, 6);
+		gl_state::bind_texture(GL_TEXTURE_CUBE_MAP, 6);
+	}, {
+		format_call("active_texture", { GL_TEXTURE1 }),
+		format_call("bind_texture", { GL_TEXTURE_2D, 6 }),
+		format_call("bind_texture", { GL_TEXTURE_CUBE_MAP, 6 }),
+		format_call("active_texture", { GL_TEXTURE0 }),
+		format_call("bind_texture", { GL_TEXTURE_CUBE_MAP, 6 }),
+	});
+	
+	// deleting bound objects resets their bindings to 0 (as gl does)
+	success &= check_calls("delete bound objects", [] {
+		const GLuint texture = 6, buffer = 5, vao = 7;
+		gl_state::delete_textures(1, &texture);
+		gl_state::delete_buffers(1, &buffer);
+		gl_state::delete_vertex_arrays(1, &vao);
+		gl_state::bind_texture(GL_TEXTURE_2D, 0);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 0);
+		gl_state::bind_vertex_array(0);
+		gl_state::bind_texture(GL_TEXTURE_2D, 6);
+		gl_state::bind_buffer(GL_ARRAY_BUFFER, 5);
+	}, {
+		format_call("delete_textures", { 6 }),
+		format_call("delete_buffers", { 5 }),
+		format_call("delete_vertex_arrays", { 7 }),
+		format_call("bind_texture", { GL_TEXTURE_2D, 6 }),
+		format_call("bind_buffer", { GL_ARRAY_BUFFER, 5 }),
+	});
+	
+	// invalidate -> everything is issued again, even if it didn't change
+	success &= check_calls("restore frame state", set_frame_state, {
+		format_call("blend_func_separate", { GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA }),
+		format_call("depth_mask", { GL_FALSE }),
+		format_call("color_mask", { GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE }),
+		format_call("bind_vertex_array", { 4 }),
+	});
+	gl_state::invalidate();
+	success &= check_calls("invalidate", set_frame_state, frame_calls);
+	
+	// a new frame moves the counters and invalidates
+	const auto frame_total = gl_state::get_frame_counters().total();
+	gl_state::start_frame();
+	success &= check("last frame counters", gl_state::get_last_frame_counters().total().issued == frame_total.issued &&
+					 gl_state::get_last_frame_counters().total().elided == frame_total.elided);
+	success &= check("reset counters", gl_state::get_frame_counters().total().issued == 0 &&
+					 gl_state::get_frame_counters().total().elided == 0);
+	success &= check_calls("start frame", set_frame_state, frame_calls);
+	
+	gl_state::set_backend(gl_backend);
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,201 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/light_clusters.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <random>
+
+static constexpr float near_plane = 1.0f, far_plane = 500.0f;
+
+//! random lights inside the view frustum + lights crossing/in front of the near plane and crossing/beyond the far plane
+static vector<float4> make_lights(const size_t count, const float aspect, const unsigned int seed) {
+	mt19937 gen(seed);
+	uniform_real_distribution<float> unit_dist(0.0f, 1.0f);
+	vector<float4> light_data;
+	light_data.reserve(count * 2);
+	for(size_t i = 0; i < count; i++) {
+		float dist = near_plane + unit_dist(gen) * (far_plane - near_plane);
+		float radius = 0.5f + unit_dist(gen) * 10.0f;
+		switch(i % 16) {
+			case 0: dist = unit_dist(gen) * near_plane * 2.0f; break; // crossing the near plane
+			case 1: dist = -unit_dist(gen) * 5.0f; radius = 0.5f + unit_dist(gen) * 2.0f; break; // behind the camera
+			case 2: dist = far_plane + (unit_dist(gen) - 0.5f) * 10.0f; break; // crossing the far plane
+			case 3: dist = far_plane + 20.0f + unit_dist(gen) * 100.0f; break; // beyond the far plane
+			default: break;
+		}
+		// (slightly more than) the frustum extent at this distance
+		const float extent = std::max(dist, near_plane) * 1.2f;
+		const float x = (unit_dist(gen) * 2.0f - 1.0f) * extent * aspect;
+		const float y = (unit_dist(gen) * 2.0f - 1.0f) * extent;
+		light_data.emplace_back(float3(x, y, -dist), radius);
+		light_data.emplace_back(float3(1.0f, 1.0f, 1.0f), 1.0f / (radius * radius));
+	}
+	return light_data;
+}
+
+//! returns the sorted light indices of each cluster
+static vector<vector<uint32_t>> get_cluster_lights(const light_clusters& clusters) {
+	vector<vector<uint32_t>> cluster_lights;
+	for(const auto& cluster : clusters.get_clusters()) {
+		vector<uint32_t> indices(clusters.get_light_indices().begin() + cluster.x,
+								 clusters.get_light_indices().begin() + cluster.x + cluster.y);
+		sort(indices.begin(), indices.end());
+		cluster_lights.emplace_back(indices);
+	}
+	return cluster_lights;
+}
+
+//! tests every light against the view space aabb of every froxel (exponential depth slices, tiles in ndc x/y),
+//! returns the clusters every light must be in (radius - epsilon) and may be in (radius + epsilon)
+static void brute_force(const vector<float4>& light_data, const matrix4f& projection, const uint3& grid_size,
+						vector<vector<uint32_t>>& required, vector<vector<uint32_t>>& allowed) {
+	const size_t cluster_count = size_t(grid_size.x) * size_t(grid_size.y) * size_t(grid_size.z);
+	required.assign(cluster_count, {});
+	allowed.assign(cluster_count, {});
+	const auto& m = projection.data;
+	for(uint32_t k = 0; k < grid_size.z; k++) {
+		const float d_near = near_plane * powf(far_plane / near_plane, float(k) / float(grid_size.z));
+		const float d_far = near_plane * powf(far_plane / near_plane, float(k + 1) / float(grid_size.z));
+		for(uint32_t j = 0; j < grid_size.y; j++) {
+			const float ndc_y_0 = (float(j) / float(grid_size.y)) * 2.0f - 1.0f;
+			const float ndc_y_1 = (float(j + 1) / float(grid_size.y)) * 2.0f - 1.0f;
+			for(uint32_t i = 0; i < grid_size.x; i++) {
+				const float ndc_x_0 = (float(i) / float(grid_size.x)) * 2.0f - 1.0f;
+				const float ndc_x_1 = (float(i + 1) / float(grid_size.x)) * 2.0f - 1.0f;
+				
+				// aabb of the 8 froxel corners
+				float3 bmin(numeric_limits<float>::max()), bmax(-numeric_limits<float>::max());
+				for(const auto& d : { d_near, d_far }) {
+					for(const auto& ndc_x : { ndc_x_0, ndc_x_1 }) {
+						for(const auto& ndc_y : { ndc_y_0, ndc_y_1 }) {
+							const float3 corner(d * (ndc_x + m[8]) / m[0], d * (ndc_y + m[9]) / m[5], -d);
+							bmin.x = std::min(bmin.x, corner.x); bmax.x = std::max(bmax.x, corner.x);
+							bmin.y = std::min(bmin.y, corner.y); bmax.y = std::max(bmax.y, corner.y);
+							bmin.z = std::min(bmin.z, corner.z); bmax.z = std::max(bmax.z, corner.z);
+						}
+					}
+				}
+				
+				const size_t cluster_idx = i + (j + k * grid_size.y) * grid_size.x;
+				for(size_t l = 0; l < light_data.size() / 2; l++) {
+					const float4& sphere = light_data[l * 2];
+					const float dx = std::max(std::max(bmin.x - sphere.x, 0.0f), sphere.x - bmax.x);
+					const float dy = std::max(std::max(bmin.y - sphere.y, 0.0f), sphere.y - bmax.y);
+					const float dz = std::max(std::max(bmin.z - sphere.z, 0.0f), sphere.z - bmax.z);
+					const float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+					// relative to the light distance, since the slice computation (log) is only exact up to that
+					const float epsilon = 1.0e-4f * (sphere.w + fabsf(sphere.z));
+					if(dist <= sphere.w - epsilon) required[cluster_idx].push_back((uint32_t)l);
+					if(dist <= sphere.w + epsilon) allowed[cluster_idx].push_back((uint32_t)l);
+				}
+			}
+		}
+	}
+}
+
+//! checks the light assignment against a brute force sphere/froxel test (single- and multi-threaded binning),
+//! then times binning 1k - 64k lights
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	const float aspect = 16.0f / 9.0f;
+	const matrix4f modelview;
+	const matrix4f projection(make_projection(aspect, near_plane, far_plane));
+	const float2 near_far(near_plane, far_plane);
+	const uint3 grid_size(16, 9, 24);
+	
+	// correctness (no cluster overflow -> the light lists must match exactly, up to rounding at the froxel borders)
+	{
+		const auto light_data = make_lights(2048, aspect, 1);
+		vector<vector<uint32_t>> required, allowed;
+		brute_force(light_data, projection, grid_size, required, allowed);
+		
+		for(const auto& worker_count : { size_t(1), size_t(4) }) {
+			light_clusters clusters(grid_size, 2048);
+			clusters.set_worker_count(worker_count);
+			clusters.build(light_data, modelview, projection, near_far);
+			const auto cluster_lights = get_cluster_lights(clusters);
+			
+			bool missing = false, superfluous = false;
+			for(size_t i = 0; i < cluster_lights.size(); i++) {
+				missing |= !includes(cluster_lights[i].begin(), cluster_lights[i].end(),
+									 required[i].begin(), required[i].end());
+				superfluous |= !includes(allowed[i].begin(), allowed[i].end(),
+										 cluster_lights[i].begin(), cluster_lights[i].end());
+			}
+			success &= check(worker_count == 1 ? "missing lights (1 worker)" : "missing lights (4 workers)", !missing);
+			success &= check(worker_count == 1 ? "superfluous lights (1 worker)" : "superfluous lights (4 workers)",
+							 !superfluous);
+		}
+	}
+	
+	// only lights in front of the near plane / beyond the far plane
+	{
+		vector<float4> light_data;
+		light_data.emplace_back(float3(0.0f, 0.0f, 5.0f), 1.0f); // behind the camera
+		light_data.emplace_back(float3(1.0f, 1.0f, 1.0f), 1.0f);
+		light_data.emplace_back(float3(0.0f, 0.0f, -(far_plane + 10.0f)), 1.0f); // beyond the far plane
+		light_data.emplace_back(float3(1.0f, 1.0f, 1.0f), 1.0f);
+		light_data.emplace_back(float3(0.0f, 0.0f, -near_plane * 0.5f), near_plane * 0.25f); // in front of the near plane
+		light_data.emplace_back(float3(1.0f, 1.0f, 1.0f), 1.0f);
+		light_clusters clusters(grid_size);
+		clusters.set_worker_count(1);
+		clusters.build(light_data, modelview, projection, near_far);
+		success &= check("culled near/far lights", clusters.get_light_indices().empty());
+		
+		// a light exactly at the near plane must end up in the first slice
+		light_data.resize(2);
+		light_data[0] = float4(0.0f, 0.0f, -near_plane, 0.01f);
+		clusters.build(light_data, modelview, projection, near_far);
+		const auto center_cluster = clusters.get_clusters()[clusters.get_cluster_index(uint3(grid_size.x / 2, grid_size.y / 2, 0))];
+		success &= check("light at the near plane", clusters.get_light_indices().size() >= 1 && center_cluster.y == 1);
+	}
+	
+	// multi-threaded binning must produce the same clusters as single-threaded binning
+	for(size_t light_count = 1024; light_count <= 64 * 1024; light_count *= 4) {
+		const auto light_data = make_lights(light_count, aspect, (unsigned int)light_count);
+		light_clusters single_clusters(grid_size), multi_clusters(grid_size);
+		single_clusters.set_worker_count(1);
+		single_clusters.build(light_data, modelview, projection, near_far);
+		multi_clusters.build(light_data, modelview, projection, near_far);
+		success &= check("single-/multi-threaded", get_cluster_lights(single_clusters) == get_cluster_lights(multi_clusters));
+	}
+	
+	// timing
+	const size_t iterations = 20;
+	for(size_t light_count = 1024; light_count <= 64 * 1024; light_count *= 2) {
+		const auto light_data = make_lights(light_count, aspect, 42);
+		cout << light_count << " lights:";
+		for(const auto& worker_count : { size_t(1), size_t(0) }) {
+			light_clusters clusters(grid_size);
+			clusters.set_worker_count(worker_count);
+			clusters.build(light_data, modelview, projection, near_far); // warm-up
+			const auto start = chrono::steady_clock::now();
+			for(size_t i = 0; i < iterations; i++) {
+				clusters.build(light_data, modelview, projection, near_far);
+			}
+			const double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / double(iterations);
+			cout << (worker_count == 1 ? " single-threaded " : ", multi-threaded ") << time << "ms";
+			if(worker_count == 1) cout << " (" << clusters.get_light_indices().size() << " indices)";
+		}
+		cout << endl;
+	}
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
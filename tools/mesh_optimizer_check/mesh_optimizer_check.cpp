@@ -0,0 +1,333 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/model/a2m_file.hpp"
+#include "scene/model/mesh_optimizer.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <random>
+
+//! a torus and two concentric spheres (-> overdraw from every direction), all vertices exist twice (the triangles
+//! randomly reference either copy), some vertices are unreferenced and the triangles are in random order
+static a2m_file::model_data make_model(mt19937& gen) {
+	struct sub_object {
+		vector<float3> positions, normals;
+		vector<float2> tex_coords;
+		vector<uint3> triangles;
+		
+		// (u, v) grid of vertices (the seam vertices are separate, since their tex coords differ)
+		void add_grid(const size_t u_count, const size_t v_count, const function<float3(float, float, float3&)>& surface) {
+			const uint32_t base = (uint32_t)positions.size();
+			for(size_t j = 0; j <= v_count; j++) {
+				for(size_t i = 0; i <= u_count; i++) {
+					const float u = float(i) / float(u_count), v = float(j) / float(v_count);
+					float3 normal;
+					positions.emplace_back(surface(u, v, normal));
+					normals.emplace_back(normal);
+					tex_coords.emplace_back(u, v);
+				}
+			}
+			for(uint32_t j = 0; j < v_count; j++) {
+				for(uint32_t i = 0; i < u_count; i++) {
+					const uint32_t idx = base + i + j * uint32_t(u_count + 1);
+					triangles.emplace_back(idx, idx + 1, idx + uint32_t(u_count) + 2);
+					triangles.emplace_back(idx, idx + uint32_t(u_count) + 2, idx + uint32_t(u_count) + 1);
+				}
+			}
+		}
+	};
+	const float pi = 3.14159265358979f;
+	const auto torus = [pi](float u, float v, float3& normal) {
+		const float phi = u * 2.0f * pi, theta = v * 2.0f * pi;
+		normal = float3(cosf(phi) * cosf(theta), sinf(theta), -sinf(phi) * cosf(theta));
+		return float3(cosf(phi), 0.0f, -sinf(phi)) + normal * 0.4f;
+	};
+	const auto sphere = [pi](const float radius) {
+		return [pi, radius](float u, float v, float3& normal) {
+			const float phi = u * 2.0f * pi, theta = (v - 0.5f) * pi;
+			normal = float3(cosf(phi) * cosf(theta), sinf(theta), -sinf(phi) * cosf(theta));
+			return normal * radius;
+		};
+	};
+	array<sub_object, 2> objects;
+	objects[0].add_grid(96, 48, torus);
+	objects[1].add_grid(64, 32, sphere(0.8f));
+	objects[1].add_grid(64, 32, sphere(1.0f));
+	
+	a2m_file::model_data data;
+	for(const auto& obj : objects) {
+		data.vertex_count += (unsigned int)obj.positions.size() * 2 + 8;
+	}
+	data.vertices = new float3[data.vertex_count];
+	data.tex_coords = new float2[data.vertex_count];
+	data.normals = new float3[data.vertex_count];
+	data.binormals = new float3[data.vertex_count];
+	data.tangents = new float3[data.vertex_count];
+	data.object_count = (unsigned int)objects.size();
+	data.object_names = { "torus", "spheres" };
+	data.indices = new uint3*[data.object_count];
+	data.index_count = new unsigned int[data.object_count];
+	data.min_index = new unsigned int[data.object_count];
+	data.max_index = new unsigned int[data.object_count];
+	
+	uint32_t vertex_offset = 0;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		const auto& obj = objects[i];
+		const uint32_t vertex_count = (uint32_t)obj.positions.size();
+		// vertex layout of the sub-object: vertices, copies of all vertices, 8 unreferenced vertices
+		for(uint32_t j = 0; j < vertex_count * 2 + 8; j++) {
+			const uint32_t src = j % vertex_count;
+			const float3 tangent(obj.normals[src].crossed(float3(0.0f, 1.0f, 0.0f)));
+			data.vertices[vertex_offset + j] = obj.positions[src] + (j < vertex_count * 2 ? float3(0.0f) : float3(10.0f));
+			data.tex_coords[vertex_offset + j] = obj.tex_coords[src];
+			data.normals[vertex_offset + j] = obj.normals[src];
+			data.tangents[vertex_offset + j] = tangent;
+			data.binormals[vertex_offset + j] = obj.normals[src].crossed(tangent);
+		}
+		
+		vector<uint3> triangles(obj.triangles);
+		shuffle(triangles.begin(), triangles.end(), gen);
+		uniform_int_distribution<uint32_t> copy_dist(0, 1), rotation_dist(0, 2);
+		for(auto& tri : triangles) {
+			// random copy of each vertex + random (winding preserving) rotation of the triangle
+			for(size_t k = 0; k < 3; k++) tri[k] += vertex_offset + copy_dist(gen) * vertex_count;
+			const uint32_t rotation = rotation_dist(gen);
+			tri = uint3(tri[rotation], tri[(rotation + 1) % 3], tri[(rotation + 2) % 3]);
+		}
+		data.index_count[i] = (unsigned int)triangles.size();
+		data.indices[i] = new uint3[triangles.size()];
+		copy(triangles.begin(), triangles.end(), data.indices[i]);
+		data.min_index[i] = vertex_offset;
+		data.max_index[i] = vertex_offset + vertex_count * 2 + 7;
+		vertex_offset += vertex_count * 2 + 8;
+	}
+	return data;
+}
+
+static a2m_file::model_data copy_model(const a2m_file::model_data& src) {
+	a2m_file::model_data data;
+	data.type = src.type;
+	data.optimized = src.optimized;
+	data.vertex_count = src.vertex_count;
+	data.vertices = new float3[src.vertex_count];
+	data.tex_coords = new float2[src.vertex_count];
+	data.normals = new float3[src.vertex_count];
+	data.binormals = new float3[src.vertex_count];
+	data.tangents = new float3[src.vertex_count];
+	copy(src.vertices, src.vertices + src.vertex_count, data.vertices);
+	copy(src.tex_coords, src.tex_coords + src.vertex_count, data.tex_coords);
+	copy(src.normals, src.normals + src.vertex_count, data.normals);
+	copy(src.binormals, src.binormals + src.vertex_count, data.binormals);
+	copy(src.tangents, src.tangents + src.vertex_count, data.tangents);
+	data.object_count = src.object_count;
+	data.object_names = src.object_names;
+	data.indices = new uint3*[src.object_count];
+	data.index_count = new unsigned int[src.object_count];
+	data.min_index = new unsigned int[src.object_count];
+	data.max_index = new unsigned int[src.object_count];
+	for(unsigned int i = 0; i < src.object_count; i++) {
+		data.index_count[i] = src.index_count[i];
+		data.min_index[i] = src.min_index[i];
+		data.max_index[i] = src.max_index[i];
+		data.indices[i] = new uint3[src.index_count[i]];
+		copy(src.indices[i], src.indices[i] + src.index_count[i], data.indices[i]);
+	}
+	return data;
+}
+
+//! true if both models contain the exact same (byte-wise) vertex and index data
+static bool equal_models(const a2m_file::model_data& a, const a2m_file::model_data& b) {
+	if(a.vertex_count != b.vertex_count || a.object_count != b.object_count) return false;
+	if(memcmp(a.vertices, b.vertices, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.tex_coords, b.tex_coords, a.vertex_count * sizeof(float2)) != 0 ||
+	   memcmp(a.normals, b.normals, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.binormals, b.binormals, a.vertex_count * sizeof(float3)) != 0 ||
+	   memcmp(a.tangents, b.tangents, a.vertex_count * sizeof(float3)) != 0) {
+		return false;
+	}
+	for(unsigned int i = 0; i < a.object_count; i++) {
+		if(a.index_count[i] != b.index_count[i] || a.min_index[i] != b.min_index[i] || a.max_index[i] != b.max_index[i] ||
+		   memcmp(a.indices[i], b.indices[i], a.index_count[i] * sizeof(uint3)) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//! all vertex attributes of a triangle (as bits), starting with the smallest vertex (-> independent of the vertex
+//! indices and the rotation of the triangle, but not of its winding)
+typedef array<uint32_t, 14> vertex_key;
+typedef array<vertex_key, 3> triangle_key;
+static vector<triangle_key> get_triangle_set(const a2m_file::model_data& data, const unsigned int object) {
+	vector<triangle_key> triangles;
+	triangles.reserve(data.index_count[object]);
+	for(unsigned int i = 0; i < data.index_count[object]; i++) {
+		triangle_key tri;
+		for(size_t j = 0; j < 3; j++) {
+			const uint32_t idx = data.indices[object][i][j];
+			memcpy(&tri[j][0], &data.vertices[idx], sizeof(float3));
+			memcpy(&tri[j][3], &data.tex_coords[idx], sizeof(float2));
+			memcpy(&tri[j][5], &data.normals[idx], sizeof(float3));
+			memcpy(&tri[j][8], &data.binormals[idx], sizeof(float3));
+			memcpy(&tri[j][11], &data.tangents[idx], sizeof(float3));
+		}
+		const size_t first = (size_t)(min_element(tri.begin(), tri.end()) - tri.begin());
+		triangles.push_back({{ tri[first], tri[(first + 1) % 3], tri[(first + 2) % 3] }});
+	}
+	sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+//! triangle weighted acmr of all sub-objects
+static float compute_acmr(const a2m_file::model_data& data, const size_t cache_size) {
+	float misses = 0.0f;
+	size_t triangle_count = 0;
+	for(unsigned int i = 0; i < data.object_count; i++) {
+		misses += mesh_optimizer::compute_acmr(data.indices[i], data.index_count[i], data.vertex_count, cache_size) *
+				  float(data.index_count[i]);
+		triangle_count += data.index_count[i];
+	}
+	return misses / float(triangle_count);
+}
+
+//! renders each sub-object (in draw order, back-face culled, depth tested) with orthographic projections from 26
+//! directions and returns the average number of shaded fragments per covered pixel
+static float compute_overdraw(const a2m_file::model_data& data) {
+	static constexpr int resolution = 256;
+	vector<float> depth_buffer(resolution * resolution);
+	size_t shaded = 0, covered = 0;
+	for(int dx = -1; dx <= 1; dx++) {
+		for(int dy = -1; dy <= 1; dy++) {
+			for(int dz = -1; dz <= 1; dz++) {
+				if(dx == 0 && dy == 0 && dz == 0) continue;
+				// the viewer looks along -dir, (u, v, dir) is right-handed -> front faces are ccw on screen
+				const float3 dir(float3(float(dx), float(dy), float(dz)).normalized());
+				const float3 u_axis(fabsf(dir.y) < 0.99f ? float3(0.0f, 1.0f, 0.0f).crossed(dir).normalized() :
+									float3(1.0f, 0.0f, 0.0f).crossed(dir).normalized());
+				const float3 v_axis(dir.crossed(u_axis));
+				const float extent = 1.5f;
+				const auto project = [&](const float3& pos) {
+					return float3((pos.dot(u_axis) / extent * 0.5f + 0.5f) * float(resolution),
+								  (pos.dot(v_axis) / extent * 0.5f + 0.5f) * float(resolution), pos.dot(dir));
+				};
+				
+				for(unsigned int obj = 0; obj < data.object_count; obj++) {
+					fill(depth_buffer.begin(), depth_buffer.end(), -numeric_limits<float>::max());
+					for(unsigned int i = 0; i < data.index_count[obj]; i++) {
+						const uint3& tri = data.indices[obj][i];
+						const float3 p0(project(data.vertices[tri.x])), p1(project(data.vertices[tri.y])), p2(project(data.vertices[tri.z]));
+						const float area = (p1.x - p0.x) * (p2.y - p0.y) - (p2.x - p0.x) * (p1.y - p0.y);
+						if(area <= 0.0f) continue;
+						const int x_min = std::max(0, (int)floorf(std::min(std::min(p0.x, p1.x), p2.x)));
+						const int x_max = std::min(resolution - 1, (int)ceilf(std::max(std::max(p0.x, p1.x), p2.x)));
+						const int y_min = std::max(0, (int)floorf(std::min(std::min(p0.y, p1.y), p2.y)));
+						const int y_max = std::min(resolution - 1, (int)ceilf(std::max(std::max(p0.y, p1.y), p2.y)));
+						for(int y = y_min; y <= y_max; y++) {
+							for(int x = x_min; x <= x_max; x++) {
+								const float px = float(x) + 0.5f, py = float(y) + 0.5f;
+								const float w0 = (p1.x - px) * (p2.y - py) - (p2.x - px) * (p1.y - py);
+								const float w1 = (p2.x - px) * (p0.y - py) - (p0.x - px) * (p2.y - py);
+								const float w2 = area - w0 - w1;
+								if(w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+								const float depth = (w0 * p0.z + w1 * p1.z + w2 * p2.z) / area;
+								float& stored_depth = depth_buffer[(size_t)(y * resolution + x)];
+								if(depth > stored_depth) {
+									if(stored_depth == -numeric_limits<float>::max()) covered++;
+									stored_depth = depth;
+									shaded++;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	return float(shaded) / float(std::max(covered, size_t(1)));
+}
+
+//! runs the mesh optimizer (with and without overdraw reduction) and checks that the triangle set doesn't change
+//! (same triangles with the same winding and vertex data, duplicates merged, unreferenced vertices removed, each
+//! sub-object in its own vertex range), that the acmr and overdraw improve and that the output is deterministic
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	mt19937 gen(42);
+	a2m_file::model_data input = make_model(gen);
+	
+	const float acmr_before = compute_acmr(input, 16), acmr_32_before = compute_acmr(input, 32);
+	const float overdraw_before = compute_overdraw(input);
+	cout << "input: " << input.vertex_count << " vertices, acmr " << acmr_before << " (cache 16) / " << acmr_32_before;
+	cout << " (cache 32), overdraw " << overdraw_before << endl;
+	
+	float acmr_cache_only = 0.0f, overdraw_cache_only = 0.0f;
+	for(const bool reduce_overdraw : { false, true }) {
+		a2m_file::model_data data = copy_model(input), data_2 = copy_model(input);
+		const auto start = chrono::steady_clock::now();
+		a2m_file::optimize(data, reduce_overdraw, "check");
+		const double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		a2m_file::optimize(data_2, reduce_overdraw, "check");
+		success &= check("deterministic", equal_models(data, data_2));
+		
+		// same triangles, each sub-object only references its own (contiguous) vertex range, which contains no unused,
+		// duplicate or foreign vertices
+		bool same_triangles = true, valid_ranges = true;
+		unsigned int next_min_index = 0;
+		for(unsigned int i = 0; i < data.object_count; i++) {
+			same_triangles &= (get_triangle_set(input, i) == get_triangle_set(data, i));
+			
+			valid_ranges &= (data.min_index[i] == next_min_index && data.min_index[i] <= data.max_index[i]);
+			vector<uint8_t> referenced(data.max_index[i] - data.min_index[i] + 1, 0);
+			for(unsigned int j = 0; j < data.index_count[i]; j++) {
+				for(size_t k = 0; k < 3; k++) {
+					const uint32_t idx = data.indices[i][j][k];
+					if(idx < data.min_index[i] || idx > data.max_index[i]) valid_ranges = false;
+					else referenced[idx - data.min_index[i]] = 1;
+				}
+			}
+			valid_ranges &= all_of(referenced.begin(), referenced.end(), [](const uint8_t& ref) { return ref != 0; });
+			// the input contains each vertex twice + 8 unreferenced vertices
+			valid_ranges &= ((input.max_index[i] - input.min_index[i] + 1 - 8) / 2 == referenced.size());
+			next_min_index = data.max_index[i] + 1;
+		}
+		valid_ranges &= (next_min_index == data.vertex_count);
+		success &= check("triangle set", same_triangles);
+		success &= check("vertex ranges", valid_ranges);
+		
+		const float acmr = compute_acmr(data, 16), acmr_32 = compute_acmr(data, 32);
+		const float overdraw = compute_overdraw(data);
+		cout << (reduce_overdraw ? "vertex cache + overdraw" : "vertex cache") << ": " << data.vertex_count << " vertices, acmr ";
+		cout << acmr << " (cache 16) / " << acmr_32 << " (cache 32), overdraw " << overdraw << " (" << time << "ms)" << endl;
+		success &= check("acmr", acmr < acmr_before * 0.5f && acmr_32 < acmr_32_before * 0.5f);
+		if(!reduce_overdraw) {
+			acmr_cache_only = acmr;
+			overdraw_cache_only = overdraw;
+		}
+		else {
+			// the cluster reordering trades a little acmr (threshold 1.05 + cache flushes at cluster boundaries)
+			success &= check("overdraw", overdraw <= overdraw_cache_only && overdraw - 1.0f < (overdraw_before - 1.0f) * 0.1f);
+			success &= check("acmr (overdraw)", acmr <= acmr_cache_only * 1.1f);
+		}
+		
+		data.clear();
+		data_2.clear();
+	}
+	input.clear();
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
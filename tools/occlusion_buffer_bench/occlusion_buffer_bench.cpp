@@ -0,0 +1,160 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/occlusion_buffer.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <random>
+
+// unit cube (-1 .. 1), 12 triangles
+static const float3 cube_vertices[8] {
+	{ -1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f },
+	{ -1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, 1.0f }, { -1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f },
+};
+static const uint3 cube_indices[12] {
+	{ 0, 2, 1 }, { 1, 2, 3 }, { 4, 5, 6 }, { 5, 7, 6 }, { 0, 1, 4 }, { 1, 5, 4 },
+	{ 2, 6, 3 }, { 3, 6, 7 }, { 0, 4, 2 }, { 2, 4, 6 }, { 1, 3, 5 }, { 3, 7, 5 },
+};
+
+static bool check(const char* name, const bool result, const bool expected) {
+	if(result != expected) {
+		cout << "FAILED: " << name << " (expected " << (expected ? "occluded" : "visible") << ")" << endl;
+		return false;
+	}
+	return true;
+}
+
+//! checks the occlusion test against a few known configurations (occluders in front of/behind/next to the occludees,
+//! occluders and occludees crossing the near plane, single- vs multi-threaded rasterization),
+//! then times rasterizing random occluders of increasing triangle counts and testing random occludees
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	const matrix4f mvpm(make_projection(2.0f, 0.1f, 1000.0f));
+	occlusion_buffer buffer(uint2(256, 128));
+	
+	// nothing rasterized -> nothing is occluded
+	buffer.begin(mvpm);
+	buffer.rasterize();
+	success &= check("empty buffer", buffer.is_occluded(float3(-1.0f, -1.0f, -20.0f), float3(1.0f, 1.0f, -18.0f)), false);
+	
+	// a 10 * 10 wall at z = -10 (as two triangles)
+	const float3 wall_vertices[4] {
+		{ -5.0f, -5.0f, 0.0f }, { 5.0f, -5.0f, 0.0f }, { -5.0f, 5.0f, 0.0f }, { 5.0f, 5.0f, 0.0f },
+	};
+	const uint3 wall_indices[2] { { 0, 1, 2 }, { 1, 3, 2 } };
+	buffer.begin(mvpm);
+	buffer.add_occluder(wall_vertices, 4, wall_indices, 2, matrix4f().translate(0.0f, 0.0f, -10.0f));
+	buffer.rasterize();
+	success &= check("behind the wall", buffer.is_occluded(float3(-1.0f, -1.0f, -20.0f), float3(1.0f, 1.0f, -18.0f)), true);
+	success &= check("in front of the wall", buffer.is_occluded(float3(-1.0f, -1.0f, -8.0f), float3(1.0f, 1.0f, -6.0f)), false);
+	success &= check("intersecting the wall", buffer.is_occluded(float3(-1.0f, -1.0f, -12.0f), float3(1.0f, 1.0f, -8.0f)), false);
+	success &= check("next to the wall", buffer.is_occluded(float3(12.0f, -1.0f, -20.0f), float3(14.0f, 1.0f, -18.0f)), false);
+	success &= check("partially behind the wall", buffer.is_occluded(float3(8.0f, -1.0f, -20.0f), float3(14.0f, 1.0f, -18.0f)), false);
+	success &= check("crossing the near plane", buffer.is_occluded(float3(-1.0f, -1.0f, -5.0f), float3(1.0f, 1.0f, 1.0f)), false);
+	success &= check("large box behind the wall", buffer.is_occluded(float3(-20.0f, -20.0f, -90.0f), float3(20.0f, 20.0f, -80.0f)), true);
+	
+	// a ground plane that crosses the near plane (-> must be clipped)
+	const float3 ground_vertices[4] {
+		{ -100.0f, -1.0f, 50.0f }, { 100.0f, -1.0f, 50.0f }, { -100.0f, -1.0f, -100.0f }, { 100.0f, -1.0f, -100.0f },
+	};
+	buffer.begin(mvpm);
+	buffer.add_occluder(ground_vertices, 4, wall_indices, 2, matrix4f());
+	buffer.rasterize();
+	success &= check("below the ground", buffer.is_occluded(float3(-1.0f, -5.0f, -20.0f), float3(1.0f, -3.0f, -18.0f)), true);
+	success &= check("above the ground", buffer.is_occluded(float3(-1.0f, 1.0f, -20.0f), float3(1.0f, 3.0f, -18.0f)), false);
+	success &= check("on the ground", buffer.is_occluded(float3(-1.0f, -2.0f, -20.0f), float3(1.0f, 0.0f, -18.0f)), false);
+	
+	// random occluders: multi-threaded rasterization must produce exactly the same depth buffer
+	mt19937 gen(42);
+	uniform_real_distribution<float> xy_dist(-40.0f, 40.0f), z_dist(-100.0f, -5.0f), size_dist(0.5f, 4.0f);
+	const size_t max_occluder_count = 10000;
+	vector<matrix4f> occluder_worlds(max_occluder_count);
+	for(auto& world : occluder_worlds) {
+		const float scale = size_dist(gen);
+		world = matrix4f().scale(scale, scale, scale) * matrix4f().translate(xy_dist(gen), xy_dist(gen) * 0.5f, z_dist(gen));
+	}
+	vector<float> single_threaded_depth;
+	for(const size_t worker_count : { 1u, 4u }) {
+		buffer.set_worker_count(worker_count);
+		buffer.begin(mvpm);
+		for(size_t i = 0; i < 1000; i++) {
+			buffer.add_occluder(cube_vertices, 8, cube_indices, 12, occluder_worlds[i]);
+		}
+		buffer.rasterize();
+		if(worker_count == 1) single_threaded_depth = buffer.get_depth();
+		else if(single_threaded_depth != buffer.get_depth()) {
+			cout << "FAILED: multi-threaded depth buffer differs from the single-threaded one" << endl;
+			success = false;
+		}
+	}
+	
+	// hi-z: each texel must be the min of the 2x2 texels below it
+	for(size_t level = 1; level < buffer.get_level_count(); level++) {
+		const auto& src = buffer.get_level(level - 1);
+		const auto& dst = buffer.get_level(level);
+		const uint2 src_size(buffer.get_level_size(level - 1)), dst_size(buffer.get_level_size(level));
+		for(uint32_t y = 0; y < src_size.y; y++) {
+			for(uint32_t x = 0; x < src_size.x; x++) {
+				if(dst[(y / 2) * dst_size.x + (x / 2)] > src[y * src_size.x + x]) {
+					cout << "FAILED: hi-z level " << level << " is not conservative" << endl;
+					success = false;
+					y = src_size.y;
+					break;
+				}
+			}
+		}
+	}
+	
+	// benchmark: rasterization of increasing amounts of occluder triangles, then occlusion tests of random boxes
+	vector<float3> test_min(100000), test_max(100000);
+	for(size_t i = 0; i < test_min.size(); i++) {
+		const float3 center(xy_dist(gen), xy_dist(gen) * 0.5f, z_dist(gen));
+		const float3 half_extent(size_dist(gen) * 0.5f);
+		test_min[i] = center - half_extent;
+		test_max[i] = center + half_extent;
+	}
+	for(const size_t occluder_count : { 100u, 1000u, 10000u }) {
+		for(const size_t worker_count : { 1u, 0u }) {
+			buffer.set_worker_count(worker_count);
+			double raster_time = 0.0;
+			for(size_t run = 0; run < 3; run++) {
+				const auto start = chrono::steady_clock::now();
+				buffer.begin(mvpm);
+				for(size_t i = 0; i < occluder_count; i++) {
+					buffer.add_occluder(cube_vertices, 8, cube_indices, 12, occluder_worlds[i]);
+				}
+				buffer.rasterize();
+				raster_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			}
+			
+			const auto test_start = chrono::steady_clock::now();
+			size_t occluded_count = 0;
+			for(size_t i = 0; i < test_min.size(); i++) {
+				if(buffer.is_occluded(test_min[i], test_max[i])) occluded_count++;
+			}
+			const double test_time = chrono::duration<double, milli>(chrono::steady_clock::now() - test_start).count();
+			
+			cout << occluder_count * 12 << " triangles (" << buffer.get_stats().triangle_count << " rasterized), ";
+			cout << (worker_count == 1 ? "single-threaded" : "threaded") << ": " << raster_time << "ms, ";
+			cout << test_min.size() << " tests: " << test_time << "ms (" << occluded_count << " occluded)" << endl;
+		}
+	}
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
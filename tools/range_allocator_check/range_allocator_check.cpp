@@ -0,0 +1,109 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rendering/range_allocator.hpp"
+#include <chrono>
+#include <random>
+
+//! runs random allocate/free/grow/defragment sequences against range_allocator and checks after each step that the
+//! allocator is consistent and that no two live allocations overlap (defragment must also keep their contents,
+//! which is simulated by moving a per-element tag array according to the returned relocations)
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	mt19937 gen(42);
+	bool success = true;
+	const auto fail = [&success](const string& msg) {
+		if(success) cout << "FAILED: " << msg << endl;
+		success = false;
+	};
+	
+	const auto start = chrono::steady_clock::now();
+	size_t total_ops = 0, total_defrags = 0;
+	for(size_t run = 0; run < 100 && success; run++) {
+		range_allocator allocator(1024);
+		vector<range_allocator::handle> live;
+		// content simulation: every element of an allocation is tagged with its handle
+		vector<uint32_t> memory(1024, range_allocator::invalid_handle);
+		
+		uniform_int_distribution<size_t> size_dist(0, 96), op_dist(0, 99);
+		for(size_t op = 0; op < 2000 && success; op++, total_ops++) {
+			const size_t op_type = op_dist(gen);
+			if(op_type < 55) {
+				const size_t size = size_dist(gen);
+				auto alloc = allocator.allocate(size);
+				if(alloc == range_allocator::invalid_handle) {
+					if(allocator.get_largest_free_range() >= size) fail("allocation failed despite enough space");
+					// grow like the geometry arena does
+					const size_t capacity = std::max(allocator.get_capacity() * 2, allocator.get_used_size() + size);
+					allocator.grow(capacity);
+					memory.resize(capacity, range_allocator::invalid_handle);
+					alloc = allocator.allocate(size);
+					if(alloc == range_allocator::invalid_handle) fail("allocation failed after growing");
+				}
+				if(alloc != range_allocator::invalid_handle) {
+					const size_t offset = allocator.get_offset(alloc);
+					for(size_t i = offset; i < offset + size; i++) {
+						if(memory[i] != range_allocator::invalid_handle) fail("overlapping allocation");
+						memory[i] = alloc;
+					}
+					live.push_back(alloc);
+				}
+			}
+			else if(op_type < 95 && !live.empty()) {
+				uniform_int_distribution<size_t> idx_dist(0, live.size() - 1);
+				const size_t idx = idx_dist(gen);
+				const auto alloc = live[idx];
+				const size_t offset = allocator.get_offset(alloc);
+				for(size_t i = offset; i < offset + allocator.get_size(alloc); i++) {
+					memory[i] = range_allocator::invalid_handle;
+				}
+				allocator.free(alloc);
+				live[idx] = live.back();
+				live.pop_back();
+			}
+			else {
+				total_defrags++;
+				const size_t used = allocator.get_used_size();
+				vector<uint32_t> new_memory(memory.size(), range_allocator::invalid_handle);
+				for(const auto& reloc : allocator.defragment()) {
+					if(reloc.dst_offset > reloc.src_offset) fail("defragment moved an allocation back");
+					copy_n(&memory[reloc.src_offset], reloc.size, &new_memory[reloc.dst_offset]);
+				}
+				memory.swap(new_memory);
+				if(allocator.get_free_range_count() > 1) fail("more than one free range after defragment");
+				if(allocator.get_used_size() != used) fail("defragment changed the used size");
+			}
+			
+			if(!allocator.validate()) fail("inconsistent allocator state");
+			if(allocator.get_allocation_count() != live.size()) fail("wrong allocation count");
+			for(const auto& alloc : live) {
+				const size_t offset = allocator.get_offset(alloc);
+				for(size_t i = offset; i < offset + allocator.get_size(alloc); i++) {
+					if(memory[i] != alloc) {
+						fail("allocation contents were lost");
+						break;
+					}
+				}
+			}
+		}
+	}
+	
+	const double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	cout << total_ops << " operations (" << total_defrags << " defragmentations) in " << time << "ms: ";
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,88 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rendering/render_queue.hpp"
+#include <chrono>
+#include <random>
+
+//! fills render queues of increasing size with random render states (a realistic amount of distinct shaders, materials
+//! and meshes), then times building + sorting the queue against std::stable_sort and a plain submission loop over the
+//! items
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	mt19937 gen(42);
+	uniform_int_distribution<uint32_t> shader_dist(0, 31), material_dist(0, 1023), mesh_dist(0, 4095);
+	uniform_real_distribution<float> depth_dist(0.0f, 1.0f);
+	bool success = true;
+	render_queue queue;
+	for(const size_t item_count : { 10000u, 100000u, 1000000u }) {
+		vector<uint64_t> keys(item_count);
+		for(auto& key : keys) {
+			key = render_queue::make_key(0, shader_dist(gen), material_dist(gen), mesh_dist(gen), depth_dist(gen));
+		}
+		
+		// push + radix sort (queue memory is reused, as in the scene)
+		double queue_time = 0.0;
+		for(size_t run = 0; run < 2; run++) {
+			const auto start = chrono::steady_clock::now();
+			queue.clear();
+			queue.reserve(item_count);
+			for(size_t i = 0; i < item_count; i++) {
+				queue.push(keys[i], nullptr, (uint32_t)i);
+			}
+			queue.sort();
+			queue_time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+		}
+		
+		// reference: comparison sort of the same data
+		vector<pair<uint64_t, uint32_t>> ref_keys(item_count);
+		const auto ref_start = chrono::steady_clock::now();
+		for(size_t i = 0; i < item_count; i++) {
+			ref_keys[i] = make_pair(keys[i], (uint32_t)i);
+		}
+		std::stable_sort(ref_keys.begin(), ref_keys.end(), [](const pair<uint64_t, uint32_t>& a,
+															  const pair<uint64_t, uint32_t>& b) {
+			return a.first < b.first;
+		});
+		const double ref_time = chrono::duration<double, milli>(chrono::steady_clock::now() - ref_start).count();
+		
+		// submission: walk the sorted items and count shader/material changes (what the scene would rebind)
+		const auto submit_start = chrono::steady_clock::now();
+		size_t state_changes = 0;
+		uint64_t prev_state = ~0ull;
+		for(size_t i = 0; i < queue.size(); i++) {
+			const uint64_t state = queue.get_key(i) >> (render_queue::mesh_bits + render_queue::depth_bits);
+			if(state != prev_state) {
+				state_changes++;
+				prev_state = state;
+			}
+		}
+		const double submit_time = chrono::duration<double, milli>(chrono::steady_clock::now() - submit_start).count();
+		
+		// verify: same order as the stable reference sort
+		bool match = (queue.size() == item_count);
+		for(size_t i = 0; match && i < item_count; i++) {
+			if(queue.get_key(i) != ref_keys[i].first || queue[i].sub_object != ref_keys[i].second) match = false;
+		}
+		if(!match) success = false;
+		
+		cout << item_count << " items: radix " << queue_time << "ms, std::stable_sort " << ref_time << "ms, ";
+		cout << "submission " << submit_time << "ms (" << state_changes << " state changes)";
+		cout << (match ? "" : " - MISMATCH") << endl;
+	}
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,114 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "rendering/extensions.hpp"
+#include "rendering/renderer/shader_object.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+
+typedef shader_object::internal_shader_object::shader_variable shader_variable;
+typedef shader_object::internal_shader_object::variable_table variable_table;
+
+//! uniforms of a light pass program (names, locations and samplers as the gl would report them)
+static const char* uniform_names[] {
+	"mvpm", "imvm", "screen_size", "projection_ab", "cam_position", "light_position", "light_color",
+	"light_radius", "light_inv_radius", "light_count", "normal_nearest_buffer", "depth_buffer",
+	"specular_buffer", "shadow_map", "light_aux", "shadow_matrix", "fog_color", "time",
+};
+static const shader_var_name hashed_names[] {
+	A2E_SHADER_VAR("mvpm"), A2E_SHADER_VAR("imvm"), A2E_SHADER_VAR("screen_size"), A2E_SHADER_VAR("projection_ab"),
+	A2E_SHADER_VAR("cam_position"), A2E_SHADER_VAR("light_position"), A2E_SHADER_VAR("light_color"),
+	A2E_SHADER_VAR("light_radius"), A2E_SHADER_VAR("light_inv_radius"), A2E_SHADER_VAR("light_count"),
+	A2E_SHADER_VAR("normal_nearest_buffer"), A2E_SHADER_VAR("depth_buffer"), A2E_SHADER_VAR("specular_buffer"),
+	A2E_SHADER_VAR("shadow_map"), A2E_SHADER_VAR("light_aux"), A2E_SHADER_VAR("shadow_matrix"),
+	A2E_SHADER_VAR("fog_color"), A2E_SHADER_VAR("time"),
+};
+static constexpr size_t uniform_count = sizeof(uniform_names) / sizeof(uniform_names[0]);
+static_assert(uniform_count == sizeof(hashed_names) / sizeof(hashed_names[0]), "name lists differ");
+
+//! the uniforms that are set per light in the light pass (-> the lookups that are timed)
+static constexpr size_t per_light_uniforms[] { 5, 6, 7, 8 };
+
+//! builds the variable map of a light pass program and its flat lookup table, checks that both return the same
+//! location (and sampler unit) for every name and that an unknown name is not found, then times the per-light
+//! uniform lookups: map<string>::find (what the shaders used to do) vs. the table with runtime and compile time hashes
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	map<string, shader_variable> uniforms;
+	map<string, size_t> samplers;
+	for(size_t i = 0; i < uniform_count; i++) {
+		// locations aren't dense in practice (arrays, inactive uniforms), start at 0 so that a location 0 bug shows
+		const string name = uniform_names[i];
+		const bool sampler = (name.find("buffer") != string::npos || name == "shadow_map");
+		uniforms.insert(make_pair(name, shader_variable(i * 3, 1, sampler ? GL_SAMPLER_2D : GL_FLOAT_VEC4)));
+		if(sampler) samplers.insert(make_pair(name, samplers.size()));
+	}
+	variable_table table;
+	table.build(uniforms, &samplers);
+	
+	bool success = true;
+	for(size_t i = 0; i < uniform_count; i++) {
+		const auto& map_var = uniforms.find(uniform_names[i])->second;
+		const auto entry = table.find(uniform_names[i]);
+		const auto hashed_entry = table.find(hashed_names[i]);
+		const auto sampler_iter = samplers.find(uniform_names[i]);
+		const size_t sampler = (sampler_iter != samplers.end() ? sampler_iter->second : 0);
+		success &= check(uniform_names[i], (entry != nullptr && entry == hashed_entry &&
+											entry->location == map_var.location && entry->sampler == sampler &&
+											entry->type == (GLenum)map_var.type));
+	}
+	success &= check("unknown name", (table.find("light_colour") == nullptr && uniforms.count("light_colour") == 0));
+	success &= check("unknown name (compile time hash)", table.find(A2E_SHADER_VAR("light_colour")) == nullptr);
+	success &= check("empty table", variable_table().find("mvpm") == nullptr);
+	
+	// 4 uniforms per light, as in the light pass
+	static constexpr size_t iterations = 2000000;
+	size_t map_sum = 0, runtime_sum = 0, compile_time_sum = 0;
+	
+	const auto map_start = chrono::steady_clock::now();
+	for(size_t i = 0; i < iterations; i++) {
+		for(const auto& idx : per_light_uniforms) {
+			map_sum += uniforms.find(uniform_names[idx])->second.location;
+		}
+	}
+	const double map_time = chrono::duration<double, milli>(chrono::steady_clock::now() - map_start).count();
+	
+	const auto runtime_start = chrono::steady_clock::now();
+	for(size_t i = 0; i < iterations; i++) {
+		for(const auto& idx : per_light_uniforms) {
+			runtime_sum += table.find(uniform_names[idx])->location;
+		}
+	}
+	const double runtime_time = chrono::duration<double, milli>(chrono::steady_clock::now() - runtime_start).count();
+	
+	const auto compile_time_start = chrono::steady_clock::now();
+	for(size_t i = 0; i < iterations; i++) {
+		for(const auto& idx : per_light_uniforms) {
+			compile_time_sum += table.find(hashed_names[idx])->location;
+		}
+	}
+	const double compile_time_time = chrono::duration<double, milli>(chrono::steady_clock::now() - compile_time_start).count();
+	success &= check("lookup results", (map_sum == runtime_sum && map_sum == compile_time_sum));
+	
+	const double lookups = double(iterations * (sizeof(per_light_uniforms) / sizeof(per_light_uniforms[0])));
+	cout << "map<string>::find: " << (map_time * 1000000.0 / lookups) << "ns/lookup" << endl;
+	cout << "table, runtime hash: " << (runtime_time * 1000000.0 / lookups) << "ns/lookup" << endl;
+	cout << "table, A2E_SHADER_VAR: " << (compile_time_time * 1000000.0 / lookups) << "ns/lookup" << endl;
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
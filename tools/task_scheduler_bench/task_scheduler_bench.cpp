@@ -0,0 +1,168 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "task_scheduler.hpp"
+#include "../tools_common.hpp"
+#include <chrono>
+#include <cmath>
+
+// some arithmetic that can't be optimized away (~ the cost of a model matrix/aabb update)
+static float work_item(const size_t i) {
+	float val = float(i);
+	for(size_t j = 0; j < 64; j++) {
+		val = sqrt(val * 1.0001f + float(j));
+	}
+	return val;
+}
+
+//! checks fork/join, parallel_for and task graphs for all worker counts from 0 (serial) to hardware threads,
+//! checks that the serial mode executes everything in submission order,
+//! then times a parallel_for workload for 1 to hardware threads
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	const size_t hw_threads = max(size_t(thread::hardware_concurrency()), size_t(1));
+	
+	// serial mode: submission order, graph nodes in depth-first dependency order
+	{
+		task_scheduler scheduler(0);
+		vector<size_t> order;
+		task_scheduler::task_group group(scheduler);
+		for(size_t i = 0; i < 8; i++) {
+			group.run([&order, i] { order.emplace_back(i); });
+		}
+		group.wait();
+		success &= check("serial task order", order == vector<size_t> { 0, 1, 2, 3, 4, 5, 6, 7 });
+		
+		order.clear();
+		scheduler.parallel_for(10, 3, [&order](const size_t begin, const size_t end) {
+			order.emplace_back(begin);
+			order.emplace_back(end);
+		});
+		success &= check("serial parallel_for chunks", order == vector<size_t> { 3, 6, 6, 9, 9, 10, 0, 3 });
+		
+		order.clear();
+		task_scheduler::task_graph graph;
+		const auto a = graph.add([&order] { order.emplace_back(0); });
+		const auto b = graph.add([&order] { order.emplace_back(1); }, { a });
+		const auto c = graph.add([&order] { order.emplace_back(2); }, { a });
+		graph.add([&order] { order.emplace_back(3); }, { b, c });
+		graph.run(scheduler);
+		success &= check("serial graph order", order == vector<size_t> { 0, 1, 2, 3 });
+	}
+	
+	for(size_t worker_count = 0; worker_count <= max(hw_threads, size_t(4)); worker_count++) {
+		task_scheduler scheduler(worker_count);
+		
+		// parallel_for: every index is visited exactly once, the result is independent of the worker count
+		vector<atomic<uint32_t>> visits(100003);
+		for(auto& visit : visits) visit = 0;
+		vector<float> results(visits.size());
+		scheduler.parallel_for(visits.size(), 1000, [&visits, &results](const size_t begin, const size_t end) {
+			for(size_t i = begin; i < end; i++) {
+				visits[i]++;
+				results[i] = work_item(i);
+			}
+		});
+		bool all_visited = true;
+		for(const auto& visit : visits) all_visited &= (visit == 1);
+		success &= check("parallel_for coverage", all_visited);
+		for(size_t i = 0; i < results.size(); i += 997) {
+			success &= check("parallel_for results", results[i] == work_item(i));
+		}
+		
+		// nested fork/join (recursive sum of 0 .. 2^16 - 1)
+		function<uint64_t(const uint64_t, const uint64_t)> sum = [&](const uint64_t begin, const uint64_t end) -> uint64_t {
+			if(end - begin <= 64) {
+				uint64_t ret = 0;
+				for(uint64_t i = begin; i < end; i++) ret += i;
+				return ret;
+			}
+			uint64_t left = 0, right = 0;
+			const uint64_t mid = (begin + end) / 2;
+			task_scheduler::task_group group(scheduler);
+			group.run([&] { left = sum(begin, mid); });
+			right = sum(mid, end);
+			group.wait();
+			return left + right;
+		};
+		success &= check("nested fork/join", sum(0, 65536) == (65536ull * 65535ull) / 2ull);
+		
+		// graph: a diamond chain, each node must start after all of its dependencies finished
+		task_scheduler::task_graph graph;
+		const size_t layer_count = 32, layer_width = 8;
+		vector<atomic<uint32_t>> finished(layer_count * layer_width);
+		atomic<uint32_t> order_errors { 0 };
+		vector<task_scheduler::task_graph::node> prev_layer;
+		for(size_t layer = 0; layer < layer_count; layer++) {
+			vector<task_scheduler::task_graph::node> cur_layer;
+			for(size_t i = 0; i < layer_width; i++) {
+				const size_t idx = layer * layer_width + i;
+				auto func = [&finished, &order_errors, layer, idx, layer_width] {
+					if(layer > 0) {
+						for(size_t j = 0; j < layer_width; j += 3) {
+							if(finished[(layer - 1) * layer_width + j] == 0) order_errors++;
+						}
+					}
+					work_item(idx);
+					finished[idx] = 1;
+				};
+				if(prev_layer.empty()) cur_layer.emplace_back(graph.add(func));
+				else {
+					// depend on every third node of the previous layer
+					cur_layer.emplace_back(graph.add(func, { prev_layer[0], prev_layer[3], prev_layer[6] }));
+				}
+			}
+			prev_layer = cur_layer;
+		}
+		for(size_t run = 0; run < 3; run++) {
+			for(auto& fin : finished) fin = 0;
+			graph.run(scheduler);
+			bool all_finished = true;
+			for(const auto& fin : finished) all_finished &= (fin == 1);
+			success &= check("graph completion", all_finished);
+		}
+		success &= check("graph dependency order", order_errors == 0);
+	}
+	
+	// scaling: workers + the calling thread
+	const size_t item_count = 1u << 20;
+	vector<float> data(item_count);
+	double single_time = 0.0;
+	for(size_t thread_count = 1; thread_count <= hw_threads; thread_count++) {
+		task_scheduler scheduler(thread_count - 1);
+		double best_time = 1e30;
+		for(size_t run = 0; run < 5; run++) {
+			const auto start = chrono::steady_clock::now();
+			scheduler.parallel_for(item_count, 4096, [&data](const size_t begin, const size_t end) {
+				for(size_t i = begin; i < end; i++) {
+					data[i] = work_item(i);
+				}
+			});
+			best_time = min(best_time, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+		}
+		if(thread_count == 1) single_time = best_time;
+		cout << thread_count << " thread(s): " << item_count << " items in " << best_time << "ms (speedup ";
+		cout << single_time / best_time << "x)" << endl;
+	}
+	if(hw_threads == 1) {
+		cout << "NOTE: only one hardware thread available, no scaling can be measured" << endl;
+	}
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}
@@ -0,0 +1,45 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __A2E_TOOLS_COMMON_HPP__
+#define __A2E_TOOLS_COMMON_HPP__
+
+#include "global.hpp"
+#include <floor/math/matrix4.hpp>
+
+//! helpers that are shared by the tools (include as "../tools_common.hpp")
+
+//! prints "FAILED: <name>" if the check failed, returns the result
+inline bool check(const char* name, const bool result) {
+	if(!result) cout << "FAILED: " << name << endl;
+	return result;
+}
+
+//! gl style perspective projection with a 90 degrees vertical fov (camera at the origin, looking down -z)
+inline matrix4f make_projection(const float aspect, const float near_plane, const float far_plane) {
+	matrix4f proj;
+	for(auto& val : proj.data) val = 0.0f;
+	proj.data[0] = 1.0f / aspect;
+	proj.data[5] = 1.0f;
+	proj.data[10] = (far_plane + near_plane) / (near_plane - far_plane);
+	proj.data[11] = -1.0f;
+	proj.data[14] = (2.0f * far_plane * near_plane) / (near_plane - far_plane);
+	return proj;
+}
+
+#endif
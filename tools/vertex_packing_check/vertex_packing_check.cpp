@@ -0,0 +1,191 @@
+/*
+ *  Albion 2 Engine "light"
+ *  Copyright (C) 2004 - 2014 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License only.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scene/model/vertex_packing.hpp"
+#include "../tools_common.hpp"
+#include <random>
+
+//! max error of a 10-bit snorm component (rounding to the nearest multiple of 1/511)
+static constexpr float snorm_max_error = 0.5f / 511.0f + 1.0e-6f;
+//! max error of a half float tex coord within [-max_half_tex_coord, max_half_tex_coord] (half ulp at [2, 4): 2^-10)
+static constexpr float half_tex_coord_max_error = 1.0f / 1024.0f;
+
+static float max_component_error(const float3& a, const float3& b) {
+	return std::max(std::max(fabsf(a.x - b.x), fabsf(a.y - b.y)), fabsf(a.z - b.z));
+}
+
+static float3 random_unit_vector(mt19937& gen) {
+	normal_distribution<float> dist(0.0f, 1.0f);
+	for(;;) {
+		const float3 vec(dist(gen), dist(gen), dist(gen));
+		if(vec.length() > 1.0e-3f) return vec.normalized();
+	}
+}
+
+//! true if no other finite half float is closer to val than the converted one (-> round to nearest)
+static bool is_nearest_half(const float& val, const uint16_t& half) {
+	const double error = fabs(double(vertex_packing::half_to_float(half)) - double(val));
+	const uint16_t magnitude = half & 0x7FFFu, sign = half & 0x8000u;
+	if(magnitude > 0 &&
+	   fabs(double(vertex_packing::half_to_float((uint16_t)(sign | (magnitude - 1u)))) - double(val)) < error) {
+		return false;
+	}
+	if(magnitude < 0x7BFFu &&
+	   fabs(double(vertex_packing::half_to_float((uint16_t)(sign | (magnitude + 1u)))) - double(val)) < error) {
+		return false;
+	}
+	return true;
+}
+
+//! checks the 10:10:10:2 snorm normal/binormal/tangent packing and the half float tex coord packing against
+//! their error bounds, the float <-> half conversion (exact round trips, round to nearest even, overflow,
+//! denormals) and that the compact interleaved vertex layout reads back within the same bounds
+int main(int argc floor_unused, char* argv[] floor_unused) {
+	bool success = true;
+	mt19937 gen(42);
+	const size_t sample_count = 1000000;
+	
+	// snorm 10:10:10:2
+	{
+		const auto exact = vertex_packing::unpack_snorm_10_10_10_2(vertex_packing::pack_snorm_10_10_10_2(float3(1.0f, -1.0f, 0.0f)));
+		success &= check("snorm exact values", exact.x == 1.0f && exact.y == -1.0f && exact.z == 0.0f);
+		const auto clamped = vertex_packing::unpack_snorm_10_10_10_2(vertex_packing::pack_snorm_10_10_10_2(float3(2.0f, -3.0f, 0.5f)));
+		success &= check("snorm clamping", clamped.x == 1.0f && clamped.y == -1.0f && fabsf(clamped.z - 0.5f) <= snorm_max_error);
+		
+		float max_error = 0.0f, max_length_error = 0.0f;
+		bool w_zero = true;
+		for(size_t i = 0; i < sample_count; i++) {
+			const float3 vec(random_unit_vector(gen));
+			const uint32_t packed = vertex_packing::pack_snorm_10_10_10_2(vec);
+			const float3 unpacked(vertex_packing::unpack_snorm_10_10_10_2(packed));
+			max_error = std::max(max_error, max_component_error(vec, unpacked));
+			max_length_error = std::max(max_length_error, fabsf(unpacked.length() - 1.0f));
+			w_zero &= ((packed >> 30u) == 0u);
+		}
+		cout << "snorm 10:10:10:2: max component error " << max_error << " (bound " << snorm_max_error;
+		cout << "), max length error " << max_length_error << endl;
+		success &= check("snorm component error", max_error <= snorm_max_error);
+		success &= check("snorm length error", max_length_error <= sqrtf(3.0f) * snorm_max_error);
+		success &= check("snorm w", w_zero);
+	}
+	
+	// half float: all halves convert back exactly, float -> half rounds to the nearest half
+	{
+		bool round_trip = true;
+		for(uint32_t half = 0; half <= 0xFFFFu; half++) {
+			const float val = vertex_packing::half_to_float((uint16_t)half);
+			const uint16_t converted = vertex_packing::float_to_half(val);
+			if((half & 0x7C00u) == 0x7C00u && (half & 0x3FFu) != 0) {
+				round_trip &= (val != val && (converted & 0x7C00u) == 0x7C00u && (converted & 0x3FFu) != 0); // nan
+			}
+			else round_trip &= (converted == half);
+		}
+		success &= check("half round trip", round_trip);
+		
+		success &= check("half round to even (down)", vertex_packing::float_to_half(1.0f + 1.0f / 2048.0f) == 0x3C00u);
+		success &= check("half round to even (up)", vertex_packing::float_to_half(1.0f + 3.0f / 2048.0f) == 0x3C02u);
+		success &= check("half max", vertex_packing::float_to_half(65519.0f) == 0x7BFFu);
+		success &= check("half overflow", vertex_packing::float_to_half(65520.0f) == 0x7C00u &&
+						 vertex_packing::float_to_half(-1.0e6f) == 0xFC00u);
+		success &= check("half min denormal", vertex_packing::float_to_half(ldexpf(1.0f, -24)) == 0x0001u);
+		success &= check("half denormal round to even", vertex_packing::float_to_half(ldexpf(1.0f, -25)) == 0x0000u &&
+						 vertex_packing::float_to_half(ldexpf(1.5f, -25)) == 0x0001u &&
+						 vertex_packing::float_to_half(ldexpf(3.0f, -25)) == 0x0002u);
+		success &= check("half signed zero", vertex_packing::float_to_half(-0.0f) == 0x8000u);
+		
+		// random values over the whole finite half range (log distributed) -> nearest half
+		uniform_real_distribution<float> exp_dist(-26.0f, 15.99f), sign_dist(0.0f, 1.0f);
+		bool nearest = true;
+		for(size_t i = 0; i < sample_count; i++) {
+			const float val = exp2f(exp_dist(gen)) * (sign_dist(gen) < 0.5f ? -1.0f : 1.0f);
+			nearest &= is_nearest_half(val, vertex_packing::float_to_half(val));
+		}
+		success &= check("half round to nearest", nearest);
+		
+		// tex coords within the half range of the compact format
+		uniform_real_distribution<float> tex_coord_dist(-vertex_packing::max_half_tex_coord, vertex_packing::max_half_tex_coord);
+		float max_error = 0.0f;
+		for(size_t i = 0; i < sample_count; i++) {
+			const float val = (i < 2 ? (i == 0 ? -1.0f : 1.0f) * vertex_packing::max_half_tex_coord : tex_coord_dist(gen));
+			max_error = std::max(max_error, fabsf(vertex_packing::half_to_float(vertex_packing::float_to_half(val)) - val));
+		}
+		cout << "half tex coords: max error " << max_error << " (bound " << half_tex_coord_max_error << ")" << endl;
+		success &= check("half tex coord error", max_error <= half_tex_coord_max_error);
+	}
+	
+	// compact interleaved vertices (half and float tex coords)
+	success &= check("compact stride", vertex_packing::compact_stride(true) == 28 && vertex_packing::compact_stride(false) == 32);
+	for(const bool half_tex_coords : { true, false }) {
+		const size_t stride = vertex_packing::compact_stride(half_tex_coords);
+		const size_t vertex_count = 100000;
+		uniform_real_distribution<float> pos_dist(-1000.0f, 1000.0f);
+		uniform_real_distribution<float> tex_coord_dist(-vertex_packing::max_half_tex_coord, vertex_packing::max_half_tex_coord);
+		vector<float3> positions(vertex_count), normals(vertex_count), binormals(vertex_count), tangents(vertex_count);
+		vector<float2> tex_coords(vertex_count);
+		for(size_t i = 0; i < vertex_count; i++) {
+			positions[i] = float3(pos_dist(gen), pos_dist(gen), pos_dist(gen));
+			normals[i] = random_unit_vector(gen);
+			binormals[i] = random_unit_vector(gen);
+			tangents[i] = random_unit_vector(gen);
+			tex_coords[i] = float2(tex_coord_dist(gen), tex_coord_dist(gen));
+		}
+		
+		// one extra vertex worth of guard bytes: each vertex must only write its own stride
+		vector<uint8_t> vertex_data((vertex_count + 1) * stride, 0xCD);
+		for(size_t i = 0; i < vertex_count; i++) {
+			vertex_packing::pack_compact_vertex(&vertex_data[i * stride], positions[i], normals[i], binormals[i],
+												tangents[i], tex_coords[i], half_tex_coords);
+		}
+		success &= check("compact vertex size", all_of(vertex_data.begin() + (ptrdiff_t)(vertex_count * stride), vertex_data.end(),
+													   [](const uint8_t& byte) { return byte == 0xCD; }));
+		
+		// read back like the gl vertex fetch does
+		bool positions_exact = true;
+		float max_frame_error = 0.0f, max_tex_coord_error = 0.0f;
+		for(size_t i = 0; i < vertex_count; i++) {
+			const uint8_t* vertex = &vertex_data[i * stride];
+			float3 position;
+			uint32_t packed_frame[3];
+			memcpy(&position, vertex, sizeof(float3));
+			memcpy(packed_frame, vertex + vertex_packing::compact_normal_offset, sizeof(packed_frame));
+			positions_exact &= (memcmp(&position, &positions[i], sizeof(float3)) == 0);
+			max_frame_error = std::max(max_frame_error, max_component_error(normals[i], vertex_packing::unpack_snorm_10_10_10_2(packed_frame[0])));
+			max_frame_error = std::max(max_frame_error, max_component_error(binormals[i], vertex_packing::unpack_snorm_10_10_10_2(packed_frame[1])));
+			max_frame_error = std::max(max_frame_error, max_component_error(tangents[i], vertex_packing::unpack_snorm_10_10_10_2(packed_frame[2])));
+			
+			float2 tex_coord;
+			if(half_tex_coords) {
+				uint16_t packed_tex_coord[2];
+				memcpy(packed_tex_coord, vertex + vertex_packing::compact_tex_coord_offset, sizeof(packed_tex_coord));
+				tex_coord = float2(vertex_packing::half_to_float(packed_tex_coord[0]), vertex_packing::half_to_float(packed_tex_coord[1]));
+			}
+			else memcpy(&tex_coord, vertex + vertex_packing::compact_tex_coord_offset, sizeof(float2));
+			max_tex_coord_error = std::max(max_tex_coord_error, std::max(fabsf(tex_coord.x - tex_coords[i].x),
+																		 fabsf(tex_coord.y - tex_coords[i].y)));
+		}
+		cout << "compact vertices (" << (half_tex_coords ? "half" : "float") << " tex coords, " << stride << " bytes): ";
+		cout << "max normal/binormal/tangent error " << max_frame_error << ", max tex coord error " << max_tex_coord_error << endl;
+		success &= check("compact positions", positions_exact);
+		success &= check("compact normal/binormal/tangent error", max_frame_error <= snorm_max_error);
+		success &= check(half_tex_coords ? "compact tex coord error (half)" : "compact tex coord error (float)",
+						 max_tex_coord_error <= (half_tex_coords ? half_tex_coord_max_error : 0.0f));
+	}
+	
+	cout << (success ? "ok" : "FAILED") << endl;
+	return (success ? 0 : 1);
+}